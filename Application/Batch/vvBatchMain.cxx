@@ -0,0 +1,528 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vvBatchMain.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+// Headless export of a pcap recording, for batch jobs on servers without
+// display. Runs the same reader and writers as the application exports:
+//
+//   lidarview-batch --pcap rec.pcap --calibration VLP-16.xml
+//                   --output rec.las [--first 0] [--last -1] [--stride 1]
+//                   [--transform raw|applied] [--sensor-position x y z]
+//                   [--sensor-rotation roll pitch yaw] [--threads 0]
+
+#include "LidarCaptureConverter.h"
+#include "LidarLASWriter.h"
+#include "LidarPointCloudWriter.h"
+#include "LidarTaskPool.h"
+#include "vtkLidarReader.h"
+
+#include <vtkCSVWriter.h>
+#include <vtkInitializationHelper.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkProcessModule.h>
+#include <vtkSMPTools.h>
+#include <vtkSMParaViewPipelineController.h>
+#include <vtkSMPluginManager.h>
+#include <vtkSMPropertyHelper.h>
+#include <vtkSMProxyListDomain.h>
+#include <vtkSMProxyManager.h>
+#include <vtkSMProxyProperty.h>
+#include <vtkSMSession.h>
+#include <vtkSMSessionProxyManager.h>
+#include <vtkSMSourceProxy.h>
+#include <vtkSmartPointer.h>
+
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+struct Options
+{
+  std::string Pcap;
+  std::string Calibration;
+  std::string Output;
+  std::string Format;
+  std::string Interpreter;
+  std::string Transform = "raw";
+  std::string PluginDirectory;
+  std::string CacheDirectory;
+  std::vector<double> SensorPosition;
+  std::vector<double> SensorRotation;
+  int First = 0;
+  int Last = -1;
+  int Stride = 1;
+  int Threads = 0;
+  bool CompressPCD = false;
+  bool Quiet = false;
+};
+
+//-----------------------------------------------------------------------------
+struct Throughput
+{
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+  int Frames = 0;
+  vtkIdType Points = 0;
+
+  void Print(double outputBytes) const
+  {
+    const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - this->Start).count();
+    std::cout << this->Frames << " frames, " << this->Points << " points in " << seconds
+              << " s: " << this->Frames / seconds << " frames/s, " << this->Points / seconds / 1e6
+              << " Mpoints/s, " << outputBytes / seconds / (1 << 20) << " MiB/s written"
+              << std::endl;
+  }
+};
+
+//-----------------------------------------------------------------------------
+bool LoadPlugins(const Options& options, const std::string& executable)
+{
+  std::vector<std::string> directories;
+  if (!options.PluginDirectory.empty())
+  {
+    directories.push_back(options.PluginDirectory);
+  }
+  const std::string executableDirectory = vtksys::SystemTools::GetFilenamePath(executable);
+  directories.push_back(executableDirectory + "/" LIDARVIEW_BATCH_PLUGIN_DIRECTORY);
+  directories.push_back(executableDirectory);
+
+  vtkSMPluginManager* plugins = vtkSMProxyManager::GetProxyManager()->GetPluginManager();
+  for (const char* plugin : { LIDARVIEW_BATCH_LIDAR_PLUGIN, LIDARVIEW_BATCH_VELODYNE_PLUGIN,
+         LIDARVIEW_BATCH_PROCESSING_PLUGIN })
+  {
+    bool loaded = false;
+    for (const std::string& directory : directories)
+    {
+      const std::string path = directory + "/" + plugin;
+      if (vtksys::SystemTools::FileExists(path, true) && plugins->LoadLocalPlugin(path.c_str()))
+      {
+        loaded = true;
+        break;
+      }
+    }
+    if (!loaded)
+    {
+      std::cerr << "Could not load " << plugin << ", use --plugin-dir" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Same defaults as lqUpdateCalibrationReaction::setCalibrationFileAndDefaultInterpreter
+ */
+vtkSMProxy* SelectInterpreter(vtkSMProxy* reader, const Options& options)
+{
+  vtkSMProxyProperty* property =
+    vtkSMProxyProperty::SafeDownCast(reader->GetProperty("PacketInterpreter"));
+  vtkSMProxyListDomain* domain = property
+    ? vtkSMProxyListDomain::SafeDownCast(property->FindDomain("vtkSMProxyListDomain"))
+    : nullptr;
+  if (!domain)
+  {
+    return nullptr;
+  }
+
+  std::string name = options.Interpreter;
+  if (name.empty())
+  {
+    const std::string calibration = vtksys::SystemTools::LowerCase(options.Calibration);
+    name = calibration.find("velarray") != std::string::npos
+      ? "VelodyneSpecialVelarrayPacketInterpreter"
+      : "VelodyneMetaPacketInterpreter";
+  }
+  vtkSMProxy* interpreter = domain->FindProxy("LidarPacketInterpreter", name.c_str());
+  if (interpreter)
+  {
+    vtkSMPropertyHelper(property).Set(interpreter);
+  }
+  return interpreter;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Same as lqUpdateCalibrationReaction::setTransform: a Transform2 proxy as the
+ * "Sensor Transform" of the interpreter
+ */
+void SetSensorTransform(vtkSMProxy* interpreter, const Options& options)
+{
+  vtkSMSessionProxyManager* pxm = interpreter->GetSessionProxyManager();
+  vtkSmartPointer<vtkSMProxy> transform;
+  transform.TakeReference(pxm->NewProxy("extended_sources", "Transform2"));
+  const std::vector<double> zero(3, 0.);
+  const std::vector<double>& position =
+    options.SensorPosition.empty() ? zero : options.SensorPosition;
+  const std::vector<double>& rotation =
+    options.SensorRotation.empty() ? zero : options.SensorRotation;
+  vtkSMPropertyHelper(transform, "Position").Set(position.data(), 3);
+  vtkSMPropertyHelper(transform, "Rotation").Set(rotation.data(), 3);
+  transform->UpdateVTKObjects();
+  vtkSMPropertyHelper(interpreter, "Sensor Transform").Set(transform);
+}
+
+//-----------------------------------------------------------------------------
+bool ExportLAS(vtkLidarReader* reader, const std::vector<int>& frames, const Options& options)
+{
+  LidarLASWriter writer;
+  if (!writer.Open(options.Output))
+  {
+    std::cerr << writer.GetLastError() << std::endl;
+    return false;
+  }
+
+  Throughput throughput;
+  reader->Open();
+  bool ok = true;
+  for (int frame : frames)
+  {
+    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
+    throughput.Frames++;
+    throughput.Points += data ? data->GetNumberOfPoints() : 0;
+    // The point source ID is 16 bits: frames after 65535 all get 65535
+    const unsigned short sourceId =
+      static_cast<unsigned short>(std::min(frame, static_cast<int>(VTK_UNSIGNED_SHORT_MAX)));
+    if (!writer.WriteFrame(data, sourceId))
+    {
+      ok = false;
+      break;
+    }
+    if (!options.Quiet)
+    {
+      std::cout << "\rframe " << frame << std::flush;
+    }
+  }
+  reader->Close();
+  ok = writer.Close() && ok;
+  if (!ok)
+  {
+    std::cerr << std::endl << writer.GetLastError() << std::endl;
+    return false;
+  }
+  std::cout << std::endl;
+  throughput.Print(static_cast<double>(vtksys::SystemTools::FileLength(options.Output)));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ExportCSV(vtkLidarReader* reader, const std::vector<int>& frames, const Options& options)
+{
+  // One file per frame, named as the zipped export of the application
+  if (!static_cast<bool>(vtksys::SystemTools::MakeDirectory(options.Output)))
+  {
+    std::cerr << "Could not create " << options.Output << std::endl;
+    return false;
+  }
+  const std::string basename = vtksys::SystemTools::GetFilenameName(options.Output);
+
+  vtkNew<vtkCSVWriter> writer;
+  writer->SetFieldAssociation(vtkDataObject::FIELD_ASSOCIATION_POINTS);
+  writer->SetPrecision(16);
+
+  Throughput throughput;
+  double bytes = 0.;
+  reader->Open();
+  for (int frame : frames)
+  {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), " (Frame %04d).csv", frame);
+    const std::string filename = options.Output + "/" + basename + suffix;
+    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
+    writer->SetInputData(data);
+    writer->SetFileName(filename.c_str());
+    if (!writer->Write())
+    {
+      reader->Close();
+      std::cerr << std::endl << "Could not write " << filename << std::endl;
+      return false;
+    }
+    throughput.Frames++;
+    throughput.Points += data ? data->GetNumberOfPoints() : 0;
+    bytes += vtksys::SystemTools::FileLength(filename);
+    if (!options.Quiet)
+    {
+      std::cout << "\rframe " << frame << std::flush;
+    }
+  }
+  reader->Close();
+  std::cout << std::endl;
+  throughput.Print(bytes);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ExportPointClouds(
+  vtkLidarReader* reader, const std::vector<int>& frames, const Options& options)
+{
+  // One file per frame as for csv, encoded concurrently while the next frames
+  // are decoded
+  if (!static_cast<bool>(vtksys::SystemTools::MakeDirectory(options.Output)))
+  {
+    std::cerr << "Could not create " << options.Output << std::endl;
+    return false;
+  }
+  const std::string basename = vtksys::SystemTools::GetFilenameName(options.Output);
+  LidarPointCloudWriter writer;
+  writer.SetWriteAllArrays(true);
+  if (options.Format == "ply")
+  {
+    writer.SetFormat(LidarPointCloudWriter::PLY);
+  }
+  else
+  {
+    writer.SetFormat(
+      options.CompressPCD ? LidarPointCloudWriter::PCD_COMPRESSED : LidarPointCloudWriter::PCD);
+  }
+
+  Throughput throughput;
+  reader->Open();
+  bool ok = true;
+  for (int frame : frames)
+  {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), " (Frame %04d).", frame);
+    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
+    if (!writer.WriteFrame(data, options.Output + "/" + basename + suffix + options.Format))
+    {
+      ok = false;
+      break;
+    }
+    throughput.Frames++;
+    throughput.Points += data ? data->GetNumberOfPoints() : 0;
+    if (!options.Quiet)
+    {
+      std::cout << "\rframe " << frame << std::flush;
+    }
+  }
+  reader->Close();
+  ok = writer.Flush() && ok;
+  if (!ok)
+  {
+    std::cerr << std::endl << writer.GetLastError() << std::endl;
+    return false;
+  }
+  std::cout << std::endl;
+  throughput.Print(static_cast<double>(writer.GetNumberOfBytesWritten()));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ExportPCAP(vtkLidarReader* reader, const std::vector<int>& frames, const Options& options)
+{
+  if (options.Stride != 1)
+  {
+    std::cerr << "The pcap export only supports a stride of 1" << std::endl;
+    return false;
+  }
+  Throughput throughput;
+  reader->Open();
+  reader->SaveFrame(frames.front(), frames.back(), options.Output.c_str());
+  reader->Close();
+  throughput.Frames = static_cast<int>(frames.size());
+  throughput.Print(static_cast<double>(vtksys::SystemTools::FileLength(options.Output)));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int Run(const Options& options, const std::string& executable)
+{
+  if (!LoadPlugins(options, executable))
+  {
+    return EXIT_FAILURE;
+  }
+
+  vtkSMSessionProxyManager* pxm =
+    vtkSMProxyManager::GetProxyManager()->GetActiveSessionProxyManager();
+  vtkSmartPointer<vtkSMSourceProxy> proxy;
+  proxy.TakeReference(vtkSMSourceProxy::SafeDownCast(pxm->NewProxy("sources", "LidarReader")));
+  if (!proxy)
+  {
+    std::cerr << "Could not create the LidarReader" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // pcapng and compressed recordings are read through a classic pcap copy
+  const std::string cacheDirectory = options.CacheDirectory.empty()
+    ? vtksys::SystemTools::GetFilenamePath(vtksys::SystemTools::CollapseFullPath(options.Output)) +
+      "/.lidarview-captures"
+    : options.CacheDirectory;
+  std::string error;
+  const std::string pcap = LidarCaptureConverter::Prepare(options.Pcap, cacheDirectory, &error);
+  if (pcap.empty())
+  {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkSMParaViewPipelineController> controller;
+  controller->PreInitializeProxy(proxy);
+  vtkSMPropertyHelper(proxy, "FileName").Set(pcap.c_str());
+  vtkSMPropertyHelper(proxy, "CalibrationFileName").Set(options.Calibration.c_str());
+  vtkSMProxy* interpreter = SelectInterpreter(proxy, options);
+  if (!interpreter)
+  {
+    std::cerr << "Unknown packet interpreter " << options.Interpreter << std::endl;
+    return EXIT_FAILURE;
+  }
+  const bool applyTransform = options.Transform == "applied";
+  if (applyTransform)
+  {
+    SetSensorTransform(interpreter, options);
+  }
+  vtkSMPropertyHelper(interpreter, "ApplyTransform").Set(applyTransform ? 1 : 0);
+  interpreter->UpdateVTKObjects();
+  controller->PostInitializeProxy(proxy);
+  proxy->UpdateVTKObjects();
+  proxy->UpdatePipelineInformation();
+
+  vtkLidarReader* reader = vtkLidarReader::SafeDownCast(proxy->GetClientSideObject());
+  const int nbFrames = reader ? reader->GetNumberOfFrames() : 0;
+  const int last = options.Last < 0 ? nbFrames - 1 : std::min(options.Last, nbFrames - 1);
+  std::vector<int> frames;
+  for (int frame = std::max(options.First, 0); frame <= last; frame += options.Stride)
+  {
+    frames.push_back(frame);
+  }
+  if (frames.empty())
+  {
+    std::cerr << "No frame to export, " << options.Pcap << " has " << nbFrames << " frames"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool ok = false;
+  if (options.Format == "las")
+  {
+    ok = ExportLAS(reader, frames, options);
+  }
+  else if (options.Format == "csv")
+  {
+    ok = ExportCSV(reader, frames, options);
+  }
+  else if (options.Format == "ply" || options.Format == "pcd")
+  {
+    ok = ExportPointClouds(reader, frames, options);
+  }
+  else if (options.Format == "pcap")
+  {
+    ok = ExportPCAP(reader, frames, options);
+  }
+  else
+  {
+    std::cerr << "Unknown format " << options.Format << std::endl;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  Options options;
+  bool help = false;
+  typedef vtksys::CommandLineArguments argT;
+  argT arguments;
+  arguments.Initialize(argc, argv);
+  arguments.AddArgument("--pcap", argT::SPACE_ARGUMENT, &options.Pcap,
+    "Recording to export: pcap or pcapng, optionally gzip or zstd compressed");
+  arguments.AddArgument(
+    "--calibration", argT::SPACE_ARGUMENT, &options.Calibration, "Calibration file of the sensor");
+  arguments.AddArgument("--output", argT::SPACE_ARGUMENT, &options.Output,
+    "Output file, or directory for csv");
+  arguments.AddArgument("--format", argT::SPACE_ARGUMENT, &options.Format,
+    "las, csv, ply, pcd or pcap. Default is the extension of the output");
+  arguments.AddArgument("--first", argT::SPACE_ARGUMENT, &options.First, "First frame, default 0");
+  arguments.AddArgument(
+    "--last", argT::SPACE_ARGUMENT, &options.Last, "Last frame, default -1 for the last one");
+  arguments.AddArgument(
+    "--stride", argT::SPACE_ARGUMENT, &options.Stride, "Export one frame every stride, default 1");
+  arguments.AddArgument("--transform", argT::SPACE_ARGUMENT, &options.Transform,
+    "raw (sensor frame, default) or applied (sensor position and rotation applied)");
+  arguments.AddArgument("--sensor-position", argT::MULTI_ARGUMENT, &options.SensorPosition,
+    "x y z of the sensor in meters, for --transform applied. Default 0 0 0");
+  arguments.AddArgument("--sensor-rotation", argT::MULTI_ARGUMENT, &options.SensorRotation,
+    "Roll pitch yaw of the sensor in degrees, for --transform applied. Default 0 0 0");
+  arguments.AddArgument("--interpreter", argT::SPACE_ARGUMENT, &options.Interpreter,
+    "Packet interpreter, default chosen from the calibration as in the application");
+  arguments.AddArgument("--threads", argT::SPACE_ARGUMENT, &options.Threads,
+    "Number of threads, default 0 for all the hardware threads");
+  arguments.AddArgument("--plugin-dir", argT::SPACE_ARGUMENT, &options.PluginDirectory,
+    "Directory of the LidarView plugins");
+  arguments.AddArgument("--cache-dir", argT::SPACE_ARGUMENT, &options.CacheDirectory,
+    "Where pcapng and compressed recordings are converted, default next to the output");
+  arguments.AddBooleanArgument(
+    "--pcd-compressed", &options.CompressPCD, "Write binary_compressed pcd files");
+  arguments.AddBooleanArgument("--quiet", &options.Quiet, "Do not print the progress");
+  arguments.AddBooleanArgument("--help", &help, "Print this help");
+
+  if (!arguments.Parse() || help || options.Pcap.empty() || options.Calibration.empty() ||
+    options.Output.empty())
+  {
+    std::cerr << "Usage: " << argv[0] << " --pcap FILE --calibration FILE --output PATH [options]"
+              << std::endl
+              << arguments.GetHelp() << std::endl;
+    return help ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  if (options.Format.empty())
+  {
+    options.Format = vtksys::SystemTools::GetFilenameLastExtension(options.Output);
+    options.Format = options.Format.empty() ? "csv" : options.Format.substr(1);
+  }
+  options.Format = vtksys::SystemTools::LowerCase(options.Format);
+  if (options.Transform != "raw" && options.Transform != "applied")
+  {
+    std::cerr << "Unknown transform mode " << options.Transform << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (const std::vector<double>* values : { &options.SensorPosition, &options.SensorRotation })
+  {
+    if (!values->empty() && values->size() != 3)
+    {
+      std::cerr << "--sensor-position and --sensor-rotation take 3 values" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (options.Transform == "applied" && options.SensorPosition.empty() &&
+    options.SensorRotation.empty())
+  {
+    std::cerr << "--transform applied needs --sensor-position or --sensor-rotation" << std::endl;
+    return EXIT_FAILURE;
+  }
+  options.Stride = std::max(options.Stride, 1);
+
+  if (options.Threads > 0)
+  {
+    vtkSMPTools::Initialize(options.Threads);
+    LidarTaskPool::SetDefaultNumberOfThreads(static_cast<unsigned int>(options.Threads));
+  }
+
+  vtkInitializationHelper::Initialize(argv[0], vtkProcessModule::PROCESS_BATCH);
+  vtkProcessModule* processModule = vtkProcessModule::GetProcessModule();
+  vtkNew<vtkSMSession> session;
+  const vtkIdType sessionId = processModule->RegisterSession(session);
+
+  const int status = Run(options, argv[0]);
+
+  processModule->UnRegisterSession(sessionId);
+  vtkInitializationHelper::Finalize();
+  return status;
+}
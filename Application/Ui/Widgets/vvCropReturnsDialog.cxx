@@ -105,6 +105,9 @@ void vvCropReturnsDialog::pqInternal::saveSettings()
   this->Settings->setValue("LidarPlugin/CropReturnsDialog/SecondCornerX", xRange[1]);
   this->Settings->setValue("LidarPlugin/CropReturnsDialog/SecondCornerY", yRange[1]);
   this->Settings->setValue("LidarPlugin/CropReturnsDialog/SecondCornerZ", zRange[1]);
+
+  this->Settings->setValue(
+    "LidarPlugin/CropReturnsDialog/Regions", this->RegionsTextEdit->toPlainText());
 }
 
 //-----------------------------------------------------------------------------
@@ -180,6 +183,9 @@ void vvCropReturnsDialog::pqInternal::restoreSettings()
   this->YDoubleRangeSlider.setMaximumValue(yRange[1]);
   this->ZDoubleRangeSlider.setMinimumValue(zRange[0]);
   this->ZDoubleRangeSlider.setMaximumValue(zRange[1]);
+
+  this->RegionsTextEdit->setPlainText(
+    this->Settings->value("LidarPlugin/CropReturnsDialog/Regions", QString()).toString());
 }
 
 //-----------------------------------------------------------------------------
@@ -302,6 +308,27 @@ void vvCropReturnsDialog::setSecondCorner(QVector3D corner)
   d->Z2SpinBox->setValue(corner.z());
 }
 
+//-----------------------------------------------------------------------------
+QStringList vvCropReturnsDialog::regions() const
+{
+  QStringList lines = this->Internal->RegionsTextEdit->toPlainText().split('\n');
+  QStringList result;
+  foreach (const QString& line, lines)
+  {
+    if (!line.trimmed().isEmpty())
+    {
+      result << line.trimmed();
+    }
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+void vvCropReturnsDialog::setRegions(const QStringList& regions)
+{
+  this->Internal->RegionsTextEdit->setPlainText(regions.join('\n'));
+}
+
 //-----------------------------------------------------------------------------
 void vvCropReturnsDialog::apply()
 {
@@ -656,6 +683,7 @@ void vvCropReturnsDialog::onCropGroupBoxToggled()
   this->Internal->cartesianRadioButton->setDisabled(!this->Internal->CropGroupBox->isChecked());
   this->Internal->sphericalRadioButton->setDisabled(!this->Internal->CropGroupBox->isChecked());
   this->Internal->CropOutsideCheckBox->setDisabled(!this->Internal->CropGroupBox->isChecked());
+  this->Internal->RegionsTextEdit->setDisabled(!this->Internal->CropGroupBox->isChecked());
 }
 
 //-----------------------------------------------------------------------------
@@ -15,6 +15,7 @@
 #define __vvCropReturnsDialog_h
 
 #include <QDialog>
+#include <QStringList>
 #include <QVector3D>
 
 class vvCropReturnsDialog : public QDialog
@@ -24,6 +25,7 @@ class vvCropReturnsDialog : public QDialog
   Q_PROPERTY(bool cropOutside READ cropOutside WRITE setCropOutside)
   Q_PROPERTY(QVector3D firstCorner READ firstCorner WRITE setFirstCorner)
   Q_PROPERTY(QVector3D secondCorner READ secondCorner WRITE setSecondCorner)
+  Q_PROPERTY(QStringList regions READ regions WRITE setRegions)
 
 public:
   vvCropReturnsDialog(QWidget* p = 0);
@@ -41,6 +43,11 @@ public:
   void setFirstCorner(QVector3D);
   void setSecondCorner(QVector3D);
 
+  /// Additional include / exclude regions, see vtkLidarCropRegions for the syntax.
+  /// Empty lines are not returned.
+  QStringList regions() const;
+  void setRegions(const QStringList&);
+
   Q_INVOKABLE void UpdateDialogWithCurrentSetting();
 
   Q_INVOKABLE int GetCropMode() const;
@@ -0,0 +1,237 @@
+#include "lqAdvancedArraysReaction.h"
+
+#include <vtkDataObject.h>
+#include <vtkNew.h>
+#include <vtkSMPVRepresentationProxy.h>
+#include <vtkSMParaViewPipelineControllerWithRendering.h>
+#include <vtkSMPropertyHelper.h>
+#include <vtkSMProxy.h>
+#include <vtkSMSourceProxy.h>
+#include <vtkSMViewProxy.h>
+
+#include <pqActiveObjects.h>
+#include <pqApplicationCore.h>
+#include <pqCoreUtilities.h>
+#include <pqObjectBuilder.h>
+#include <pqPipelineFilter.h>
+#include <pqPipelineSource.h>
+#include <pqView.h>
+
+#include "lqHelper.h"
+#include "vtkLidarAdvancedArrays.h"
+
+#include <QAction>
+#include <QCursor>
+#include <QMenu>
+#include <QSignalBlocker>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+/// Lidar source of the active pipeline branch, nullptr when none.
+pqPipelineSource* FindLidarSource(pqPipelineSource* source)
+{
+  while (source && !IsLidarProxy(source->getProxy()))
+  {
+    pqPipelineFilter* filter = qobject_cast<pqPipelineFilter*>(source);
+    source = filter && filter->getInputCount() > 0 ? filter->getInput(0) : nullptr;
+  }
+  return source;
+}
+
+//-----------------------------------------------------------------------------
+/// First consumer of source created from the xmlName proxy, nullptr when none.
+pqPipelineSource* FindConsumer(pqPipelineSource* source, const char* xmlName)
+{
+  foreach (pqPipelineSource* consumer, source->getAllConsumers())
+  {
+    if (QString(consumer->getProxy()->GetXMLName()) == xmlName)
+    {
+      return consumer;
+    }
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+/// Advanced arrays filter fed by lidarSource, nullptr when none.
+pqPipelineSource* FindAdvancedArrays(pqPipelineSource* lidarSource)
+{
+  return FindConsumer(lidarSource, "LidarAdvancedArrays");
+}
+
+//-----------------------------------------------------------------------------
+/// Crop regions or trailing frame filter fed by source, nullptr when none.
+pqPipelineSource* FindDisplayChain(pqPipelineSource* source)
+{
+  pqPipelineSource* consumer = FindConsumer(source, "LidarCropRegions");
+  return consumer ? consumer : FindConsumer(source, "TrailingFrame");
+}
+
+//-----------------------------------------------------------------------------
+/// Last filter of the display chain following source, source when none.
+pqPipelineSource* FindDisplayed(pqPipelineSource* source)
+{
+  while (pqPipelineSource* next = FindDisplayChain(source))
+  {
+    source = next;
+  }
+  return source;
+}
+
+//-----------------------------------------------------------------------------
+/// Makes the display chain of lidarSource read filter instead, as applogic
+/// does when it inserts the crop regions filter. Returns the displayed filter.
+pqPipelineSource* InsertInDisplayChain(pqPipelineSource* lidarSource, pqPipelineSource* filter)
+{
+  pqPipelineSource* next = FindDisplayChain(lidarSource);
+  if (!next)
+  {
+    return filter;
+  }
+  vtkSMPropertyHelper(next->getProxy(), "Input").Set(filter->getProxy(), 0);
+  next->getProxy()->UpdateVTKObjects();
+  return FindDisplayed(next);
+}
+
+//-----------------------------------------------------------------------------
+/// Interpreter of lidarSource if it has advanced arrays, nullptr otherwise.
+vtkSMProxy* FindInterpreter(pqPipelineSource* lidarSource)
+{
+  vtkSMProxy* proxy = lidarSource->getProxy();
+  vtkSMProxy* interpreter = proxy->GetProperty("PacketInterpreter")
+    ? vtkSMPropertyHelper(proxy, "PacketInterpreter").GetAsProxy()
+    : nullptr;
+  return interpreter && interpreter->GetProperty("EnableAdvancedArrays") ? interpreter : nullptr;
+}
+}
+
+//-----------------------------------------------------------------------------
+lqAdvancedArraysReaction::lqAdvancedArraysReaction(QAction* action)
+  : Superclass(action)
+  , Menu(new QMenu(pqCoreUtilities::mainWidget()))
+{
+  vtkNew<vtkLidarAdvancedArrays> arrays;
+  for (int i = 0; i < arrays->GetNumberOfPointArrays(); ++i)
+  {
+    QAction* entry = this->Menu->addAction(arrays->GetPointArrayName(i));
+    entry->setData(QString(arrays->GetPointArrayName(i)));
+    entry->setCheckable(true);
+    this->connect(entry, SIGNAL(toggled(bool)), SLOT(onArrayToggled(bool)));
+  }
+  this->Menu->addSeparator();
+  this->InterpreterArrays = this->Menu->addAction("All interpreter arrays");
+  this->InterpreterArrays->setToolTip("Computed together, on every frame");
+  this->InterpreterArrays->setCheckable(true);
+  this->connect(
+    this->InterpreterArrays, SIGNAL(toggled(bool)), SLOT(onInterpreterArraysToggled(bool)));
+  action->setMenu(this->Menu);
+
+  this->connect(&pqActiveObjects::instance(), SIGNAL(sourceChanged(pqPipelineSource*)),
+    SLOT(updateEnableState()));
+  this->updateEnableState();
+}
+
+//-----------------------------------------------------------------------------
+void lqAdvancedArraysReaction::onTriggered()
+{
+  this->updateMenu();
+  this->Menu->popup(QCursor::pos());
+}
+
+//-----------------------------------------------------------------------------
+void lqAdvancedArraysReaction::updateEnableState()
+{
+  this->parentAction()->setEnabled(
+    FindLidarSource(pqActiveObjects::instance().activeSource()) != nullptr);
+  this->updateMenu();
+}
+
+//-----------------------------------------------------------------------------
+void lqAdvancedArraysReaction::updateMenu()
+{
+  pqPipelineSource* lidarSource = FindLidarSource(pqActiveObjects::instance().activeSource());
+  pqPipelineSource* filter = lidarSource ? FindAdvancedArrays(lidarSource) : nullptr;
+  foreach (QAction* entry, this->Menu->actions())
+  {
+    if (entry->isSeparator() || entry == this->InterpreterArrays)
+    {
+      continue;
+    }
+    const QSignalBlocker blocker(entry);
+    entry->setChecked(filter &&
+      vtkSMPropertyHelper(filter->getProxy(), "PointArrayStatus")
+        .GetStatus(entry->data().toString().toUtf8().data(), 0));
+  }
+
+  vtkSMProxy* interpreter = lidarSource ? FindInterpreter(lidarSource) : nullptr;
+  const QSignalBlocker blocker(this->InterpreterArrays);
+  this->InterpreterArrays->setEnabled(interpreter != nullptr);
+  this->InterpreterArrays->setChecked(
+    interpreter && vtkSMPropertyHelper(interpreter, "EnableAdvancedArrays").GetAsInt() != 0);
+}
+
+//-----------------------------------------------------------------------------
+void lqAdvancedArraysReaction::onArrayToggled(bool checked)
+{
+  QAction* entry = qobject_cast<QAction*>(this->sender());
+  pqPipelineSource* lidarSource = FindLidarSource(pqActiveObjects::instance().activeSource());
+  if (!entry || !lidarSource)
+  {
+    return;
+  }
+
+  pqView* view = pqActiveObjects::instance().activeView();
+  vtkNew<vtkSMParaViewPipelineControllerWithRendering> controller;
+  pqPipelineSource* filter = FindAdvancedArrays(lidarSource);
+  if (!filter)
+  {
+    if (!checked)
+    {
+      return;
+    }
+    // All the arrays of the filter start disabled: nothing is computed yet.
+    // The frames on screen come from the trailing frame filter, or from the
+    // crop regions filter, which now read the arrays filter.
+    pqObjectBuilder* builder = pqApplicationCore::instance()->getObjectBuilder();
+    filter = builder->createFilter("filters", "LidarAdvancedArrays", lidarSource);
+    // A stream without crop regions is displayed directly
+    if (InsertInDisplayChain(lidarSource, filter) == filter && view)
+    {
+      controller->Show(filter->getSourceProxy(), 0, view->getViewProxy());
+      controller->Hide(lidarSource->getSourceProxy(), 0, view->getViewProxy());
+    }
+  }
+
+  const QByteArray name = entry->data().toString().toUtf8();
+  vtkSMProxy* proxy = filter->getProxy();
+  vtkSMPropertyHelper(proxy, "PointArrayStatus").SetStatus(name.data(), checked ? 1 : 0);
+  proxy->UpdateVTKObjects();
+  pqPipelineSource* displayed = FindDisplayed(filter);
+  displayed->updatePipeline();
+
+  vtkSMProxy* representation = checked && view
+    ? view->getViewProxy()->FindRepresentation(displayed->getSourceProxy(), 0)
+    : nullptr;
+  if (representation)
+  {
+    vtkSMPVRepresentationProxy::SetScalarColoring(
+      representation, name.data(), vtkDataObject::POINT);
+  }
+  pqApplicationCore::instance()->render();
+}
+
+//-----------------------------------------------------------------------------
+void lqAdvancedArraysReaction::onInterpreterArraysToggled(bool checked)
+{
+  pqPipelineSource* lidarSource = FindLidarSource(pqActiveObjects::instance().activeSource());
+  vtkSMProxy* interpreter = lidarSource ? FindInterpreter(lidarSource) : nullptr;
+  if (!interpreter)
+  {
+    return;
+  }
+  vtkSMPropertyHelper(interpreter, "EnableAdvancedArrays").Set(checked ? 1 : 0);
+  interpreter->UpdateVTKObjects();
+  lidarSource->updatePipeline();
+  pqApplicationCore::instance()->render();
+}
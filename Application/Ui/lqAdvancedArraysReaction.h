@@ -0,0 +1,48 @@
+#ifndef LQADVANCEDARRAYSREACTION_H
+#define LQADVANCEDARRAYSREACTION_H
+
+#include "applicationui_export.h"
+
+#include "pqReaction.h"
+
+class QMenu;
+
+/**
+* @ingroup Reactions
+* Reaction to enable the advanced arrays of the active lidar source, one by one.
+*
+* The action menu lists the arrays of the "Advanced Arrays" filter: checking
+* one inserts the filter after the lidar source if needed, ahead of the crop
+* regions and trailing frame filters which display the frames, enables only
+* that array and colors the displayed frames by it. Each array is thus only computed for the frames
+* once asked for, see vtkLidarAdvancedArrays. The arrays of the interpreter,
+* which are all computed together on every frame, have their own entry.
+*/
+class APPLICATIONUI_EXPORT lqAdvancedArraysReaction : public pqReaction
+{
+  Q_OBJECT
+  typedef pqReaction Superclass;
+
+public:
+  lqAdvancedArraysReaction(QAction* action);
+
+protected:
+  /// Called when the action is triggered: shows the arrays menu.
+  void onTriggered() override;
+
+  void updateEnableState() override;
+
+protected slots:
+  void onArrayToggled(bool checked);
+  void onInterpreterArraysToggled(bool checked);
+
+private:
+  void updateMenu();
+
+  QMenu* Menu;
+  QAction* InterpreterArrays;
+
+  Q_DISABLE_COPY(lqAdvancedArraysReaction)
+};
+
+#endif // LQADVANCEDARRAYSREACTION_H
@@ -21,10 +21,18 @@
 #include "vvCalibrationDialog.h"
 #include "lqSensorListWidget.h"
 
+#include <LidarCaptureConverter.h>
+#include <LidarCompressedFile.h>
+
 #include <QApplication>
+#include <QMap>
+#include <QMessageBox>
 #include <QProgressDialog>
+#include <QStandardPaths>
 #include <QString>
 
+#include <chrono>
+#include <future>
 #include <string>
 
 #include <vtkCommand.h>
@@ -53,6 +61,17 @@ public:
   }
 };
 
+namespace
+{
+//-----------------------------------------------------------------------------
+// Recording each converted pcap of the cache was prepared from
+QMap<QString, QString>& PreparedCaptures()
+{
+  static QMap<QString, QString> captures;
+  return captures;
+}
+}
+
 //-----------------------------------------------------------------------------
 lqOpenPcapReaction::lqOpenPcapReaction(QAction *action) :
   Superclass(action)
@@ -69,7 +88,8 @@ void lqOpenPcapReaction::onTriggered()
 
   pqFileDialog dial(
     pqActiveObjects::instance().activeServer(), pqCoreUtilities::mainWidget(),
-    tr("Open LiDAR File"), defaultDir, tr("Wireshark Capture (*.pcap)")
+    tr("Open LiDAR File"), defaultDir,
+    tr("Wireshark Capture (*.pcap *.pcapng *.pcap.gz *.pcapng.gz *.pcap.zst *.pcapng.zst)")
   );
   dial.setObjectName("LidarFileOpenDialog");
   dial.setFileMode(pqFileDialog::ExistingFile);
@@ -84,6 +104,18 @@ void lqOpenPcapReaction::onTriggered()
   lqOpenPcapReaction::createSourceFromFile(fileName);
 }
 
+//-----------------------------------------------------------------------------
+bool lqOpenPcapReaction::isCaptureFile(const QString& fileName)
+{
+  return LidarCaptureConverter::IsCaptureFileName(fileName.toStdString());
+}
+
+//-----------------------------------------------------------------------------
+QString lqOpenPcapReaction::captureFileName(const QString& readerFileName)
+{
+  return PreparedCaptures().value(readerFileName, readerFileName);
+}
+
 //-----------------------------------------------------------------------------
 void lqOpenPcapReaction::createSourceFromFile(QString fileName)
 {
@@ -107,6 +139,40 @@ void lqOpenPcapReaction::createSourceFromFile(QString fileName)
   progress.setModal(true);
   progress.show();
 
+  // The reader seeks in classic pcap files only: pcapng and compressed
+  // captures are converted once into the cache, on a worker thread so that
+  // the application stays responsive
+  const QString recordingFileName = fileName;
+  const bool isCompressed =
+    LidarCompressedFile::DetectFormat(fileName.toStdString()) != LidarCompressedFile::NONE;
+  if (isCompressed ||
+    LidarCaptureConverter::DetectFormat(fileName.toStdString()) != LidarCaptureConverter::PCAP)
+  {
+    progress.setLabelText(isCompressed ? "Decompressing capture" : "Converting pcapng capture");
+    const std::string cacheDirectory =
+      (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/captures")
+        .toStdString();
+    const std::string source = fileName.toStdString();
+    std::string error;
+    std::future<std::string> prepared = std::async(std::launch::async,
+      [&]() { return LidarCaptureConverter::Prepare(source, cacheDirectory, &error); });
+    while (prepared.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready)
+    {
+      QApplication::processEvents();
+    }
+    const std::string preparedFileName = prepared.get();
+    if (preparedFileName.empty())
+    {
+      progress.close();
+      QMessageBox::warning(pqLidarViewManager::getMainWindow(), tr("Open LiDAR File"),
+        QString::fromStdString(error));
+      return;
+    }
+    fileName = QString::fromStdString(preparedFileName);
+    PreparedCaptures()[fileName] = recordingFileName;
+    progress.setLabelText("Reading pcap");
+  }
+
   vtkProcessModule* pm = vtkProcessModule::GetProcessModule();
   vtkPVSession* session = vtkPVSession::SafeDownCast(pm->GetSession());
   if(!session)
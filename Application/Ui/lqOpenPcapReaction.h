@@ -19,6 +19,14 @@ public:
   lqOpenPcapReaction(QAction* action);
   static void createSourceFromFile(QString fileName);
 
+  /// Whether fileName is a capture this reaction opens: pcap or pcapng,
+  /// optionally gzip or zstd compressed.
+  static bool isCaptureFile(const QString& fileName);
+
+  /// Recording a reader file name was opened from: pcapng and compressed
+  /// captures are read through a converted copy in the cache.
+  static QString captureFileName(const QString& readerFileName);
+
 protected:
   /// Called when the action is triggered.
   void onTriggered() override;
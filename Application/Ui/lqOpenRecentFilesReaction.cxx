@@ -45,7 +45,8 @@ void lqOpenRecentFilesReaction::onSourceAdded(pqPipelineSource* src)
       return;
     }
 
-    QString pcapName = QString(vtkSMPropertyHelper(pcapProp).GetAsString());
+    QString pcapName = lqOpenPcapReaction::captureFileName(
+      QString(vtkSMPropertyHelper(pcapProp).GetAsString()));
 
     // We connect the property "Filename" of the reader
     // - If "FileName" is not already set (default behavior):
@@ -76,7 +77,8 @@ void lqOpenRecentFilesReaction::onPcapUpdate(vtkObject* caller, unsigned long, v
   {
     return;
   }
-  QString pcapName = QString(vtkSMPropertyHelper(pcapProp).GetAsString());
+  QString pcapName = lqOpenPcapReaction::captureFileName(
+    QString(vtkSMPropertyHelper(pcapProp).GetAsString()));
 
   if(!pcapName.isNull() && !pcapName.isEmpty())
   {
@@ -114,7 +116,7 @@ void lqOpenRecentFilesReaction::createNewRecentFile(QString pcapName)
 //-----------------------------------------------------------------------------
 void lqOpenRecentFilesReaction::onOpenRecentFile(QString filename)
 {
-  if (filename.endsWith(".pcap"))
+  if (lqOpenPcapReaction::isCaptureFile(filename))
   {
     lqOpenPcapReaction::createSourceFromFile(filename);
   }
@@ -22,6 +22,40 @@
 #include "vvCalibrationDialog.h"
 
 #include <cctype>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+/**
+ * Settings that change how packets are split into frames: calibration,
+ * interpreter and ports. Only a change of these requires the source to reset
+ * its frame assembly / rescan its file, the other interpreter settings apply
+ * to the next frames.
+ */
+std::string FrameSplittingSettings(vtkSMProxy* proxy)
+{
+  std::string settings;
+  if (proxy->GetProperty("CalibrationFileName"))
+  {
+    settings += vtkSMPropertyHelper(proxy, "CalibrationFileName").GetAsString();
+  }
+  if (proxy->GetProperty("PacketInterpreter"))
+  {
+    // Each interpreter is its own proxy of the list domain
+    vtkSMProxy* interpreter = vtkSMPropertyHelper(proxy, "PacketInterpreter").GetAsProxy();
+    settings += std::string(" ") + (interpreter ? interpreter->GetXMLName() : "none");
+  }
+  for (const char* port : { "ListeningPort", "LidarPort" })
+  {
+    if (proxy->GetProperty(port))
+    {
+      settings += " " + std::to_string(vtkSMPropertyHelper(proxy, port).GetAsInt());
+    }
+  }
+  return settings;
+}
+}
+
 //-----------------------------------------------------------------------------
 lqUpdateCalibrationReaction::lqUpdateCalibrationReaction(QAction *action) :
   Superclass(action)
@@ -62,6 +96,9 @@ void lqUpdateCalibrationReaction::setTransform(vtkSMProxy * proxy,
   rotate.push_back(yaw);
   vtkSMPropertyHelper(transformProxy, "Position").Set(translate.data(), translate.size());
   vtkSMPropertyHelper(transformProxy, "Rotation").Set(rotate.data(), rotate.size());
+  // Push Position / Rotation to the transform itself, updating the interpreter
+  // only pushes its own properties
+  transformProxy->UpdateVTKObjects();
   vtkSMProperty * TransformProp = interpreterProxy->GetProperty("Sensor Transform");
   vtkSMPropertyHelper(TransformProp).Set(transformProxy);
   interpreterProxy->UpdateVTKObjects();
@@ -147,6 +184,8 @@ void lqUpdateCalibrationReaction::UpdateCalibration(pqPipelineSource* & lidarSou
     return;
   }
 
+  const std::string previousSplittingSettings = FrameSplittingSettings(lidarProxy);
+
   // Set the calibration File and the lidar interpreter
   lqUpdateCalibrationReaction::setCalibrationFileAndDefaultInterpreter(lidarProxy, dialog.selectedCalibrationFile());
 
@@ -161,8 +200,19 @@ void lqUpdateCalibrationReaction::UpdateCalibration(pqPipelineSource* & lidarSou
                                                      dialog.isForwarding(), dialog.ipAddressForwarding(),
                                                      dialog.isCrashAnalysing(), dialog.isEnableMultiSensors());
 
-  lidarProxy->UpdateSelfAndAllInputs();
-  lidarSource->updatePipeline();
+  // The setters above already pushed the new interpreter settings. Tearing
+  // down the pipeline would reset the frame assembly of a stream and rescan
+  // a pcap, so only do it when the frame splitting itself changed; otherwise
+  // the next render picks the new settings up.
+  if (FrameSplittingSettings(lidarProxy) != previousSplittingSettings)
+  {
+    lidarProxy->UpdateSelfAndAllInputs();
+    lidarSource->updatePipeline();
+  }
+  else
+  {
+    pqApplicationCore::instance()->render();
+  }
 
   // The user can chose to enable the gps packet interpretation in the dialog.
   // This is why we create here the gps source if it's not already exist
@@ -14,6 +14,12 @@
 #include "pqLidarViewManager.h"
 
 #include "LASFileWriter.h"
+#include "LidarHash.h"
+#include "LidarLASWriter.h"
+#include "LidarPcapIndex.h"
+#include "LidarSpatialIndex.h"
+#include "LidarTaskPool.h"
+#include "LidarZipWriter.h"
 #include "vtkPVConfig.h" //  needed for PARAVIEW_VERSION
 #include "vtkLidarReader.h"
 #include "vvPythonQtDecorators.h"
@@ -37,22 +43,39 @@
 #include <vtkSMSourceProxy.h>
 #include <vtkSMViewProxy.h>
 
+#include <vtkAlgorithm.h>
 #include <vtkFieldData.h>
+#include <vtkNew.h>
 #include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkPolyData.h>
 #include <vtkPythonInterpreter.h>
+#include <vtkSmartPointer.h>
 #include <vtkTimerLog.h>
+#include <vtkXMLPolyDataWriter.h>
 
 #include <QApplication>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QLabel>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QProcess>
 #include <QProgressDialog>
+#include <QStandardPaths>
 #include <QTimer>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
 #include <sstream>
+#include <vector>
 
 // Use LV_PYTHON_VERSION supplied at build time
 #ifndef LV_PYTHON_VERSION
@@ -65,6 +88,43 @@ class pqLidarViewManager::pqInternal
 {
 };
 
+namespace
+{
+//-----------------------------------------------------------------------------
+/**
+ * Index frame matching the first frame of the reader, -1 when the frames do
+ * not line up. The reader may skip the leading partial frame of the capture
+ * and drop the trailing one. A reader frame matches an index frame when its
+ * time is within half a frame period of the capture time of the first packet
+ * of the index frame.
+ */
+int FindFirstIndexFrame(const LidarPcapIndex& index, const std::vector<double>& times)
+{
+  const std::size_t nbFrames = index.GetNumberOfFrames();
+  if (times.empty() || times.size() > nbFrames)
+  {
+    return -1;
+  }
+  const double period = nbFrames > 1
+    ? (index.GetFrame(nbFrames - 1).Time - index.GetFrame(0).Time) / (nbFrames - 1)
+    : 0.1;
+  for (std::size_t first = 0; first <= std::min<std::size_t>(nbFrames - times.size(), 1);
+       ++first)
+  {
+    bool aligned = true;
+    for (std::size_t i = 0; i < times.size() && aligned; ++i)
+    {
+      aligned = std::abs(times[i] - index.GetFrame(first + i).Time) <= 0.5 * period;
+    }
+    if (aligned)
+    {
+      return static_cast<int>(first);
+    }
+  }
+  return -1;
+}
+}
+
 //-----------------------------------------------------------------------------
 QPointer<pqLidarViewManager> pqLidarViewManagerInstance = NULL;
 
@@ -220,6 +280,79 @@ void pqLidarViewManager::saveFramesToPCAP(
     return;
   }
 
+  // Copy the byte range of the frames straight from the capture when our
+  // index splits the frames as the reader does, instead of replaying it
+  const std::string pcapFileName = vtkSMPropertyHelper(proxy, "FileName").GetAsString();
+  const int lidarPort =
+    proxy->GetProperty("LidarPort") ? vtkSMPropertyHelper(proxy, "LidarPort").GetAsInt() : 0;
+  const QString cacheDirectory =
+    QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/pcap-index";
+  QDir().mkpath(cacheDirectory);
+  const std::string absolutePath =
+    QFileInfo(QString::fromStdString(pcapFileName)).absoluteFilePath().toStdString();
+  const std::string cacheFileName = cacheDirectory.toStdString() + "/" +
+    LidarHash::ToHex(LidarHash::FNV1a(absolutePath)) + ".lvidx";
+
+  // The first export of a capture scans all of it, off the GUI thread
+  QProgressDialog progress("Indexing pcap...", "Abort Export", 0, 100, getMainWindow());
+  progress.setWindowModality(Qt::WindowModal);
+  progress.setMinimumDuration(500);
+  std::atomic<int> percent(0);
+  std::atomic<bool> canceled(false);
+  LidarPcapIndex index;
+  std::string error;
+  std::future<bool> built = std::async(std::launch::async, [&]() {
+    return index.Build(pcapFileName, std::max(lidarPort, 0), cacheFileName, &error,
+      [&](double fraction) {
+        percent = static_cast<int>(100 * fraction);
+        return !canceled;
+      });
+  });
+  while (built.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready)
+  {
+    progress.setValue(percent);
+    QApplication::processEvents();
+    canceled = progress.wasCanceled();
+  }
+  const bool isBuilt = built.get();
+  progress.reset();
+  if (canceled)
+  {
+    return;
+  }
+  if (!error.empty())
+  {
+    // Failure, or where a truncated capture was cut
+    std::cerr << error << std::endl;
+    error.clear();
+  }
+
+  std::vector<double> times;
+  if (proxy->GetProperty("TimestepValues"))
+  {
+    proxy->UpdatePropertyInformation();
+    times = vtkSMPropertyHelper(proxy, "TimestepValues").GetDoubleArray();
+  }
+  const int nbFrames = reader->GetNumberOfFrames();
+  if (isBuilt && startFrame >= 0 && startFrame <= endFrame && endFrame < nbFrames &&
+    times.size() == static_cast<std::size_t>(nbFrames))
+  {
+    const int first = FindFirstIndexFrame(index, times);
+    if (first >= 0)
+    {
+      if (index.Extract(first + startFrame, first + endFrame, filename.toStdString(), &error))
+      {
+        return;
+      }
+      std::cerr << error << std::endl;
+    }
+    else
+    {
+      std::cerr << "The frames of the pcap index do not line up with the ones of the reader, "
+                << "replaying the capture to export it" << std::endl;
+    }
+  }
+
   reader->Open();
   reader->SaveFrame(startFrame, endFrame, filename.toUtf8().data());
   reader->Close();
@@ -248,9 +381,6 @@ void pqLidarViewManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* po
 
   bool isLatLon = false;
 
-  LASFileWriter writer;
-  writer.Open(qPrintable(filename));
-
   // not sensor relative; it can be
   // relative registered data or
   // georeferenced data
@@ -300,6 +430,56 @@ void pqLidarViewManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* po
   std::cout << "origin : [" << northing << ";" << easting << ";" << height << "]" << std::endl;
   std::cout << "gcs : " << gcs << std::endl;
 
+  // Projected or relative coordinates: single pass, the points being encoded
+  // in parallel while the next frames are read. Lat/lon output still needs the
+  // projection of LASFileWriter.
+  if (!isLatLon)
+  {
+    LidarLASWriter lasWriter;
+    lasWriter.SetScale(neTol, hTol);
+    lasWriter.SetOrigin(easting, northing, height);
+    if (gcs)
+    {
+      lasWriter.SetCoordinateSystemWKT(LidarLASWriter::GetUTMZoneWKT(utmZone));
+    }
+    if (!lasWriter.Open(filename.toStdString()))
+    {
+      QMessageBox::warning(getMainWindow(), "Export LAS",
+        QString::fromStdString(lasWriter.GetLastError()));
+      return;
+    }
+
+    QProgressDialog progress(
+      "Exporting LAS...", "Abort Export", startFrame, endFrame, getMainWindow());
+    progress.setWindowModality(Qt::WindowModal);
+
+    reader->Open();
+    bool ok = true;
+    for (int frame = startFrame; ok && frame <= endFrame; ++frame)
+    {
+      progress.setValue(frame);
+      if (progress.wasCanceled())
+      {
+        break;
+      }
+      // The point source ID is 16 bits: frames after 65535 all get 65535
+      const unsigned short sourceId =
+        static_cast<unsigned short>(std::min(frame, static_cast<int>(VTK_UNSIGNED_SHORT_MAX)));
+      ok = lasWriter.WriteFrame(reader->GetFrame(frame), sourceId);
+    }
+    reader->Close();
+
+    // Also completes the header of an aborted export
+    if (!lasWriter.Close() || !ok)
+    {
+      QMessageBox::warning(getMainWindow(), "Export LAS",
+        QString::fromStdString(lasWriter.GetLastError()));
+    }
+    return;
+  }
+
+  LASFileWriter writer;
+  writer.Open(qPrintable(filename));
   writer.SetPrecision(neTol, hTol);
   writer.SetGeoConversionUTM(utmZone, isLatLon);
   writer.SetOrigin(easting, northing, height);
@@ -342,6 +522,233 @@ void pqLidarViewManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* po
   reader->Close();
 }
 
+//-----------------------------------------------------------------------------
+void pqLidarViewManager::saveFramesToKiwiViewer(vtkSMSourceProxy* proxy,
+  const QVariantList& timesteps, const QString& filename, const QStringList& extraFiles)
+{
+  vtkAlgorithm* algorithm =
+    proxy ? vtkAlgorithm::SafeDownCast(proxy->GetClientSideObject()) : nullptr;
+  if (!algorithm)
+  {
+    return;
+  }
+
+  LidarZipWriter zip;
+  std::string error;
+  if (!zip.Open(filename.toStdString(), &error))
+  {
+    QMessageBox::warning(
+      getMainWindow(), "Export To KiwiViewer", QString::fromStdString(error));
+    return;
+  }
+
+  // Same layout as the zipped export directory: a folder named as the archive
+  const std::string folder = QFileInfo(filename).completeBaseName().toStdString() + "/";
+  bool ok = true;
+  for (const QString& extraFile : extraFiles)
+  {
+    const std::string name = folder + QFileInfo(extraFile).fileName().toStdString();
+    ok = ok && zip.WriteFile(name, extraFile.toStdString(), true, &error);
+  }
+
+  QProgressDialog progress(
+    "Exporting to KiwiViewer...", "Abort Export", 0, timesteps.size(), getMainWindow());
+  progress.setWindowModality(Qt::WindowModal);
+
+  // The frames are produced in order by the pipeline, serialized and
+  // compressed on the task pool, and stored in the archive in order. They are
+  // already zlib compressed: deflating them again would only cost time.
+  LidarTaskPool& pool = LidarTaskPool::GetInstance();
+  const std::size_t maxPending = 2 * pool.GetNumberOfThreads();
+  std::deque<std::future<LidarZipWriter::Entry>> pending;
+  auto writeFront = [&]() {
+    const LidarZipWriter::Entry entry = pending.front().get();
+    pending.pop_front();
+    if (ok && entry.Name.empty())
+    {
+      error = "Unable to serialize a frame";
+      ok = false;
+    }
+    ok = ok && zip.Write(entry, &error);
+  };
+
+  bool canceled = false;
+  for (int i = 0; ok && i < timesteps.size(); ++i)
+  {
+    progress.setValue(i);
+    if (progress.wasCanceled())
+    {
+      canceled = true;
+      break;
+    }
+
+    // Update the source alone, instead of moving the animation time of the
+    // whole application (and rendering) for each frame
+    const double time = timesteps[i].toDouble();
+    algorithm->UpdateTimeStep(time);
+    vtkPolyData* output = vtkPolyData::SafeDownCast(algorithm->GetOutputDataObject(0));
+    if (!output)
+    {
+      error = "The active source does not produce a polydata";
+      ok = false;
+      break;
+    }
+    // The writer runs on a worker while the next time step is produced: it
+    // needs its own arrays, the pipeline reuses or modifies the shared ones
+    // (and even GetRange() updates the array range cache)
+    auto frame = vtkSmartPointer<vtkPolyData>::New();
+    frame->DeepCopy(output);
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%04d.vtp", static_cast<int>(time));
+    const std::string entryName = folder + name;
+
+    while (pending.size() >= maxPending)
+    {
+      writeFront();
+    }
+    pending.push_back(pool.Submit([frame, entryName]() {
+      vtkNew<vtkXMLPolyDataWriter> writer;
+      writer->SetInputData(frame);
+      writer->SetDataModeToAppended();
+      writer->EncodeAppendedDataOff();
+      writer->SetCompressorTypeToZLib();
+      writer->WriteToOutputStringOn();
+      if (!writer->Write())
+      {
+        return LidarZipWriter::Entry();
+      }
+      const std::string& xml = writer->GetOutputStdString();
+      return LidarZipWriter::MakeEntry(entryName, xml.data(), xml.size(), false);
+    }));
+  }
+  // Pending tasks reference the frames: always wait for them
+  while (!pending.empty())
+  {
+    writeFront();
+  }
+
+  ok = zip.Close(ok ? &error : nullptr) && ok;
+  if (canceled || !ok)
+  {
+    // Do not leave a truncated archive behind
+    QFile::remove(filename);
+  }
+  if (!ok)
+  {
+    QMessageBox::warning(
+      getMainWindow(), "Export To KiwiViewer", QString::fromStdString(error));
+  }
+}
+
+namespace
+{
+//-----------------------------------------------------------------------------
+std::shared_ptr<const LidarSpatialIndex> GetSpatialIndex(
+  vtkSMSourceProxy* proxy, vtkPointSet*& frame)
+{
+  vtkAlgorithm* algorithm =
+    proxy ? vtkAlgorithm::SafeDownCast(proxy->GetClientSideObject()) : nullptr;
+  frame = algorithm ? vtkPointSet::SafeDownCast(algorithm->GetOutputDataObject(0)) : nullptr;
+  return LidarSpatialIndex::GetIndex(frame);
+}
+
+//-----------------------------------------------------------------------------
+bool ToDoubles(const QVariantList& list, int size, double* values)
+{
+  if (list.size() != size)
+  {
+    return false;
+  }
+  for (int i = 0; i < size; ++i)
+  {
+    values[i] = list[i].toDouble();
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+QVariantList ToPoint(vtkPointSet* frame, vtkIdType id)
+{
+  if (id < 0)
+  {
+    return QVariantList();
+  }
+  double p[3];
+  frame->GetPoint(id, p);
+  return QVariantList() << static_cast<qlonglong>(id) << p[0] << p[1] << p[2];
+}
+
+//-----------------------------------------------------------------------------
+QVariantList ToIds(const std::vector<vtkIdType>& ids)
+{
+  QVariantList list;
+  list.reserve(static_cast<int>(ids.size()));
+  for (vtkIdType id : ids)
+  {
+    list << static_cast<qlonglong>(id);
+  }
+  return list;
+}
+}
+
+//-----------------------------------------------------------------------------
+QVariantList pqLidarViewManager::findClosestPoint(
+  vtkSMSourceProxy* proxy, const QVariantList& point, double maxDistance)
+{
+  vtkPointSet* frame;
+  const std::shared_ptr<const LidarSpatialIndex> index = GetSpatialIndex(proxy, frame);
+  double x[3];
+  if (!index || !ToDoubles(point, 3, x))
+  {
+    return QVariantList();
+  }
+  return ToPoint(frame, index->FindClosestPoint(x, maxDistance));
+}
+
+//-----------------------------------------------------------------------------
+QVariantList pqLidarViewManager::findClosestPointToRay(vtkSMSourceProxy* proxy,
+  const QVariantList& origin, const QVariantList& direction, double tolerance)
+{
+  vtkPointSet* frame;
+  const std::shared_ptr<const LidarSpatialIndex> index = GetSpatialIndex(proxy, frame);
+  double o[3], d[3];
+  if (!index || !ToDoubles(origin, 3, o) || !ToDoubles(direction, 3, d))
+  {
+    return QVariantList();
+  }
+  return ToPoint(frame, index->FindClosestPointToRay(o, d, tolerance));
+}
+
+//-----------------------------------------------------------------------------
+QVariantList pqLidarViewManager::findPointsWithinRadius(
+  vtkSMSourceProxy* proxy, const QVariantList& point, double radius)
+{
+  vtkPointSet* frame;
+  const std::shared_ptr<const LidarSpatialIndex> index = GetSpatialIndex(proxy, frame);
+  double x[3];
+  std::vector<vtkIdType> ids;
+  if (index && ToDoubles(point, 3, x))
+  {
+    index->FindPointsWithinRadius(x, radius, ids);
+  }
+  return ToIds(ids);
+}
+
+//-----------------------------------------------------------------------------
+QVariantList pqLidarViewManager::findPointsInBox(
+  vtkSMSourceProxy* proxy, const QVariantList& bounds)
+{
+  vtkPointSet* frame;
+  const std::shared_ptr<const LidarSpatialIndex> index = GetSpatialIndex(proxy, frame);
+  double b[6];
+  std::vector<vtkIdType> ids;
+  if (index && ToDoubles(bounds, 6, b))
+  {
+    index->FindPointsInBox(b, ids);
+  }
+  return ToIds(ids);
+}
+
 //-----------------------------------------------------------------------------
 void pqLidarViewManager::setup()
 {
@@ -357,7 +764,7 @@ void pqLidarViewManager::setPythonShell(pqPythonShell* shell)
 //-----------------------------------------------------------------------------
 void pqLidarViewManager::openData(const QString& filename)
 {
-  if (QFileInfo(filename).suffix() == "pcap")
+  if (lqOpenPcapReaction::isCaptureFile(filename))
   {
     lqOpenPcapReaction::createSourceFromFile(filename);
   }
@@ -16,6 +16,8 @@
 #define __pqLidarViewManager_h
 
 #include <QObject>
+#include <QStringList>
+#include <QVariantList>
 #include "applicationui_export.h"
 
 class vtkLidarReader;
@@ -74,6 +76,23 @@ public:
   static void saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* position, int startFrame,
     int endFrame, const QString& filename, int positionMode);
 
+  /// Export the frames of the source at the given time steps to a KiwiViewer
+  /// archive. extraFiles, e.g. the json description of the scene, are added
+  /// next to the frames.
+  static void saveFramesToKiwiViewer(vtkSMSourceProxy* proxy, const QVariantList& timesteps,
+    const QString& filename, const QStringList& extraFiles);
+
+  /// Spatial queries on the current frame of the source, served by a spatial
+  /// index built on first use and cached per frame. Points are returned as
+  /// [id, x, y, z], or an empty list when there is none; ids as a list.
+  static QVariantList findClosestPoint(
+    vtkSMSourceProxy* proxy, const QVariantList& point, double maxDistance);
+  static QVariantList findClosestPointToRay(vtkSMSourceProxy* proxy, const QVariantList& origin,
+    const QVariantList& direction, double tolerance);
+  static QVariantList findPointsWithinRadius(
+    vtkSMSourceProxy* proxy, const QVariantList& point, double radius);
+  static QVariantList findPointsInBox(vtkSMSourceProxy* proxy, const QVariantList& bounds);
+
 public slots:
 
   void pythonStartup();
@@ -24,7 +24,6 @@ from paraview import vtk
 import PythonQt
 from PythonQt import QtCore, QtGui
 
-from vtk import vtkXMLPolyDataWriter
 import lidarviewcore.kiwiviewerExporter as kiwiviewerExporter
 import lidarview.gridAdjustmentDialog as gridAdjustmentDialog
 import lidarview.aboutDialog as aboutDialog
@@ -77,6 +76,7 @@ class AppLogic(object):
         self.trailingFrame = []
         self.position = None
         self.sensor = None
+        self.cropRegions = None
 
         self.gridProperties = None
 
@@ -374,6 +374,7 @@ def UpdateApplogicReader(lidarName, posOrName, trailingFrameName):
     if not current_trailingFrame :
         return
     current_trailingFrame.NumberOfTrailingFrames=app.trailingFramesSpinBox.value
+    app.trailingFrame.append(current_trailingFrame)
 
     filename = reader.FileName
     displayableFilename = os.path.basename(filename)
@@ -431,7 +432,6 @@ def UpdateApplogicReader(lidarName, posOrName, trailingFrameName):
     showMeasurementGrid()
 
     setDefaultLookupTables(current_trailingFrame)
-    app.trailingFrame.append(current_trailingFrame)
     updateUIwithNewLidar()
 
 
@@ -470,18 +470,34 @@ def showRuler():
     app.ruler.Visibility = True
     smp.Render()
 
+# Maximum distance, in meters, between the mouse ray and the lidar point it snaps to
+RULER_SNAP_TOLERANCE = 0.2
+
 def getPointFromCoordinate(coord, midPlaneDistance = 0.5):
     assert len(coord) == 2
 
     windowHeight = smp.GetActiveView().ViewSize[1]
-
-    displayPoint = [coord[0], windowHeight - coord[1], midPlaneDistance]
     renderer = smp.GetActiveView().GetRenderer()
-    renderer.SetDisplayPoint(displayPoint)
-    renderer.DisplayToWorld()
-    world1 = renderer.GetWorldPoint()
 
-    return world1[:3]
+    def displayToWorld(depth):
+        displayPoint = [coord[0], windowHeight - coord[1], depth]
+        renderer.SetDisplayPoint(displayPoint)
+        renderer.DisplayToWorld()
+        return list(renderer.GetWorldPoint()[:3])
+
+    # Snap to the first lidar point under the cursor, found with the spatial
+    # index of the frame, rather than picking in the renderer
+    lidar = getLidar()
+    if lidar:
+        near = displayToWorld(0.)
+        far = displayToWorld(1.)
+        direction = [f - n for f, n in zip(far, near)]
+        hit = PythonQt.paraview.pqLidarViewManager.findClosestPointToRay(
+            lidar.SMProxy, near, direction, RULER_SNAP_TOLERANCE)
+        if hit:
+            return hit[1:]
+
+    return displayToWorld(midPlaneDistance)
 
 def toggleRulerContext():
 
@@ -889,46 +905,19 @@ def onKiwiViewerExport():
 
 def saveToKiwiViewer(filename, timesteps):
 
+    # Only the json description goes through a temporary directory, the frames
+    # are compressed in parallel and streamed into the archive
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
-    outDir = os.path.join(tempDir, os.path.splitext(os.path.basename(filename))[0])
-
-    os.makedirs(outDir)
-
-    filenames = exportToDirectory(outDir, timesteps)
+    filenames = ['frame_%04d.vtp' % t for t in timesteps]
+    kiwiviewerExporter.writeJsonData(tempDir, smp.GetActiveView(), smp.GetDisplayProperties(), filenames)
+    extraFiles = [os.path.join(tempDir, f) for f in sorted(os.listdir(tempDir))]
 
-    kiwiviewerExporter.writeJsonData(outDir, smp.GetActiveView(), smp.GetDisplayProperties(), filenames)
+    PythonQt.paraview.pqLidarViewManager.saveFramesToKiwiViewer(
+        smp.GetActiveSource().SMProxy, list(timesteps), filename, extraFiles)
 
-    kiwiviewerExporter.zipDir(outDir, filename)
     kiwiviewerExporter.shutil.rmtree(tempDir)
 
 
-def exportToDirectory(outDir, timesteps):
-
-    filenames = []
-
-    alg = smp.GetActiveSource().GetClientSideObject()
-
-    writer = vtkXMLPolyDataWriter()
-    writer.SetDataModeToAppended()
-    writer.EncodeAppendedDataOff()
-    writer.SetCompressorTypeToZLib()
-
-    for t in timesteps:
-
-        filename = 'frame_%04d.vtp' % t
-        filenames.append(filename)
-
-        app.scene.AnimationTime = t
-        polyData = vtk.vtkPolyData()
-        polyData.ShallowCopy(alg.GetOutput())
-
-        writer.SetInputData(polyData)
-        writer.SetFileName(os.path.join(outDir, filename))
-        writer.Update()
-
-    return filenames
-
-
 def getVersionString():
   return " ".join(getMainWindow().windowTitle.split(" ")[1:])
 
@@ -1024,6 +1013,7 @@ def unloadData():
     app.trailingFrame = []
     app.position = None
     app.sensor = None
+    app.cropRegions = None
 
     clearSpreadSheetView()
 
@@ -1085,8 +1075,63 @@ def onCropReturns(show = True):
         p1 = dialog.firstCorner
         p2 = dialog.secondCorner
         lidarInterpreter.CropRegion = [p1.x(), p2.x(), p1.y(), p2.y(), p1.z(), p2.z()]
-        if show:
-            smp.Render()
+
+    setCropRegions(dialog.regions if dialog.GetCropMode() != 0 else [])
+
+    if lidarInterpreter and show:
+        smp.Render()
+
+
+def getLidarOutput(lidar):
+    '''
+    Source feeding the crop regions and trailing frame filters: the Advanced
+    Arrays filter inserted after the lidar by lqAdvancedArraysReaction if any,
+    the lidar otherwise.
+    '''
+    for source in smp.GetSources().values():
+        if source.GetXMLName() == 'LidarAdvancedArrays' and source.Input == lidar:
+            return source
+    return lidar
+
+
+def setCropRegions(regions):
+    '''
+    Apply the additional include / exclude crop regions to the current lidar.
+    A LidarCropRegions filter is inserted between the lidar and its displayed
+    consumers when there is at least one region, and removed otherwise.
+    '''
+    lidar = getLidar()
+    if not lidar:
+        return
+
+    lidarOutput = getLidarOutput(lidar)
+    cropFilter = getattr(app, 'cropRegions', None)
+
+    if not regions:
+        if cropFilter:
+            for trailingFrame in app.trailingFrame:
+                if trailingFrame.Input == cropFilter:
+                    trailingFrame.Input = lidarOutput
+            if getSensor():
+                smp.Show(lidarOutput)
+            smp.Delete(cropFilter)
+            app.cropRegions = None
+        return
+
+    if not cropFilter:
+        cropFilter = smp.LidarCropRegions(guiName='Crop Regions', Input=lidarOutput)
+        app.cropRegions = cropFilter
+        for trailingFrame in app.trailingFrame:
+            if trailingFrame.Input == lidarOutput:
+                trailingFrame.Input = cropFilter
+        # a stream is displayed directly, display the cropped frames instead
+        if getSensor():
+            smp.Hide(lidarOutput)
+            rep = smp.Show(cropFilter)
+            rep.InterpolateScalarsBeforeMapping = 0
+            setDefaultLookupTables(cropFilter)
+
+    cropFilter.Regions = [str(region) for region in regions]
 
 
 def resetCameraToBirdsEyeView(view=None):
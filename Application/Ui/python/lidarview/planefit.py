@@ -14,19 +14,16 @@
 from __future__ import print_function
 #import VelodynePlugin.VelodyneLidar as vpmod #do we need this ?
 import paraview.simple as smp
-from paraview import vtk
+
+# Name of the plane fitting source displayed in the spreadsheet view
+PLANE_FIT_NAME = 'PlaneFit1'
 
 # Clean last planefitting source and the spreadsheet view
 def cleanStats():
-    planeFitter1 = smp.FindSource('PlaneFitter1')
-    if planeFitter1 is not None:
-        smp.Delete(planeFitter1)
-        del planeFitter1
-
-    PVTrivialProducer1 = smp.FindSource('PVTrivialProducer1')
-    if PVTrivialProducer1 is not None:
-        smp.Delete(PVTrivialProducer1)
-        del PVTrivialProducer1
+    planeFit1 = smp.FindSource(PLANE_FIT_NAME)
+    if planeFit1 is not None:
+        smp.Delete(planeFit1)
+        del planeFit1
 
 # Find or create a 'SpreadSheet View' to display plane fitting statistics
 def showStats(actionSpreadsheet=None):
@@ -34,9 +31,9 @@ def showStats(actionSpreadsheet=None):
         print("Unable to display stats : SpreadSheet action is not defined")
         return
     
-    planeFitter1 = smp.FindSource('PlaneFitter1')
-    if planeFitter1 is None:
-        print("Unable to create spreadsheet view : PlaneFitter1 source missing")
+    planeFit1 = smp.FindSource(PLANE_FIT_NAME)
+    if planeFit1 is None:
+        print("Unable to create spreadsheet view : " + PLANE_FIT_NAME + " source missing")
         return
 
     renderView1 = smp.FindView('RenderView1')
@@ -58,7 +55,7 @@ def showStats(actionSpreadsheet=None):
     spreadSheetView1.ColumnToSort = ''
     spreadSheetView1.BlockSize = 1024
     spreadSheetView1.FieldAssociation = 'Row Data'
-    smp.Show(planeFitter1, spreadSheetView1)
+    smp.Show(planeFit1, spreadSheetView1)
 
 def fitPlane(actionSpreadsheet=None):
     src = smp.GetActiveSource()
@@ -72,51 +69,29 @@ def fitPlane(actionSpreadsheet=None):
         print("A selection has to be defined to run plane fitting")
         return
 
-    extracter = smp.ExtractSelection()
-    extracter.Selection = selection
-    extracter.Input = src
-    smp.Show(extracter)
-
     # Clean last plane fitting stats before processing a new one
     cleanStats()
 
     try:
-        pd = extracter.GetClientSideObject().GetOutput()
-        if not pd.GetNumberOfPoints():
-            print("An empty selection is defined")
-            return
-
-        # Append data from each block
-        if pd.IsTypeOf("vtkMultiBlockDataSet"):
-            if not pd.GetNumberOfBlocks():
-                print("An empty selection is defined")
-                return
-
-            appendFilter = vtk.vtkAppendFilter()
-            for i in range(pd.GetNumberOfBlocks()):
-                appendFilter.AddInputData(pd.GetBlock(i))
-            appendFilter.Update()
-            pd = appendFilter.GetOutput()
-
-        # Create a data source from selected points
-        PVTrivialProducer1 = smp.PVTrivialProducer()
-        PVTrivialProducer1Client = PVTrivialProducer1.GetClientSideObject()
-        PVTrivialProducer1Client.SetOutput(pd)
-
-        # Create and apply plane fitter filter
-        planeFitter1 = smp.PlaneFitter(Input=PVTrivialProducer1)
+        # The selected points are fitted in place, without being extracted
+        planeFit1 = smp.LidarPlaneFit(Input=src, Selection=selection)
+        smp.RenameSource(PLANE_FIT_NAME, planeFit1)
 
         # if laser_id is the name of the array in Legacy and Special Velarray mode
         # LCN is the name of the array in APF mode
-        if pd.GetPointData().GetArray("laser_id") :
-            planeFitter1.laserIDArray = "laser_id"
-        elif pd.GetPointData().GetArray("LCN"):
-            planeFitter1.laserIDArray = "LCN"
-        planeFitter1.UpdatePipeline()
+        pointArrays = src.PointData.keys()
+        if "laser_id" in pointArrays:
+            planeFit1.LaserIdArrayName = "laser_id"
+        elif "LCN" in pointArrays:
+            planeFit1.LaserIdArrayName = "LCN"
+        planeFit1.UpdatePipeline()
+
+        if not planeFit1.GetDataInformation().GetNumberOfRows():
+            print("An empty selection is defined")
+            return
 
         # Display results on the main spreadsheet view
         showStats(actionSpreadsheet)
 
     finally:
-        smp.Delete(extracter)
         smp.SetActiveSource(src)
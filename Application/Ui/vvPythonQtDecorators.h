@@ -57,6 +57,36 @@ public slots:
   {
     pqLidarViewManager::saveFramesToLAS(arg0, arg1, arg2, arg3, arg4, arg5);
   }
+
+  void static_pqLidarViewManager_saveFramesToKiwiViewer(vtkSMSourceProxy* arg0,
+    const QVariantList& arg1, const QString& arg2, const QStringList& arg3)
+  {
+    pqLidarViewManager::saveFramesToKiwiViewer(arg0, arg1, arg2, arg3);
+  }
+
+  QVariantList static_pqLidarViewManager_findClosestPoint(
+    vtkSMSourceProxy* arg0, const QVariantList& arg1, double arg2)
+  {
+    return pqLidarViewManager::findClosestPoint(arg0, arg1, arg2);
+  }
+
+  QVariantList static_pqLidarViewManager_findClosestPointToRay(vtkSMSourceProxy* arg0,
+    const QVariantList& arg1, const QVariantList& arg2, double arg3)
+  {
+    return pqLidarViewManager::findClosestPointToRay(arg0, arg1, arg2, arg3);
+  }
+
+  QVariantList static_pqLidarViewManager_findPointsWithinRadius(
+    vtkSMSourceProxy* arg0, const QVariantList& arg1, double arg2)
+  {
+    return pqLidarViewManager::findPointsWithinRadius(arg0, arg1, arg2);
+  }
+
+  QVariantList static_pqLidarViewManager_findPointsInBox(
+    vtkSMSourceProxy* arg0, const QVariantList& arg1)
+  {
+    return pqLidarViewManager::findPointsInBox(arg0, arg1);
+  }
 };
 
 #endif
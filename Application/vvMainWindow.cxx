@@ -30,7 +30,7 @@
 #include "lqDockableSpreadSheetReaction.h"
 #include "lqSaveLidarStateReaction.h"
 #include "lqLoadLidarStateReaction.h"
-#include "lqEnableAdvancedArraysReaction.h"
+#include "lqAdvancedArraysReaction.h"
 #include "lqOpenSensorReaction.h"
 #include "lqOpenPcapReaction.h"
 #include "lqOpenRecentFilesReaction.h"
@@ -363,9 +363,11 @@ private:
     lqSensorListWidget * listSensor = lqSensorListWidget::instance();
     listSensor->setCalibrationFunction(&lqUpdateCalibrationReaction::UpdateExistingSource);
 
-    new lqSaveLidarFrameReaction(this->Ui.actionSavePCD, "PCDWriter", "pcd", false, false, true, true);
+    new lqSaveLidarFrameReaction(this->Ui.actionSavePCD, "LidarPCDWriter", "pcd", false, false, true, true);
     new lqSaveLidarFrameReaction(this->Ui.actionSaveCSV, "DataSetCSVWriter", "csv", false, false, true, true);
-    new lqSaveLidarFrameReaction(this->Ui.actionSavePLY, "PPLYWriter", "ply", false, false, true, true);
+    new lqSaveLidarFrameReaction(this->Ui.actionSavePLY, "LidarPLYWriter", "ply", false, false, true, true);
+    // No frame number in the file name: the frames of the range are appended to one container
+    new lqSaveLidarFrameReaction(this->Ui.actionSaveLVF, "LidarFrameWriter", "lvf", false, false, true, false);
     new lqSaveLASReaction(this->Ui.actionSaveLAS, false, false, true, true);
 
     connect(this->Ui.actionMeasurement_Grid, SIGNAL(toggled(bool)), pqLidarViewManager::instance(),
@@ -380,8 +382,8 @@ private:
     connect(this->Ui.actionPython_Console, SIGNAL(triggered()), this->Ui.pythonShellDock,
       SLOT(show()));
 
-    // Add save/load lidar state action
-    new lqEnableAdvancedArraysReaction(this->Ui.actionEnableAdvancedArrays);
+    // Advanced arrays, each one computed only once selected
+    new lqAdvancedArraysReaction(this->Ui.actionEnableAdvancedArrays);
   }
 };
 
@@ -458,7 +460,7 @@ void vvMainWindow::dropEvent(QDropEvent* evt)
     return;
   }
 
-  if (files[0].endsWith(".pcap"))
+  if (lqOpenPcapReaction::isCaptureFile(files[0]))
   {
     lqOpenPcapReaction::createSourceFromFile(files[0]);
   }
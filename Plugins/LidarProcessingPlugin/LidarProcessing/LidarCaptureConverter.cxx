@@ -0,0 +1,570 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCaptureConverter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarCaptureConverter.h"
+
+#include "LidarCompressedFile.h"
+#include "LidarHash.h"
+
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+constexpr std::uint64_t LidarCaptureConverter::DEFAULT_MAX_CACHE_SIZE;
+
+namespace
+{
+constexpr std::uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+constexpr std::uint32_t PCAP_NANO_MAGIC = 0xa1b23c4d;
+constexpr std::uint32_t PCAPNG_SECTION_HEADER = 0x0A0D0D0A;
+constexpr std::uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr std::uint32_t PCAPNG_INTERFACE_DESCRIPTION = 1;
+constexpr std::uint32_t PCAPNG_PACKET = 2;
+constexpr std::uint32_t PCAPNG_SIMPLE_PACKET = 3;
+constexpr std::uint32_t PCAPNG_ENHANCED_PACKET = 6;
+constexpr std::uint32_t MAX_BLOCK_SIZE = 1 << 24;
+constexpr std::uint32_t SNAPSHOT_LENGTH = 1 << 18;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::uint32_t Swap32(std::uint32_t value)
+{
+  return ((value & 0xFF) << 24) | ((value & 0xFF00) << 8) | ((value >> 8) & 0xFF00) |
+    (value >> 24);
+}
+
+//-----------------------------------------------------------------------------
+std::uint32_t ReadU32(const unsigned char* p, bool swap)
+{
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return swap ? Swap32(value) : value;
+}
+
+//-----------------------------------------------------------------------------
+std::uint16_t ReadU16(const unsigned char* p, bool swap)
+{
+  std::uint16_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return swap ? static_cast<std::uint16_t>((value >> 8) | (value << 8)) : value;
+}
+
+//-----------------------------------------------------------------------------
+struct Interface
+{
+  std::uint16_t LinkType = 0;
+  // Timestamp units per second, from the if_tsresol option
+  std::uint64_t Resolution = 1000000;
+};
+
+//-----------------------------------------------------------------------------
+std::uint64_t ParseResolution(const unsigned char* options, std::size_t size, bool swap)
+{
+  std::size_t i = 0;
+  while (i + 4 <= size)
+  {
+    const std::uint16_t code = ReadU16(options + i, swap);
+    const std::uint16_t length = ReadU16(options + i + 2, swap);
+    if (code == 0 || i + 4 + length > size)
+    {
+      break;
+    }
+    if (code == 9 && length >= 1) // if_tsresol
+    {
+      const unsigned char value = options[i + 4];
+      std::uint64_t resolution = 1;
+      if (value & 0x80)
+      {
+        resolution <<= std::min(value & 0x7F, 63);
+      }
+      else
+      {
+        for (int p = 0; p < std::min<int>(value, 19); ++p)
+        {
+          resolution *= 10;
+        }
+      }
+      return resolution;
+    }
+    i += 4 + ((length + 3u) & ~3u);
+  }
+  return 1000000;
+}
+
+//-----------------------------------------------------------------------------
+bool WriteRecord(std::FILE* output, std::uint64_t timestamp, std::uint64_t resolution,
+  const unsigned char* data, std::uint32_t capturedLength, std::uint32_t originalLength)
+{
+  const std::uint64_t seconds = timestamp / resolution;
+  const std::uint64_t fraction = timestamp % resolution;
+  std::uint32_t header[4];
+  header[0] = static_cast<std::uint32_t>(seconds);
+  header[1] = static_cast<std::uint32_t>(static_cast<double>(fraction) * 1e6 / resolution);
+  header[2] = capturedLength;
+  header[3] = originalLength;
+  return std::fwrite(header, sizeof(header), 1, output) == 1 &&
+    std::fwrite(data, 1, capturedLength, output) == capturedLength;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Convert the pcapng read sequentially by read(buffer, size), which returns
+ * the number of bytes read, to a classic pcap.
+ */
+template <typename ReadFunction>
+bool ConvertPcapngStream(ReadFunction&& read, const std::string& inputFileName,
+  const std::string& outputFileName, std::string* error)
+{
+  std::FILE* output = std::fopen(outputFileName.c_str(), "wb");
+  if (!output)
+  {
+    SetError(error, "Unable to open " + outputFileName);
+    return false;
+  }
+  std::vector<char> outputBuffer(1 << 20);
+  std::setvbuf(output, outputBuffer.data(), _IOFBF, outputBuffer.size());
+
+  std::vector<unsigned char> block;
+  std::vector<Interface> interfaces;
+  bool swap = false;
+  bool headerWritten = false;
+  std::uint16_t linkType = 0;
+  std::uint64_t nbSkipped = 0;
+  std::string message;
+  for (;;)
+  {
+    unsigned char blockHeader[12];
+    const std::size_t nbRead = read(blockHeader, sizeof(blockHeader));
+    if (nbRead == 0)
+    {
+      break;
+    }
+    if (nbRead != sizeof(blockHeader))
+    {
+      message = inputFileName + " is truncated";
+      break;
+    }
+    std::uint32_t type = ReadU32(blockHeader, swap);
+    if (type == PCAPNG_SECTION_HEADER)
+    {
+      // Each section sets its own byte order and interfaces
+      const std::uint32_t byteOrder = ReadU32(blockHeader + 8, false);
+      if (byteOrder != PCAPNG_BYTE_ORDER_MAGIC && Swap32(byteOrder) != PCAPNG_BYTE_ORDER_MAGIC)
+      {
+        message = inputFileName + " is not a pcapng file";
+        break;
+      }
+      swap = byteOrder != PCAPNG_BYTE_ORDER_MAGIC;
+      interfaces.clear();
+    }
+    const std::uint32_t length = ReadU32(blockHeader + 4, swap);
+    if (length < 16 || length % 4 != 0 || length > MAX_BLOCK_SIZE)
+    {
+      message = inputFileName + " holds an invalid block";
+      break;
+    }
+    // Body, without the type, the length and its trailing copy
+    block.resize(length - 8);
+    std::memcpy(block.data(), blockHeader + 8, 4);
+    if (read(block.data() + 4, block.size() - 4) != block.size() - 4)
+    {
+      message = inputFileName + " is truncated";
+      break;
+    }
+    const std::size_t bodySize = block.size() - 4;
+    const unsigned char* body = block.data();
+
+    if (type == PCAPNG_INTERFACE_DESCRIPTION && bodySize >= 8)
+    {
+      Interface description;
+      description.LinkType = ReadU16(body, swap);
+      description.Resolution = ParseResolution(body + 8, bodySize - 8, swap);
+      interfaces.push_back(description);
+      if (!headerWritten)
+      {
+        linkType = description.LinkType;
+        const std::uint32_t header[6] = { PCAP_MAGIC, 0x00040002, 0, 0, SNAPSHOT_LENGTH,
+          linkType };
+        headerWritten = std::fwrite(header, sizeof(header), 1, output) == 1;
+        if (!headerWritten)
+        {
+          message = "Unable to write " + outputFileName;
+          break;
+        }
+      }
+      continue;
+    }
+
+    // Packet blocks, with their interface, timestamp, and captured data
+    std::uint32_t interfaceId = 0;
+    std::uint64_t timestamp = 0;
+    std::uint32_t capturedLength = 0;
+    std::uint32_t originalLength = 0;
+    const unsigned char* data = nullptr;
+    if (type == PCAPNG_ENHANCED_PACKET && bodySize >= 20)
+    {
+      interfaceId = ReadU32(body, swap);
+      timestamp = (static_cast<std::uint64_t>(ReadU32(body + 4, swap)) << 32) |
+        ReadU32(body + 8, swap);
+      capturedLength = ReadU32(body + 12, swap);
+      originalLength = ReadU32(body + 16, swap);
+      data = body + 20;
+    }
+    else if (type == PCAPNG_PACKET && bodySize >= 20)
+    {
+      interfaceId = ReadU16(body, swap);
+      timestamp = (static_cast<std::uint64_t>(ReadU32(body + 4, swap)) << 32) |
+        ReadU32(body + 8, swap);
+      capturedLength = ReadU32(body + 12, swap);
+      originalLength = ReadU32(body + 16, swap);
+      data = body + 20;
+    }
+    else if (type == PCAPNG_SIMPLE_PACKET && bodySize >= 4)
+    {
+      // No timestamp, and only the original length is stored
+      originalLength = ReadU32(body, swap);
+      capturedLength = std::min<std::uint32_t>(originalLength, bodySize - 4);
+      data = body + 4;
+    }
+    else
+    {
+      // Statistics, name resolution, custom blocks...
+      continue;
+    }
+    const std::size_t available = bodySize - static_cast<std::size_t>(data - body);
+    if (capturedLength > available || interfaceId >= interfaces.size())
+    {
+      message = inputFileName + " holds an invalid packet block";
+      break;
+    }
+    const Interface& description = interfaces[interfaceId];
+    if (description.LinkType != linkType)
+    {
+      ++nbSkipped;
+      continue;
+    }
+    if (!WriteRecord(output, timestamp, description.Resolution, data, capturedLength,
+          originalLength))
+    {
+      message = "Unable to write " + outputFileName;
+      break;
+    }
+  }
+  if (std::fclose(output) != 0 && message.empty())
+  {
+    message = "Unable to write " + outputFileName;
+  }
+  if (message.empty() && !headerWritten)
+  {
+    message = inputFileName + " does not describe any interface";
+  }
+  if (!message.empty())
+  {
+    vtksys::SystemTools::RemoveFile(outputFileName);
+    SetError(error, message);
+    return false;
+  }
+  if (nbSkipped > 0)
+  {
+    std::cerr << nbSkipped << " packets of " << inputFileName
+              << " were captured on interfaces of another link type and were skipped"
+              << std::endl;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Name of the cached copy of a capture: its name without the compression and
+ * capture extensions, so that exports named after the reader file keep the
+ * name of the recording.
+ */
+std::string GetCaptureStem(const std::string& fileName)
+{
+  std::string stem = vtksys::SystemTools::GetFilenameName(fileName);
+  for (const char* extension : { ".gz", ".zst", ".zstd", ".pcapng", ".pcap" })
+  {
+    const std::size_t length = std::strlen(extension);
+    if (stem.size() > length &&
+      vtksys::SystemTools::LowerCase(stem.substr(stem.size() - length)) == extension)
+    {
+      stem.resize(stem.size() - length);
+    }
+  }
+  return stem;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Remove the least recently used entries of the cache until it holds at most
+ * maxSize bytes. keep, the entry just prepared, is never removed.
+ */
+void TrimCache(const std::string& cacheDirectory, std::uint64_t maxSize, const std::string& keep)
+{
+  struct Entry
+  {
+    std::string Directory;
+    std::uint64_t Size = 0;
+    long Time = 0;
+  };
+  std::vector<Entry> entries;
+  std::uint64_t totalSize = 0;
+  vtksys::Directory directory;
+  if (!directory.Load(cacheDirectory))
+  {
+    return;
+  }
+  for (unsigned long i = 0; i < directory.GetNumberOfFiles(); ++i)
+  {
+    const std::string name = directory.GetFile(i);
+    const std::string path = cacheDirectory + "/" + name;
+    if (name == "." || name == ".." || path == keep ||
+      !vtksys::SystemTools::FileIsDirectory(path))
+    {
+      continue;
+    }
+    Entry entry;
+    entry.Directory = path;
+    vtksys::Directory files;
+    files.Load(path);
+    for (unsigned long j = 0; j < files.GetNumberOfFiles(); ++j)
+    {
+      const std::string file = path + "/" + files.GetFile(j);
+      if (!vtksys::SystemTools::FileIsDirectory(file))
+      {
+        entry.Size += vtksys::SystemTools::FileLength(file);
+        entry.Time = std::max(entry.Time, vtksys::SystemTools::ModifiedTime(file));
+      }
+    }
+    totalSize += entry.Size;
+    entries.push_back(entry);
+  }
+  if (vtksys::SystemTools::FileIsDirectory(keep))
+  {
+    vtksys::Directory files;
+    files.Load(keep);
+    for (unsigned long j = 0; j < files.GetNumberOfFiles(); ++j)
+    {
+      totalSize += vtksys::SystemTools::FileLength(keep + "/" + files.GetFile(j));
+    }
+  }
+
+  std::sort(entries.begin(), entries.end(),
+    [](const Entry& a, const Entry& b) { return a.Time < b.Time; });
+  for (const Entry& entry : entries)
+  {
+    if (totalSize <= maxSize)
+    {
+      break;
+    }
+    // Fails on Windows while another reader has the file open, it is then
+    // evicted next time
+    if (static_cast<bool>(vtksys::SystemTools::RemoveADirectory(entry.Directory)))
+    {
+      totalSize -= entry.Size;
+    }
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCaptureConverter::IsCaptureFileName(const std::string& fileName)
+{
+  std::string name = fileName;
+  std::transform(name.begin(), name.end(), name.begin(),
+    [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  auto endsWith = [&name](const std::string& suffix) {
+    return name.size() >= suffix.size() &&
+      name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+  for (const char* compression : { ".gz", ".zst", ".zstd" })
+  {
+    if (endsWith(compression))
+    {
+      name.resize(name.size() - std::strlen(compression));
+      break;
+    }
+  }
+  return endsWith(".pcap") || endsWith(".pcapng");
+}
+
+//-----------------------------------------------------------------------------
+LidarCaptureConverter::CaptureFormat LidarCaptureConverter::DetectFormat(
+  const std::string& fileName)
+{
+  std::uint32_t magic = 0;
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (!file)
+  {
+    return UNKNOWN;
+  }
+  const bool ok = std::fread(&magic, sizeof(magic), 1, file) == 1;
+  std::fclose(file);
+  if (!ok)
+  {
+    return UNKNOWN;
+  }
+  if (magic == PCAP_MAGIC || magic == PCAP_NANO_MAGIC || Swap32(magic) == PCAP_MAGIC ||
+    Swap32(magic) == PCAP_NANO_MAGIC)
+  {
+    return PCAP;
+  }
+  // The section header block type is a palindrome
+  return magic == PCAPNG_SECTION_HEADER ? PCAPNG : UNKNOWN;
+}
+
+//-----------------------------------------------------------------------------
+std::string LidarCaptureConverter::Prepare(const std::string& fileName,
+  const std::string& cacheDirectory, std::string* error, std::uint64_t maxCacheSize)
+{
+  const LidarCompressedFile::Format compression = LidarCompressedFile::DetectFormat(fileName);
+  if (compression == LidarCompressedFile::NONE)
+  {
+    switch (LidarCaptureConverter::DetectFormat(fileName))
+    {
+      case PCAP:
+        return fileName;
+      case PCAPNG:
+        break;
+      default:
+        SetError(error, fileName + " is not a pcap, pcapng, gzip or zstd file");
+        return std::string();
+    }
+  }
+
+  // One entry per version of the source file
+  const std::string absolutePath = vtksys::SystemTools::CollapseFullPath(fileName);
+  const std::string key = absolutePath + "|" +
+    std::to_string(vtksys::SystemTools::FileLength(fileName)) + "|" +
+    std::to_string(vtksys::SystemTools::ModifiedTime(fileName));
+  const std::string entryDirectory =
+    cacheDirectory + "/" + LidarHash::ToHex(LidarHash::FNV1a(key));
+  const std::string cacheFileName = entryDirectory + "/" + GetCaptureStem(fileName) + ".pcap";
+  if (vtksys::SystemTools::FileExists(cacheFileName, true))
+  {
+    // Most recently used, for the eviction
+    vtksys::SystemTools::Touch(cacheFileName, false);
+    return cacheFileName;
+  }
+  if (!static_cast<bool>(vtksys::SystemTools::MakeDirectory(entryDirectory)))
+  {
+    SetError(error, "Unable to create " + entryDirectory);
+    return std::string();
+  }
+
+  // Write to temporary files first so that concurrent readers never see a
+  // partial cache entry
+  const std::string tmpFileName = cacheFileName + ".tmp";
+  bool ok = true;
+  if (compression == LidarCompressedFile::NONE)
+  {
+    ok = LidarCaptureConverter::ConvertPcapng(fileName, tmpFileName, error);
+  }
+  else
+  {
+    LidarCompressedFile compressed;
+    ok = compressed.Open(fileName, error);
+    char magic[4] = { 0, 0, 0, 0 };
+    if (ok && compressed.IsSeekable() && compressed.GetSize() >= sizeof(magic) &&
+      compressed.Read(0, sizeof(magic), magic) &&
+      std::memcmp(magic, &PCAPNG_SECTION_HEADER, sizeof(magic)) == 0)
+    {
+      // Seekable pcapng: converted while reading its blocks, without an
+      // intermediate decompressed copy
+      std::uint64_t offset = 0;
+      const std::uint64_t size = compressed.GetSize();
+      auto read = [&](void* buffer, std::size_t count) -> std::size_t {
+        count = static_cast<std::size_t>(std::min<std::uint64_t>(count, size - offset));
+        if (count == 0 || !compressed.Read(offset, count, static_cast<char*>(buffer)))
+        {
+          return 0;
+        }
+        offset += count;
+        return count;
+      };
+      ok = ConvertPcapngStream(read, fileName, tmpFileName, error);
+    }
+    else if (ok)
+    {
+      // Decompressed in parallel when seekable, then converted when needed
+      const std::string decompressedFileName = cacheFileName + ".decompressed.tmp";
+      ok = compressed.DecompressTo(decompressedFileName, error);
+      if (ok)
+      {
+        switch (LidarCaptureConverter::DetectFormat(decompressedFileName))
+        {
+          case PCAP:
+            ok = static_cast<bool>(
+              vtksys::SystemTools::RenameFile(decompressedFileName, tmpFileName));
+            if (!ok)
+            {
+              SetError(error, "Unable to write " + tmpFileName);
+            }
+            break;
+          case PCAPNG:
+            ok = LidarCaptureConverter::ConvertPcapng(decompressedFileName, tmpFileName, error);
+            break;
+          default:
+            SetError(error, fileName + " does not hold a pcap or pcapng capture");
+            ok = false;
+        }
+      }
+      vtksys::SystemTools::RemoveFile(decompressedFileName);
+    }
+  }
+  if (ok && !static_cast<bool>(vtksys::SystemTools::RenameFile(tmpFileName, cacheFileName)))
+  {
+    SetError(error, "Unable to write " + cacheFileName);
+    ok = false;
+  }
+  if (!ok)
+  {
+    vtksys::SystemTools::RemoveADirectory(entryDirectory);
+    return std::string();
+  }
+  TrimCache(cacheDirectory, maxCacheSize, entryDirectory);
+  return cacheFileName;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCaptureConverter::ConvertPcapng(
+  const std::string& inputFileName, const std::string& outputFileName, std::string* error)
+{
+  std::FILE* input = std::fopen(inputFileName.c_str(), "rb");
+  if (!input)
+  {
+    SetError(error, "Unable to open " + inputFileName);
+    return false;
+  }
+  std::vector<char> inputBuffer(1 << 20);
+  std::setvbuf(input, inputBuffer.data(), _IOFBF, inputBuffer.size());
+  auto read = [input](void* buffer, std::size_t size) {
+    return std::fread(buffer, 1, size, input);
+  };
+  const bool ok = ConvertPcapngStream(read, inputFileName, outputFileName, error);
+  std::fclose(input);
+  return ok;
+}
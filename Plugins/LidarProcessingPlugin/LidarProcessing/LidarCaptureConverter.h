@@ -0,0 +1,83 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCaptureConverter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarCaptureConverter_h
+#define LidarCaptureConverter_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class LidarCaptureConverter
+ * @brief Turn pcapng and compressed captures into classic pcap files.
+ *
+ * The LidarReader indexes and seeks in classic pcap files only. Captures
+ * saved as pcapng, or compressed with gzip or zstd, are fully converted once
+ * to a classic pcap stored in a cache directory, which the reader then uses
+ * in place of the recording, and reused as long as the source file is not
+ * modified. Decompression goes through LidarCompressedFile: a
+ * seekable (BGZF or seekable zstd) pcap is decompressed in parallel, a
+ * seekable pcapng is converted while reading its blocks, without an
+ * intermediate decompressed copy.
+ *
+ * The cache is bounded: once a capture is prepared, the least recently used
+ * entries are removed until the cache fits in its maximum size. The cached
+ * copy keeps the name of the recording, in its own directory.
+ *
+ * Classic pcap files are used in place.
+ */
+class LIDARPROCESSING_EXPORT LidarCaptureConverter
+{
+public:
+  enum CaptureFormat
+  {
+    UNKNOWN = 0,
+    PCAP,
+    PCAPNG
+  };
+
+  /**
+   * Whether fileName has a capture extension: .pcap or .pcapng, optionally
+   * followed by .gz or .zst.
+   */
+  static bool IsCaptureFileName(const std::string& fileName);
+
+  /**
+   * Format of an uncompressed capture, from its first bytes.
+   */
+  static CaptureFormat DetectFormat(const std::string& fileName);
+
+  /**
+   * Default maximum size of the cache directory, 8 GiB.
+   */
+  static constexpr std::uint64_t DEFAULT_MAX_CACHE_SIZE = std::uint64_t(8) << 30;
+
+  /**
+   * Classic pcap holding the packets of fileName: fileName itself when it is
+   * one, a converted copy in cacheDirectory otherwise. Returns an empty string
+   * and fills error on failure. Blocks until the conversion is done, call it
+   * from a worker thread in interactive applications.
+   */
+  static std::string Prepare(const std::string& fileName, const std::string& cacheDirectory,
+    std::string* error = nullptr, std::uint64_t maxCacheSize = DEFAULT_MAX_CACHE_SIZE);
+
+  /**
+   * Convert a pcapng file to a classic pcap with microsecond timestamps. Only
+   * the packets of the interfaces sharing the link type of the first one are
+   * kept.
+   */
+  static bool ConvertPcapng(const std::string& inputFileName, const std::string& outputFileName,
+    std::string* error = nullptr);
+};
+
+#endif // LidarCaptureConverter_h
@@ -0,0 +1,357 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCompactFrame.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarCompactFrame.h"
+
+#include "LidarFrameBuffer.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkTemplateAliasMacro.h>
+#include <vtkTypeUInt32Array.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+template <typename OutT>
+OutT Quantize(double value, double offset, double quantum)
+{
+  const double q = std::round((value - offset) / quantum);
+  const double maxValue = static_cast<double>(std::numeric_limits<OutT>::max());
+  // NaN comparisons are false, so NaN ends up as 0
+  return q > 0. ? static_cast<OutT>(std::min(q, maxValue)) : OutT(0);
+}
+
+//-----------------------------------------------------------------------------
+template <typename InT, typename OutT>
+void QuantizeValues(const InT* in, vtkIdType nbValues, double offset, double quantum, OutT* out)
+{
+  vtkSMPTools::For(0, nbValues, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      out[i] = Quantize<OutT>(static_cast<double>(in[i]), offset, quantum);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+template <typename OutT>
+void QuantizeArray(vtkDataArray* array, vtkIdType nbValues, double offset, double quantum, OutT* out)
+{
+  if (!array)
+  {
+    std::fill(out, out + nbValues, OutT(0));
+    return;
+  }
+  switch (array->GetDataType())
+  {
+    vtkTemplateAliasMacro(QuantizeValues(
+      static_cast<const VTK_TT*>(array->GetVoidPointer(0)), nbValues, offset, quantum, out));
+    default:
+      std::fill(out, out + nbValues, OutT(0));
+  }
+}
+
+//-----------------------------------------------------------------------------
+template <bool Transform, typename T>
+void PackPositionsRange(const T* in, vtkIdType begin, vtkIdType end, const double* m,
+  float* positions, std::uint16_t* ranges, double rangeQuantum)
+{
+  // Branch free inner loop so that the compiler can vectorize it
+  for (vtkIdType i = begin; i < end; ++i)
+  {
+    const double x = in[3 * i], y = in[3 * i + 1], z = in[3 * i + 2];
+    float* q = positions + 3 * i;
+    if (Transform)
+    {
+      q[0] = static_cast<float>(m[0] * x + m[1] * y + m[2] * z + m[3]);
+      q[1] = static_cast<float>(m[4] * x + m[5] * y + m[6] * z + m[7]);
+      q[2] = static_cast<float>(m[8] * x + m[9] * y + m[10] * z + m[11]);
+    }
+    else
+    {
+      q[0] = static_cast<float>(x);
+      q[1] = static_cast<float>(y);
+      q[2] = static_cast<float>(z);
+    }
+  }
+  if (ranges)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const double x = in[3 * i], y = in[3 * i + 1], z = in[3 * i + 2];
+      ranges[i] = Quantize<std::uint16_t>(std::sqrt(x * x + y * y + z * z), 0., rangeQuantum);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void PackPositions(const T* in, vtkIdType nbPoints, const double* m, float* positions,
+  std::uint16_t* ranges, double rangeQuantum)
+{
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    if (m)
+    {
+      PackPositionsRange<true>(in, begin, end, m, positions, ranges, rangeQuantum);
+    }
+    else
+    {
+      PackPositionsRange<false>(in, begin, end, m, positions, ranges, rangeQuantum);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* GetScalarArray(vtkPolyData* frame, const std::string& name)
+{
+  vtkDataArray* array = frame->GetPointData()->GetArray(name.c_str());
+  return (array && array->GetNumberOfComponents() == 1) ? array : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+template <typename ArrayT, typename ValueT>
+vtkSmartPointer<ArrayT> NewView(LidarFrameBuffer* buffer, ValueT* values, vtkIdType nbTuples,
+  int nbComponents, const char* name)
+{
+  // Each view owns one reference on the buffer, released by its free function
+  buffer->Register();
+  auto array = vtkSmartPointer<ArrayT>::New();
+  array->SetName(name);
+  array->SetNumberOfComponents(nbComponents);
+  array->SetArray(values, nbTuples * nbComponents, 0, ArrayT::VTK_DATA_ARRAY_USER_DEFINED);
+  array->SetArrayFreeFunction(LidarFrameBuffer::ReleaseSection);
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+void AddFieldValue(vtkFieldData* fieldData, const char* name, double value)
+{
+  vtkNew<vtkDoubleArray> array;
+  array->SetName(name);
+  array->InsertNextValue(value);
+  fieldData->AddArray(array);
+}
+}
+
+const char* const LidarCompactFrame::TIMESTAMP_OFFSET_ARRAY_NAME = "timestamp_offset";
+const char* const LidarCompactFrame::RANGE_ARRAY_NAME = "distance_q";
+
+//-----------------------------------------------------------------------------
+LidarCompactFrame::LidarCompactFrame() = default;
+
+//-----------------------------------------------------------------------------
+LidarCompactFrame::~LidarCompactFrame()
+{
+  this->Reset();
+}
+
+//-----------------------------------------------------------------------------
+void LidarCompactFrame::Reset()
+{
+  if (this->Buffer)
+  {
+    this->Buffer->UnRegister();
+    this->Buffer = nullptr;
+  }
+  this->NumberOfPoints = 0;
+  this->TimestampBase = 0.;
+}
+
+//-----------------------------------------------------------------------------
+void LidarCompactFrame::SetTransform(const double matrix[16])
+{
+  this->TransformEnabled = matrix != nullptr;
+  if (matrix)
+  {
+    std::copy(matrix, matrix + 16, this->Transform);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarCompactFrame::GetPointSize(Section section)
+{
+  switch (section)
+  {
+    case POSITIONS:
+      return 3 * sizeof(float);
+    case TIMESTAMPS:
+      return sizeof(std::uint32_t);
+    case INTENSITY:
+    case RANGE:
+      return sizeof(std::uint16_t);
+    case LASER_ID:
+      return sizeof(std::uint8_t);
+    default:
+      return 0;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarCompactFrame::Allocate(vtkIdType nbPoints, double timestampBase)
+{
+  this->Reset();
+  const std::size_t n = static_cast<std::size_t>(nbPoints);
+  std::vector<std::size_t> sizes(NUMBER_OF_SECTIONS);
+  for (int section = 0; section < NUMBER_OF_SECTIONS; ++section)
+  {
+    sizes[section] = n * LidarCompactFrame::GetPointSize(static_cast<Section>(section));
+  }
+  this->Buffer = LidarFrameBuffer::New(sizes);
+  this->NumberOfPoints = nbPoints;
+  this->TimestampBase = timestampBase;
+}
+
+//-----------------------------------------------------------------------------
+void LidarCompactFrame::Pack(vtkPolyData* frame)
+{
+  const vtkIdType nbPoints = frame ? frame->GetNumberOfPoints() : 0;
+  this->Allocate(nbPoints, 0.);
+  if (nbPoints == 0)
+  {
+    return;
+  }
+
+  float* positions = static_cast<float*>(this->GetSection(POSITIONS));
+  auto timestamps = static_cast<std::uint32_t*>(this->GetSection(TIMESTAMPS));
+  auto intensities = static_cast<std::uint16_t*>(this->GetSection(INTENSITY));
+  auto ranges = static_cast<std::uint16_t*>(this->GetSection(RANGE));
+  auto laserIds = static_cast<std::uint8_t*>(this->GetSection(LASER_ID));
+
+  // Positions, transformed in the same pass, and the range when the
+  // interpreter does not provide it
+  const double* matrix = this->TransformEnabled ? this->Transform : nullptr;
+  vtkDataArray* rangeArray = GetScalarArray(frame, this->RangeArrayName);
+  std::uint16_t* computedRanges = rangeArray ? nullptr : ranges;
+  vtkDataArray* points = frame->GetPoints()->GetData();
+  if (auto floatPoints = vtkFloatArray::FastDownCast(points))
+  {
+    PackPositions(
+      floatPoints->GetPointer(0), nbPoints, matrix, positions, computedRanges, this->RangeQuantum);
+  }
+  else if (auto doublePoints = vtkDoubleArray::FastDownCast(points))
+  {
+    PackPositions(
+      doublePoints->GetPointer(0), nbPoints, matrix, positions, computedRanges, this->RangeQuantum);
+  }
+  else
+  {
+    vtkNew<vtkDoubleArray> converted;
+    converted->DeepCopy(points);
+    PackPositions(
+      converted->GetPointer(0), nbPoints, matrix, positions, computedRanges, this->RangeQuantum);
+  }
+  if (rangeArray)
+  {
+    QuantizeArray(rangeArray, nbPoints, 0., this->RangeQuantum, ranges);
+  }
+
+  // Timestamps are stored relative to the earliest one of the frame
+  vtkDataArray* timestampArray = GetScalarArray(frame, this->TimestampArrayName);
+  this->TimestampBase = timestampArray ? timestampArray->GetRange(0)[0] : 0.;
+  QuantizeArray(timestampArray, nbPoints, this->TimestampBase, this->TimestampQuantum, timestamps);
+
+  QuantizeArray(GetScalarArray(frame, this->IntensityArrayName), nbPoints, 0.,
+    this->IntensityQuantum, intensities);
+  QuantizeArray(GetScalarArray(frame, this->LaserIdArrayName), nbPoints, 0., 1., laserIds);
+}
+
+//-----------------------------------------------------------------------------
+void LidarCompactFrame::ExportTo(vtkPolyData* output) const
+{
+  const vtkIdType n = this->NumberOfPoints;
+  vtkNew<vtkPoints> points;
+  if (this->Buffer && n > 0)
+  {
+    points->SetData(NewView<vtkFloatArray>(this->Buffer,
+      static_cast<float*>(this->GetSection(POSITIONS)), n, 3, "Points"));
+
+    vtkPointData* pointData = output->GetPointData();
+    pointData->AddArray(NewView<vtkTypeUInt32Array>(this->Buffer,
+      static_cast<std::uint32_t*>(this->GetSection(TIMESTAMPS)), n, 1,
+      TIMESTAMP_OFFSET_ARRAY_NAME));
+    pointData->AddArray(NewView<vtkUnsignedShortArray>(this->Buffer,
+      static_cast<std::uint16_t*>(this->GetSection(INTENSITY)), n, 1,
+      this->IntensityArrayName.c_str()));
+    pointData->AddArray(NewView<vtkUnsignedShortArray>(this->Buffer,
+      static_cast<std::uint16_t*>(this->GetSection(RANGE)), n, 1, RANGE_ARRAY_NAME));
+    pointData->AddArray(NewView<vtkUnsignedCharArray>(this->Buffer,
+      static_cast<std::uint8_t*>(this->GetSection(LASER_ID)), n, 1,
+      this->LaserIdArrayName.c_str()));
+  }
+  else
+  {
+    points->SetDataTypeToFloat();
+  }
+  output->SetPoints(points);
+
+  vtkFieldData* fieldData = output->GetFieldData();
+  AddFieldValue(fieldData, "timestamp_base", this->TimestampBase);
+  AddFieldValue(fieldData, "timestamp_quantum", this->TimestampQuantum);
+  AddFieldValue(fieldData, "intensity_quantum", this->IntensityQuantum);
+  AddFieldValue(fieldData, "range_quantum", this->RangeQuantum);
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarCompactFrame::GetAllocatedSize() const
+{
+  return this->Buffer ? this->Buffer->GetAllocatedSize() : 0;
+}
+
+//-----------------------------------------------------------------------------
+void* LidarCompactFrame::GetSection(Section section) const
+{
+  return this->Buffer ? this->Buffer->GetSection(section) : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+const float* LidarCompactFrame::GetPositions() const
+{
+  return static_cast<const float*>(this->GetSection(POSITIONS));
+}
+
+//-----------------------------------------------------------------------------
+const std::uint32_t* LidarCompactFrame::GetTimestampOffsets() const
+{
+  return static_cast<const std::uint32_t*>(this->GetSection(TIMESTAMPS));
+}
+
+//-----------------------------------------------------------------------------
+const std::uint16_t* LidarCompactFrame::GetIntensities() const
+{
+  return static_cast<const std::uint16_t*>(this->GetSection(INTENSITY));
+}
+
+//-----------------------------------------------------------------------------
+const std::uint16_t* LidarCompactFrame::GetRanges() const
+{
+  return static_cast<const std::uint16_t*>(this->GetSection(RANGE));
+}
+
+//-----------------------------------------------------------------------------
+const std::uint8_t* LidarCompactFrame::GetLaserIds() const
+{
+  return static_cast<const std::uint8_t*>(this->GetSection(LASER_ID));
+}
@@ -0,0 +1,165 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCompactFrame.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarCompactFrame_h
+#define LidarCompactFrame_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class LidarFrameBuffer;
+class vtkPolyData;
+
+/**
+ * @class LidarCompactFrame
+ * @brief Compact structure-of-arrays storage of a lidar frame.
+ *
+ * All the arrays of a frame live in a single LidarFrameBuffer allocation:
+ *  - positions as float32 x, y, z triplets (12 bytes)
+ *  - timestamps as uint32 offsets from a per frame base value (4 bytes)
+ *  - intensity and range quantized to uint16 (2 + 2 bytes)
+ *  - laser id as uint8 (1 byte)
+ *
+ * That is 21 bytes per point, to compare with the double precision arrays
+ * produced by the interpreters. ExportTo() exposes the arrays to VTK without
+ * any copy: the VTK arrays keep the buffer alive until they are released.
+ *
+ * The quantization steps are stored in the field data of the exported frame
+ * ("timestamp_base", "timestamp_quantum", "intensity_quantum", "range_quantum")
+ * so that the original values can be recovered.
+ */
+class LIDARPROCESSING_EXPORT LidarCompactFrame
+{
+public:
+  enum Section
+  {
+    POSITIONS = 0,
+    TIMESTAMPS,
+    INTENSITY,
+    RANGE,
+    LASER_ID,
+    NUMBER_OF_SECTIONS
+  };
+
+  LidarCompactFrame();
+  ~LidarCompactFrame();
+  LidarCompactFrame(const LidarCompactFrame&) = delete;
+  void operator=(const LidarCompactFrame&) = delete;
+
+  //@{
+  /**
+   * Quantization steps, in the units of the source arrays.
+   * Default: 4mm for the range (up to 262m), 1 for intensity and timestamps.
+   */
+  double RangeQuantum = 0.004;
+  double IntensityQuantum = 1.;
+  double TimestampQuantum = 1.;
+  //@}
+
+  //@{
+  /**
+   * Names of the source arrays. The range is computed from the positions when
+   * its array is missing, the other missing arrays are filled with 0.
+   */
+  std::string IntensityArrayName = "intensity";
+  std::string LaserIdArrayName = "laser_id";
+  std::string RangeArrayName = "distance_m";
+  std::string TimestampArrayName = "timestamp";
+  //@}
+
+  /**
+   * Set the row-major 4x4 affine matrix applied to the positions while they
+   * are packed, typically the sensor transform composed with the pose of the
+   * frame. nullptr disables the transform. The range, when computed from the
+   * positions, uses the untransformed ones.
+   */
+  void SetTransform(const double matrix[16]);
+  bool HasTransform() const { return this->TransformEnabled; }
+
+  /**
+   * Allocate the buffer and fill it from a decoded frame, applying the
+   * transform in the same pass.
+   */
+  void Pack(vtkPolyData* frame);
+
+  /**
+   * Allocate the buffer for nbPoints points without filling it, for readers of
+   * frames already stored in the compact layout (see GetMutableSection()).
+   */
+  void Allocate(vtkIdType nbPoints, double timestampBase);
+
+  /**
+   * Size of the values of a section, in bytes per point.
+   */
+  static std::size_t GetPointSize(Section section);
+
+  /**
+   * Release the buffer. Arrays previously exported stay valid.
+   */
+  void Reset();
+
+  /**
+   * Expose the compact arrays as points and point data of output, without copy:
+   * the quantized timestamps, intensity and range are not converted back to
+   * their source units. Output vertices are not modified.
+   */
+  void ExportTo(vtkPolyData* output) const;
+
+  //@{
+  /**
+   * Names of the exported quantized arrays.
+   */
+  static const char* const TIMESTAMP_OFFSET_ARRAY_NAME;
+  static const char* const RANGE_ARRAY_NAME;
+  //@}
+
+  vtkIdType GetNumberOfPoints() const { return this->NumberOfPoints; }
+  double GetTimestampBase() const { return this->TimestampBase; }
+
+  /**
+   * Size of the allocation holding the frame, in bytes.
+   */
+  std::size_t GetAllocatedSize() const;
+
+  //@{
+  /**
+   * Raw access to the compact arrays, valid until the next Pack() or Reset().
+   */
+  const float* GetPositions() const;
+  const std::uint32_t* GetTimestampOffsets() const;
+  const std::uint16_t* GetIntensities() const;
+  const std::uint16_t* GetRanges() const;
+  const std::uint8_t* GetLaserIds() const;
+  void* GetMutableSection(Section section) { return this->GetSection(section); }
+  //@}
+
+  double GetTimestamp(vtkIdType i) const
+  {
+    return this->TimestampBase + this->GetTimestampOffsets()[i] * this->TimestampQuantum;
+  }
+  double GetRange(vtkIdType i) const { return this->GetRanges()[i] * this->RangeQuantum; }
+
+private:
+  void* GetSection(Section section) const;
+
+  LidarFrameBuffer* Buffer = nullptr;
+  vtkIdType NumberOfPoints = 0;
+  double TimestampBase = 0.;
+  double Transform[16];
+  bool TransformEnabled = false;
+};
+
+#endif // LidarCompactFrame_h
@@ -0,0 +1,540 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCompressedFile.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarCompressedFile.h"
+
+#include "LidarTaskPool.h"
+
+#include <vtk_zlib.h>
+#include <vtksys/SystemTools.hxx>
+
+#ifdef LIDARVIEW_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+
+namespace
+{
+constexpr std::uint32_t ZSTD_MAGIC = 0xFD2FB528;
+constexpr std::uint32_t ZSTD_SKIPPABLE_MAGIC = 0x184D2A50;
+constexpr std::uint32_t ZSTD_SEEK_TABLE_MAGIC = 0x184D2A5E;
+constexpr std::uint32_t ZSTD_SEEKABLE_MAGIC = 0x8F92EAB1;
+constexpr std::size_t ZSTD_SEEK_FOOTER_SIZE = 9;
+
+constexpr std::size_t STREAM_BUFFER_SIZE = 1 << 20;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::uint32_t ReadLittleEndian32(const unsigned char* p)
+{
+  return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+    (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+//-----------------------------------------------------------------------------
+bool ReadAt(std::FILE* file, std::uint64_t offset, std::size_t size, void* buffer)
+{
+#ifdef _WIN32
+  const int status = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+  const int status = fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  return status == 0 && std::fread(buffer, 1, size, file) == size;
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Decompress a single gzip member or zstd frame whose size is known.
+ */
+bool DecompressBlock(LidarCompressedFile::Format format, const std::vector<char>& input,
+  char* output, std::uint32_t outputSize)
+{
+  if (format == LidarCompressedFile::GZIP)
+  {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    {
+      return false;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output);
+    stream.avail_out = outputSize;
+    const int status = inflate(&stream, Z_FINISH);
+    const bool ok = status == Z_STREAM_END && stream.total_out == outputSize;
+    inflateEnd(&stream);
+    return ok;
+  }
+#ifdef LIDARVIEW_USE_ZSTD
+  if (format == LidarCompressedFile::ZSTD)
+  {
+    const std::size_t size = ZSTD_decompress(output, outputSize, input.data(), input.size());
+    return !ZSTD_isError(size) && size == outputSize;
+  }
+#endif
+  return false;
+}
+}
+
+//-----------------------------------------------------------------------------
+LidarCompressedFile::Format LidarCompressedFile::DetectFormat(const std::string& fileName)
+{
+  unsigned char magic[4];
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (!file)
+  {
+    return NONE;
+  }
+  const bool ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic);
+  std::fclose(file);
+  if (!ok)
+  {
+    return NONE;
+  }
+  if (magic[0] == 0x1F && magic[1] == 0x8B)
+  {
+    return GZIP;
+  }
+  const std::uint32_t value = ReadLittleEndian32(magic);
+  if (value == ZSTD_MAGIC || (value & 0xFFFFFFF0) == ZSTD_SKIPPABLE_MAGIC)
+  {
+    return ZSTD;
+  }
+  return NONE;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::IsFormatAvailable(Format format)
+{
+#ifdef LIDARVIEW_USE_ZSTD
+  return format == GZIP || format == ZSTD;
+#else
+  return format == GZIP;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::Open(const std::string& fileName, std::string* error)
+{
+  this->FileName = fileName;
+  this->FileFormat = LidarCompressedFile::DetectFormat(fileName);
+  this->Blocks.clear();
+  {
+    std::lock_guard<std::mutex> lock(this->CacheMutex);
+    this->CachedBlock = static_cast<std::size_t>(-1);
+    this->CachedData.clear();
+  }
+
+  if (this->FileFormat == NONE)
+  {
+    SetError(error, fileName + " is not a gzip or zstd file");
+    return false;
+  }
+  if (!LidarCompressedFile::IsFormatAvailable(this->FileFormat))
+  {
+    SetError(error, "LidarView was built without zstd support, unable to read " + fileName);
+    return false;
+  }
+
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (!file)
+  {
+    SetError(error, "Unable to open " + fileName);
+    return false;
+  }
+  const std::uint64_t fileSize = vtksys::SystemTools::FileLength(fileName);
+  // A file without block structure is still readable as a stream
+  const bool indexed = this->FileFormat == GZIP ? this->IndexGzip(file, fileSize)
+                                                : this->IndexZstd(file, fileSize);
+  if (!indexed)
+  {
+    this->Blocks.clear();
+  }
+  std::fclose(file);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::IndexGzip(std::FILE* file, std::uint64_t fileSize)
+{
+  // BGZF: each member carries its compressed size in a "BC" extra subfield,
+  // and its decompressed size is the ISIZE field of its trailer
+  std::uint64_t offset = 0;
+  std::uint64_t decompressedOffset = 0;
+  std::vector<unsigned char> extra;
+  while (offset < fileSize)
+  {
+    unsigned char header[12];
+    if (!ReadAt(file, offset, sizeof(header), header) || header[0] != 0x1F ||
+      header[1] != 0x8B || header[2] != 8 || !(header[3] & 0x04))
+    {
+      return false;
+    }
+    extra.resize(header[10] | (header[11] << 8));
+    if (std::fread(extra.data(), 1, extra.size(), file) != extra.size())
+    {
+      return false;
+    }
+    std::uint32_t blockSize = 0;
+    for (std::size_t i = 0; i + 4 <= extra.size(); i += 4 + (extra[i + 2] | (extra[i + 3] << 8)))
+    {
+      if (extra[i] == 'B' && extra[i + 1] == 'C' && extra[i + 2] == 2 && i + 6 <= extra.size())
+      {
+        blockSize = (extra[i + 4] | (extra[i + 5] << 8)) + 1u;
+        break;
+      }
+    }
+    unsigned char trailer[4];
+    if (blockSize <= sizeof(header) + extra.size() + 8 || offset + blockSize > fileSize ||
+      !ReadAt(file, offset + blockSize - sizeof(trailer), sizeof(trailer), trailer))
+    {
+      return false;
+    }
+    Block block;
+    block.CompressedOffset = offset;
+    block.CompressedSize = blockSize;
+    block.Offset = decompressedOffset;
+    block.Size = ReadLittleEndian32(trailer);
+    // Skip empty members such as the BGZF end of file marker
+    if (block.Size > 0)
+    {
+      this->Blocks.push_back(block);
+    }
+    offset += blockSize;
+    decompressedOffset += block.Size;
+  }
+  return !this->Blocks.empty();
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::IndexZstd(std::FILE* file, std::uint64_t fileSize)
+{
+  // Seekable format: the file ends with a skippable frame listing the
+  // compressed and decompressed size of every frame
+  unsigned char footer[ZSTD_SEEK_FOOTER_SIZE];
+  if (fileSize < 8 + ZSTD_SEEK_FOOTER_SIZE ||
+    !ReadAt(file, fileSize - sizeof(footer), sizeof(footer), footer) ||
+    ReadLittleEndian32(footer + 5) != ZSTD_SEEKABLE_MAGIC)
+  {
+    return false;
+  }
+  const std::uint64_t nbFrames = ReadLittleEndian32(footer);
+  const std::uint64_t entrySize = (footer[4] & 0x80) ? 12 : 8;
+  const std::uint64_t tableSize = 8 + nbFrames * entrySize + ZSTD_SEEK_FOOTER_SIZE;
+  if (tableSize > fileSize)
+  {
+    return false;
+  }
+  std::vector<unsigned char> table(static_cast<std::size_t>(tableSize));
+  if (!ReadAt(file, fileSize - tableSize, table.size(), table.data()) ||
+    ReadLittleEndian32(table.data()) != ZSTD_SEEK_TABLE_MAGIC ||
+    ReadLittleEndian32(table.data() + 4) != tableSize - 8)
+  {
+    return false;
+  }
+
+  std::uint64_t offset = 0;
+  std::uint64_t decompressedOffset = 0;
+  for (std::uint64_t frame = 0; frame < nbFrames; ++frame)
+  {
+    const unsigned char* entry = table.data() + 8 + frame * entrySize;
+    Block block;
+    block.CompressedOffset = offset;
+    block.CompressedSize = ReadLittleEndian32(entry);
+    block.Offset = decompressedOffset;
+    block.Size = ReadLittleEndian32(entry + 4);
+    if (block.Size > 0)
+    {
+      this->Blocks.push_back(block);
+    }
+    offset += block.CompressedSize;
+    decompressedOffset += block.Size;
+  }
+  // The frames must exactly cover the file up to the seek table
+  return offset == fileSize - tableSize && !this->Blocks.empty();
+}
+
+//-----------------------------------------------------------------------------
+std::uint64_t LidarCompressedFile::GetSize() const
+{
+  return this->Blocks.empty() ? 0 : this->Blocks.back().Offset + this->Blocks.back().Size;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::Read(
+  std::uint64_t offset, std::size_t size, char* buffer, std::string* error) const
+{
+  if (!this->IsSeekable())
+  {
+    SetError(error, this->FileName + " is not seekable");
+    return false;
+  }
+  if (offset + size > this->GetSize())
+  {
+    SetError(error, "Read past the end of " + this->FileName);
+    return false;
+  }
+
+  auto isBefore = [](std::uint64_t value, const Block& block) { return value < block.Offset; };
+  std::size_t index = static_cast<std::size_t>(
+    std::upper_bound(this->Blocks.begin(), this->Blocks.end(), offset, isBefore) -
+    this->Blocks.begin() - 1);
+  std::FILE* file = nullptr;
+  std::vector<char> compressed;
+  std::vector<char> data;
+  bool ok = true;
+  while (size > 0 && ok)
+  {
+    const Block& block = this->Blocks[index];
+    const std::size_t begin = static_cast<std::size_t>(offset - block.Offset);
+    const std::size_t count = std::min<std::size_t>(size, block.Size - begin);
+    bool cached;
+    {
+      std::lock_guard<std::mutex> lock(this->CacheMutex);
+      cached = this->CachedBlock == index;
+      if (cached)
+      {
+        std::memcpy(buffer, this->CachedData.data() + begin, count);
+      }
+    }
+    if (!cached)
+    {
+      // Decompress out of the lock so that concurrent reads of other blocks
+      // do not wait on each other
+      if (!file)
+      {
+        file = std::fopen(this->FileName.c_str(), "rb");
+      }
+      compressed.resize(block.CompressedSize);
+      data.resize(block.Size);
+      ok = file && ReadAt(file, block.CompressedOffset, compressed.size(), compressed.data()) &&
+        DecompressBlock(this->FileFormat, compressed, data.data(), block.Size);
+      if (ok)
+      {
+        std::memcpy(buffer, data.data() + begin, count);
+        std::lock_guard<std::mutex> lock(this->CacheMutex);
+        this->CachedBlock = index;
+        this->CachedData.swap(data);
+      }
+    }
+    buffer += count;
+    offset += count;
+    size -= count;
+    ++index;
+  }
+  if (file)
+  {
+    std::fclose(file);
+  }
+  if (!ok)
+  {
+    SetError(error, "Unable to decompress " + this->FileName);
+  }
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::DecompressTo(
+  const std::string& outputFileName, std::string* error) const
+{
+  if (this->FileFormat == NONE)
+  {
+    SetError(error, "No compressed file opened");
+    return false;
+  }
+  std::FILE* output = std::fopen(outputFileName.c_str(), "wb");
+  if (!output)
+  {
+    SetError(error, "Unable to open " + outputFileName);
+    return false;
+  }
+  std::vector<char> outputBuffer(STREAM_BUFFER_SIZE);
+  std::setvbuf(output, outputBuffer.data(), _IOFBF, outputBuffer.size());
+
+  bool ok = true;
+  if (!this->IsSeekable())
+  {
+    ok = this->StreamTo(output, error);
+  }
+  else
+  {
+    std::FILE* input = std::fopen(this->FileName.c_str(), "rb");
+    ok = input != nullptr;
+    if (!ok)
+    {
+      SetError(error, "Unable to open " + this->FileName);
+    }
+
+    // Blocks are read here and decompressed on the pool, with enough of them
+    // in flight to keep it busy; an empty result marks a corrupted block
+    LidarTaskPool& pool = LidarTaskPool::GetInstance();
+    const std::size_t maxPending = 2 * pool.GetNumberOfThreads();
+    std::deque<std::future<std::vector<char>>> pending;
+    auto writeNext = [&]() {
+      const std::vector<char> data = pending.front().get();
+      pending.pop_front();
+      if (data.empty())
+      {
+        SetError(error, "Unable to decompress " + this->FileName);
+        return false;
+      }
+      if (std::fwrite(data.data(), 1, data.size(), output) != data.size())
+      {
+        SetError(error, "Unable to write " + outputFileName);
+        return false;
+      }
+      return true;
+    };
+    const Format format = this->FileFormat;
+    for (std::size_t i = 0; i < this->Blocks.size() && ok; ++i)
+    {
+      while (pending.size() >= maxPending && ok)
+      {
+        ok = writeNext();
+      }
+      const Block block = this->Blocks[i];
+      auto compressed = std::make_shared<std::vector<char>>(block.CompressedSize);
+      if (!ok || !ReadAt(input, block.CompressedOffset, compressed->size(), compressed->data()))
+      {
+        SetError(error, "Unable to read " + this->FileName);
+        ok = false;
+        break;
+      }
+      pending.push_back(pool.Submit([compressed, block, format]() {
+        std::vector<char> data(block.Size);
+        if (!DecompressBlock(format, *compressed, data.data(), block.Size))
+        {
+          data.clear();
+        }
+        return data;
+      }));
+    }
+    while (!pending.empty() && ok)
+    {
+      ok = writeNext();
+    }
+    if (input)
+    {
+      std::fclose(input);
+    }
+  }
+
+  if (std::fclose(output) != 0 && ok)
+  {
+    SetError(error, "Unable to write " + outputFileName);
+    ok = false;
+  }
+  if (!ok)
+  {
+    vtksys::SystemTools::RemoveFile(outputFileName);
+  }
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCompressedFile::StreamTo(std::FILE* output, std::string* error) const
+{
+  std::FILE* input = std::fopen(this->FileName.c_str(), "rb");
+  if (!input)
+  {
+    SetError(error, "Unable to open " + this->FileName);
+    return false;
+  }
+  std::vector<char> in(STREAM_BUFFER_SIZE);
+  std::vector<char> out(4 * STREAM_BUFFER_SIZE);
+  bool ok = true;
+  // Whether the input ended on a gzip member or zstd frame boundary
+  bool complete = false;
+
+  if (this->FileFormat == GZIP)
+  {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    ok = inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK;
+    // Whether the previous call left no pending output in zlib
+    bool flushed = true;
+    while (ok)
+    {
+      if (stream.avail_in == 0 && flushed)
+      {
+        stream.avail_in = static_cast<uInt>(std::fread(in.data(), 1, in.size(), input));
+        stream.next_in = reinterpret_cast<Bytef*>(in.data());
+        if (stream.avail_in == 0)
+        {
+          break;
+        }
+      }
+      stream.next_out = reinterpret_cast<Bytef*>(out.data());
+      stream.avail_out = static_cast<uInt>(out.size());
+      const int status = inflate(&stream, Z_NO_FLUSH);
+      const std::size_t produced = out.size() - stream.avail_out;
+      ok = (status == Z_OK || status == Z_STREAM_END || status == Z_BUF_ERROR) &&
+        std::fwrite(out.data(), 1, produced, output) == produced;
+      flushed = stream.avail_out != 0;
+      complete = status == Z_STREAM_END || (complete && produced == 0);
+      if (status == Z_STREAM_END)
+      {
+        // Concatenated members, as written by pigz or cat
+        inflateReset(&stream);
+      }
+    }
+    inflateEnd(&stream);
+  }
+#ifdef LIDARVIEW_USE_ZSTD
+  else if (this->FileFormat == ZSTD)
+  {
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    ok = stream != nullptr;
+    std::size_t status = 0;
+    while (ok)
+    {
+      ZSTD_inBuffer inBuffer = { in.data(), std::fread(in.data(), 1, in.size(), input), 0 };
+      if (inBuffer.size == 0)
+      {
+        break;
+      }
+      // Until the input is consumed and the decoder has no pending output
+      for (bool full = true; ok && (inBuffer.pos < inBuffer.size || full);)
+      {
+        ZSTD_outBuffer outBuffer = { out.data(), out.size(), 0 };
+        status = ZSTD_decompressStream(stream, &outBuffer, &inBuffer);
+        ok = !ZSTD_isError(status) &&
+          std::fwrite(out.data(), 1, outBuffer.pos, output) == outBuffer.pos;
+        full = outBuffer.pos == outBuffer.size;
+      }
+    }
+    complete = ok && status == 0;
+    ZSTD_freeDStream(stream);
+  }
+#endif
+  std::fclose(input);
+
+  if (!ok || !complete)
+  {
+    SetError(error, this->FileName + (ok ? " is truncated" : " is corrupted"));
+    return false;
+  }
+  return true;
+}
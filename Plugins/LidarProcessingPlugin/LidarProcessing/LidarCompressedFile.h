@@ -0,0 +1,118 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCompressedFile.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarCompressedFile_h
+#define LidarCompressedFile_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class LidarCompressedFile
+ * @brief gzip or zstd compressed file, with random access when seekable.
+ *
+ * Opening the file builds an index of its independently compressed blocks:
+ * the members of a BGZF file (blocked gzip, as written by bgzip) or the
+ * frames listed in the seek table of a seekable zstd file (as written by the
+ * zstd seekable format, e.g. t2sz). Reading a byte range then only
+ * decompresses the blocks it covers, and decompressing the whole file runs
+ * the blocks in parallel on the LidarTaskPool while the output is written in
+ * order.
+ *
+ * Other gzip or zstd files are not seekable: they can only be decompressed as
+ * a stream, on the calling thread.
+ *
+ * zstd support requires LidarView to be built with LIDARVIEW_USE_ZSTD.
+ */
+class LIDARPROCESSING_EXPORT LidarCompressedFile
+{
+public:
+  enum Format
+  {
+    NONE = 0,
+    GZIP,
+    ZSTD
+  };
+
+  struct Block
+  {
+    std::uint64_t CompressedOffset = 0;
+    std::uint64_t Offset = 0;
+    std::uint32_t CompressedSize = 0;
+    std::uint32_t Size = 0;
+  };
+
+  /**
+   * Compression of a file, from its first bytes.
+   */
+  static Format DetectFormat(const std::string& fileName);
+
+  /**
+   * Whether this build can decompress format.
+   */
+  static bool IsFormatAvailable(Format format);
+
+  LidarCompressedFile() = default;
+
+  /**
+   * Open a compressed file and index its blocks. Returns false and fills
+   * error when the file is not compressed or its format is not available.
+   */
+  bool Open(const std::string& fileName, std::string* error = nullptr);
+
+  Format GetFormat() const { return this->FileFormat; }
+  bool IsSeekable() const { return !this->Blocks.empty(); }
+  std::size_t GetNumberOfBlocks() const { return this->Blocks.size(); }
+  const Block& GetBlock(std::size_t block) const { return this->Blocks[block]; }
+
+  /**
+   * Decompressed size, 0 when the file is not seekable.
+   */
+  std::uint64_t GetSize() const;
+
+  /**
+   * Read size decompressed bytes from offset. Only the blocks overlapping the
+   * range are decompressed, the last one being kept for the next call. Only
+   * available on seekable files. Safe to call from several threads.
+   */
+  bool Read(
+    std::uint64_t offset, std::size_t size, char* buffer, std::string* error = nullptr) const;
+
+  /**
+   * Decompress the whole file to outputFileName.
+   */
+  bool DecompressTo(const std::string& outputFileName, std::string* error = nullptr) const;
+
+private:
+  LidarCompressedFile(const LidarCompressedFile&) = delete;
+  void operator=(const LidarCompressedFile&) = delete;
+
+  bool IndexGzip(std::FILE* file, std::uint64_t fileSize);
+  bool IndexZstd(std::FILE* file, std::uint64_t fileSize);
+  bool StreamTo(std::FILE* output, std::string* error) const;
+
+  std::string FileName;
+  Format FileFormat = NONE;
+  std::vector<Block> Blocks;
+
+  // Last block decompressed by Read
+  mutable std::mutex CacheMutex;
+  mutable std::size_t CachedBlock = static_cast<std::size_t>(-1);
+  mutable std::vector<char> CachedData;
+};
+
+#endif // LidarCompressedFile_h
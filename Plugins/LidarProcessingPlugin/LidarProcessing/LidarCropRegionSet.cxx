@@ -0,0 +1,481 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCropRegionSet.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarCropRegionSet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+constexpr double PI = 3.14159265358979323846;
+constexpr double RAD_TO_DEG = 180. / PI;
+constexpr double DEG_TO_RAD = PI / 180.;
+
+//-----------------------------------------------------------------------------
+double NormalizeAzimuth(double azimuth)
+{
+  azimuth = std::fmod(azimuth, 360.);
+  return azimuth < 0. ? azimuth + 360. : azimuth;
+}
+
+//-----------------------------------------------------------------------------
+// Check if azimuth (in [0, 360[) lies in [azmin, azmax], wrapping around 0 if azmin > azmax
+bool IsInAzimuthInterval(double azimuth, double azmin, double azmax)
+{
+  if (azmin <= azmax)
+  {
+    return azimuth >= azmin && azimuth <= azmax;
+  }
+  return azimuth >= azmin || azimuth <= azmax;
+}
+
+//-----------------------------------------------------------------------------
+bool ParseNumbers(std::istringstream& stream, std::vector<double>& values)
+{
+  std::string token;
+  while (stream >> token)
+  {
+    char* end = nullptr;
+    double value = std::strtod(token.c_str(), &end);
+    if (end == token.c_str() || *end != '\0')
+    {
+      return false;
+    }
+    values.push_back(value);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+double SegmentDistanceToOrigin(double ax, double ay, double bx, double by)
+{
+  double dx = bx - ax;
+  double dy = by - ay;
+  double length2 = dx * dx + dy * dy;
+  double t = length2 > 0. ? -(ax * dx + ay * dy) / length2 : 0.;
+  t = std::max(0., std::min(1., t));
+  double px = ax + t * dx;
+  double py = ay + t * dy;
+  return std::sqrt(px * px + py * py);
+}
+
+//-----------------------------------------------------------------------------
+// Cartesian bounding box of the annular sector [r0, r1] x [a0, a1] (azimuth in degrees)
+void AnnularSectorBounds(double r0, double r1, double a0, double a1, double bounds[4])
+{
+  bounds[0] = bounds[2] = std::numeric_limits<double>::max();
+  bounds[1] = bounds[3] = std::numeric_limits<double>::lowest();
+  auto extend = [&bounds](double r, double a) {
+    double x = r * std::cos(a * DEG_TO_RAD);
+    double y = r * std::sin(a * DEG_TO_RAD);
+    bounds[0] = std::min(bounds[0], x);
+    bounds[1] = std::max(bounds[1], x);
+    bounds[2] = std::min(bounds[2], y);
+    bounds[3] = std::max(bounds[3], y);
+  };
+  extend(r0, a0);
+  extend(r0, a1);
+  extend(r1, a0);
+  extend(r1, a1);
+  for (double axis = 0.; axis < 360.; axis += 90.)
+  {
+    if (axis >= a0 && axis <= a1)
+    {
+      extend(r1, axis);
+    }
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+LidarCropRegionSet::LidarCropRegionSet() = default;
+
+//-----------------------------------------------------------------------------
+void LidarCropRegionSet::Clear()
+{
+  this->Regions.clear();
+  this->HasIncludeRegion = false;
+  this->Compiled = false;
+  this->CellOffsets.clear();
+  this->CellCandidates.clear();
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCropRegionSet::AddRegion(const std::string& description)
+{
+  std::istringstream stream(description);
+  std::string rule, shape;
+  if (!(stream >> rule >> shape))
+  {
+    return false;
+  }
+
+  RuleType ruleType;
+  if (rule == "include")
+  {
+    ruleType = INCLUDE;
+  }
+  else if (rule == "exclude")
+  {
+    ruleType = EXCLUDE;
+  }
+  else
+  {
+    return false;
+  }
+
+  std::vector<double> values;
+  if (!ParseNumbers(stream, values))
+  {
+    return false;
+  }
+
+  if (shape == "box" && values.size() == 6)
+  {
+    this->AddBox(ruleType, values.data());
+    return true;
+  }
+  if (shape == "sector" && values.size() == 6)
+  {
+    this->AddSector(ruleType, values.data());
+    return true;
+  }
+  // at least 3 vertices, each with 2 coordinates
+  if (shape == "polygon" && values.size() >= 8 && values.size() % 2 == 0)
+  {
+    std::vector<double> xy(values.begin() + 2, values.end());
+    this->AddPolygon(ruleType, values[0], values[1], xy);
+    return true;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void LidarCropRegionSet::AddBox(RuleType rule, const double bounds[6])
+{
+  Region region;
+  region.Rule = rule;
+  region.Shape = BOX;
+  for (int i = 0; i < 3; ++i)
+  {
+    region.Bounds[2 * i] = std::min(bounds[2 * i], bounds[2 * i + 1]);
+    region.Bounds[2 * i + 1] = std::max(bounds[2 * i], bounds[2 * i + 1]);
+  }
+  this->Regions.push_back(region);
+  this->HasIncludeRegion |= (rule == INCLUDE);
+  this->Compiled = false;
+}
+
+//-----------------------------------------------------------------------------
+void LidarCropRegionSet::AddPolygon(
+  RuleType rule, double zmin, double zmax, const std::vector<double>& xy)
+{
+  Region region;
+  region.Rule = rule;
+  region.Shape = POLYGON;
+  region.Polygon = xy;
+  region.Bounds[0] = region.Bounds[2] = std::numeric_limits<double>::max();
+  region.Bounds[1] = region.Bounds[3] = std::numeric_limits<double>::lowest();
+  for (std::size_t i = 0; i + 1 < xy.size(); i += 2)
+  {
+    region.Bounds[0] = std::min(region.Bounds[0], xy[i]);
+    region.Bounds[1] = std::max(region.Bounds[1], xy[i]);
+    region.Bounds[2] = std::min(region.Bounds[2], xy[i + 1]);
+    region.Bounds[3] = std::max(region.Bounds[3], xy[i + 1]);
+  }
+  region.Bounds[4] = std::min(zmin, zmax);
+  region.Bounds[5] = std::max(zmin, zmax);
+  this->Regions.push_back(region);
+  this->HasIncludeRegion |= (rule == INCLUDE);
+  this->Compiled = false;
+}
+
+//-----------------------------------------------------------------------------
+void LidarCropRegionSet::AddSector(RuleType rule, const double sector[6])
+{
+  Region region;
+  region.Rule = rule;
+  region.Shape = SECTOR;
+  if (std::abs(sector[1] - sector[0]) >= 360.)
+  {
+    region.Bounds[0] = 0.;
+    region.Bounds[1] = 360.;
+  }
+  else
+  {
+    region.Bounds[0] = NormalizeAzimuth(sector[0]);
+    region.Bounds[1] = NormalizeAzimuth(sector[1]);
+  }
+  region.Bounds[2] = std::max(-90., std::min(sector[2], sector[3]));
+  region.Bounds[3] = std::min(90., std::max(sector[2], sector[3]));
+  region.Bounds[4] = std::max(0., std::min(sector[4], sector[5]));
+  region.Bounds[5] = std::max(sector[4], sector[5]);
+  this->Regions.push_back(region);
+  this->HasIncludeRegion |= (rule == INCLUDE);
+  this->Compiled = false;
+}
+
+//-----------------------------------------------------------------------------
+void LidarCropRegionSet::ComputePolarExtent(
+  const Region& region, double azimuth[2], double range[2]) const
+{
+  if (region.Shape == SECTOR)
+  {
+    azimuth[0] = region.Bounds[0];
+    azimuth[1] = region.Bounds[1];
+    double cos0 = std::cos(region.Bounds[2] * DEG_TO_RAD);
+    double cos1 = std::cos(region.Bounds[3] * DEG_TO_RAD);
+    double cosMax = (region.Bounds[2] <= 0. && region.Bounds[3] >= 0.) ? 1. : std::max(cos0, cos1);
+    double cosMin = std::min(cos0, cos1);
+    range[0] = region.Bounds[4] * cosMin;
+    range[1] = region.Bounds[5] * cosMax;
+    return;
+  }
+
+  // Unbounded footprints concern every cell
+  for (int i = 0; i < 4; ++i)
+  {
+    if (!std::isfinite(region.Bounds[i]))
+    {
+      azimuth[0] = 0.;
+      azimuth[1] = 360.;
+      range[0] = 0.;
+      range[1] = std::numeric_limits<double>::max();
+      return;
+    }
+  }
+
+  // Boxes and polygons share the same footprint logic
+  std::vector<double> xy = region.Polygon;
+  if (region.Shape == BOX)
+  {
+    const double* b = region.Bounds;
+    xy = { b[0], b[2], b[1], b[2], b[1], b[3], b[0], b[3] };
+  }
+  const std::size_t nbVertices = xy.size() / 2;
+
+  // Unwrap the vertex angles along the boundary. A non-null winding number means
+  // that the footprint contains the sensor, so that every azimuth is concerned.
+  double current = std::atan2(xy[1], xy[0]);
+  double minAngle = current, maxAngle = current;
+  double winding = 0.;
+  range[0] = std::numeric_limits<double>::max();
+  range[1] = 0.;
+  for (std::size_t i = 0; i < nbVertices; ++i)
+  {
+    const double ax = xy[2 * i], ay = xy[2 * i + 1];
+    const double bx = xy[2 * ((i + 1) % nbVertices)], by = xy[2 * ((i + 1) % nbVertices) + 1];
+    double delta = std::atan2(by, bx) - std::atan2(ay, ax);
+    delta = delta > PI ? delta - 2. * PI : (delta < -PI ? delta + 2. * PI : delta);
+    winding += delta;
+    current += delta;
+    minAngle = std::min(minAngle, current);
+    maxAngle = std::max(maxAngle, current);
+    range[0] = std::min(range[0], SegmentDistanceToOrigin(ax, ay, bx, by));
+    range[1] = std::max(range[1], std::sqrt(ax * ax + ay * ay));
+  }
+
+  if (std::abs(winding) > PI || range[0] == 0. || (maxAngle - minAngle) >= 2. * PI)
+  {
+    azimuth[0] = 0.;
+    azimuth[1] = 360.;
+    range[0] = 0.;
+    return;
+  }
+  azimuth[0] = NormalizeAzimuth(minAngle * RAD_TO_DEG);
+  azimuth[1] = NormalizeAzimuth(maxAngle * RAD_TO_DEG);
+}
+
+//-----------------------------------------------------------------------------
+void LidarCropRegionSet::Compile(double azimuthResolution, double rangeResolution, double maxRange)
+{
+  azimuthResolution = std::max(azimuthResolution, 1e-3);
+  rangeResolution = std::max(rangeResolution, 1e-3);
+  maxRange = std::max(maxRange, rangeResolution);
+
+  this->NumberOfAzimuthBins = static_cast<int>(std::ceil(360. / azimuthResolution));
+  // the last ring gathers everything beyond maxRange
+  this->NumberOfRangeBins = static_cast<int>(std::ceil(maxRange / rangeResolution)) + 1;
+  this->AzimuthBinsPerDegree = this->NumberOfAzimuthBins / 360.;
+  this->RangeBinsPerMeter = 1. / rangeResolution;
+
+  const int nbCells = this->NumberOfAzimuthBins * this->NumberOfRangeBins;
+  std::vector<std::vector<std::uint32_t> > cells(nbCells);
+
+  // Exclude regions are registered first, so that IsKept() can return as soon
+  // as an include region matches.
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    const RuleType rule = pass == 0 ? EXCLUDE : INCLUDE;
+    for (std::size_t index = 0; index < this->Regions.size(); ++index)
+    {
+      const Region& region = this->Regions[index];
+      if (region.Rule != rule)
+      {
+        continue;
+      }
+
+      double azimuth[2], range[2];
+      this->ComputePolarExtent(region, azimuth, range);
+
+      const bool fullTurn = azimuth[0] == 0. && azimuth[1] == 360.;
+      int firstAz = fullTurn ? 0 : static_cast<int>(azimuth[0] * this->AzimuthBinsPerDegree);
+      int lastAz = fullTurn ? this->NumberOfAzimuthBins - 1
+                            : static_cast<int>(azimuth[1] * this->AzimuthBinsPerDegree);
+      firstAz = std::min(firstAz, this->NumberOfAzimuthBins - 1);
+      lastAz = std::min(lastAz, this->NumberOfAzimuthBins - 1);
+      if (lastAz < firstAz)
+      {
+        // interval wrapping around 0
+        lastAz += this->NumberOfAzimuthBins;
+      }
+      const double lastRing = this->NumberOfRangeBins - 1;
+      const int firstR = static_cast<int>(std::min(range[0] * this->RangeBinsPerMeter, lastRing));
+      const int lastR = static_cast<int>(std::min(range[1] * this->RangeBinsPerMeter, lastRing));
+
+      for (int a = firstAz; a <= lastAz; ++a)
+      {
+        const int azBin = a % this->NumberOfAzimuthBins;
+        for (int r = firstR; r <= lastR; ++r)
+        {
+          // The polar extent of boxes and polygons is loose, prune the cells whose
+          // cartesian bounding box misses the footprint bounding box.
+          if (region.Shape != SECTOR && r < this->NumberOfRangeBins - 1)
+          {
+            double cell[4];
+            AnnularSectorBounds(r / this->RangeBinsPerMeter, (r + 1) / this->RangeBinsPerMeter,
+              azBin / this->AzimuthBinsPerDegree, (azBin + 1) / this->AzimuthBinsPerDegree, cell);
+            if (cell[1] < region.Bounds[0] || cell[0] > region.Bounds[1] ||
+              cell[3] < region.Bounds[2] || cell[2] > region.Bounds[3])
+            {
+              continue;
+            }
+          }
+          cells[azBin * this->NumberOfRangeBins + r].push_back(static_cast<std::uint32_t>(index));
+        }
+      }
+    }
+  }
+
+  // Flatten the per cell lists
+  this->CellOffsets.assign(nbCells + 1, 0);
+  for (int i = 0; i < nbCells; ++i)
+  {
+    this->CellOffsets[i + 1] = this->CellOffsets[i] + static_cast<std::uint32_t>(cells[i].size());
+  }
+  this->CellCandidates.resize(this->CellOffsets[nbCells]);
+  for (int i = 0; i < nbCells; ++i)
+  {
+    std::copy(cells[i].begin(), cells[i].end(), this->CellCandidates.begin() + this->CellOffsets[i]);
+  }
+  this->Compiled = true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCropRegionSet::IsInside(const Region& region, double x, double y, double z) const
+{
+  const double* b = region.Bounds;
+  switch (region.Shape)
+  {
+    case BOX:
+      return x >= b[0] && x <= b[1] && y >= b[2] && y <= b[3] && z >= b[4] && z <= b[5];
+
+    case POLYGON:
+    {
+      if (z < b[4] || z > b[5] || x < b[0] || x > b[1] || y < b[2] || y > b[3])
+      {
+        return false;
+      }
+      // crossing number test
+      const std::vector<double>& p = region.Polygon;
+      const std::size_t n = p.size() / 2;
+      bool inside = false;
+      for (std::size_t i = 0, j = n - 1; i < n; j = i++)
+      {
+        const double xi = p[2 * i], yi = p[2 * i + 1];
+        const double xj = p[2 * j], yj = p[2 * j + 1];
+        if (((yi > y) != (yj > y)) && (x < (xj - xi) * (y - yi) / (yj - yi) + xi))
+        {
+          inside = !inside;
+        }
+      }
+      return inside;
+    }
+
+    case SECTOR:
+    {
+      const double horizontal2 = x * x + y * y;
+      const double range = std::sqrt(horizontal2 + z * z);
+      if (range < b[4] || range > b[5])
+      {
+        return false;
+      }
+      const double elevation = std::atan2(z, std::sqrt(horizontal2)) * RAD_TO_DEG;
+      if (elevation < b[2] || elevation > b[3])
+      {
+        return false;
+      }
+      if (b[0] == 0. && b[1] == 360.)
+      {
+        return true;
+      }
+      return IsInAzimuthInterval(NormalizeAzimuth(std::atan2(y, x) * RAD_TO_DEG), b[0], b[1]);
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarCropRegionSet::IsKept(double x, double y, double z) const
+{
+  if (this->Regions.empty())
+  {
+    return true;
+  }
+  // A non finite point lies in no region, and would index outside of the grid
+  if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z))
+  {
+    return !this->HasIncludeRegion;
+  }
+
+  double azimuth = std::atan2(y, x) * RAD_TO_DEG;
+  azimuth = azimuth < 0. ? azimuth + 360. : azimuth;
+  const int azBin =
+    std::min(static_cast<int>(azimuth * this->AzimuthBinsPerDegree), this->NumberOfAzimuthBins - 1);
+  const int rBin = std::min(static_cast<int>(std::sqrt(x * x + y * y) * this->RangeBinsPerMeter),
+    this->NumberOfRangeBins - 1);
+  const int cell = azBin * this->NumberOfRangeBins + rBin;
+
+  // Candidates are sorted with exclude regions first
+  for (std::uint32_t i = this->CellOffsets[cell]; i < this->CellOffsets[cell + 1]; ++i)
+  {
+    const Region& region = this->Regions[this->CellCandidates[i]];
+    if (this->IsInside(region, x, y, z))
+    {
+      return region.Rule == INCLUDE;
+    }
+  }
+  return !this->HasIncludeRegion;
+}
+
+//-----------------------------------------------------------------------------
+double LidarCropRegionSet::GetAverageCandidatesPerCell() const
+{
+  if (this->CellOffsets.size() < 2)
+  {
+    return 0.;
+  }
+  return static_cast<double>(this->CellCandidates.size()) / (this->CellOffsets.size() - 1);
+}
@@ -0,0 +1,142 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarCropRegionSet.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarCropRegionSet_h
+#define LidarCropRegionSet_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class LidarCropRegionSet
+ * @brief List of include / exclude regions compiled into an azimuth / range grid.
+ *
+ * Three kinds of regions are supported:
+ *  - axis aligned boxes
+ *  - arbitrary 2D polygons in the XY plane, extruded between two Z values
+ *  - spherical sectors (azimuth, elevation and range intervals)
+ *
+ * A point is kept when it lies inside at least one "include" region (or when
+ * there is no include region at all) and inside no "exclude" region.
+ *
+ * Once Compile() has been called, each cell of a polar grid (azimuth x
+ * horizontal range) stores the few regions that may intersect it, so the cost
+ * of IsKept() does not depend on the total number of regions.
+ *
+ * Regions can be described with one line of text each (see AddRegion()):
+ * @code
+ *   include box     xmin xmax ymin ymax zmin zmax
+ *   exclude polygon zmin zmax x0 y0 x1 y1 x2 y2 ...
+ *   exclude sector  azmin azmax elmin elmax rmin rmax
+ * @endcode
+ * Angles are in degrees. Azimuth is measured in the XY plane, counter-clockwise
+ * from the +X axis, within [0, 360[. An azimuth interval with azmin > azmax wraps
+ * around 0. Elevation is measured from the XY plane, positive toward +Z.
+ */
+class LIDARPROCESSING_EXPORT LidarCropRegionSet
+{
+public:
+  enum RuleType
+  {
+    INCLUDE = 0,
+    EXCLUDE = 1
+  };
+
+  enum ShapeType
+  {
+    BOX = 0,
+    POLYGON = 1,
+    SECTOR = 2
+  };
+
+  struct Region
+  {
+    RuleType Rule = INCLUDE;
+    ShapeType Shape = BOX;
+    // BOX:     xmin xmax ymin ymax zmin zmax
+    // POLYGON: xmin xmax ymin ymax (footprint bounding box) zmin zmax
+    // SECTOR:  azmin azmax elmin elmax rmin rmax
+    double Bounds[6] = { 0., 0., 0., 0., 0., 0. };
+    // POLYGON only: x0 y0 x1 y1 ...
+    std::vector<double> Polygon;
+  };
+
+  LidarCropRegionSet();
+
+  /**
+   * Remove all regions. The set must be compiled again before use.
+   */
+  void Clear();
+
+  /**
+   * Parse a textual region description and add it to the set.
+   * Returns false if the description is invalid, in which case the set is left unchanged.
+   */
+  bool AddRegion(const std::string& description);
+
+  void AddBox(RuleType rule, const double bounds[6]);
+  void AddPolygon(RuleType rule, double zmin, double zmax, const std::vector<double>& xy);
+  void AddSector(RuleType rule, const double sector[6]);
+
+  std::size_t GetNumberOfRegions() const { return this->Regions.size(); }
+  const Region& GetRegion(std::size_t index) const { return this->Regions[index]; }
+
+  /**
+   * Build the lookup grid. azimuthResolution is in degrees, rangeResolution
+   * and maxRange in meters. Points further than maxRange all share the last
+   * range ring of the grid.
+   */
+  void Compile(double azimuthResolution = 1., double rangeResolution = 1., double maxRange = 300.);
+
+  /**
+   * Return true if the set has been compiled since its last modification.
+   */
+  bool IsCompiled() const { return this->Compiled; }
+
+  /**
+   * Return true if the set has no region, i.e. every point is kept.
+   */
+  bool IsEmpty() const { return this->Regions.empty(); }
+
+  /**
+   * Return true if the point must be kept. Compile() must have been called.
+   * A non finite point lies in no region: it is kept only when there is no
+   * include region.
+   */
+  bool IsKept(double x, double y, double z) const;
+
+  /**
+   * Return the average number of candidate regions per grid cell, this is a
+   * good estimation of the number of exact tests run per point.
+   */
+  double GetAverageCandidatesPerCell() const;
+
+private:
+  bool IsInside(const Region& region, double x, double y, double z) const;
+  void ComputePolarExtent(const Region& region, double azimuth[2], double range[2]) const;
+
+  std::vector<Region> Regions;
+  bool HasIncludeRegion = false;
+  bool Compiled = false;
+
+  // Compiled grid
+  double AzimuthBinsPerDegree = 1.;
+  double RangeBinsPerMeter = 1.;
+  int NumberOfAzimuthBins = 0;
+  int NumberOfRangeBins = 0;
+  std::vector<std::uint32_t> CellOffsets;
+  std::vector<std::uint32_t> CellCandidates;
+};
+
+#endif // LidarCropRegionSet_h
@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameBuffer.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarFrameBuffer.h"
+
+#include "LidarFrameBufferPool.h"
+
+#include <cstdint>
+
+namespace
+{
+constexpr std::size_t ALIGNMENT = 64;
+
+//-----------------------------------------------------------------------------
+std::size_t AlignUp(std::size_t size)
+{
+  return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+}
+
+//-----------------------------------------------------------------------------
+LidarFrameBuffer* LidarFrameBuffer::New(const std::vector<std::size_t>& sectionSizes)
+{
+  // Each section is preceded by an ALIGNMENT bytes slot whose last bytes store
+  // the owning buffer pointer, so that sections stay aligned.
+  std::size_t total = 0;
+  for (std::size_t size : sectionSizes)
+  {
+    total += ALIGNMENT + AlignUp(size);
+  }
+
+  // Blocks come from the pool, so that frames of similar sizes recycle memory
+  std::size_t blockSize = 0;
+  char* memory = static_cast<char*>(
+    LidarFrameBufferPool::GetInstance().Allocate(total + ALIGNMENT, blockSize));
+  LidarFrameBuffer* buffer = new LidarFrameBuffer;
+  buffer->Memory = memory;
+  buffer->AllocatedSize = blockSize;
+
+  const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(buffer->Memory);
+  char* cursor = buffer->Memory + (AlignUp(address) - address);
+  for (std::size_t size : sectionSizes)
+  {
+    cursor += ALIGNMENT;
+    *reinterpret_cast<LidarFrameBuffer**>(cursor - sizeof(LidarFrameBuffer*)) = buffer;
+    buffer->Sections.push_back(cursor);
+    cursor += AlignUp(size);
+  }
+  return buffer;
+}
+
+//-----------------------------------------------------------------------------
+LidarFrameBuffer::~LidarFrameBuffer()
+{
+  LidarFrameBufferPool::GetInstance().Release(this->Memory, this->AllocatedSize);
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameBuffer::UnRegister()
+{
+  if (--this->ReferenceCount == 0)
+  {
+    delete this;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameBuffer::ReleaseSection(void* section)
+{
+  if (!section)
+  {
+    return;
+  }
+  LidarFrameBuffer* buffer =
+    *reinterpret_cast<LidarFrameBuffer**>(static_cast<char*>(section) - sizeof(LidarFrameBuffer*));
+  buffer->UnRegister();
+}
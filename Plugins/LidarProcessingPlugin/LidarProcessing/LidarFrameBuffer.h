@@ -0,0 +1,70 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameBuffer.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarFrameBuffer_h
+#define LidarFrameBuffer_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class LidarFrameBuffer
+ * @brief Reference counted allocation holding all the arrays of a frame.
+ *
+ * The buffer is split into 64 bytes aligned sections, one per array. Each
+ * section is preceded by a pointer to its owning buffer, so that a VTK array
+ * wrapping a section without copy can release the whole buffer from its free
+ * function (see ReleaseSection()). The buffer is freed once the creator and
+ * every array view released it, its memory then goes back to the
+ * LidarFrameBufferPool.
+ */
+class LIDARPROCESSING_EXPORT LidarFrameBuffer
+{
+public:
+  /**
+   * Allocate a buffer able to hold sections of the given sizes (in bytes).
+   * The returned buffer has a reference count of 1.
+   */
+  static LidarFrameBuffer* New(const std::vector<std::size_t>& sectionSizes);
+
+  void Register() { ++this->ReferenceCount; }
+  void UnRegister();
+
+  /**
+   * Free function to give to vtkAbstractArray::SetArrayFreeFunction for arrays
+   * wrapping a section. Each array view must Register() the buffer first.
+   */
+  static void ReleaseSection(void* section);
+
+  void* GetSection(std::size_t index) const { return this->Sections[index]; }
+  std::size_t GetNumberOfSections() const { return this->Sections.size(); }
+
+  /**
+   * Total number of bytes allocated for this buffer.
+   */
+  std::size_t GetAllocatedSize() const { return this->AllocatedSize; }
+
+private:
+  LidarFrameBuffer() = default;
+  ~LidarFrameBuffer();
+  LidarFrameBuffer(const LidarFrameBuffer&) = delete;
+  void operator=(const LidarFrameBuffer&) = delete;
+
+  std::atomic<int> ReferenceCount{ 1 };
+  char* Memory = nullptr;
+  std::size_t AllocatedSize = 0;
+  std::vector<void*> Sections;
+};
+
+#endif // LidarFrameBuffer_h
@@ -0,0 +1,164 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameBufferPool.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarFrameBufferPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+// Requests below this size all share the smallest class
+constexpr std::size_t MIN_CLASS_SIZE = 4096;
+// Number of classes per power of two
+constexpr int CLASS_STEPS_LOG2 = 3;
+}
+
+//-----------------------------------------------------------------------------
+LidarFrameBufferPool& LidarFrameBufferPool::GetInstance()
+{
+  // Never destroyed: frames may still be released during static destruction
+  static LidarFrameBufferPool* instance = new LidarFrameBufferPool;
+  return *instance;
+}
+
+//-----------------------------------------------------------------------------
+LidarFrameBufferPool::~LidarFrameBufferPool()
+{
+  this->TrimTo(0);
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarFrameBufferPool::GetSizeClass(std::size_t size)
+{
+  if (size <= MIN_CLASS_SIZE)
+  {
+    return MIN_CLASS_SIZE;
+  }
+  // round up to a multiple of (highest power of two below size) / 8
+  std::size_t highBit = 1;
+  while ((highBit << 1) <= size)
+  {
+    highBit <<= 1;
+  }
+  const std::size_t step = highBit >> CLASS_STEPS_LOG2;
+  return (size + step - 1) / step * step;
+}
+
+//-----------------------------------------------------------------------------
+void* LidarFrameBufferPool::Allocate(std::size_t size, std::size_t& blockSize)
+{
+  blockSize = GetSizeClass(size);
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stats.Requests++;
+    this->Stats.BytesInUse += blockSize;
+    this->Stats.PeakBytesInUse = std::max(this->Stats.PeakBytesInUse, this->Stats.BytesInUse);
+
+    auto it = this->FreeLists.find(blockSize);
+    if (it != this->FreeLists.end() && !it->second.empty())
+    {
+      void* block = it->second.back();
+      it->second.pop_back();
+      this->Stats.Reuses++;
+      this->Stats.BytesRetained -= blockSize;
+      return block;
+    }
+  }
+
+  void* block = std::malloc(blockSize);
+  if (!block)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stats.BytesInUse -= blockSize;
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameBufferPool::Release(void* block, std::size_t blockSize)
+{
+  if (!block)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stats.BytesInUse -= blockSize;
+    if (this->Stats.BytesRetained + blockSize <= this->HighWaterMark)
+    {
+      this->FreeLists[blockSize].push_back(block);
+      this->Stats.BytesRetained += blockSize;
+      return;
+    }
+  }
+  std::free(block);
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameBufferPool::SetHighWaterMark(std::size_t bytes)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->HighWaterMark = bytes;
+  }
+  this->TrimTo(bytes);
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarFrameBufferPool::GetHighWaterMark() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->HighWaterMark;
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameBufferPool::TrimTo(std::size_t bytes)
+{
+  std::vector<void*> blocks;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    // Free the largest blocks first, they are the least likely to be reused
+    for (auto it = this->FreeLists.rbegin();
+         it != this->FreeLists.rend() && this->Stats.BytesRetained > bytes; ++it)
+    {
+      std::vector<void*>& freeList = it->second;
+      while (!freeList.empty() && this->Stats.BytesRetained > bytes)
+      {
+        blocks.push_back(freeList.back());
+        freeList.pop_back();
+        this->Stats.BytesRetained -= it->first;
+      }
+    }
+  }
+  for (void* block : blocks)
+  {
+    std::free(block);
+  }
+}
+
+//-----------------------------------------------------------------------------
+LidarFrameBufferPool::Statistics LidarFrameBufferPool::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  return this->Stats;
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameBufferPool::ResetStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Stats.Requests = 0;
+  this->Stats.Reuses = 0;
+  this->Stats.PeakBytesInUse = this->Stats.BytesInUse;
+}
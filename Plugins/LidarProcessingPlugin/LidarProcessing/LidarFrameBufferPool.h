@@ -0,0 +1,109 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameBufferPool.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarFrameBufferPool_h
+#define LidarFrameBufferPool_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class LidarFrameBufferPool
+ * @brief Size-classed pool recycling the memory blocks of the frame buffers.
+ *
+ * During playback frames of almost identical sizes are allocated and freed at
+ * the sensor rate. Released blocks are kept in free lists, one per size class,
+ * and handed back to the next request of the same class instead of going
+ * through malloc / free.
+ *
+ * Size classes split each power of two in 8 steps, so that at most 12.5% of a
+ * block is wasted. The memory kept idle in the free lists never exceeds the
+ * high-water mark: blocks released above it are freed immediately.
+ *
+ * The pool is shared by the whole process and is thread safe.
+ */
+class LIDARPROCESSING_EXPORT LidarFrameBufferPool
+{
+public:
+  struct Statistics
+  {
+    std::uint64_t Requests = 0;
+    std::uint64_t Reuses = 0;
+    std::size_t BytesInUse = 0;
+    std::size_t PeakBytesInUse = 0;
+    std::size_t BytesRetained = 0;
+
+    double GetReuseRate() const
+    {
+      return this->Requests ? static_cast<double>(this->Reuses) / this->Requests : 0.;
+    }
+  };
+
+  static LidarFrameBufferPool& GetInstance();
+
+  /**
+   * Get a block of at least size bytes. The actual size of the block, which
+   * must be given back to Release(), is stored in blockSize.
+   * Throws std::bad_alloc on failure.
+   */
+  void* Allocate(std::size_t size, std::size_t& blockSize);
+
+  /**
+   * Give a block back to the pool.
+   */
+  void Release(void* block, std::size_t blockSize);
+
+  //@{
+  /**
+   * Maximum number of bytes kept in the free lists. Default is 256 MiB.
+   * Lowering it frees the blocks above the new limit.
+   */
+  void SetHighWaterMark(std::size_t bytes);
+  std::size_t GetHighWaterMark() const;
+  //@}
+
+  /**
+   * Free all the idle blocks.
+   */
+  void Trim() { this->TrimTo(0); }
+
+  Statistics GetStatistics() const;
+
+  /**
+   * Reset the request / reuse counters and set the peak to the current usage.
+   */
+  void ResetStatistics();
+
+  /**
+   * Size class of a request, in bytes.
+   */
+  static std::size_t GetSizeClass(std::size_t size);
+
+private:
+  LidarFrameBufferPool() = default;
+  ~LidarFrameBufferPool();
+  LidarFrameBufferPool(const LidarFrameBufferPool&) = delete;
+  void operator=(const LidarFrameBufferPool&) = delete;
+
+  void TrimTo(std::size_t bytes);
+
+  mutable std::mutex Mutex;
+  std::map<std::size_t, std::vector<void*>> FreeLists;
+  std::size_t HighWaterMark = std::size_t(256) << 20;
+  Statistics Stats;
+};
+
+#endif // LidarFrameBufferPool_h
@@ -0,0 +1,110 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameCache.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarFrameCache_h
+#define LidarFrameCache_h
+
+#include <vtkDataObject.h>
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <utility>
+
+/**
+ * Key of a frame data object: its address and modification time.
+ */
+using LidarFrameObjectKey = std::pair<const void*, vtkMTimeType>;
+inline LidarFrameObjectKey GetLidarFrameObjectKey(vtkDataObject* frame)
+{
+  return LidarFrameObjectKey(frame, frame->GetMTime());
+}
+
+/**
+ * @class LidarFrameCache
+ * @brief Small LRU cache of values computed from a frame.
+ *
+ * The key identifies the frame and is chosen by the user of the cache:
+ *  - the time step of the frame, for values computed in a pipeline. A reader
+ *    produces a new data object each time it goes back to a frame, so only the
+ *    time step lets a replay hit the cache. The user must clear the cache when
+ *    the frames of a time step may have changed (upstream modification).
+ *  - the frame address and its modification time, LidarFrameObjectKey, for
+ *    values computed from a given data object. A frame modified in place, or a
+ *    new frame allocated at the address of a released one, never hits a stale
+ *    entry.
+ * Capacity is expressed in frames and should cover the trailing frames
+ * displayed at once.
+ */
+template <typename Key, typename Value>
+class LidarFrameCache
+{
+public:
+  explicit LidarFrameCache(std::size_t capacity = 16)
+    : Capacity(capacity > 0 ? capacity : 1)
+  {
+  }
+
+  /**
+   * Get the value associated to key, creating a default one if needed.
+   * The most recently used entries are kept when the capacity is exceeded.
+   * The returned reference is valid until the next call.
+   */
+  Value& Get(const Key& key)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    for (auto it = this->Entries.begin(); it != this->Entries.end(); ++it)
+    {
+      if (it->first == key)
+      {
+        this->Entries.splice(this->Entries.begin(), this->Entries, it);
+        this->Hits++;
+        return this->Entries.front().second;
+      }
+    }
+    this->Misses++;
+    this->Entries.emplace_front(key, Value());
+    while (this->Entries.size() > this->Capacity)
+    {
+      this->Entries.pop_back();
+    }
+    return this->Entries.front().second;
+  }
+
+  void SetCapacity(std::size_t capacity)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Capacity = capacity > 0 ? capacity : 1;
+    while (this->Entries.size() > this->Capacity)
+    {
+      this->Entries.pop_back();
+    }
+  }
+  std::size_t GetCapacity() const { return this->Capacity; }
+
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Entries.clear();
+  }
+
+  std::size_t GetNumberOfHits() const { return this->Hits; }
+  std::size_t GetNumberOfMisses() const { return this->Misses; }
+
+private:
+  std::mutex Mutex;
+  std::list<std::pair<Key, Value>> Entries;
+  std::size_t Capacity;
+  std::size_t Hits = 0;
+  std::size_t Misses = 0;
+};
+
+#endif // LidarFrameCache_h
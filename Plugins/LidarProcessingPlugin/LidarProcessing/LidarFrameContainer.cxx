@@ -0,0 +1,269 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameContainer.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarFrameContainer.h"
+
+#include "LidarCompactFrame.h"
+
+#include <vtkSMPTools.h>
+#include <vtk_zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+}
+
+const char LidarFrameContainer::HEADER_MAGIC[8] = { 'L', 'V', 'F', 'R', 'A', 'M', 'E', '\0' };
+const char LidarFrameContainer::TRAILER_MAGIC[8] = { 'L', 'V', 'F', 'I', 'N', 'D', 'X', '\0' };
+const std::uint32_t LidarFrameContainer::VERSION = 1;
+
+//-----------------------------------------------------------------------------
+LidarFrameContainer::~LidarFrameContainer()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+void LidarFrameContainer::Close()
+{
+#ifdef _WIN32
+  if (this->Mapping)
+  {
+    UnmapViewOfFile(this->Mapping);
+  }
+  if (this->MappingHandle)
+  {
+    CloseHandle(this->MappingHandle);
+  }
+  if (this->FileHandle)
+  {
+    CloseHandle(this->FileHandle);
+  }
+  this->MappingHandle = nullptr;
+  this->FileHandle = nullptr;
+#else
+  if (this->Mapping)
+  {
+    munmap(const_cast<char*>(this->Mapping), static_cast<std::size_t>(this->MappingSize));
+  }
+#endif
+  this->Mapping = nullptr;
+  this->MappingSize = 0;
+  this->Frames.clear();
+  this->Chunks.clear();
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainer::Open(const std::string& fileName, std::string* error)
+{
+  this->Close();
+  this->FileName = fileName;
+
+#ifdef _WIN32
+  this->FileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  LARGE_INTEGER size;
+  if (this->FileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->FileHandle, &size))
+  {
+    if (this->FileHandle != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(this->FileHandle);
+    }
+    this->FileHandle = nullptr;
+    SetError(error, "Unable to open " + fileName);
+    return false;
+  }
+  this->MappingSize = static_cast<std::uint64_t>(size.QuadPart);
+  this->MappingHandle =
+    CreateFileMappingA(this->FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  this->Mapping = this->MappingHandle
+    ? static_cast<const char*>(MapViewOfFile(this->MappingHandle, FILE_MAP_READ, 0, 0, 0))
+    : nullptr;
+#else
+  const int file = open(fileName.c_str(), O_RDONLY);
+  struct stat status;
+  if (file < 0 || fstat(file, &status) != 0)
+  {
+    if (file >= 0)
+    {
+      close(file);
+    }
+    SetError(error, "Unable to open " + fileName);
+    return false;
+  }
+  this->MappingSize = static_cast<std::uint64_t>(status.st_size);
+  void* mapping = this->MappingSize > 0
+    ? mmap(nullptr, static_cast<std::size_t>(this->MappingSize), PROT_READ, MAP_SHARED, file, 0)
+    : MAP_FAILED;
+  // The mapping stays valid once the descriptor is closed
+  close(file);
+  this->Mapping = mapping != MAP_FAILED ? static_cast<const char*>(mapping) : nullptr;
+#endif
+  if (!this->Mapping)
+  {
+    this->Close();
+    SetError(error, "Unable to map " + fileName);
+    return false;
+  }
+
+  Trailer trailer;
+  if (this->MappingSize < sizeof(Header) + sizeof(Trailer))
+  {
+    this->Close();
+    SetError(error, fileName + " is not a LidarView frame file");
+    return false;
+  }
+  std::memcpy(&this->FileHeader, this->Mapping, sizeof(Header));
+  std::memcpy(&trailer, this->Mapping + this->MappingSize - sizeof(Trailer), sizeof(Trailer));
+  const std::uint64_t tablesEnd = this->MappingSize - sizeof(Trailer);
+  if (std::memcmp(this->FileHeader.Magic, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0 ||
+    std::memcmp(trailer.Magic, TRAILER_MAGIC, sizeof(TRAILER_MAGIC)) != 0)
+  {
+    this->Close();
+    SetError(error, fileName + " is not a LidarView frame file");
+    return false;
+  }
+  if (this->FileHeader.Version != VERSION || this->FileHeader.ChunkSize == 0 ||
+    trailer.FrameTableOffset > tablesEnd ||
+    trailer.NumberOfFrames > (tablesEnd - trailer.FrameTableOffset) / sizeof(FrameEntry) ||
+    trailer.ChunkTableOffset > tablesEnd ||
+    trailer.NumberOfChunks > (tablesEnd - trailer.ChunkTableOffset) / sizeof(ChunkEntry))
+  {
+    this->Close();
+    SetError(error, fileName + " has an unsupported version or is corrupted");
+    return false;
+  }
+
+  this->Frames.resize(static_cast<std::size_t>(trailer.NumberOfFrames));
+  std::memcpy(this->Frames.data(), this->Mapping + trailer.FrameTableOffset,
+    this->Frames.size() * sizeof(FrameEntry));
+  this->Chunks.resize(static_cast<std::size_t>(trailer.NumberOfChunks));
+  std::memcpy(this->Chunks.data(), this->Mapping + trailer.ChunkTableOffset,
+    this->Chunks.size() * sizeof(ChunkEntry));
+
+  // Check the tables once so that ReadFrame() can trust them
+  for (const FrameEntry& frame : this->Frames)
+  {
+    const std::uint64_t nbChunks =
+      GetNumberOfChunks(frame.NumberOfPoints, this->FileHeader.ChunkSize) *
+      LidarCompactFrame::NUMBER_OF_SECTIONS;
+    if (frame.FirstChunk > this->Chunks.size() ||
+      nbChunks > this->Chunks.size() - frame.FirstChunk)
+    {
+      this->Close();
+      SetError(error, fileName + " has an invalid frame table");
+      return false;
+    }
+  }
+  for (const ChunkEntry& chunk : this->Chunks)
+  {
+    if (chunk.Offset > tablesEnd || chunk.StoredSize > tablesEnd - chunk.Offset)
+    {
+      this->Close();
+      SetError(error, fileName + " has an invalid chunk table");
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainer::ReadFrame(
+  std::size_t frameIndex, LidarCompactFrame& compact, std::string* error) const
+{
+  if (!this->Mapping || frameIndex >= this->Frames.size())
+  {
+    SetError(error, "Invalid frame");
+    return false;
+  }
+  const FrameEntry& frame = this->Frames[frameIndex];
+  compact.RangeQuantum = this->FileHeader.RangeQuantum;
+  compact.IntensityQuantum = this->FileHeader.IntensityQuantum;
+  compact.TimestampQuantum = this->FileHeader.TimestampQuantum;
+  try
+  {
+    compact.Allocate(static_cast<vtkIdType>(frame.NumberOfPoints), frame.TimestampBase);
+  }
+  catch (const std::bad_alloc&)
+  {
+    SetError(error, "Unable to allocate a frame of " + std::to_string(frame.NumberOfPoints) +
+        " points");
+    return false;
+  }
+
+  // Every chunk of every section is independent
+  const std::uint32_t chunkSize = this->FileHeader.ChunkSize;
+  const vtkIdType chunksPerSection =
+    static_cast<vtkIdType>(GetNumberOfChunks(frame.NumberOfPoints, chunkSize));
+  std::atomic<bool> ok(true);
+  vtkSMPTools::For(0, chunksPerSection * LidarCompactFrame::NUMBER_OF_SECTIONS,
+    [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        const auto section = static_cast<LidarCompactFrame::Section>(i / chunksPerSection);
+        const std::uint64_t firstPoint =
+          static_cast<std::uint64_t>(i % chunksPerSection) * chunkSize;
+        const std::uint64_t nbPoints =
+          std::min<std::uint64_t>(chunkSize, frame.NumberOfPoints - firstPoint);
+        const std::size_t pointSize = LidarCompactFrame::GetPointSize(section);
+        char* destination =
+          static_cast<char*>(compact.GetMutableSection(section)) + firstPoint * pointSize;
+        const ChunkEntry& chunk = this->Chunks[frame.FirstChunk + i];
+        const char* source = this->Mapping + chunk.Offset;
+        uLongf size = static_cast<uLongf>(nbPoints * pointSize);
+        if (chunk.Size != size)
+        {
+          ok = false;
+        }
+        else if (chunk.StoredSize == chunk.Size)
+        {
+          std::memcpy(destination, source, chunk.Size);
+        }
+        else if (uncompress(reinterpret_cast<Bytef*>(destination), &size,
+                   reinterpret_cast<const Bytef*>(source), chunk.StoredSize) != Z_OK ||
+          size != chunk.Size)
+        {
+          ok = false;
+        }
+      }
+    });
+  if (!ok)
+  {
+    compact.Reset();
+    SetError(error, "Frame " + std::to_string(frameIndex) + " of " + this->FileName +
+        " is corrupted");
+    return false;
+  }
+  return true;
+}
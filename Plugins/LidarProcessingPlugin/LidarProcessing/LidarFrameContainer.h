@@ -0,0 +1,130 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameContainer.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarFrameContainer_h
+#define LidarFrameContainer_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class LidarCompactFrame;
+
+/**
+ * @class LidarFrameContainer
+ * @brief Reader of .lvf files, frames already decoded in the compact layout.
+ *
+ * An .lvf file stores a sequence of frames in the LidarCompactFrame layout,
+ * column by column, each column split into chunks of a fixed number of points:
+ *
+ *   Header | chunks of frame 0 | chunks of frame 1 | ... | FrameEntry table |
+ *   ChunkEntry table | Trailer
+ *
+ * Chunks are deflated when that saves at least an eighth of their size, and
+ * stored as is otherwise. The tables at the end index every frame, so that
+ * any frame is loaded with one memcpy or inflate per chunk, without any parsing
+ * or quantization: the file is memory mapped and the chunks of a frame are
+ * copied in parallel into a single LidarFrameBuffer allocation.
+ *
+ * Values are stored little endian, all the offsets are 8 bytes aligned.
+ * See LidarFrameContainerWriter for writing.
+ */
+class LIDARPROCESSING_EXPORT LidarFrameContainer
+{
+public:
+  struct Header
+  {
+    char Magic[8];
+    std::uint32_t Version;
+    std::uint32_t ChunkSize;
+    double RangeQuantum;
+    double IntensityQuantum;
+    double TimestampQuantum;
+    std::uint64_t Reserved[3];
+  };
+
+  struct FrameEntry
+  {
+    double Time;
+    double TimestampBase;
+    std::uint64_t NumberOfPoints;
+    std::uint64_t FirstChunk;
+  };
+
+  struct ChunkEntry
+  {
+    std::uint64_t Offset;
+    std::uint32_t StoredSize;
+    std::uint32_t Size;
+  };
+
+  struct Trailer
+  {
+    std::uint64_t FrameTableOffset;
+    std::uint64_t NumberOfFrames;
+    std::uint64_t ChunkTableOffset;
+    std::uint64_t NumberOfChunks;
+    char Magic[8];
+  };
+
+  static const char HEADER_MAGIC[8];
+  static const char TRAILER_MAGIC[8];
+  static const std::uint32_t VERSION;
+
+  /**
+   * Number of chunks of each section of a frame.
+   */
+  static std::uint64_t GetNumberOfChunks(std::uint64_t nbPoints, std::uint32_t chunkSize)
+  {
+    return (nbPoints + chunkSize - 1) / chunkSize;
+  }
+
+  LidarFrameContainer() = default;
+  ~LidarFrameContainer();
+
+  /**
+   * Map fileName and load its tables. Returns false and fills error when it
+   * is not a valid .lvf file.
+   */
+  bool Open(const std::string& fileName, std::string* error = nullptr);
+  void Close();
+
+  const Header& GetHeader() const { return this->FileHeader; }
+  std::size_t GetNumberOfFrames() const { return this->Frames.size(); }
+  const FrameEntry& GetFrame(std::size_t frame) const { return this->Frames[frame]; }
+  const std::vector<ChunkEntry>& GetChunks() const { return this->Chunks; }
+
+  /**
+   * Load a frame into compact. Its quantization steps are set from the header.
+   */
+  bool ReadFrame(std::size_t frame, LidarCompactFrame& compact, std::string* error = nullptr) const;
+
+private:
+  LidarFrameContainer(const LidarFrameContainer&) = delete;
+  void operator=(const LidarFrameContainer&) = delete;
+
+  std::string FileName;
+  Header FileHeader;
+  std::vector<FrameEntry> Frames;
+  std::vector<ChunkEntry> Chunks;
+
+  const char* Mapping = nullptr;
+  std::uint64_t MappingSize = 0;
+#ifdef _WIN32
+  void* FileHandle = nullptr;
+  void* MappingHandle = nullptr;
+#endif
+};
+
+#endif // LidarFrameContainer_h
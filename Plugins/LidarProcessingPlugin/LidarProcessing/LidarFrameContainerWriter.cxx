@@ -0,0 +1,250 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameContainerWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarFrameContainerWriter.h"
+
+#include "LidarCompactFrame.h"
+
+#include <vtkSMPTools.h>
+#include <vtk_zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::uint64_t Align(std::uint64_t offset)
+{
+  return (offset + 7) & ~std::uint64_t(7);
+}
+}
+
+//-----------------------------------------------------------------------------
+LidarFrameContainerWriter::~LidarFrameContainerWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainerWriter::Open(
+  const std::string& fileName, bool append, std::string* error)
+{
+  this->Close();
+  this->FileName = fileName;
+  this->Frames.clear();
+  this->Chunks.clear();
+
+  if (append)
+  {
+    this->File = std::fopen(fileName.c_str(), "r+b");
+    if (this->File && this->LoadTables(nullptr))
+    {
+      return true;
+    }
+    // Not a container yet: start a new one
+    this->Close();
+    this->Frames.clear();
+    this->Chunks.clear();
+  }
+
+  this->File = std::fopen(fileName.c_str(), "w+b");
+  if (!this->File)
+  {
+    SetError(error, "Unable to open " + fileName);
+    return false;
+  }
+  std::memset(&this->Header, 0, sizeof(this->Header));
+  std::memcpy(this->Header.Magic, LidarFrameContainer::HEADER_MAGIC, sizeof(this->Header.Magic));
+  this->Header.Version = LidarFrameContainer::VERSION;
+  this->Header.ChunkSize = std::max<std::uint32_t>(this->ChunkSize, 1);
+  this->Header.RangeQuantum = this->RangeQuantum;
+  this->Header.IntensityQuantum = this->IntensityQuantum;
+  this->Header.TimestampQuantum = this->TimestampQuantum;
+  this->DataEnd = sizeof(this->Header);
+  if (!this->WriteAt(0, &this->Header, sizeof(this->Header)) || !this->WriteTables())
+  {
+    this->Close();
+    SetError(error, "Unable to write " + fileName);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainerWriter::LoadTables(std::string* error)
+{
+  // Only the tables are needed to append, the chunks are left untouched
+  LidarFrameContainer container;
+  if (!container.Open(this->FileName, error))
+  {
+    return false;
+  }
+  this->Header = container.GetHeader();
+  for (std::size_t i = 0; i < container.GetNumberOfFrames(); ++i)
+  {
+    this->Frames.push_back(container.GetFrame(i));
+  }
+  this->Chunks = container.GetChunks();
+  this->DataEnd = sizeof(this->Header);
+  for (const LidarFrameContainer::ChunkEntry& chunk : this->Chunks)
+  {
+    this->DataEnd = std::max(this->DataEnd, Align(chunk.Offset + chunk.StoredSize));
+  }
+  this->RangeQuantum = this->Header.RangeQuantum;
+  this->IntensityQuantum = this->Header.IntensityQuantum;
+  this->TimestampQuantum = this->Header.TimestampQuantum;
+  this->ChunkSize = this->Header.ChunkSize;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainerWriter::WriteFrame(
+  const LidarCompactFrame& frame, double time, std::string* error)
+{
+  if (!this->File)
+  {
+    SetError(error, "No container opened");
+    return false;
+  }
+
+  // Compress every chunk of every section in parallel; incompressible chunks
+  // are stored as is so that reading them is a plain copy
+  const std::uint64_t nbPoints = static_cast<std::uint64_t>(frame.GetNumberOfPoints());
+  const std::uint32_t chunkSize = this->Header.ChunkSize;
+  const vtkIdType chunksPerSection =
+    static_cast<vtkIdType>(LidarFrameContainer::GetNumberOfChunks(nbPoints, chunkSize));
+  const vtkIdType nbChunks = chunksPerSection * LidarCompactFrame::NUMBER_OF_SECTIONS;
+  const void* sections[LidarCompactFrame::NUMBER_OF_SECTIONS] = { frame.GetPositions(),
+    frame.GetTimestampOffsets(), frame.GetIntensities(), frame.GetRanges(),
+    frame.GetLaserIds() };
+  std::vector<std::vector<char>> compressed(static_cast<std::size_t>(nbChunks));
+  std::vector<const char*> data(compressed.size());
+  std::vector<std::uint32_t> sizes(compressed.size());
+  const int level = this->CompressionLevel;
+  vtkSMPTools::For(0, nbChunks, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const auto section = static_cast<LidarCompactFrame::Section>(i / chunksPerSection);
+      const std::uint64_t firstPoint = static_cast<std::uint64_t>(i % chunksPerSection) * chunkSize;
+      const std::size_t pointSize = LidarCompactFrame::GetPointSize(section);
+      const std::size_t size =
+        static_cast<std::size_t>(std::min<std::uint64_t>(chunkSize, nbPoints - firstPoint)) *
+        pointSize;
+      data[i] = static_cast<const char*>(sections[section]) + firstPoint * pointSize;
+      sizes[i] = static_cast<std::uint32_t>(size);
+      if (level <= 0)
+      {
+        continue;
+      }
+      std::vector<char>& out = compressed[i];
+      uLongf outSize = compressBound(static_cast<uLong>(size));
+      out.resize(outSize);
+      if (compress2(reinterpret_cast<Bytef*>(out.data()), &outSize,
+            reinterpret_cast<const Bytef*>(data[i]), static_cast<uLong>(size), level) == Z_OK &&
+        outSize < size - size / 8)
+      {
+        out.resize(outSize);
+      }
+      else
+      {
+        out.clear();
+      }
+    }
+  });
+
+  // The new chunks overwrite the previous tables, rewritten after them
+  LidarFrameContainer::FrameEntry entry;
+  entry.Time = time;
+  entry.TimestampBase = frame.GetTimestampBase();
+  entry.NumberOfPoints = nbPoints;
+  entry.FirstChunk = this->Chunks.size();
+  std::uint64_t offset = this->DataEnd;
+  for (std::size_t i = 0; i < compressed.size(); ++i)
+  {
+    LidarFrameContainer::ChunkEntry chunk;
+    chunk.Offset = offset;
+    chunk.Size = sizes[i];
+    const bool stored = compressed[i].empty();
+    chunk.StoredSize = stored ? sizes[i] : static_cast<std::uint32_t>(compressed[i].size());
+    if (!this->WriteAt(offset, stored ? data[i] : compressed[i].data(), chunk.StoredSize))
+    {
+      SetError(error, "Unable to write " + this->FileName);
+      return false;
+    }
+    this->Chunks.push_back(chunk);
+    offset = Align(offset + chunk.StoredSize);
+  }
+  this->Frames.push_back(entry);
+  this->DataEnd = offset;
+  if (!this->WriteTables())
+  {
+    SetError(error, "Unable to write " + this->FileName);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainerWriter::WriteAt(std::uint64_t offset, const void* data, std::size_t size)
+{
+  if (size == 0)
+  {
+    return true;
+  }
+#ifdef _WIN32
+  const int status = _fseeki64(this->File, static_cast<__int64>(offset), SEEK_SET);
+#else
+  const int status = fseeko(this->File, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  return status == 0 && std::fwrite(data, 1, size, this->File) == size;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainerWriter::WriteTables()
+{
+  LidarFrameContainer::Trailer trailer;
+  trailer.FrameTableOffset = this->DataEnd;
+  trailer.NumberOfFrames = this->Frames.size();
+  trailer.ChunkTableOffset =
+    trailer.FrameTableOffset + this->Frames.size() * sizeof(LidarFrameContainer::FrameEntry);
+  trailer.NumberOfChunks = this->Chunks.size();
+  std::memcpy(trailer.Magic, LidarFrameContainer::TRAILER_MAGIC, sizeof(trailer.Magic));
+  return this->WriteAt(trailer.FrameTableOffset, this->Frames.data(),
+           this->Frames.size() * sizeof(LidarFrameContainer::FrameEntry)) &&
+    this->WriteAt(trailer.ChunkTableOffset, this->Chunks.data(),
+      this->Chunks.size() * sizeof(LidarFrameContainer::ChunkEntry)) &&
+    this->WriteAt(trailer.ChunkTableOffset +
+        this->Chunks.size() * sizeof(LidarFrameContainer::ChunkEntry),
+      &trailer, sizeof(trailer)) &&
+    std::fflush(this->File) == 0;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarFrameContainerWriter::Close()
+{
+  if (!this->File)
+  {
+    return true;
+  }
+  const bool ok = std::fclose(this->File) == 0;
+  this->File = nullptr;
+  return ok;
+}
@@ -0,0 +1,97 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarFrameContainerWriter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarFrameContainerWriter_h
+#define LidarFrameContainerWriter_h
+
+#include "LidarFrameContainer.h"
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class LidarCompactFrame;
+
+/**
+ * @class LidarFrameContainerWriter
+ * @brief Write compact frames to an .lvf file (see LidarFrameContainer).
+ *
+ * Frames are appended one at a time. The chunks of a frame are compressed in
+ * parallel, then written after the previous frame, followed by the updated
+ * tables: the file is a valid container after each WriteFrame(), so that it
+ * can be read while a session is still being exported.
+ */
+class LIDARPROCESSING_EXPORT LidarFrameContainerWriter
+{
+public:
+  LidarFrameContainerWriter() = default;
+  ~LidarFrameContainerWriter();
+
+  //@{
+  /**
+   * Quantization steps written in the header of new files, they must match the
+   * ones of the frames given to WriteFrame(). Default to the LidarCompactFrame
+   * ones.
+   */
+  double RangeQuantum = 0.004;
+  double IntensityQuantum = 1.;
+  double TimestampQuantum = 1.;
+  //@}
+
+  /**
+   * Number of points per chunk, for new files. Default is 65536.
+   */
+  std::uint32_t ChunkSize = 1 << 16;
+
+  /**
+   * Deflate level of the chunks, 0 to store them uncompressed. Default is 1,
+   * fast enough to keep up with the decoding of a live sensor.
+   */
+  int CompressionLevel = 1;
+
+  /**
+   * Create fileName, or append to it when append is true and it is already a
+   * valid container. When appending, the quantization steps and chunk size of
+   * the existing file are used.
+   */
+  bool Open(const std::string& fileName, bool append, std::string* error = nullptr);
+
+  /**
+   * Append a frame, associated to time (usually the pipeline time step).
+   */
+  bool WriteFrame(const LidarCompactFrame& frame, double time, std::string* error = nullptr);
+
+  bool Close();
+
+  bool IsOpen() const { return this->File != nullptr; }
+  const std::string& GetFileName() const { return this->FileName; }
+  std::size_t GetNumberOfFrames() const { return this->Frames.size(); }
+
+private:
+  LidarFrameContainerWriter(const LidarFrameContainerWriter&) = delete;
+  void operator=(const LidarFrameContainerWriter&) = delete;
+
+  bool LoadTables(std::string* error);
+  bool WriteAt(std::uint64_t offset, const void* data, std::size_t size);
+  bool WriteTables();
+
+  std::string FileName;
+  std::FILE* File = nullptr;
+  LidarFrameContainer::Header Header;
+  std::vector<LidarFrameContainer::FrameEntry> Frames;
+  std::vector<LidarFrameContainer::ChunkEntry> Chunks;
+  // End of the chunks, where the tables start
+  std::uint64_t DataEnd = 0;
+};
+
+#endif // LidarFrameContainerWriter_h
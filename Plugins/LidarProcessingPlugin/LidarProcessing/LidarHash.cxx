@@ -0,0 +1,35 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarHash.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarHash.h"
+
+#include <cstdio>
+
+//-----------------------------------------------------------------------------
+std::uint64_t LidarHash::FNV1a(const void* data, std::size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint64_t hash = 14695981039346656037ull;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+//-----------------------------------------------------------------------------
+std::string LidarHash::ToHex(std::uint64_t hash)
+{
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+  return hex;
+}
@@ -0,0 +1,43 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarHash.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarHash_h
+#define LidarHash_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class LidarHash
+ * @brief 64 bits FNV-1a hash, naming the cache entries of the module.
+ *
+ * Not a cryptographic hash: it is only meant to turn a file content or path
+ * into a short stable name.
+ */
+class LIDARPROCESSING_EXPORT LidarHash
+{
+public:
+  static std::uint64_t FNV1a(const void* data, std::size_t size);
+  static std::uint64_t FNV1a(const std::string& content)
+  {
+    return FNV1a(content.data(), content.size());
+  }
+
+  /**
+   * Hash as 16 lowercase hexadecimal digits.
+   */
+  static std::string ToHex(std::uint64_t hash);
+};
+
+#endif // LidarHash_h
@@ -0,0 +1,480 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarLASWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarLASWriter.h"
+
+#include "LidarTaskPool.h"
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+constexpr unsigned short HEADER_SIZE = 375;
+constexpr unsigned short VLR_HEADER_SIZE = 54;
+constexpr unsigned short WKT_RECORD_ID = 2112;
+constexpr unsigned short GLOBAL_ENCODING_WKT = 1 << 4;
+constexpr int WAVE_PACKET_SIZE = 29;
+
+//-----------------------------------------------------------------------------
+// LAS is little endian, as are all the platforms LidarView runs on
+template <typename T>
+void Put(char*& buffer, T value)
+{
+  std::memcpy(buffer, &value, sizeof(T));
+  buffer += sizeof(T);
+}
+
+//-----------------------------------------------------------------------------
+void PutString(char*& buffer, const char* value, std::size_t size)
+{
+  std::memset(buffer, 0, size);
+  std::strncpy(buffer, value, size);
+  buffer += size;
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* GetArray(vtkPolyData* frame, const std::string& name, int nbComponents)
+{
+  if (name.empty())
+  {
+    return nullptr;
+  }
+  vtkDataArray* array = frame->GetPointData()->GetArray(name.c_str());
+  return (array && array->GetNumberOfComponents() == nbComponents) ? array : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+std::int32_t Quantize(double value, double scale)
+{
+  const double quantized = std::round(value / scale);
+  return static_cast<std::int32_t>(std::min(std::max(quantized,
+    static_cast<double>(std::numeric_limits<std::int32_t>::min())),
+    static_cast<double>(std::numeric_limits<std::int32_t>::max())));
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+T Clamp(double value)
+{
+  return static_cast<T>(std::min(std::max(value, static_cast<double>(std::numeric_limits<T>::min())),
+    static_cast<double>(std::numeric_limits<T>::max())));
+}
+
+//-----------------------------------------------------------------------------
+void ResetBounds(double bounds[6])
+{
+  for (int k = 0; k < 3; ++k)
+  {
+    bounds[2 * k] = std::numeric_limits<double>::max();
+    bounds[2 * k + 1] = std::numeric_limits<double>::lowest();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void MergeBounds(const double in[6], double out[6])
+{
+  for (int k = 0; k < 3; ++k)
+  {
+    out[2 * k] = std::min(out[2 * k], in[2 * k]);
+    out[2 * k + 1] = std::max(out[2 * k + 1], in[2 * k + 1]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool HasColor(int format)
+{
+  return format == 7 || format == 8 || format == 10;
+}
+}
+
+//-----------------------------------------------------------------------------
+struct LidarLASWriter::FrameArrays
+{
+  vtkSmartPointer<vtkPolyData> Frame;
+  vtkDataArray* Points = nullptr;
+  vtkDataArray* Intensity = nullptr;
+  vtkDataArray* LaserId = nullptr;
+  vtkDataArray* Timestamp = nullptr;
+  vtkDataArray* ReturnNumber = nullptr;
+  vtkDataArray* NumberOfReturns = nullptr;
+  vtkDataArray* Classification = nullptr;
+  vtkDataArray* Color = nullptr;
+  double ColorScale = 1.;
+  unsigned short SourceId = 0;
+};
+
+//-----------------------------------------------------------------------------
+struct LidarLASWriter::Chunk
+{
+  std::vector<char> Records;
+  vtkIdType NbPoints = 0;
+  std::uint64_t PointsByReturn[15] = {};
+  double Bounds[6];
+};
+
+//-----------------------------------------------------------------------------
+LidarLASWriter::LidarLASWriter()
+{
+  ResetBounds(this->Bounds);
+}
+
+//-----------------------------------------------------------------------------
+LidarLASWriter::~LidarLASWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::SetPointFormat(int format)
+{
+  if (format < 6 || format > 10)
+  {
+    return false;
+  }
+  this->PointFormat = format;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void LidarLASWriter::SetScale(double xy, double z)
+{
+  this->Scale[0] = this->Scale[1] = xy;
+  this->Scale[2] = z;
+}
+
+//-----------------------------------------------------------------------------
+void LidarLASWriter::SetOrigin(double x, double y, double z)
+{
+  this->Origin[0] = x;
+  this->Origin[1] = y;
+  this->Origin[2] = z;
+}
+
+//-----------------------------------------------------------------------------
+void LidarLASWriter::SetTimestampConversion(double scale, double offset)
+{
+  this->TimestampScale = scale;
+  this->TimestampOffset = offset;
+}
+
+//-----------------------------------------------------------------------------
+void LidarLASWriter::SetChunkSize(vtkIdType size)
+{
+  this->ChunkSize = std::max(size, vtkIdType(1));
+}
+
+//-----------------------------------------------------------------------------
+std::string LidarLASWriter::GetUTMZoneWKT(int zone, bool south)
+{
+  std::ostringstream wkt;
+  wkt << "PROJCS[\"WGS 84 / UTM zone " << zone << (south ? "S" : "N") << "\","
+      << "GEOGCS[\"WGS 84\",DATUM[\"WGS_1984\",SPHEROID[\"WGS 84\",6378137,298.257223563,"
+      << "AUTHORITY[\"EPSG\",\"7030\"]],AUTHORITY[\"EPSG\",\"6326\"]],"
+      << "PRIMEM[\"Greenwich\",0,AUTHORITY[\"EPSG\",\"8901\"]],"
+      << "UNIT[\"degree\",0.0174532925199433,AUTHORITY[\"EPSG\",\"9122\"]],"
+      << "AUTHORITY[\"EPSG\",\"4326\"]],"
+      << "PROJECTION[\"Transverse_Mercator\"],"
+      << "PARAMETER[\"latitude_of_origin\",0],"
+      << "PARAMETER[\"central_meridian\"," << 6 * zone - 183 << "],"
+      << "PARAMETER[\"scale_factor\",0.9996],"
+      << "PARAMETER[\"false_easting\",500000],"
+      << "PARAMETER[\"false_northing\"," << (south ? 10000000 : 0) << "],"
+      << "UNIT[\"metre\",1,AUTHORITY[\"EPSG\",\"9001\"]],"
+      << "AXIS[\"Easting\",EAST],AXIS[\"Northing\",NORTH],"
+      << "AUTHORITY[\"EPSG\",\"" << (south ? 32700 : 32600) + zone << "\"]]";
+  return wkt.str();
+}
+
+//-----------------------------------------------------------------------------
+unsigned short LidarLASWriter::GetRecordLength() const
+{
+  switch (this->PointFormat)
+  {
+    case 7:
+      return 36;
+    case 8:
+      return 38;
+    case 9:
+      return 30 + WAVE_PACKET_SIZE;
+    case 10:
+      return 38 + WAVE_PACKET_SIZE;
+    default:
+      return 30;
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::uint64_t LidarLASWriter::GetNumberOfPoints() const
+{
+  std::uint64_t nbPoints = 0;
+  for (std::uint64_t count : this->PointsByReturn)
+  {
+    nbPoints += count;
+  }
+  return nbPoints;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::Fail(const std::string& error)
+{
+  this->LastError = error;
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::Open(const std::string& filename)
+{
+  this->Close();
+  this->LastError.clear();
+  std::fill(std::begin(this->PointsByReturn), std::end(this->PointsByReturn), 0);
+  ResetBounds(this->Bounds);
+
+  this->File = std::fopen(filename.c_str(), "wb");
+  if (!this->File)
+  {
+    return this->Fail("Could not open " + filename);
+  }
+  // Placeholder, completed on Close()
+  return this->WriteHeader();
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::WriteHeader()
+{
+  const unsigned short wktSize =
+    this->WKT.empty() ? 0 : static_cast<unsigned short>(this->WKT.size() + 1);
+  const std::uint32_t pointDataOffset =
+    HEADER_SIZE + (this->WKT.empty() ? 0 : VLR_HEADER_SIZE + wktSize);
+  std::vector<char> buffer(pointDataOffset, 0);
+  char* p = buffer.data();
+
+  const std::time_t now = std::time(nullptr);
+  const std::tm* date = std::gmtime(&now);
+  const bool empty = this->GetNumberOfPoints() == 0;
+
+  PutString(p, "LASF", 4);
+  Put<std::uint16_t>(p, 0);                   // file source ID
+  Put<std::uint16_t>(p, GLOBAL_ENCODING_WKT); // global encoding
+  p += 16;                                    // project ID
+  Put<std::uint8_t>(p, 1);
+  Put<std::uint8_t>(p, 4);
+  PutString(p, "OTHER", 32);
+  PutString(p, "LidarView", 32);
+  Put<std::uint16_t>(p, static_cast<std::uint16_t>(date->tm_yday + 1));
+  Put<std::uint16_t>(p, static_cast<std::uint16_t>(date->tm_year + 1900));
+  Put<std::uint16_t>(p, HEADER_SIZE);
+  Put<std::uint32_t>(p, pointDataOffset);
+  Put<std::uint32_t>(p, this->WKT.empty() ? 0 : 1);
+  Put<std::uint8_t>(p, static_cast<std::uint8_t>(this->PointFormat));
+  Put<std::uint16_t>(p, this->GetRecordLength());
+  // Legacy point counts stay 0 for point formats 6 and above
+  p += 4 + 5 * 4;
+  for (int k = 0; k < 3; ++k)
+  {
+    Put<double>(p, this->Scale[k]);
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    Put<double>(p, this->Origin[k]);
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    Put<double>(p, empty ? 0. : this->Bounds[2 * k + 1]);
+    Put<double>(p, empty ? 0. : this->Bounds[2 * k]);
+  }
+  Put<std::uint64_t>(p, 0); // start of waveform data
+  Put<std::uint64_t>(p, 0); // start of first EVLR
+  Put<std::uint32_t>(p, 0); // number of EVLRs
+  Put<std::uint64_t>(p, this->GetNumberOfPoints());
+  for (std::uint64_t count : this->PointsByReturn)
+  {
+    Put<std::uint64_t>(p, count);
+  }
+
+  if (!this->WKT.empty())
+  {
+    Put<std::uint16_t>(p, 0);
+    PutString(p, "LASF_Projection", 16);
+    Put<std::uint16_t>(p, WKT_RECORD_ID);
+    Put<std::uint16_t>(p, wktSize);
+    PutString(p, "OGC coordinate system WKT", 32);
+    std::memcpy(p, this->WKT.c_str(), wktSize);
+  }
+
+  if (std::fseek(this->File, 0, SEEK_SET) ||
+    std::fwrite(buffer.data(), 1, buffer.size(), this->File) != buffer.size())
+  {
+    return this->Fail("Could not write the LAS header");
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+LidarLASWriter::Chunk LidarLASWriter::Encode(
+  const FrameArrays& arrays, vtkIdType begin, vtkIdType end) const
+{
+  const unsigned short length = this->GetRecordLength();
+  const bool color = HasColor(this->PointFormat);
+  Chunk chunk;
+  chunk.NbPoints = end - begin;
+  chunk.Records.assign(static_cast<std::size_t>(length) * chunk.NbPoints, 0);
+  ResetBounds(chunk.Bounds);
+
+  char* record = chunk.Records.data();
+  for (vtkIdType i = begin; i < end; ++i, record += length)
+  {
+    double point[3];
+    arrays.Points->GetTuple(i, point);
+    std::int32_t xyz[3];
+    for (int k = 0; k < 3; ++k)
+    {
+      xyz[k] = Quantize(point[k], this->Scale[k]);
+      const double value = xyz[k] * this->Scale[k] + this->Origin[k];
+      chunk.Bounds[2 * k] = std::min(chunk.Bounds[2 * k], value);
+      chunk.Bounds[2 * k + 1] = std::max(chunk.Bounds[2 * k + 1], value);
+    }
+
+    const int returnNumber = arrays.ReturnNumber
+      ? std::min(std::max(static_cast<int>(arrays.ReturnNumber->GetComponent(i, 0)), 1), 15)
+      : 1;
+    const int nbReturns = arrays.NumberOfReturns
+      ? std::min(std::max(static_cast<int>(arrays.NumberOfReturns->GetComponent(i, 0)), 1), 15)
+      : 1;
+    chunk.PointsByReturn[returnNumber - 1]++;
+
+    char* p = record;
+    Put<std::int32_t>(p, xyz[0]);
+    Put<std::int32_t>(p, xyz[1]);
+    Put<std::int32_t>(p, xyz[2]);
+    Put<std::uint16_t>(p,
+      arrays.Intensity ? Clamp<std::uint16_t>(arrays.Intensity->GetComponent(i, 0)) : 0);
+    Put<std::uint8_t>(p, static_cast<std::uint8_t>(returnNumber | (nbReturns << 4)));
+    Put<std::uint8_t>(p, 0); // classification flags, channel, scan direction, edge
+    Put<std::uint8_t>(p,
+      arrays.Classification ? Clamp<std::uint8_t>(arrays.Classification->GetComponent(i, 0)) : 0);
+    Put<std::uint8_t>(p,
+      arrays.LaserId ? Clamp<std::uint8_t>(arrays.LaserId->GetComponent(i, 0)) : 0);
+    Put<std::int16_t>(p, 0); // scan angle
+    Put<std::uint16_t>(p, arrays.SourceId);
+    Put<double>(p,
+      arrays.Timestamp
+        ? arrays.Timestamp->GetComponent(i, 0) * this->TimestampScale + this->TimestampOffset
+        : 0.);
+    if (color && arrays.Color)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        Put<std::uint16_t>(
+          p, Clamp<std::uint16_t>(arrays.Color->GetComponent(i, k) * arrays.ColorScale));
+      }
+    }
+    // NIR and wave packets are left to 0
+  }
+  return chunk;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::WriteFrame(vtkPolyData* frame, unsigned short sourceId)
+{
+  if (!this->File)
+  {
+    return this->Fail("The writer is not open");
+  }
+  if (!frame || !frame->GetPoints() || frame->GetNumberOfPoints() == 0)
+  {
+    return true;
+  }
+
+  auto arrays = std::make_shared<FrameArrays>();
+  arrays->Frame = frame;
+  arrays->Points = frame->GetPoints()->GetData();
+  arrays->Intensity = GetArray(frame, this->Names.Intensity, 1);
+  arrays->LaserId = GetArray(frame, this->Names.LaserId, 1);
+  arrays->Timestamp = GetArray(frame, this->Names.Timestamp, 1);
+  arrays->ReturnNumber = GetArray(frame, this->Names.ReturnNumber, 1);
+  arrays->NumberOfReturns = GetArray(frame, this->Names.NumberOfReturns, 1);
+  arrays->Classification = GetArray(frame, this->Names.Classification, 1);
+  arrays->Color = GetArray(frame, this->Names.Color, 3);
+  // LAS colors are 16 bits
+  arrays->ColorScale = (arrays->Color && arrays->Color->GetDataTypeSize() == 1) ? 257. : 1.;
+  arrays->SourceId = sourceId;
+
+  // Enough chunks in flight to keep the pool busy while bounding the memory
+  LidarTaskPool& pool = LidarTaskPool::GetInstance();
+  const std::size_t maxPending = 2 * pool.GetNumberOfThreads();
+  const vtkIdType nbPoints = frame->GetNumberOfPoints();
+  for (vtkIdType begin = 0; begin < nbPoints; begin += this->ChunkSize)
+  {
+    const vtkIdType end = std::min(begin + this->ChunkSize, nbPoints);
+    while (this->Pending.size() >= maxPending)
+    {
+      Chunk chunk = this->Pending.front().get();
+      this->Pending.pop_front();
+      if (!this->Emit(chunk))
+      {
+        return false;
+      }
+    }
+    this->Pending.push_back(
+      pool.Submit([this, arrays, begin, end]() { return this->Encode(*arrays, begin, end); }));
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::Emit(Chunk& chunk)
+{
+  if (std::fwrite(chunk.Records.data(), 1, chunk.Records.size(), this->File) !=
+    chunk.Records.size())
+  {
+    return this->Fail("Could not write the point records");
+  }
+
+  for (int r = 0; r < 15; ++r)
+  {
+    this->PointsByReturn[r] += chunk.PointsByReturn[r];
+  }
+  MergeBounds(chunk.Bounds, this->Bounds);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarLASWriter::Close()
+{
+  bool ok = true;
+  while (!this->Pending.empty())
+  {
+    Chunk chunk = this->Pending.front().get();
+    this->Pending.pop_front();
+    // Keep draining on error: pending tasks reference this writer
+    ok = ok && this->Emit(chunk);
+  }
+
+  if (this->File)
+  {
+    ok = this->WriteHeader() && ok;
+    ok = std::fclose(this->File) == 0 && ok;
+    this->File = nullptr;
+  }
+  return ok;
+}
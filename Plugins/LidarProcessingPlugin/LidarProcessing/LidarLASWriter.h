@@ -0,0 +1,157 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarLASWriter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarLASWriter_h
+#define LidarLASWriter_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+class vtkPolyData;
+
+/**
+ * @class LidarLASWriter
+ * @brief Streaming LAS 1.4 writer encoding chunks of points in parallel.
+ *
+ * Frames are split in chunks of ChunkSize points, encoded to point data records
+ * on the LidarTaskPool and written in submission order, so that the file is
+ * identical to a sequential write. A bounded number of chunks is kept in
+ * flight: the caller keeps decoding frames while the previous ones are encoded.
+ *
+ * Point data record formats 6 to 10 are supported, with the GPS time taken
+ * from the timestamp array and up to 15 returns per pulse. The header (point
+ * counts by return, bounds) is completed on Close().
+ *
+ * Coordinates are written as point + Origin, quantized with Scale, the origin
+ * being the offset of the file.
+ */
+class LIDARPROCESSING_EXPORT LidarLASWriter
+{
+public:
+  LidarLASWriter();
+  ~LidarLASWriter();
+
+  /**
+   * Names of the point arrays read for each record. Empty or missing arrays
+   * leave the matching field to its default: return 1 of 1, unclassified,
+   * black.
+   */
+  struct ArrayNames
+  {
+    std::string Intensity = "intensity";
+    //! Stored in the user data byte
+    std::string LaserId = "laser_id";
+    std::string Timestamp = "adjustedtime";
+    std::string ReturnNumber;
+    std::string NumberOfReturns;
+    std::string Classification;
+    //! 3 components, 0-255 or 0-65535 depending on the array type
+    std::string Color;
+  };
+  void SetArrayNames(const ArrayNames& names) { this->Names = names; }
+  const ArrayNames& GetArrayNames() const { return this->Names; }
+
+  //@{
+  /**
+   * Point data record format, 6 (default) to 10. Returns false for an
+   * unsupported format.
+   */
+  bool SetPointFormat(int format);
+  int GetPointFormat() const { return this->PointFormat; }
+  //@}
+
+  //@{
+  /**
+   * Quantization of the horizontal and vertical coordinates. Default is 1 mm.
+   */
+  void SetScale(double xy, double z);
+  void SetOrigin(double x, double y, double z);
+  //@}
+
+  /**
+   * GPS time = timestamp * scale + offset. Default converts microseconds to
+   * seconds.
+   */
+  void SetTimestampConversion(double scale, double offset);
+
+  /**
+   * OGC WKT of the coordinate system, written as a LASF_Projection record.
+   */
+  void SetCoordinateSystemWKT(const std::string& wkt) { this->WKT = wkt; }
+
+  /**
+   * WKT of the WGS 84 / UTM zone.
+   */
+  static std::string GetUTMZoneWKT(int zone, bool south = false);
+
+  //@{
+  /**
+   * Number of points per encoded chunk. Default is 50000.
+   */
+  void SetChunkSize(vtkIdType size);
+  vtkIdType GetChunkSize() const { return this->ChunkSize; }
+  //@}
+
+  bool Open(const std::string& filename);
+
+  /**
+   * Queue the points of a frame. sourceId is stored as the point source ID,
+   * e.g. the frame index. The frame is kept alive until it is encoded.
+   */
+  bool WriteFrame(vtkPolyData* frame, unsigned short sourceId = 0);
+
+  /**
+   * Write the pending chunks and complete the header.
+   */
+  bool Close();
+
+  std::uint64_t GetNumberOfPoints() const;
+  const std::string& GetLastError() const { return this->LastError; }
+
+private:
+  LidarLASWriter(const LidarLASWriter&) = delete;
+  void operator=(const LidarLASWriter&) = delete;
+
+  struct Chunk;
+  struct FrameArrays;
+
+  unsigned short GetRecordLength() const;
+  Chunk Encode(const FrameArrays& arrays, vtkIdType begin, vtkIdType end) const;
+  bool WriteHeader();
+  bool Emit(Chunk& chunk);
+  bool Fail(const std::string& error);
+
+  ArrayNames Names;
+  int PointFormat = 6;
+  double Scale[3] = { 1e-3, 1e-3, 1e-3 };
+  double Origin[3] = { 0., 0., 0. };
+  double TimestampScale = 1e-6;
+  double TimestampOffset = 0.;
+  std::string WKT;
+  vtkIdType ChunkSize = 50000;
+
+  std::FILE* File = nullptr;
+  std::deque<std::future<Chunk>> Pending;
+  // Header inventory, updated as chunks are written
+  std::uint64_t PointsByReturn[15] = {};
+  double Bounds[6];
+  std::string LastError;
+};
+
+#endif // LidarLASWriter_h
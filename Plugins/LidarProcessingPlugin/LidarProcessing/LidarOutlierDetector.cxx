@@ -0,0 +1,198 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarOutlierDetector.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarOutlierDetector.h"
+
+#include "LidarRangeImage.h"
+
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Squared distances from position to the points of the pixels
+// [column, column + nbColumns[ of a row, skipping the empty pixels and skip
+void GatherDistances(const LidarRangeImage& image, int row, int column, int nbColumns,
+  const double position[3], vtkIdType skip, std::vector<float>& distances)
+{
+  const vtkIdType first = image.GetPixel(row, column);
+  const float* positions = image.GetPosition(first);
+  for (int c = 0; c < nbColumns; ++c)
+  {
+    const vtkIdType pixel = first + c;
+    if (image.GetPointId(pixel) < 0 || pixel == skip)
+    {
+      continue;
+    }
+    const float* neighbor = positions + 3 * c;
+    const double dx = neighbor[0] - position[0];
+    const double dy = neighbor[1] - position[1];
+    const double dz = neighbor[2] - position[2];
+    distances.push_back(static_cast<float>(dx * dx + dy * dy + dz * dz));
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType LidarOutlierDetector::Detect(
+  const LidarRangeImage& image, vtkDataArray* points, unsigned char* outliers) const
+{
+  const vtkIdType nbPoints = points->GetNumberOfTuples();
+  const int width = image.GetWidth();
+  const int height = image.GetHeight();
+  // The window cannot wrap onto itself
+  const int size = std::max(0, std::min(this->NeighborhoodSize, (width - 1) / 2));
+  const double columnAngle = 2. * vtkMath::Pi() / width;
+  const int method = this->Method;
+  const vtkIdType minNeighbors = std::max(this->MinNeighbors, 0);
+  const std::size_t meanK = static_cast<std::size_t>(std::max(this->MeanK, 1));
+
+  // Radius criteria give the outliers directly, STATISTICAL first gives the
+  // mean distance to the closest neighbors, -1 when not applicable
+  std::vector<double> meanDistances(method == STATISTICAL ? nbPoints : 0);
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<float> distances;
+    distances.reserve((2 * size + 1) * (2 * size + 1));
+    double position[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      outliers[i] = 0;
+      const vtkIdType pixel = image.GetPointPixel(i);
+      if (pixel < 0)
+      {
+        if (method == STATISTICAL)
+        {
+          meanDistances[i] = -1.;
+        }
+        continue;
+      }
+      // The point of the pixel is not a neighbor of itself, but the other
+      // points sharing the pixel are neighbors of it
+      const bool isPixelPoint = image.GetPointId(pixel) == i;
+      if (isPixelPoint)
+      {
+        const float* pixelPosition = image.GetPosition(pixel);
+        position[0] = pixelPosition[0];
+        position[1] = pixelPosition[1];
+        position[2] = pixelPosition[2];
+      }
+      else
+      {
+        points->GetTuple(i, position);
+      }
+
+      // Contiguous spans of the window rows, split where the columns wrap
+      distances.clear();
+      const int row = static_cast<int>(pixel / width);
+      const int column = static_cast<int>(pixel % width);
+      const int firstColumn = column - size;
+      const int lastColumn = column + size;
+      const vtkIdType skip = isPixelPoint ? pixel : -1;
+      for (int r = std::max(row - size, 0); r <= std::min(row + size, height - 1); ++r)
+      {
+        if (firstColumn < 0)
+        {
+          GatherDistances(image, r, width + firstColumn, -firstColumn, position, skip, distances);
+          GatherDistances(image, r, 0, lastColumn + 1, position, skip, distances);
+        }
+        else if (lastColumn >= width)
+        {
+          GatherDistances(
+            image, r, firstColumn, width - firstColumn, position, skip, distances);
+          GatherDistances(image, r, 0, lastColumn - width + 1, position, skip, distances);
+        }
+        else
+        {
+          GatherDistances(image, r, firstColumn, 2 * size + 1, position, skip, distances);
+        }
+      }
+
+      if (distances.empty())
+      {
+        outliers[i] = 1;
+        if (method == STATISTICAL)
+        {
+          meanDistances[i] = -1.;
+        }
+        continue;
+      }
+      if (method == STATISTICAL)
+      {
+        const std::size_t k = std::min(meanK, distances.size());
+        std::nth_element(distances.begin(), distances.begin() + (k - 1), distances.end());
+        double sum = 0.;
+        for (std::size_t n = 0; n < k; ++n)
+        {
+          sum += std::sqrt(distances[n]);
+        }
+        meanDistances[i] = sum / k;
+        continue;
+      }
+      double radius = this->Radius;
+      if (method == DYNAMIC_RADIUS)
+      {
+        const double range = std::sqrt(vtkMath::Dot(position, position));
+        radius = std::max(radius, this->RadiusMultiplier * range * columnAngle);
+      }
+      const float radius2 = static_cast<float>(radius * radius);
+      vtkIdType nbNeighbors = 0;
+      for (float distance2 : distances)
+      {
+        nbNeighbors += distance2 <= radius2 ? 1 : 0;
+      }
+      outliers[i] = nbNeighbors < minNeighbors ? 1 : 0;
+    }
+  });
+
+  if (method == STATISTICAL)
+  {
+    double sum = 0.;
+    double sum2 = 0.;
+    vtkIdType count = 0;
+    for (double distance : meanDistances)
+    {
+      if (distance >= 0.)
+      {
+        sum += distance;
+        sum2 += distance * distance;
+        ++count;
+      }
+    }
+    if (count > 0)
+    {
+      const double mean = sum / count;
+      const double stdDev = std::sqrt(std::max(sum2 / count - mean * mean, 0.));
+      const double threshold = mean + this->StdDevMultiplier * stdDev;
+      vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; ++i)
+        {
+          if (meanDistances[i] > threshold)
+          {
+            outliers[i] = 1;
+          }
+        }
+      });
+    }
+  }
+
+  vtkIdType nbOutliers = 0;
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    nbOutliers += outliers[i];
+  }
+  return nbOutliers;
+}
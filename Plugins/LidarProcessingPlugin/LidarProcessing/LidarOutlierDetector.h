@@ -0,0 +1,127 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarOutlierDetector.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarOutlierDetector_h
+#define LidarOutlierDetector_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+class vtkDataArray;
+class LidarRangeImage;
+
+/**
+ * @class LidarOutlierDetector
+ * @brief Detect isolated points of a frame, such as rain, dust or spray returns.
+ *
+ * The neighbors of a point are the points of the pixels around its pixel in
+ * the range image of the frame (NeighborhoodSize pixels on each side), so no
+ * spatial search is needed. A point is an outlier when:
+ *  - RADIUS: fewer than MinNeighbors neighbors are within Radius.
+ *  - DYNAMIC_RADIUS: same, with a radius growing with the range of the point,
+ *    RadiusMultiplier times the distance between two azimuth columns at that
+ *    range, and at least Radius. The points of far away objects are sparser,
+ *    a fixed radius would remove them.
+ *  - STATISTICAL: the mean distance to its MeanK closest neighbors is above the
+ *    mean of these distances over the frame plus StdDevMultiplier standard
+ *    deviations.
+ *
+ * Points without any neighbor are always outliers. The points are processed in
+ * parallel, reading the neighbor positions from the contiguous rows of the
+ * image.
+ */
+class LIDARPROCESSING_EXPORT LidarOutlierDetector
+{
+public:
+  enum MethodType
+  {
+    STATISTICAL = 0,
+    RADIUS = 1,
+    DYNAMIC_RADIUS = 2
+  };
+
+  //@{
+  /**
+   * Outlier criterion. Default is DYNAMIC_RADIUS.
+   */
+  void SetMethod(int method) { this->Method = method; }
+  int GetMethod() const { return this->Method; }
+  //@}
+
+  //@{
+  /**
+   * Number of pixels on each side of the pixel of a point where its neighbors
+   * are looked for. Default is 2, a 5x5 window.
+   */
+  void SetNeighborhoodSize(int size) { this->NeighborhoodSize = size; }
+  int GetNeighborhoodSize() const { return this->NeighborhoodSize; }
+  //@}
+
+  //@{
+  /**
+   * Search radius of RADIUS, minimum radius of DYNAMIC_RADIUS. Default is 0.2 m.
+   */
+  void SetRadius(double radius) { this->Radius = radius; }
+  double GetRadius() const { return this->Radius; }
+  //@}
+
+  //@{
+  /**
+   * Neighbors needed within the radius to be an inlier. Default is 2.
+   */
+  void SetMinNeighbors(int nbNeighbors) { this->MinNeighbors = nbNeighbors; }
+  int GetMinNeighbors() const { return this->MinNeighbors; }
+  //@}
+
+  //@{
+  /**
+   * Radius of DYNAMIC_RADIUS, in azimuth column spacings. Default is 3.
+   */
+  void SetRadiusMultiplier(double multiplier) { this->RadiusMultiplier = multiplier; }
+  double GetRadiusMultiplier() const { return this->RadiusMultiplier; }
+  //@}
+
+  //@{
+  /**
+   * Number of closest neighbors of STATISTICAL. Default is 8.
+   */
+  void SetMeanK(int k) { this->MeanK = k; }
+  int GetMeanK() const { return this->MeanK; }
+  //@}
+
+  //@{
+  /**
+   * Standard deviations above the mean of STATISTICAL. Default is 1.
+   */
+  void SetStdDevMultiplier(double multiplier) { this->StdDevMultiplier = multiplier; }
+  double GetStdDevMultiplier() const { return this->StdDevMultiplier; }
+  //@}
+
+  /**
+   * Flag the outliers among the points the image was built from: outliers
+   * gets 1 for an outlier, 0 otherwise, one value per point. Points outside of
+   * the image are not outliers. Returns the number of outliers.
+   */
+  vtkIdType Detect(
+    const LidarRangeImage& image, vtkDataArray* points, unsigned char* outliers) const;
+
+private:
+  int Method = DYNAMIC_RADIUS;
+  int NeighborhoodSize = 2;
+  double Radius = 0.2;
+  int MinNeighbors = 2;
+  double RadiusMultiplier = 3.;
+  int MeanK = 8;
+  double StdDevMultiplier = 1.;
+};
+
+#endif // LidarOutlierDetector_h
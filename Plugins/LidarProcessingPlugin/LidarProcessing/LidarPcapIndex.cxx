@@ -0,0 +1,470 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPcapIndex.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarPcapIndex.h"
+
+#include <vtksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+const char CACHE_MAGIC[8] = { 'L', 'V', 'P', 'C', 'I', 'D', 'X', '\0' };
+constexpr std::uint32_t CACHE_VERSION = 2;
+
+constexpr std::uint64_t GLOBAL_HEADER_SIZE = 24;
+constexpr std::uint64_t RECORD_HEADER_SIZE = 16;
+constexpr std::uint32_t MAX_RECORD_SIZE = 1 << 18;
+
+// Velodyne legacy data packets: 12 blocks of 100 bytes + timestamp + factory
+constexpr std::size_t DATA_PACKET_SIZE = 1206;
+constexpr int NB_BLOCKS = 12;
+constexpr int BLOCK_SIZE = 100;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::uint32_t ReadU32(const unsigned char* p, bool swap)
+{
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  if (swap)
+  {
+    value = ((value & 0xFF) << 24) | ((value & 0xFF00) << 8) | ((value >> 8) & 0xFF00) |
+      (value >> 24);
+  }
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+std::uint16_t ReadBigEndian16(const unsigned char* p)
+{
+  return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * UDP payload of a captured IPv4 packet, nullptr for anything else.
+ */
+const unsigned char* GetUDPPayload(const unsigned char* data, std::uint32_t size,
+  std::uint32_t linkType, int port, std::size_t& payloadSize)
+{
+  std::uint32_t ip = 0;
+  std::uint16_t etherType = 0x0800;
+  switch (linkType)
+  {
+    case 0: // null / loopback
+      ip = 4;
+      break;
+    case 1: // Ethernet
+      ip = 14;
+      if (size < ip)
+      {
+        return nullptr;
+      }
+      etherType = ReadBigEndian16(data + 12);
+      if (etherType == 0x8100 && size >= 18) // VLAN
+      {
+        etherType = ReadBigEndian16(data + 16);
+        ip = 18;
+      }
+      break;
+    case 113: // Linux cooked
+      ip = 16;
+      if (size < ip)
+      {
+        return nullptr;
+      }
+      etherType = ReadBigEndian16(data + 14);
+      break;
+    case 12:
+    case 101: // raw IP
+      break;
+    default:
+      return nullptr;
+  }
+  if (etherType != 0x0800 || size < ip + 20 || (data[ip] >> 4) != 4 || data[ip + 9] != 17)
+  {
+    return nullptr;
+  }
+  // Fragments are not data packets of a sensor
+  if ((ReadBigEndian16(data + ip + 6) & 0x3FFF) != 0)
+  {
+    return nullptr;
+  }
+  const std::uint32_t udp = ip + (data[ip] & 0x0F) * 4;
+  if (size < udp + 8 || (port && ReadBigEndian16(data + udp + 2) != port))
+  {
+    return nullptr;
+  }
+  const std::uint16_t udpSize = ReadBigEndian16(data + udp + 4);
+  if (udpSize < 8 || size < udp + udpSize)
+  {
+    return nullptr;
+  }
+  payloadSize = udpSize - 8;
+  return data + udp + 8;
+}
+
+//-----------------------------------------------------------------------------
+bool CopyRange(int input, std::uint64_t offset, std::uint64_t size, int output)
+{
+#ifdef __linux__
+  // In kernel copy: no page goes through user space, and file systems
+  // supporting it (btrfs, xfs, NFS 4.2) may even share the extents
+  off_t inputOffset = static_cast<off_t>(offset);
+  bool kernelCopy = true;
+#ifdef SYS_copy_file_range
+  while (size > 0)
+  {
+    const ssize_t copied = syscall(SYS_copy_file_range, input, &inputOffset, output, nullptr,
+      static_cast<std::size_t>(std::min<std::uint64_t>(size, 1 << 30)), 0u);
+    if (copied <= 0)
+    {
+      break;
+    }
+    size -= static_cast<std::uint64_t>(copied);
+  }
+#endif
+  while (size > 0 && kernelCopy)
+  {
+    const ssize_t copied = sendfile(output, input, &inputOffset,
+      static_cast<std::size_t>(std::min<std::uint64_t>(size, 1 << 30)));
+    if (copied <= 0)
+    {
+      kernelCopy = false;
+      break;
+    }
+    size -= static_cast<std::uint64_t>(copied);
+  }
+  offset = static_cast<std::uint64_t>(inputOffset);
+  if (size == 0)
+  {
+    return true;
+  }
+#endif
+
+  // Portable fallback
+#ifdef _WIN32
+  if (_lseeki64(input, static_cast<__int64>(offset), SEEK_SET) < 0)
+#else
+  if (lseek(input, static_cast<off_t>(offset), SEEK_SET) < 0)
+#endif
+  {
+    return false;
+  }
+  std::vector<char> buffer(1 << 20);
+  while (size > 0)
+  {
+    const unsigned int chunk =
+      static_cast<unsigned int>(std::min<std::uint64_t>(size, buffer.size()));
+#ifdef _WIN32
+    const int nbRead = _read(input, buffer.data(), chunk);
+    if (nbRead <= 0 || _write(output, buffer.data(), nbRead) != nbRead)
+#else
+    const ssize_t nbRead = read(input, buffer.data(), chunk);
+    if (nbRead <= 0 || write(output, buffer.data(), nbRead) != nbRead)
+#endif
+    {
+      return false;
+    }
+    size -= static_cast<std::uint64_t>(nbRead);
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPcapIndex::Build(const std::string& pcapFileName, int lidarPort,
+  const std::string& cacheFileName, std::string* error, const ProgressCallback& progress)
+{
+  this->FileName = pcapFileName;
+  this->LidarPort = lidarPort;
+  this->FileSize = vtksys::SystemTools::FileLength(pcapFileName);
+  this->ModificationTime = vtksys::SystemTools::ModifiedTime(pcapFileName);
+  this->Frames.clear();
+
+  if (!cacheFileName.empty() && this->ReadCache(cacheFileName))
+  {
+    return true;
+  }
+  if (!this->Scan(error, progress))
+  {
+    this->Frames.clear();
+    return false;
+  }
+  if (!cacheFileName.empty())
+  {
+    // A missing cache only costs a scan next time
+    this->WriteCache(cacheFileName);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPcapIndex::Scan(std::string* error, const ProgressCallback& progress)
+{
+  std::FILE* file = std::fopen(this->FileName.c_str(), "rb");
+  if (!file)
+  {
+    SetError(error, "Unable to open " + this->FileName);
+    return false;
+  }
+  std::vector<char> streamBuffer(1 << 20);
+  std::setvbuf(file, streamBuffer.data(), _IOFBF, streamBuffer.size());
+
+  unsigned char header[GLOBAL_HEADER_SIZE];
+  if (std::fread(header, 1, sizeof(header), file) != sizeof(header))
+  {
+    std::fclose(file);
+    SetError(error, this->FileName + " is not a pcap file");
+    return false;
+  }
+  std::uint32_t magic;
+  std::memcpy(&magic, header, sizeof(magic));
+  const bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+  if (!swap && magic != 0xa1b2c3d4 && magic != 0xa1b23c4d)
+  {
+    std::fclose(file);
+    SetError(error, this->FileName + " is not a classic pcap file");
+    return false;
+  }
+  const std::uint32_t linkType = ReadU32(header + 20, swap) & 0xFFFF;
+  const double subsecondUnit = magic == 0xa1b23c4d || magic == 0x4d3cb2a1 ? 1e-9 : 1e-6;
+
+  std::vector<unsigned char> record(MAX_RECORD_SIZE);
+  std::uint64_t offset = GLOBAL_HEADER_SIZE;
+  int previousAzimuth = -1;
+  FrameRange current;
+  current.Begin = GLOBAL_HEADER_SIZE;
+  bool firstPacket = true;
+  bool truncated = false;
+  for (std::uint64_t nbRecords = 0;; ++nbRecords)
+  {
+    if (progress && nbRecords % 4096 == 0 &&
+      !progress(this->FileSize ? static_cast<double>(offset) / this->FileSize : 0.))
+    {
+      std::fclose(file);
+      SetError(error, "Indexing of " + this->FileName + " canceled");
+      return false;
+    }
+    unsigned char recordHeader[RECORD_HEADER_SIZE];
+    if (std::fread(recordHeader, 1, sizeof(recordHeader), file) != sizeof(recordHeader))
+    {
+      break;
+    }
+    const std::uint32_t size = ReadU32(recordHeader + 8, swap);
+    if (size > MAX_RECORD_SIZE || std::fread(record.data(), 1, size, file) != size)
+    {
+      truncated = true;
+      break;
+    }
+    const std::uint64_t recordBegin = offset;
+    offset += RECORD_HEADER_SIZE + size;
+
+    std::size_t payloadSize = 0;
+    const unsigned char* payload =
+      GetUDPPayload(record.data(), size, linkType, this->LidarPort, payloadSize);
+    if (!payload || payloadSize != DATA_PACKET_SIZE)
+    {
+      continue;
+    }
+    const double time =
+      ReadU32(recordHeader, swap) + ReadU32(recordHeader + 4, swap) * subsecondUnit;
+    if (firstPacket)
+    {
+      current.Time = time;
+      firstPacket = false;
+    }
+
+    // First block whose azimuth wraps around, if any
+    int wrap = -1;
+    for (int block = 0; block < NB_BLOCKS; ++block)
+    {
+      const unsigned char* p = payload + block * BLOCK_SIZE;
+      if (p[0] != 0xFF || p[1] < 0xBB)
+      {
+        continue;
+      }
+      const int azimuth = p[2] | (p[3] << 8);
+      if (wrap < 0 && previousAzimuth >= 0 && azimuth < previousAzimuth)
+      {
+        wrap = block;
+      }
+      previousAzimuth = azimuth;
+    }
+    if (wrap >= 0)
+    {
+      // The wrapping packet also ends the previous frame when it holds some
+      // of its firings
+      current.End = wrap == 0 ? recordBegin : offset;
+      this->Frames.push_back(current);
+      current.Begin = recordBegin;
+      current.Time = time;
+    }
+  }
+  std::fclose(file);
+
+  // Trailing frame, possibly incomplete as the recording was stopped
+  current.End = offset;
+  if (current.End > current.Begin)
+  {
+    this->Frames.push_back(current);
+  }
+  if (truncated)
+  {
+    SetError(
+      error, this->FileName + " is truncated, indexed up to byte " + std::to_string(offset));
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPcapIndex::Extract(std::size_t first, std::size_t last,
+  const std::string& outputFileName, std::string* error) const
+{
+  if (first > last || last >= this->Frames.size())
+  {
+    SetError(error, "Invalid frame range");
+    return false;
+  }
+
+#ifdef _WIN32
+  const int input = _open(this->FileName.c_str(), _O_RDONLY | _O_BINARY);
+  const int output = _open(outputFileName.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+    _S_IREAD | _S_IWRITE);
+#else
+  const int input = open(this->FileName.c_str(), O_RDONLY);
+  const int output = open(outputFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+  bool ok = input >= 0 && output >= 0;
+  if (!ok)
+  {
+    SetError(error, "Unable to open " + (input < 0 ? this->FileName : outputFileName));
+  }
+  else
+  {
+    // Global header, then the records of the frames
+    const std::uint64_t begin = this->Frames[first].Begin;
+    const std::uint64_t end = this->Frames[last].End;
+    ok = CopyRange(input, 0, GLOBAL_HEADER_SIZE, output) &&
+      CopyRange(input, begin, end - begin, output);
+    if (!ok)
+    {
+      SetError(error, "Unable to write " + outputFileName + ": " + std::strerror(errno));
+    }
+  }
+#ifdef _WIN32
+  ok = (output < 0 || _close(output) == 0) && ok;
+  if (input >= 0)
+  {
+    _close(input);
+  }
+#else
+  ok = (output < 0 || close(output) == 0) && ok;
+  if (input >= 0)
+  {
+    close(input);
+  }
+#endif
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPcapIndex::ReadCache(const std::string& cacheFileName)
+{
+  std::ifstream file(cacheFileName.c_str(), std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+  char magic[sizeof(CACHE_MAGIC)];
+  std::uint32_t version = 0;
+  std::uint64_t fileSize = 0;
+  std::int64_t modificationTime = 0;
+  std::int32_t port = 0;
+  std::uint64_t nbFrames = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  file.read(reinterpret_cast<char*>(&fileSize), sizeof(fileSize));
+  file.read(reinterpret_cast<char*>(&modificationTime), sizeof(modificationTime));
+  file.read(reinterpret_cast<char*>(&port), sizeof(port));
+  file.read(reinterpret_cast<char*>(&nbFrames), sizeof(nbFrames));
+  if (!file || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION ||
+    fileSize != this->FileSize || modificationTime != this->ModificationTime ||
+    port != this->LidarPort || nbFrames > fileSize / RECORD_HEADER_SIZE)
+  {
+    return false;
+  }
+  this->Frames.resize(static_cast<std::size_t>(nbFrames));
+  file.read(reinterpret_cast<char*>(this->Frames.data()),
+    static_cast<std::streamsize>(nbFrames * sizeof(FrameRange)));
+  if (!file)
+  {
+    this->Frames.clear();
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPcapIndex::WriteCache(const std::string& cacheFileName) const
+{
+  // Write to a temporary file first so that concurrent readers never see a
+  // partial cache entry
+  const std::string tmpFileName = cacheFileName + ".tmp";
+  {
+    std::ofstream file(tmpFileName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+      return false;
+    }
+    const std::int32_t port = this->LidarPort;
+    const std::uint64_t nbFrames = this->Frames.size();
+    file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    file.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+    file.write(reinterpret_cast<const char*>(&this->FileSize), sizeof(this->FileSize));
+    file.write(
+      reinterpret_cast<const char*>(&this->ModificationTime), sizeof(this->ModificationTime));
+    file.write(reinterpret_cast<const char*>(&port), sizeof(port));
+    file.write(reinterpret_cast<const char*>(&nbFrames), sizeof(nbFrames));
+    file.write(reinterpret_cast<const char*>(this->Frames.data()),
+      static_cast<std::streamsize>(nbFrames * sizeof(FrameRange)));
+    if (!file)
+    {
+      return false;
+    }
+  }
+  return static_cast<bool>(vtksys::SystemTools::RenameFile(tmpFileName, cacheFileName));
+}
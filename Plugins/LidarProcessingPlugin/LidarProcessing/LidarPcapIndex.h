@@ -0,0 +1,94 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPcapIndex.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarPcapIndex_h
+#define LidarPcapIndex_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @class LidarPcapIndex
+ * @brief Byte ranges of the frames of a Velodyne pcap, for extraction by copy.
+ *
+ * The index records, for each frame, the byte range of the packet records
+ * holding its firings. Frames are split where the azimuth of the data packets
+ * wraps, like the Velodyne interpreters do; the packet in which the wrap
+ * occurs belongs to both frames. Any other record found in between (position
+ * packets, other ports) is kept in the range.
+ *
+ * Extracting a frame range is then a copy of a single byte range after the
+ * pcap global header, done in kernel with copy_file_range / sendfile where
+ * available: its cost only depends on the size of the extracted range, not on
+ * its position in the capture.
+ *
+ * Building the index reads the whole capture once. It is saved to a cache
+ * file, valid as long as the size and modification time of the capture do not
+ * change. The capture time of the first data packet of each frame is recorded
+ * too, so that callers can check the frames against the ones of a reader.
+ *
+ * Only classic pcap files (micro or nanosecond, either byte order) over
+ * Ethernet, Linux cooked, null or raw IP links are indexed.
+ */
+class LIDARPROCESSING_EXPORT LidarPcapIndex
+{
+public:
+  struct FrameRange
+  {
+    std::uint64_t Begin = 0;
+    std::uint64_t End = 0;
+    //! Capture time of the first data packet of the frame, in seconds
+    double Time = 0.;
+  };
+
+  /**
+   * Called during the scan with the fraction of the capture read so far.
+   * Returning false cancels the scan.
+   */
+  using ProgressCallback = std::function<bool(double)>;
+
+  /**
+   * Index the data packets sent to lidarPort (0 for any port) of pcapFileName,
+   * or load the index from cacheFileName when it matches the capture. An empty
+   * cacheFileName disables the cache. Returns false and fills error on failure
+   * or cancelation. A truncated capture is indexed up to its last complete
+   * record: true is returned and error tells where the capture was cut.
+   */
+  bool Build(const std::string& pcapFileName, int lidarPort, const std::string& cacheFileName,
+    std::string* error = nullptr, const ProgressCallback& progress = nullptr);
+
+  std::size_t GetNumberOfFrames() const { return this->Frames.size(); }
+  const FrameRange& GetFrame(std::size_t frame) const { return this->Frames[frame]; }
+
+  /**
+   * Write frames first to last (included) to a new pcap.
+   */
+  bool Extract(std::size_t first, std::size_t last, const std::string& outputFileName,
+    std::string* error = nullptr) const;
+
+private:
+  bool Scan(std::string* error, const ProgressCallback& progress);
+  bool ReadCache(const std::string& cacheFileName);
+  bool WriteCache(const std::string& cacheFileName) const;
+
+  std::string FileName;
+  std::uint64_t FileSize = 0;
+  std::int64_t ModificationTime = 0;
+  int LidarPort = 0;
+  std::vector<FrameRange> Frames;
+};
+
+#endif // LidarPcapIndex_h
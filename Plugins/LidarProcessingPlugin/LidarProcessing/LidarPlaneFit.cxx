@@ -0,0 +1,585 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPlaneFit.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarPlaneFit.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkMath.h>
+#include <vtkSMPTools.h>
+#include <vtkTemplateAliasMacro.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace
+{
+// Hypotheses drawn and scored together between two checks of the stop criterion
+constexpr int BATCH_SIZE = 64;
+// Reductions are done per fixed block of points, then merged in order, so that
+// the results do not depend on the number of threads
+constexpr vtkIdType BLOCK_SIZE = 16384;
+constexpr int MAX_LASERS = 4096;
+constexpr int REFINE_ROUNDS = 2;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+struct Plane
+{
+  double Normal[3];
+  double Origin[3];
+
+  double Distance(const double p[3]) const
+  {
+    return this->Normal[0] * (p[0] - this->Origin[0]) +
+      this->Normal[1] * (p[1] - this->Origin[1]) + this->Normal[2] * (p[2] - this->Origin[2]);
+  }
+};
+
+//-----------------------------------------------------------------------------
+// First and second order sums of points expressed relative to a reference
+// point, which keeps the covariance accurate far from the sensor origin
+struct Moments
+{
+  vtkIdType Count = 0;
+  double Sum[3] = { 0., 0., 0. };
+  // xx, xy, xz, yy, yz, zz
+  double Cross[6] = { 0., 0., 0., 0., 0., 0. };
+
+  void Add(const double d[3])
+  {
+    ++this->Count;
+    this->Sum[0] += d[0];
+    this->Sum[1] += d[1];
+    this->Sum[2] += d[2];
+    this->Cross[0] += d[0] * d[0];
+    this->Cross[1] += d[0] * d[1];
+    this->Cross[2] += d[0] * d[2];
+    this->Cross[3] += d[1] * d[1];
+    this->Cross[4] += d[1] * d[2];
+    this->Cross[5] += d[2] * d[2];
+  }
+
+  void Merge(const Moments& other)
+  {
+    this->Count += other.Count;
+    for (int i = 0; i < 3; ++i)
+    {
+      this->Sum[i] += other.Sum[i];
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+      this->Cross[i] += other.Cross[i];
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct DistanceSums
+{
+  vtkIdType Count = 0;
+  double Sum = 0.;
+  double SumSquares = 0.;
+  double Min = std::numeric_limits<double>::max();
+  double Max = std::numeric_limits<double>::lowest();
+
+  void Add(double distance)
+  {
+    ++this->Count;
+    this->Sum += distance;
+    this->SumSquares += distance * distance;
+    this->Min = std::min(this->Min, distance);
+    this->Max = std::max(this->Max, distance);
+  }
+
+  void Merge(const DistanceSums& other)
+  {
+    this->Count += other.Count;
+    this->Sum += other.Sum;
+    this->SumSquares += other.SumSquares;
+    this->Min = std::min(this->Min, other.Min);
+    this->Max = std::max(this->Max, other.Max);
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Signed distances of all the points and of the inliers only
+struct Residuals
+{
+  DistanceSums All;
+  DistanceSums Inliers;
+
+  void Add(double distance, bool inlier)
+  {
+    this->All.Add(distance);
+    if (inlier)
+    {
+      this->Inliers.Add(distance);
+    }
+  }
+
+  void Merge(const Residuals& other)
+  {
+    this->All.Merge(other.All);
+    this->Inliers.Merge(other.Inliers);
+  }
+};
+
+//-----------------------------------------------------------------------------
+bool PlaneFromPoints(const double* a, const double* b, const double* c, Plane& plane)
+{
+  const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  const double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  vtkMath::Cross(u, v, plane.Normal);
+  // Reject (nearly) aligned points
+  const double norm = vtkMath::Norm(plane.Normal);
+  if (norm < 1e-12 * vtkMath::Norm(u) * vtkMath::Norm(v) || norm == 0.)
+  {
+    return false;
+  }
+  for (int i = 0; i < 3; ++i)
+  {
+    plane.Normal[i] /= norm;
+    plane.Origin[i] = a[i];
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool PlaneFromMoments(const Moments& moments, const double reference[3], Plane& plane)
+{
+  if (moments.Count < 3)
+  {
+    return false;
+  }
+  const double count = static_cast<double>(moments.Count);
+  double mean[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    mean[i] = moments.Sum[i] / count;
+  }
+  double row0[3] = { moments.Cross[0] / count - mean[0] * mean[0],
+    moments.Cross[1] / count - mean[0] * mean[1], moments.Cross[2] / count - mean[0] * mean[2] };
+  double row1[3] = { row0[1], moments.Cross[3] / count - mean[1] * mean[1],
+    moments.Cross[4] / count - mean[1] * mean[2] };
+  double row2[3] = { row0[2], row1[2], moments.Cross[5] / count - mean[2] * mean[2] };
+  double* covariance[3] = { row0, row1, row2 };
+
+  double eigenValues[3];
+  double vectors[3][3];
+  double* eigenVectors[3] = { vectors[0], vectors[1], vectors[2] };
+  if (!vtkMath::Jacobi(covariance, eigenValues, eigenVectors))
+  {
+    return false;
+  }
+  // Eigen values are sorted in decreasing order, vectors are the columns
+  for (int i = 0; i < 3; ++i)
+  {
+    plane.Normal[i] = vectors[i][2];
+    plane.Origin[i] = reference[i] + mean[i];
+  }
+  return vtkMath::Normalize(plane.Normal) > 0.;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType CountInliers(
+  const Plane& plane, const double* samples, vtkIdType nbSamples, double threshold)
+{
+  const double offset = vtkMath::Dot(plane.Normal, plane.Origin);
+  vtkIdType score = 0;
+  for (vtkIdType k = 0; k < nbSamples; ++k, samples += 3)
+  {
+    const double distance = plane.Normal[0] * samples[0] + plane.Normal[1] * samples[1] +
+      plane.Normal[2] * samples[2] - offset;
+    score += std::abs(distance) <= threshold ? 1 : 0;
+  }
+  return score;
+}
+
+//-----------------------------------------------------------------------------
+// Number of hypotheses needed to draw 3 inliers at least once with the given
+// confidence, for the best inlier ratio found so far
+int RequiredIterations(vtkIdType bestScore, vtkIdType nbSamples, double confidence, int maximum)
+{
+  if (bestScore <= 0)
+  {
+    return maximum;
+  }
+  const double inlierRatio = static_cast<double>(bestScore) / nbSamples;
+  const double goodDraw = inlierRatio * inlierRatio * inlierRatio;
+  if (goodDraw >= 1. - 1e-12)
+  {
+    return 0;
+  }
+  const double needed = std::ceil(std::log(1. - confidence) / std::log(1. - goodDraw));
+  return static_cast<int>(std::min<double>(maximum, std::max(needed, 1.)));
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+struct PointReader
+{
+  const T* Points;
+
+  void Get(vtkIdType id, double p[3]) const
+  {
+    const T* point = this->Points + 3 * id;
+    p[0] = static_cast<double>(point[0]);
+    p[1] = static_cast<double>(point[1]);
+    p[2] = static_cast<double>(point[2]);
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct GenericPointReader
+{
+  vtkDataArray* Points;
+
+  void Get(vtkIdType id, double p[3]) const { this->Points->GetTuple(id, p); }
+};
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void GatherLasers(const T* values, const std::vector<vtkIdType>& ids, std::vector<int>& lasers)
+{
+  lasers.resize(ids.size());
+  vtkSMPTools::For(0, static_cast<vtkIdType>(ids.size()), [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      lasers[i] = static_cast<int>(values[ids[i]]);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+template <typename Reader>
+class Fitter
+{
+public:
+  Fitter(const Reader& reader, const std::vector<vtkIdType>& ids)
+    : Points(reader)
+    , Ids(ids)
+    , NbPoints(static_cast<vtkIdType>(ids.size()))
+    , NbBlocks((this->NbPoints + BLOCK_SIZE - 1) / BLOCK_SIZE)
+  {
+  }
+
+  //-----------------------------------------------------------------------------
+  // Returns the number of sample inliers of the best hypothesis. initial, when
+  // given, is scored as the first hypothesis.
+  vtkIdType Ransac(double threshold, int maxIterations, vtkIdType maxSamples, double confidence,
+    unsigned int seed, const Plane* initial, Plane& best, int& nbIterations) const
+  {
+    // Regular subsample, copied once so that scoring runs on contiguous memory
+    const vtkIdType nbSamples = std::max<vtkIdType>(3, std::min(this->NbPoints, maxSamples));
+    std::vector<double> samples(3 * nbSamples);
+    vtkSMPTools::For(0, nbSamples, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType k = begin; k < end; ++k)
+      {
+        this->Points.Get(this->Ids[k * this->NbPoints / nbSamples], &samples[3 * k]);
+      }
+    });
+
+    vtkIdType bestScore = -1;
+    int required = maxIterations;
+    nbIterations = 0;
+    if (initial)
+    {
+      best = *initial;
+      bestScore = CountInliers(best, samples.data(), nbSamples, threshold);
+      required = RequiredIterations(bestScore, nbSamples, confidence, maxIterations);
+    }
+    while (nbIterations < required)
+    {
+      const int batch = std::min(BATCH_SIZE, required - nbIterations);
+      std::vector<Plane> planes(batch);
+      std::vector<vtkIdType> scores(batch, -1);
+      const int first = nbIterations;
+      vtkSMPTools::For(0, batch, 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType h = begin; h < end; ++h)
+        {
+          // One generator per hypothesis: the draws do not depend on the scheduling
+          std::mt19937 generator(seed + 2654435761u * static_cast<unsigned int>(first + h));
+          std::uniform_int_distribution<vtkIdType> draw(0, nbSamples - 1);
+          const vtkIdType a = draw(generator);
+          vtkIdType b = draw(generator);
+          vtkIdType c = draw(generator);
+          if (a != b && a != c && b != c &&
+            PlaneFromPoints(&samples[3 * a], &samples[3 * b], &samples[3 * c], planes[h]))
+          {
+            scores[h] = CountInliers(planes[h], samples.data(), nbSamples, threshold);
+          }
+        }
+      });
+
+      // Ties go to the first hypothesis drawn, as in a sequential loop
+      for (int h = 0; h < batch; ++h)
+      {
+        if (scores[h] > bestScore)
+        {
+          bestScore = scores[h];
+          best = planes[h];
+        }
+      }
+      nbIterations += batch;
+      required = RequiredIterations(bestScore, nbSamples, confidence, maxIterations);
+    }
+    return bestScore;
+  }
+
+  //-----------------------------------------------------------------------------
+  // Least squares plane of the points closer than threshold to plane
+  bool Refine(double threshold, Plane& plane) const
+  {
+    const Plane current = plane;
+    std::vector<Moments> blocks(this->NbBlocks);
+    vtkSMPTools::For(0, this->NbBlocks, 1, [&](vtkIdType begin, vtkIdType end) {
+      double p[3];
+      double d[3];
+      for (vtkIdType block = begin; block < end; ++block)
+      {
+        Moments& moments = blocks[block];
+        const vtkIdType last = std::min(this->NbPoints, (block + 1) * BLOCK_SIZE);
+        for (vtkIdType i = block * BLOCK_SIZE; i < last; ++i)
+        {
+          this->Points.Get(this->Ids[i], p);
+          if (std::abs(current.Distance(p)) <= threshold)
+          {
+            vtkMath::Subtract(p, current.Origin, d);
+            moments.Add(d);
+          }
+        }
+      }
+    });
+
+    Moments total;
+    for (const Moments& moments : blocks)
+    {
+      total.Merge(moments);
+    }
+    return PlaneFromMoments(total, current.Origin, plane);
+  }
+
+  //-----------------------------------------------------------------------------
+  // Signed distances reduced per group, groups holding the group of each point
+  std::vector<Residuals> ComputeResiduals(const Plane& plane, double threshold,
+    const std::vector<int>& groups, int nbGroups) const
+  {
+    // Larger blocks when there are many groups, to bound the memory used
+    const vtkIdType blockSize = std::max<vtkIdType>(BLOCK_SIZE, 16 * nbGroups);
+    const vtkIdType nbBlocks = (this->NbPoints + blockSize - 1) / blockSize;
+    std::vector<Residuals> blocks(nbBlocks * nbGroups);
+    vtkSMPTools::For(0, nbBlocks, 1, [&](vtkIdType begin, vtkIdType end) {
+      double p[3];
+      for (vtkIdType block = begin; block < end; ++block)
+      {
+        Residuals* residuals = &blocks[block * nbGroups];
+        const vtkIdType last = std::min(this->NbPoints, (block + 1) * blockSize);
+        for (vtkIdType i = block * blockSize; i < last; ++i)
+        {
+          this->Points.Get(this->Ids[i], p);
+          const double distance = plane.Distance(p);
+          residuals[groups.empty() ? 0 : groups[i]].Add(distance, std::abs(distance) <= threshold);
+        }
+      }
+    });
+
+    std::vector<Residuals> total(nbGroups);
+    for (vtkIdType block = 0; block < nbBlocks; ++block)
+    {
+      for (int group = 0; group < nbGroups; ++group)
+      {
+        total[group].Merge(blocks[block * nbGroups + group]);
+      }
+    }
+    return total;
+  }
+
+private:
+  const Reader& Points;
+  const std::vector<vtkIdType>& Ids;
+  const vtkIdType NbPoints;
+  const vtkIdType NbBlocks;
+};
+
+//-----------------------------------------------------------------------------
+void ReduceDistances(const DistanceSums& sums, double& mean, double& stdDev, double& rms,
+  double& min, double& max)
+{
+  if (sums.Count > 0)
+  {
+    const double count = static_cast<double>(sums.Count);
+    mean = sums.Sum / count;
+    rms = std::sqrt(sums.SumSquares / count);
+    stdDev = std::sqrt(std::max(0., sums.SumSquares / count - mean * mean));
+    min = sums.Min;
+    max = sums.Max;
+  }
+}
+
+//-----------------------------------------------------------------------------
+LidarPlaneFit::Statistics MakeStatistics(int laserId, const Residuals& residuals)
+{
+  LidarPlaneFit::Statistics stats;
+  stats.LaserId = laserId;
+  stats.NbPoints = residuals.All.Count;
+  stats.NbInliers = residuals.Inliers.Count;
+  ReduceDistances(residuals.All, stats.Mean, stats.StdDev, stats.RMS, stats.Min, stats.Max);
+  ReduceDistances(residuals.Inliers, stats.InlierMean, stats.InlierStdDev, stats.InlierRMS,
+    stats.InlierMin, stats.InlierMax);
+  return stats;
+}
+
+//-----------------------------------------------------------------------------
+template <typename Reader>
+bool RunFit(const Reader& reader, const std::vector<vtkIdType>& ids,
+  const std::vector<int>& lasers, int firstLaser, int nbLasers, double threshold,
+  int maxIterations, vtkIdType maxSamples, double confidence, unsigned int seed,
+  const Plane* initial, Plane& plane, int& nbIterations,
+  std::vector<LidarPlaneFit::Statistics>& stats, std::string* error)
+{
+  Fitter<Reader> fitter(reader, ids);
+  if (fitter.Ransac(threshold, maxIterations, maxSamples, confidence, seed, initial, plane,
+        nbIterations) < 3)
+  {
+    SetError(error, "No plane found: the points are aligned or too sparse for the threshold");
+    return false;
+  }
+  for (int round = 0; round < REFINE_ROUNDS; ++round)
+  {
+    if (!fitter.Refine(threshold, plane))
+    {
+      break;
+    }
+  }
+  if (plane.Normal[2] < 0.)
+  {
+    vtkMath::MultiplyScalar(plane.Normal, -1.);
+  }
+
+  std::vector<Residuals> residuals =
+    fitter.ComputeResiduals(plane, threshold, lasers, std::max(nbLasers, 1));
+  Residuals all;
+  for (const Residuals& laser : residuals)
+  {
+    all.Merge(laser);
+  }
+  stats.clear();
+  stats.push_back(MakeStatistics(-1, all));
+  for (int laser = 0; laser < nbLasers; ++laser)
+  {
+    if (residuals[laser].All.Count > 0)
+    {
+      stats.push_back(MakeStatistics(firstLaser + laser, residuals[laser]));
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+void LidarPlaneFit::SetInitialPlane(const double normal[3], const double origin[3])
+{
+  std::copy(normal, normal + 3, this->InitialNormal);
+  std::copy(origin, origin + 3, this->InitialOrigin);
+  this->HasInitialPlane = true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPlaneFit::Fit(vtkDataArray* points, const std::vector<vtkIdType>& ids,
+  vtkDataArray* laserIds, std::string* error)
+{
+  if (!points || points->GetNumberOfComponents() != 3)
+  {
+    SetError(error, "Invalid points");
+    return false;
+  }
+  if (ids.size() < 3)
+  {
+    SetError(error, "At least 3 points are needed to fit a plane");
+    return false;
+  }
+
+  // Laser of each point, shifted to start at 0
+  std::vector<int> lasers;
+  int firstLaser = 0;
+  int nbLasers = 0;
+  if (laserIds && laserIds->GetNumberOfComponents() == 1)
+  {
+    switch (laserIds->GetDataType())
+    {
+      vtkTemplateAliasMacro(
+        GatherLasers(static_cast<const VTK_TT*>(laserIds->GetVoidPointer(0)), ids, lasers));
+      default:
+        break;
+    }
+  }
+  if (!lasers.empty())
+  {
+    const auto range = std::minmax_element(lasers.begin(), lasers.end());
+    if (static_cast<long long>(*range.second) - *range.first >= MAX_LASERS)
+    {
+      SetError(error, "Too many different laser ids");
+      return false;
+    }
+    firstLaser = *range.first;
+    nbLasers = *range.second - firstLaser + 1;
+    for (int& laser : lasers)
+    {
+      laser -= firstLaser;
+    }
+  }
+
+  Plane initialPlane;
+  std::copy(this->InitialNormal, this->InitialNormal + 3, initialPlane.Normal);
+  std::copy(this->InitialOrigin, this->InitialOrigin + 3, initialPlane.Origin);
+  const Plane* initial = this->HasInitialPlane ? &initialPlane : nullptr;
+  Plane plane;
+  bool ok;
+  if (auto floatPoints = vtkFloatArray::FastDownCast(points))
+  {
+    PointReader<float> reader{ floatPoints->GetPointer(0) };
+    ok = RunFit(reader, ids, lasers, firstLaser, nbLasers, this->Threshold, this->MaxIterations,
+      this->MaxSamples, this->Confidence, this->Seed, initial, plane, this->NbIterations,
+      this->Stats, error);
+  }
+  else if (auto doublePoints = vtkDoubleArray::FastDownCast(points))
+  {
+    PointReader<double> reader{ doublePoints->GetPointer(0) };
+    ok = RunFit(reader, ids, lasers, firstLaser, nbLasers, this->Threshold, this->MaxIterations,
+      this->MaxSamples, this->Confidence, this->Seed, initial, plane, this->NbIterations,
+      this->Stats, error);
+  }
+  else
+  {
+    GenericPointReader reader{ points };
+    ok = RunFit(reader, ids, lasers, firstLaser, nbLasers, this->Threshold, this->MaxIterations,
+      this->MaxSamples, this->Confidence, this->Seed, initial, plane, this->NbIterations,
+      this->Stats, error);
+  }
+  if (ok)
+  {
+    std::copy(plane.Normal, plane.Normal + 3, this->Normal);
+    std::copy(plane.Origin, plane.Origin + 3, this->Origin);
+  }
+  return ok;
+}
@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPlaneFit.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarPlaneFit_h
+#define LidarPlaneFit_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+
+/**
+ * @class LidarPlaneFit
+ * @brief Robust plane fit of a set of lidar points, with per laser residuals.
+ *
+ * The plane is first estimated by RANSAC on a regular subsample of the points
+ * (MaxSamples): hypotheses are drawn and scored in parallel batches, each one
+ * from its own seeded generator, so the result does not depend on the number
+ * of threads. The number of iterations adapts to the best inlier ratio found
+ * so far to reach the requested Confidence.
+ *
+ * The plane is then refined by least squares on all the inliers (smallest
+ * eigenvector of their covariance), and the signed distances of the points
+ * are reduced into statistics per laser, plus a global row: once over all the
+ * points, so that a laser whose points drift away from the plane shows it,
+ * and once over the inliers only.
+ *
+ * The points are read in place, from the frame arrays, through a list of ids.
+ */
+class LIDARPROCESSING_EXPORT LidarPlaneFit
+{
+public:
+  struct Statistics
+  {
+    //! -1 for the statistics of all the points
+    int LaserId = -1;
+    vtkIdType NbPoints = 0;
+    vtkIdType NbInliers = 0;
+    //! Signed distances of all the points to the plane
+    double Mean = 0.;
+    double StdDev = 0.;
+    double RMS = 0.;
+    double Min = 0.;
+    double Max = 0.;
+    //! Signed distances of the inliers to the plane
+    double InlierMean = 0.;
+    double InlierStdDev = 0.;
+    double InlierRMS = 0.;
+    double InlierMin = 0.;
+    double InlierMax = 0.;
+  };
+
+  //@{
+  /**
+   * Maximum distance of an inlier to the plane. Default is 0.05 m.
+   */
+  void SetThreshold(double threshold) { this->Threshold = threshold; }
+  double GetThreshold() const { return this->Threshold; }
+  //@}
+
+  //@{
+  /**
+   * Maximum number of RANSAC hypotheses. Default is 500.
+   */
+  void SetMaxIterations(int iterations) { this->MaxIterations = iterations; }
+  int GetMaxIterations() const { return this->MaxIterations; }
+  //@}
+
+  //@{
+  /**
+   * Number of points the hypotheses are scored on. Default is 20000.
+   */
+  void SetMaxSamples(vtkIdType samples) { this->MaxSamples = samples; }
+  vtkIdType GetMaxSamples() const { return this->MaxSamples; }
+  //@}
+
+  //@{
+  /**
+   * Probability to draw at least one hypothesis made of inliers, used to stop
+   * the RANSAC early. Default is 0.999.
+   */
+  void SetConfidence(double confidence) { this->Confidence = confidence; }
+  double GetConfidence() const { return this->Confidence; }
+  //@}
+
+  //@{
+  /**
+   * Seed of the hypotheses generators. Default is 0.
+   */
+  void SetSeed(unsigned int seed) { this->Seed = seed; }
+  unsigned int GetSeed() const { return this->Seed; }
+  //@}
+
+  //@{
+  /**
+   * Plane scored before the random hypotheses, typically the plane of the
+   * previous frame when tracking: when it still fits, fewer hypotheses are
+   * needed. None by default.
+   */
+  void SetInitialPlane(const double normal[3], const double origin[3]);
+  void ClearInitialPlane() { this->HasInitialPlane = false; }
+  //@}
+
+  /**
+   * Fit a plane to the points listed in ids. laserIds, optional, holds one
+   * laser index per point of the frame.
+   */
+  bool Fit(vtkDataArray* points, const std::vector<vtkIdType>& ids, vtkDataArray* laserIds,
+    std::string* error = nullptr);
+
+  //@{
+  /**
+   * Results of the last successful Fit(). The normal is unit length, oriented
+   * towards positive z, and the origin is the centroid of the inliers.
+   */
+  const double* GetNormal() const { return this->Normal; }
+  const double* GetOrigin() const { return this->Origin; }
+  int GetNumberOfIterations() const { return this->NbIterations; }
+  //@}
+
+  /**
+   * Global statistics first, then one entry per laser in increasing order.
+   */
+  const std::vector<Statistics>& GetStatistics() const { return this->Stats; }
+
+private:
+  double Threshold = 0.05;
+  int MaxIterations = 500;
+  vtkIdType MaxSamples = 20000;
+  double Confidence = 0.999;
+  unsigned int Seed = 0;
+  bool HasInitialPlane = false;
+  double InitialNormal[3] = { 0., 0., 1. };
+  double InitialOrigin[3] = { 0., 0., 0. };
+
+  double Normal[3] = { 0., 0., 1. };
+  double Origin[3] = { 0., 0., 0. };
+  int NbIterations = 0;
+  std::vector<Statistics> Stats;
+};
+
+#endif // LidarPlaneFit_h
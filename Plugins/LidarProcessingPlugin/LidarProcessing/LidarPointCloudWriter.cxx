@@ -0,0 +1,666 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPointCloudWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarPointCloudWriter.h"
+
+#include "LidarTaskPool.h"
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+// Rows are assembled in blocks of about this size before being written
+constexpr std::size_t BLOCK_BYTES = 1 << 20;
+constexpr unsigned int LZF_HASH_LOG = 14;
+constexpr std::size_t LZF_MAX_OFFSET = 1 << 13;
+constexpr std::size_t LZF_MAX_LITERAL = 32;
+constexpr std::size_t LZF_MAX_MATCH = 264;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * PCD type (I, U or F) and size of the arrays written as is, false for the
+ * ones converted to double. 64 bits integers are written as is with is64Bits.
+ */
+bool GetFieldType(int dataType, bool is64Bits, char& type, int& size)
+{
+  switch (dataType)
+  {
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+      type = 'I';
+      size = 1;
+      return true;
+    case VTK_UNSIGNED_CHAR:
+      type = 'U';
+      size = 1;
+      return true;
+    case VTK_SHORT:
+      type = 'I';
+      size = 2;
+      return true;
+    case VTK_UNSIGNED_SHORT:
+      type = 'U';
+      size = 2;
+      return true;
+    case VTK_INT:
+      type = 'I';
+      size = 4;
+      return true;
+    case VTK_UNSIGNED_INT:
+      type = 'U';
+      size = 4;
+      return true;
+    case VTK_LONG:
+    case VTK_UNSIGNED_LONG:
+      type = dataType == VTK_LONG ? 'I' : 'U';
+      size = static_cast<int>(sizeof(long));
+      return sizeof(long) == 4 || is64Bits;
+    case VTK_ID_TYPE:
+      type = 'I';
+      size = static_cast<int>(sizeof(vtkIdType));
+      return sizeof(vtkIdType) == 4 || is64Bits;
+    case VTK_LONG_LONG:
+      type = 'I';
+      size = 8;
+      return is64Bits;
+    case VTK_UNSIGNED_LONG_LONG:
+      type = 'U';
+      size = 8;
+      return is64Bits;
+    case VTK_FLOAT:
+      type = 'F';
+      size = 4;
+      return true;
+    case VTK_DOUBLE:
+      type = 'F';
+      size = 8;
+      return true;
+    default:
+      return false;
+  }
+}
+
+//-----------------------------------------------------------------------------
+const char* GetPLYType(char type, int size)
+{
+  switch (size)
+  {
+    case 1:
+      return type == 'I' ? "char" : "uchar";
+    case 2:
+      return type == 'I' ? "short" : "ushort";
+    case 4:
+      return type == 'F' ? "float" : (type == 'I' ? "int" : "uint");
+    default:
+      return "double";
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string GetFieldName(const char* name, int index)
+{
+  std::string result = name && *name ? name : "array_" + std::to_string(index);
+  std::replace_if(
+    result.begin(), result.end(), [](char c) { return c <= ' '; }, '_');
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+template <std::size_t Size>
+void CopyStrided(const char* input, std::size_t inStride, char* output, std::size_t outStride,
+  std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::memcpy(output + i * outStride, input + i * inStride, Size);
+  }
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Copy count values of size bytes, with fixed size copies for the common
+ * sizes so that they compile to plain loads and stores.
+ */
+void CopyStrided(const char* input, std::size_t inStride, std::size_t size, char* output,
+  std::size_t outStride, std::size_t count)
+{
+  switch (size)
+  {
+    case 1:
+      CopyStrided<1>(input, inStride, output, outStride, count);
+      break;
+    case 2:
+      CopyStrided<2>(input, inStride, output, outStride, count);
+      break;
+    case 4:
+      CopyStrided<4>(input, inStride, output, outStride, count);
+      break;
+    case 8:
+      CopyStrided<8>(input, inStride, output, outStride, count);
+      break;
+    case 12:
+      CopyStrided<12>(input, inStride, output, outStride, count);
+      break;
+    default:
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        std::memcpy(output + i * outStride, input + i * inStride, size);
+      }
+  }
+}
+
+//-----------------------------------------------------------------------------
+class FileCloser
+{
+public:
+  explicit FileCloser(std::FILE* file)
+    : File(file)
+  {
+  }
+  ~FileCloser()
+  {
+    if (this->File)
+    {
+      std::fclose(this->File);
+    }
+  }
+  bool Close()
+  {
+    const bool ok = std::fclose(this->File) == 0;
+    this->File = nullptr;
+    return ok;
+  }
+
+private:
+  std::FILE* File;
+};
+}
+
+//-----------------------------------------------------------------------------
+struct LidarPointCloudWriter::Cloud
+{
+  struct Field
+  {
+    std::string Name;
+    //! I, U or F, as in PCD headers
+    char Type = 'F';
+    //! Size of one component, in bytes
+    int Size = 4;
+    int Count = 1;
+    const char* Data = nullptr;
+    //! Bytes between the values of two consecutive points
+    std::size_t Stride = 0;
+
+    std::size_t GetBytes() const { return static_cast<std::size_t>(this->Size) * this->Count; }
+  };
+
+  /**
+   * Fields copied together into the rows: consecutive fields interleaved in
+   * the same array, such as x, y and z, are a single copy.
+   */
+  struct Span
+  {
+    const char* Data;
+    std::size_t Stride;
+    std::size_t Bytes;
+    std::size_t Offset;
+  };
+
+  //! Copies of the frame arrays, the frame may change before the file is written
+  std::vector<vtkSmartPointer<vtkDataArray>> Arrays;
+  std::vector<std::vector<double>> Converted;
+  std::vector<Field> Fields;
+  std::size_t NbPoints = 0;
+
+  std::size_t GetRowSize() const
+  {
+    std::size_t size = 0;
+    for (const Field& field : this->Fields)
+    {
+      size += field.GetBytes();
+    }
+    return size;
+  }
+
+  std::vector<Span> GetSpans() const
+  {
+    std::vector<Span> spans;
+    std::size_t offset = 0;
+    for (const Field& field : this->Fields)
+    {
+      if (!spans.empty() && spans.back().Stride == field.Stride &&
+        spans.back().Data + spans.back().Bytes == field.Data)
+      {
+        spans.back().Bytes += field.GetBytes();
+      }
+      else
+      {
+        spans.push_back({ field.Data, field.Stride, field.GetBytes(), offset });
+      }
+      offset += field.GetBytes();
+    }
+    return spans;
+  }
+
+  /**
+   * Add the components of array as count fields, or as one field per
+   * component when names are given. 64 bits integers are kept with is64Bits.
+   */
+  void AddArray(vtkDataArray* array, const std::string& name, bool is64Bits,
+    const char* const* names = nullptr)
+  {
+    const int nbComponents = array->GetNumberOfComponents();
+    Field field;
+    const char* data = nullptr;
+    if (GetFieldType(array->GetDataType(), is64Bits, field.Type, field.Size))
+    {
+      // Contiguous copy, also for the arrays stored otherwise
+      vtkSmartPointer<vtkDataArray> copy =
+        vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(array->GetDataType()));
+      copy->DeepCopy(array);
+      data = static_cast<const char*>(copy->GetVoidPointer(0));
+      this->Arrays.push_back(copy);
+    }
+    else
+    {
+      std::vector<double> converted(this->NbPoints * nbComponents);
+      for (std::size_t i = 0; i < converted.size(); ++i)
+      {
+        converted[i] = array->GetComponent(
+          static_cast<vtkIdType>(i / nbComponents), static_cast<int>(i % nbComponents));
+      }
+      this->Converted.push_back(std::move(converted));
+      data = reinterpret_cast<const char*>(this->Converted.back().data());
+      field.Type = 'F';
+      field.Size = 8;
+    }
+    field.Stride = static_cast<std::size_t>(field.Size) * nbComponents;
+
+    if (!names)
+    {
+      field.Name = name;
+      field.Count = nbComponents;
+      field.Data = data;
+      this->Fields.push_back(field);
+      return;
+    }
+    for (int c = 0; c < nbComponents; ++c)
+    {
+      field.Name = names[c];
+      field.Data = data + c * field.Size;
+      this->Fields.push_back(field);
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+LidarPointCloudWriter::~LidarPointCloudWriter()
+{
+  this->Flush();
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<LidarPointCloudWriter::Cloud> LidarPointCloudWriter::Prepare(
+  vtkPolyData* frame) const
+{
+  auto cloud = std::make_shared<Cloud>();
+  static const char* const xyz[3] = { "x", "y", "z" };
+  if (!frame || !frame->GetPoints())
+  {
+    for (const char* name : xyz)
+    {
+      Cloud::Field field;
+      field.Name = name;
+      cloud->Fields.push_back(field);
+    }
+    return cloud;
+  }
+
+  // The arrays are copied here, in the calling thread
+  const bool is64Bits = this->FileFormat != PLY;
+  const vtkIdType nbPoints = frame->GetNumberOfPoints();
+  cloud->NbPoints = static_cast<std::size_t>(nbPoints);
+  cloud->AddArray(frame->GetPoints()->GetData(), "", is64Bits, xyz);
+  vtkPointData* pointData = frame->GetPointData();
+  if (this->WriteAllArrays)
+  {
+    for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+    {
+      vtkDataArray* array = pointData->GetArray(i);
+      if (array && array->GetNumberOfTuples() == nbPoints)
+      {
+        cloud->AddArray(array, GetFieldName(array->GetName(), i), is64Bits);
+      }
+    }
+    return cloud;
+  }
+  for (std::size_t i = 0; i < this->ArrayNames.size(); ++i)
+  {
+    const std::string& name = this->ArrayNames[i];
+    vtkDataArray* array = pointData->GetArray(name.c_str());
+    if (array && array->GetNumberOfTuples() == nbPoints)
+    {
+      cloud->AddArray(array, GetFieldName(name.c_str(), static_cast<int>(i)), is64Bits);
+    }
+  }
+  return cloud;
+}
+
+//-----------------------------------------------------------------------------
+LidarPointCloudWriter::Result LidarPointCloudWriter::Encode(
+  const Cloud& cloud, const std::string& fileName, Format format)
+{
+  Result result;
+  const std::size_t nbPoints = cloud.NbPoints;
+  const std::size_t rowSize = cloud.GetRowSize();
+  // PCL refuses to read empty compressed data
+  if (format == PCD_COMPRESSED && nbPoints == 0)
+  {
+    format = PCD;
+  }
+
+  std::ostringstream header;
+  if (format == PLY)
+  {
+    header << "ply\nformat binary_little_endian 1.0\ncomment Written by LidarView\n"
+           << "element vertex " << nbPoints << "\n";
+    for (const Cloud::Field& field : cloud.Fields)
+    {
+      for (int c = 0; c < field.Count; ++c)
+      {
+        header << "property " << GetPLYType(field.Type, field.Size) << " " << field.Name;
+        if (field.Count > 1)
+        {
+          header << "_" << c;
+        }
+        header << "\n";
+      }
+    }
+    header << "end_header\n";
+  }
+  else
+  {
+    header << "# .PCD v0.7 - Point Cloud Data file format\nVERSION 0.7\nFIELDS";
+    for (const Cloud::Field& field : cloud.Fields)
+    {
+      header << " " << field.Name;
+    }
+    header << "\nSIZE";
+    for (const Cloud::Field& field : cloud.Fields)
+    {
+      header << " " << field.Size;
+    }
+    header << "\nTYPE";
+    for (const Cloud::Field& field : cloud.Fields)
+    {
+      header << " " << field.Type;
+    }
+    header << "\nCOUNT";
+    for (const Cloud::Field& field : cloud.Fields)
+    {
+      header << " " << field.Count;
+    }
+    header << "\nWIDTH " << nbPoints << "\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS " << nbPoints
+           << "\nDATA " << (format == PCD_COMPRESSED ? "binary_compressed" : "binary") << "\n";
+  }
+
+  std::FILE* file = std::fopen(fileName.c_str(), "wb");
+  if (!file)
+  {
+    result.Error = "Unable to open " + fileName;
+    return result;
+  }
+  FileCloser closer(file);
+  const std::string headerString = header.str();
+  bool ok = std::fwrite(headerString.data(), 1, headerString.size(), file) == headerString.size();
+  result.Bytes = headerString.size();
+
+  try
+  {
+    const std::vector<Cloud::Span> spans = cloud.GetSpans();
+    if (format == PCD_COMPRESSED)
+    {
+      // Fields one after the other, compressed as a single block
+      const std::size_t size = rowSize * nbPoints;
+      if (size > std::numeric_limits<std::uint32_t>::max())
+      {
+        result.Error = "Too many points for a compressed PCD file: " + fileName;
+        return result;
+      }
+      std::vector<char> fields(size);
+      std::size_t offset = 0;
+      for (const Cloud::Field& field : cloud.Fields)
+      {
+        CopyStrided(field.Data, field.Stride, field.GetBytes(), fields.data() + offset,
+          field.GetBytes(), nbPoints);
+        offset += field.GetBytes() * nbPoints;
+      }
+      std::vector<char> compressed(GetLZFBound(size));
+      const std::uint32_t sizes[2] = { static_cast<std::uint32_t>(
+                                         CompressLZF(fields.data(), size, compressed.data())),
+        static_cast<std::uint32_t>(size) };
+      ok = ok && std::fwrite(sizes, sizeof(sizes), 1, file) == 1 &&
+        std::fwrite(compressed.data(), 1, sizes[0], file) == sizes[0];
+      result.Bytes += sizeof(sizes) + sizes[0];
+    }
+    else if (spans.size() == 1 && spans[0].Stride == rowSize)
+    {
+      // A single interleaved array: its memory is already the rows
+      ok = ok &&
+        (nbPoints == 0 || std::fwrite(spans[0].Data, rowSize, nbPoints, file) == nbPoints);
+      result.Bytes += rowSize * nbPoints;
+    }
+    else
+    {
+      const std::size_t blockPoints = std::max<std::size_t>(BLOCK_BYTES / rowSize, 1);
+      std::vector<char> block(blockPoints * rowSize);
+      for (std::size_t begin = 0; ok && begin < nbPoints; begin += blockPoints)
+      {
+        const std::size_t count = std::min(blockPoints, nbPoints - begin);
+        for (const Cloud::Span& span : spans)
+        {
+          CopyStrided(span.Data + begin * span.Stride, span.Stride, span.Bytes,
+            block.data() + span.Offset, rowSize, count);
+        }
+        ok = std::fwrite(block.data(), rowSize, count, file) == count;
+      }
+      result.Bytes += rowSize * nbPoints;
+    }
+  }
+  catch (const std::bad_alloc&)
+  {
+    result.Error = "Unable to allocate the buffers to write " + fileName;
+    return result;
+  }
+
+  if (!closer.Close() || !ok)
+  {
+    result.Error = "Unable to write " + fileName;
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPointCloudWriter::Write(
+  vtkPolyData* frame, const std::string& fileName, std::string* error) const
+{
+  const Result result = Encode(*this->Prepare(frame), fileName, this->FileFormat);
+  if (!result.Error.empty())
+  {
+    SetError(error, result.Error);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPointCloudWriter::WriteFrame(vtkPolyData* frame, const std::string& fileName)
+{
+  std::shared_ptr<Cloud> cloud = this->Prepare(frame);
+
+  // Enough files in flight to keep the pool busy while bounding the memory
+  LidarTaskPool& pool = LidarTaskPool::GetInstance();
+  const std::size_t maxPending = 2 * pool.GetNumberOfThreads();
+  bool ok = true;
+  while (this->Pending.size() >= maxPending)
+  {
+    ok = this->Collect(this->Pending.front().get()) && ok;
+    this->Pending.pop_front();
+  }
+  const Format format = this->FileFormat;
+  this->Pending.push_back(
+    pool.Submit([cloud, fileName, format]() { return Encode(*cloud, fileName, format); }));
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPointCloudWriter::Flush()
+{
+  bool ok = true;
+  while (!this->Pending.empty())
+  {
+    ok = this->Collect(this->Pending.front().get()) && ok;
+    this->Pending.pop_front();
+  }
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPointCloudWriter::Collect(Result result)
+{
+  this->BytesWritten += result.Bytes;
+  if (!result.Error.empty())
+  {
+    this->LastError = result.Error;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarPointCloudWriter::CompressLZF(
+  const void* input, std::size_t size, void* output)
+{
+  // Greedy LZ77 with a single candidate per 3 bytes hash, in the LZF format:
+  // literal runs of 1 to 32 bytes, back references of 3 to 264 bytes within
+  // the previous 8 KiB
+  const unsigned char* in = static_cast<const unsigned char*>(input);
+  unsigned char* out = static_cast<unsigned char*>(output);
+  std::vector<std::size_t> table(std::size_t(1) << LZF_HASH_LOG, 0);
+  auto hash = [in](std::size_t position) {
+    const std::uint32_t value = (std::uint32_t(in[position]) << 16) |
+      (std::uint32_t(in[position + 1]) << 8) | in[position + 2];
+    return (value * 2654435761u) >> (32 - LZF_HASH_LOG);
+  };
+
+  std::size_t ip = 0;
+  // One control byte is reserved before each literal run
+  std::size_t op = 1;
+  std::size_t literals = 0;
+  while (ip + 2 < size)
+  {
+    // Positions are stored + 1, 0 meaning no candidate
+    std::size_t& slot = table[hash(ip)];
+    const std::size_t candidate = slot;
+    slot = ip + 1;
+    if (candidate != 0 && ip - candidate < LZF_MAX_OFFSET &&
+      std::memcmp(in + candidate - 1, in + ip, 3) == 0)
+    {
+      const std::size_t reference = candidate - 1;
+      const std::size_t offset = ip - reference - 1;
+      const std::size_t maxLength = std::min(LZF_MAX_MATCH, size - ip);
+      std::size_t length = 3;
+      while (length < maxLength && in[reference + length] == in[ip + length])
+      {
+        ++length;
+      }
+
+      // Close the literal run, or drop its unused control byte
+      if (literals == 0)
+      {
+        --op;
+      }
+      else
+      {
+        out[op - literals - 1] = static_cast<unsigned char>(literals - 1);
+      }
+      const std::size_t encoded = length - 2;
+      if (encoded < 7)
+      {
+        out[op++] = static_cast<unsigned char>((encoded << 5) | (offset >> 8));
+      }
+      else
+      {
+        out[op++] = static_cast<unsigned char>((7 << 5) | (offset >> 8));
+        out[op++] = static_cast<unsigned char>(encoded - 7);
+      }
+      out[op++] = static_cast<unsigned char>(offset & 0xFF);
+
+      for (std::size_t i = ip + 1; i < ip + length && i + 2 < size; ++i)
+      {
+        table[hash(i)] = i + 1;
+      }
+      ip += length;
+      literals = 0;
+      ++op;
+      continue;
+    }
+
+    out[op++] = in[ip++];
+    if (++literals == LZF_MAX_LITERAL)
+    {
+      out[op - literals - 1] = static_cast<unsigned char>(literals - 1);
+      literals = 0;
+      ++op;
+    }
+  }
+
+  while (ip < size)
+  {
+    out[op++] = in[ip++];
+    if (++literals == LZF_MAX_LITERAL)
+    {
+      out[op - literals - 1] = static_cast<unsigned char>(literals - 1);
+      literals = 0;
+      ++op;
+    }
+  }
+  if (literals == 0)
+  {
+    --op;
+  }
+  else
+  {
+    out[op - literals - 1] = static_cast<unsigned char>(literals - 1);
+  }
+  return op;
+}
@@ -0,0 +1,139 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPointCloudWriter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarPointCloudWriter_h
+#define LidarPointCloudWriter_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class vtkPolyData;
+
+/**
+ * @class LidarPointCloudWriter
+ * @brief Binary PLY and PCD files written straight from the frame arrays.
+ *
+ * The positions and the selected numeric point data arrays (ArrayNames, or
+ * all of them with WriteAllArrays) are written as vertex properties (PLY) or
+ * fields (PCD), in their own type: rows are assembled by copying bytes from
+ * the array memory, without any per-value formatting. PCD binary_compressed
+ * files store the fields one after the other and compress them with LZF, as
+ * PCL does.
+ *
+ * 64 bits integer arrays, not supported by PLY, are converted to double in
+ * PLY files. Multi component arrays become one property per component in PLY
+ * (name_0, name_1...) and a field with a COUNT in PCD.
+ *
+ * Files are either written synchronously with Write(), or queued with
+ * WriteFrame() and encoded concurrently on the LidarTaskPool, one task per
+ * file: exporting many frames keeps all the threads busy while the caller
+ * produces the next frames. WriteFrame() copies the written arrays, the
+ * caller may modify the frame right away. The errors of the queued files are
+ * returned by the next WriteFrame() or by Flush(), which must be called
+ * after the last frame.
+ */
+class LIDARPROCESSING_EXPORT LidarPointCloudWriter
+{
+public:
+  enum Format
+  {
+    PLY = 0,
+    PCD,
+    PCD_COMPRESSED
+  };
+
+  LidarPointCloudWriter() = default;
+  ~LidarPointCloudWriter();
+
+  //@{
+  /**
+   * Format of the files. Default is PLY.
+   */
+  void SetFormat(Format format) { this->FileFormat = format; }
+  Format GetFormat() const { return this->FileFormat; }
+  //@}
+
+  //@{
+  /**
+   * Point data arrays written after the positions, in this order. Missing
+   * arrays are skipped. Default is none.
+   */
+  void SetArrayNames(const std::vector<std::string>& names) { this->ArrayNames = names; }
+  const std::vector<std::string>& GetArrayNames() const { return this->ArrayNames; }
+  //@}
+
+  //@{
+  /**
+   * Write all the numeric point data arrays instead of ArrayNames. Default is
+   * false.
+   */
+  void SetWriteAllArrays(bool all) { this->WriteAllArrays = all; }
+  bool GetWriteAllArrays() const { return this->WriteAllArrays; }
+  //@}
+
+  /**
+   * Write one frame to fileName.
+   */
+  bool Write(vtkPolyData* frame, const std::string& fileName, std::string* error = nullptr) const;
+
+  /**
+   * Queue the encoding of a frame to fileName. Returns false if a previously
+   * queued file could not be written.
+   */
+  bool WriteFrame(vtkPolyData* frame, const std::string& fileName);
+
+  /**
+   * Wait for all the queued files. Returns false if one could not be written.
+   */
+  bool Flush();
+
+  std::uint64_t GetNumberOfBytesWritten() const { return this->BytesWritten; }
+  const std::string& GetLastError() const { return this->LastError; }
+
+  /**
+   * LZF compression of size bytes of input, as used by PCD binary_compressed.
+   * output must hold at least GetLZFBound(size) bytes. Returns the compressed
+   * size.
+   */
+  static std::size_t CompressLZF(const void* input, std::size_t size, void* output);
+  static std::size_t GetLZFBound(std::size_t size) { return size + size / 32 + 16; }
+
+private:
+  LidarPointCloudWriter(const LidarPointCloudWriter&) = delete;
+  void operator=(const LidarPointCloudWriter&) = delete;
+
+  struct Cloud;
+  struct Result
+  {
+    std::string Error;
+    std::uint64_t Bytes = 0;
+  };
+
+  std::shared_ptr<Cloud> Prepare(vtkPolyData* frame) const;
+  static Result Encode(const Cloud& cloud, const std::string& fileName, Format format);
+  bool Collect(Result result);
+
+  Format FileFormat = PLY;
+  std::vector<std::string> ArrayNames;
+  bool WriteAllArrays = false;
+  std::deque<std::future<Result>> Pending;
+  std::uint64_t BytesWritten = 0;
+  std::string LastError;
+};
+
+#endif // LidarPointCloudWriter_h
@@ -0,0 +1,410 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPoseStore.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarPoseStore.h"
+
+#include "LidarFrameCache.h"
+
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+#include <utility>
+
+namespace
+{
+// Batches are split in chunks of this many timestamps, each one walking the poses
+constexpr vtkIdType BATCH_CHUNK = 4096;
+// Pose sources cached by GetStore(), a few pipelines may read different ones
+constexpr std::size_t CACHE_SIZE = 4;
+
+//-----------------------------------------------------------------------------
+void FromEuler(double roll, double pitch, double yaw, double q[4])
+{
+  // Z-Y-X convention: R = Rz(yaw) * Ry(pitch) * Rx(roll)
+  const double cr = std::cos(roll / 2.), sr = std::sin(roll / 2.);
+  const double cp = std::cos(pitch / 2.), sp = std::sin(pitch / 2.);
+  const double cy = std::cos(yaw / 2.), sy = std::sin(yaw / 2.);
+  q[0] = cr * cp * cy + sr * sp * sy;
+  q[1] = sr * cp * cy - cr * sp * sy;
+  q[2] = cr * sp * cy + sr * cp * sy;
+  q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+//-----------------------------------------------------------------------------
+void Slerp(const double a[4], const double b[4], double t, double q[4])
+{
+  double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+  // take the shortest path
+  const double sign = dot < 0. ? -1. : 1.;
+  dot *= sign;
+  double wa = 1. - t, wb = t;
+  if (dot < 0.9995)
+  {
+    const double theta = std::acos(dot);
+    const double sinTheta = std::sin(theta);
+    wa = std::sin((1. - t) * theta) / sinTheta;
+    wb = std::sin(t * theta) / sinTheta;
+  }
+  wb *= sign;
+  double norm = 0.;
+  for (int k = 0; k < 4; ++k)
+  {
+    q[k] = wa * a[k] + wb * b[k];
+    norm += q[k] * q[k];
+  }
+  norm = std::sqrt(norm);
+  for (int k = 0; k < 4; ++k)
+  {
+    q[k] /= norm;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ToMatrix(const double q[4], const double t[3], double m[12])
+{
+  const double w = q[0], x = q[1], y = q[2], z = q[3];
+  m[0] = 1. - 2. * (y * y + z * z);
+  m[1] = 2. * (x * y - z * w);
+  m[2] = 2. * (x * z + y * w);
+  m[3] = t[0];
+  m[4] = 2. * (x * y + z * w);
+  m[5] = 1. - 2. * (x * x + z * z);
+  m[6] = 2. * (y * z - x * w);
+  m[7] = t[1];
+  m[8] = 2. * (x * z - y * w);
+  m[9] = 2. * (y * z + x * w);
+  m[10] = 1. - 2. * (x * x + y * y);
+  m[11] = t[2];
+}
+
+//-----------------------------------------------------------------------------
+vtkDataArray* GetArray(vtkPolyData* poses, const std::string& name, int nbComponents)
+{
+  if (name.empty())
+  {
+    return nullptr;
+  }
+  vtkDataArray* array = poses->GetPointData()->GetArray(name.c_str());
+  return (array && array->GetNumberOfComponents() == nbComponents) ? array : nullptr;
+}
+}
+
+//-----------------------------------------------------------------------------
+LidarPoseStore::LidarPoseStore(const LidarPoseStore& other)
+{
+  *this = other;
+}
+
+//-----------------------------------------------------------------------------
+LidarPoseStore& LidarPoseStore::operator=(const LidarPoseStore& other)
+{
+  if (this != &other)
+  {
+    this->Times = other.Times;
+    this->X = other.X;
+    this->Y = other.Y;
+    this->Z = other.Z;
+    this->QW = other.QW;
+    this->QX = other.QX;
+    this->QY = other.QY;
+    this->QZ = other.QZ;
+    this->ResetStatistics();
+  }
+  return *this;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarPoseStore::Load(vtkPolyData* poses, const ArrayNames& names)
+{
+  this->Clear();
+  vtkDataArray* time = poses ? GetArray(poses, names.Time, 1) : nullptr;
+  if (!time)
+  {
+    return false;
+  }
+  vtkDataArray* x = GetArray(poses, names.X, 1);
+  vtkDataArray* y = GetArray(poses, names.Y, 1);
+  vtkDataArray* z = GetArray(poses, names.Z, 1);
+  const bool fromPoints = names.X.empty() && names.Y.empty() && names.Z.empty();
+  if (!fromPoints && !(x && y && z))
+  {
+    return false;
+  }
+  vtkDataArray* quaternion = GetArray(poses, names.Quaternion, 4);
+  vtkDataArray* roll = GetArray(poses, names.Roll, 1);
+  vtkDataArray* pitch = GetArray(poses, names.Pitch, 1);
+  vtkDataArray* yaw = GetArray(poses, names.Yaw, 1);
+
+  const vtkIdType nbPoses = time->GetNumberOfTuples();
+  if (fromPoints && poses->GetNumberOfPoints() != nbPoses)
+  {
+    return false;
+  }
+
+  // Sort once by time, sources usually provide sorted poses already
+  std::vector<vtkIdType> order(nbPoses);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [time](vtkIdType a, vtkIdType b) {
+    return time->GetComponent(a, 0) < time->GetComponent(b, 0);
+  });
+
+  this->Reserve(nbPoses);
+  for (vtkIdType i : order)
+  {
+    double position[3];
+    if (fromPoints)
+    {
+      poses->GetPoint(i, position);
+    }
+    else
+    {
+      position[0] = x->GetComponent(i, 0);
+      position[1] = y->GetComponent(i, 0);
+      position[2] = z->GetComponent(i, 0);
+    }
+    double q[4] = { 1., 0., 0., 0. };
+    if (quaternion)
+    {
+      quaternion->GetTuple(i, q);
+    }
+    else if (roll && pitch && yaw)
+    {
+      FromEuler(vtkMath::RadiansFromDegrees(roll->GetComponent(i, 0)),
+        vtkMath::RadiansFromDegrees(pitch->GetComponent(i, 0)),
+        vtkMath::RadiansFromDegrees(yaw->GetComponent(i, 0)), q);
+    }
+    this->Append(time->GetComponent(i, 0), position, q);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const LidarPoseStore> LidarPoseStore::GetStore(
+  vtkPolyData* poses, const ArrayNames& names)
+{
+  if (!poses)
+  {
+    return nullptr;
+  }
+  using Key = std::pair<LidarFrameObjectKey, std::vector<std::string>>;
+  static std::mutex mutex;
+  static LidarFrameCache<Key, std::shared_ptr<const LidarPoseStore>> cache(CACHE_SIZE);
+  std::lock_guard<std::mutex> lock(mutex);
+  const Key key(GetLidarFrameObjectKey(poses),
+    { names.Time, names.X, names.Y, names.Z, names.Quaternion, names.Roll, names.Pitch,
+      names.Yaw });
+  std::shared_ptr<const LidarPoseStore>& store = cache.Get(key);
+  if (!store)
+  {
+    auto loaded = std::make_shared<LidarPoseStore>();
+    if (!loaded->Load(poses, names) || loaded->IsEmpty())
+    {
+      return nullptr;
+    }
+    store = loaded;
+  }
+  return store;
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::Clear()
+{
+  for (std::vector<double>* values :
+    { &this->Times, &this->X, &this->Y, &this->Z, &this->QW, &this->QX, &this->QY, &this->QZ })
+  {
+    values->clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::Reserve(std::size_t nbPoses)
+{
+  for (std::vector<double>* values :
+    { &this->Times, &this->X, &this->Y, &this->Z, &this->QW, &this->QX, &this->QY, &this->QZ })
+  {
+    values->reserve(nbPoses);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::Append(double time, const double position[3], const double quaternion[4])
+{
+  const std::size_t index = (this->Times.empty() || time >= this->Times.back())
+    ? this->Times.size()
+    : static_cast<std::size_t>(
+        std::upper_bound(this->Times.begin(), this->Times.end(), time) - this->Times.begin());
+  const double values[8] = { time, position[0], position[1], position[2], quaternion[0],
+    quaternion[1], quaternion[2], quaternion[3] };
+  std::vector<double>* columns[8] = { &this->Times, &this->X, &this->Y, &this->Z, &this->QW,
+    &this->QX, &this->QY, &this->QZ };
+  for (int k = 0; k < 8; ++k)
+  {
+    columns[k]->insert(columns[k]->begin() + index, values[k]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::GetPosition(std::size_t i, double position[3]) const
+{
+  position[0] = this->X[i];
+  position[1] = this->Y[i];
+  position[2] = this->Z[i];
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarPoseStore::FindInterval(double time) const
+{
+  return static_cast<std::size_t>(
+    std::upper_bound(this->Times.begin(), this->Times.end(), time) - this->Times.begin());
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::InterpolateAt(
+  std::size_t next, double time, double position[3], double quaternion[4]) const
+{
+  const std::size_t n = this->Times.size();
+  if (n == 0)
+  {
+    position[0] = position[1] = position[2] = 0.;
+    if (quaternion)
+    {
+      quaternion[0] = 1.;
+      quaternion[1] = quaternion[2] = quaternion[3] = 0.;
+    }
+    return;
+  }
+  if (next == 0 || next == n)
+  {
+    const std::size_t i = next == 0 ? 0 : n - 1;
+    this->GetPosition(i, position);
+    if (quaternion)
+    {
+      quaternion[0] = this->QW[i];
+      quaternion[1] = this->QX[i];
+      quaternion[2] = this->QY[i];
+      quaternion[3] = this->QZ[i];
+    }
+    return;
+  }
+
+  const std::size_t prev = next - 1;
+  const double span = this->Times[next] - this->Times[prev];
+  const double t = span > 0. ? (time - this->Times[prev]) / span : 0.;
+  position[0] = this->X[prev] + t * (this->X[next] - this->X[prev]);
+  position[1] = this->Y[prev] + t * (this->Y[next] - this->Y[prev]);
+  position[2] = this->Z[prev] + t * (this->Z[next] - this->Z[prev]);
+  if (quaternion)
+  {
+    const double a[4] = { this->QW[prev], this->QX[prev], this->QY[prev], this->QZ[prev] };
+    const double b[4] = { this->QW[next], this->QX[next], this->QY[next], this->QZ[next] };
+    Slerp(a, b, t, quaternion);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::Interpolate(double time, double position[3], double quaternion[4]) const
+{
+  this->InterpolateAt(this->FindInterval(time), time, position, quaternion);
+  this->NumberOfQueries++;
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::InterpolateMatrix(double time, double matrix[12]) const
+{
+  double position[3], quaternion[4];
+  this->Interpolate(time, position, quaternion);
+  ToMatrix(quaternion, position, matrix);
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::InterpolateBatch(
+  const double* times, vtkIdType nbTimes, double* positions, double* quaternions) const
+{
+  const auto start = std::chrono::steady_clock::now();
+  const vtkIdType nbChunks = (nbTimes + BATCH_CHUNK - 1) / BATCH_CHUNK;
+  vtkSMPTools::For(0, nbChunks, [&](vtkIdType firstChunk, vtkIdType lastChunk) {
+    const std::size_t n = this->Times.size();
+    for (vtkIdType chunk = firstChunk; chunk < lastChunk; ++chunk)
+    {
+      const vtkIdType begin = chunk * BATCH_CHUNK;
+      const vtkIdType end = std::min(begin + BATCH_CHUNK, nbTimes);
+      // One search per chunk, then walk forward while timestamps are sorted
+      std::size_t next = this->FindInterval(times[begin]);
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        const double time = times[i];
+        if (i > begin && time < times[i - 1])
+        {
+          next = this->FindInterval(time);
+        }
+        while (next < n && this->Times[next] <= time)
+        {
+          ++next;
+        }
+        this->InterpolateAt(next, time, positions + 3 * i, quaternions ? quaternions + 4 * i : nullptr);
+      }
+    }
+  });
+  this->RecordBatch(static_cast<std::size_t>(nbTimes),
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::InterpolateMatrixBatch(
+  const double* times, vtkIdType nbTimes, double* matrices) const
+{
+  std::vector<double> positions(3 * nbTimes);
+  std::vector<double> quaternions(4 * nbTimes);
+  this->InterpolateBatch(times, nbTimes, positions.data(), quaternions.data());
+  vtkSMPTools::For(0, nbTimes, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      ToMatrix(&quaternions[4 * i], &positions[3 * i], matrices + 12 * i);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+std::size_t LidarPoseStore::GetMemorySize() const
+{
+  return 8 * this->Times.capacity() * sizeof(double);
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::RecordBatch(std::size_t nbQueries, double seconds) const
+{
+  this->NumberOfQueries += nbQueries;
+  this->BatchQueries += nbQueries;
+  this->BatchNanoseconds += static_cast<long long>(seconds * 1e9);
+}
+
+//-----------------------------------------------------------------------------
+double LidarPoseStore::GetQueryThroughput() const
+{
+  const long long nanoseconds = this->BatchNanoseconds;
+  return nanoseconds > 0 ? this->BatchQueries * 1e9 / nanoseconds : 0.;
+}
+
+//-----------------------------------------------------------------------------
+void LidarPoseStore::ResetStatistics()
+{
+  this->NumberOfQueries = 0;
+  this->BatchQueries = 0;
+  this->BatchNanoseconds = 0;
+}
@@ -0,0 +1,150 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarPoseStore.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarPoseStore_h
+#define LidarPoseStore_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class vtkPolyData;
+
+/**
+ * @class LidarPoseStore
+ * @brief Time indexed poses with logarithmic interpolation queries.
+ *
+ * Poses are stored as structure-of-arrays sorted by time: time, x, y, z and
+ * the orientation quaternion w, x, y, z. A single query is a binary search
+ * followed by a linear interpolation of the position and a SLERP of the
+ * orientation. Batch queries walk the poses along sorted timestamps instead
+ * of searching each one, and run in parallel.
+ *
+ * Outside of the time range of the store, the first / last pose is returned.
+ * The store counts its queries and times its batch queries, so that its
+ * throughput can be reported along with its memory footprint.
+ *
+ * GetStore() loads and caches the store of a poses data object, so that the
+ * filters reading the same poses (deskew, compact frame) share one store
+ * instead of each loading and sorting the poses for every frame.
+ */
+class LIDARPROCESSING_EXPORT LidarPoseStore
+{
+public:
+  LidarPoseStore() = default;
+  LidarPoseStore(const LidarPoseStore& other);
+  LidarPoseStore& operator=(const LidarPoseStore& other);
+
+  /**
+   * Names of the arrays read by Load(). Position arrays left empty mean the
+   * position is read from the points. The quaternion array (w, x, y, z) has
+   * precedence over the roll / pitch / yaw arrays (degrees, Z-Y-X
+   * convention); without any of them the orientation is the identity.
+   */
+  struct ArrayNames
+  {
+    std::string Time = "time";
+    std::string X;
+    std::string Y;
+    std::string Z;
+    std::string Quaternion = "orientation";
+    std::string Roll = "roll";
+    std::string Pitch = "pitch";
+    std::string Yaw = "yaw";
+  };
+
+  /**
+   * Fill the store from the output of a position / orientation source.
+   * Returns false when the time or a position array is missing.
+   */
+  bool Load(vtkPolyData* poses, const ArrayNames& names);
+
+  /**
+   * Store of poses, loaded on first use then kept in a small cache shared by
+   * all the callers. The cache is keyed by the poses, their modification time
+   * and the array names. Returns nullptr when there is no pose to load.
+   */
+  static std::shared_ptr<const LidarPoseStore> GetStore(
+    vtkPolyData* poses, const ArrayNames& names);
+
+  void Clear();
+  void Reserve(std::size_t nbPoses);
+
+  /**
+   * Add a pose, typically the latest one of a stream. A pose older than the
+   * last one is inserted at its place, which costs a move of the newer poses.
+   */
+  void Append(double time, const double position[3], const double quaternion[4]);
+
+  std::size_t GetNumberOfPoses() const { return this->Times.size(); }
+  bool IsEmpty() const { return this->Times.empty(); }
+  double GetTime(std::size_t i) const { return this->Times[i]; }
+  void GetPosition(std::size_t i, double position[3]) const;
+
+  /**
+   * Interpolate the pose at time. quaternion may be nullptr.
+   */
+  void Interpolate(double time, double position[3], double quaternion[4] = nullptr) const;
+
+  /**
+   * Interpolated pose at time as a row-major 3x4 rigid transform.
+   */
+  void InterpolateMatrix(double time, double matrix[12]) const;
+
+  //@{
+  /**
+   * Batch interpolation for nbTimes timestamps, fastest when they are
+   * sorted. Outputs hold 3 (positions), 4 (quaternions, may be nullptr) or 12
+   * (matrices) values per timestamp.
+   */
+  void InterpolateBatch(
+    const double* times, vtkIdType nbTimes, double* positions, double* quaternions = nullptr) const;
+  void InterpolateMatrixBatch(const double* times, vtkIdType nbTimes, double* matrices) const;
+  //@}
+
+  /**
+   * Memory used by the poses, in bytes.
+   */
+  std::size_t GetMemorySize() const;
+
+  //@{
+  /**
+   * Query statistics since the last reset: number of interpolated timestamps,
+   * and throughput of the batch queries in timestamps per second. Single
+   * queries are counted but not timed, as timing them would cost more than
+   * answering them.
+   */
+  std::size_t GetNumberOfQueries() const { return this->NumberOfQueries; }
+  double GetQueryThroughput() const;
+  void ResetStatistics();
+  //@}
+
+private:
+  std::size_t FindInterval(double time) const;
+  void InterpolateAt(std::size_t next, double time, double position[3], double quaternion[4]) const;
+  void RecordBatch(std::size_t nbQueries, double seconds) const;
+
+  std::vector<double> Times;
+  std::vector<double> X, Y, Z;
+  std::vector<double> QW, QX, QY, QZ;
+
+  mutable std::atomic<std::size_t> NumberOfQueries{ 0 };
+  mutable std::atomic<std::size_t> BatchQueries{ 0 };
+  mutable std::atomic<long long> BatchNanoseconds{ 0 };
+};
+
+#endif // LidarPoseStore_h
@@ -0,0 +1,71 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarProcessingHelper.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarProcessingHelper_h
+#define LidarProcessingHelper_h
+
+#include "LidarSharedVertices.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+namespace LidarProcessingHelper
+{
+//-----------------------------------------------------------------------------
+/**
+ * Fill output with the points of input listed in ids, along with all their
+ * point data arrays. Field data is passed as is.
+ * Vertices are only generated when input has some, so that point only frames
+ * stay point only.
+ */
+inline void ExtractPoints(vtkPolyData* input, vtkIdList* ids, vtkPolyData* output)
+{
+  const vtkIdType nbPoints = ids->GetNumberOfIds();
+
+  vtkNew<vtkPoints> points;
+  points->SetDataType(input->GetPoints() ? input->GetPoints()->GetDataType() : VTK_FLOAT);
+  points->SetNumberOfPoints(nbPoints);
+  if (input->GetPoints())
+  {
+    input->GetPoints()->GetData()->GetTuples(ids, points->GetData());
+  }
+  output->SetPoints(points);
+
+  vtkPointData* inPD = input->GetPointData();
+  vtkPointData* outPD = output->GetPointData();
+  outPD->CopyAllocate(inPD, nbPoints);
+  for (int i = 0; i < inPD->GetNumberOfArrays(); ++i)
+  {
+    vtkAbstractArray* inArray = inPD->GetAbstractArray(i);
+    vtkAbstractArray* outArray = outPD->GetAbstractArray(inArray->GetName());
+    if (outArray)
+    {
+      outArray->SetNumberOfTuples(nbPoints);
+      inArray->GetTuples(ids, outArray);
+    }
+  }
+
+  if (input->GetNumberOfVerts() > 0)
+  {
+    output->SetVerts(LidarSharedVertices::Get(nbPoints));
+  }
+  output->GetFieldData()->PassData(input->GetFieldData());
+}
+}
+
+#endif // LidarProcessingHelper_h
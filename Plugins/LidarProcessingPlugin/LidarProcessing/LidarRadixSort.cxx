@@ -0,0 +1,119 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarRadixSort.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarRadixSort.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+
+namespace
+{
+// Radix sort digits, and blocks of entries sharing a histogram
+constexpr int DIGIT_BITS = 11;
+constexpr int NB_BUCKETS = 1 << DIGIT_BITS;
+constexpr vtkIdType MIN_BLOCK_SIZE = 1 << 16;
+constexpr vtkIdType MAX_BLOCKS = 256;
+
+//-----------------------------------------------------------------------------
+vtkIdType GetNumberOfBlocks(vtkIdType nbEntries)
+{
+  return std::max<vtkIdType>(1, std::min(MAX_BLOCKS, nbEntries / MIN_BLOCK_SIZE));
+}
+}
+
+//-----------------------------------------------------------------------------
+void LidarRadixSort::Sort(std::vector<Entry>& entries, int nbBits)
+{
+  const vtkIdType nbEntries = static_cast<vtkIdType>(entries.size());
+  const vtkIdType nbBlocks = GetNumberOfBlocks(nbEntries);
+  const vtkIdType blockSize = (nbEntries + nbBlocks - 1) / nbBlocks;
+  std::vector<Entry> buffer(nbEntries);
+  std::vector<vtkIdType> offsets(nbBlocks * NB_BUCKETS);
+  for (int shift = 0; shift < nbBits; shift += DIGIT_BITS)
+  {
+    vtkSMPTools::For(0, nbBlocks, 1, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType block = begin; block < end; ++block)
+      {
+        vtkIdType* counts = &offsets[block * NB_BUCKETS];
+        std::fill(counts, counts + NB_BUCKETS, 0);
+        const vtkIdType last = std::min(nbEntries, (block + 1) * blockSize);
+        for (vtkIdType i = block * blockSize; i < last; ++i)
+        {
+          counts[(entries[i].Key >> shift) & (NB_BUCKETS - 1)]++;
+        }
+      }
+    });
+    // Bucket by bucket, each block writes after the previous blocks
+    vtkIdType total = 0;
+    for (int bucket = 0; bucket < NB_BUCKETS; ++bucket)
+    {
+      for (vtkIdType block = 0; block < nbBlocks; ++block)
+      {
+        const vtkIdType count = offsets[block * NB_BUCKETS + bucket];
+        offsets[block * NB_BUCKETS + bucket] = total;
+        total += count;
+      }
+    }
+    vtkSMPTools::For(0, nbBlocks, 1, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType block = begin; block < end; ++block)
+      {
+        vtkIdType* next = &offsets[block * NB_BUCKETS];
+        const vtkIdType last = std::min(nbEntries, (block + 1) * blockSize);
+        for (vtkIdType i = block * blockSize; i < last; ++i)
+        {
+          buffer[next[(entries[i].Key >> shift) & (NB_BUCKETS - 1)]++] = entries[i];
+        }
+      }
+    });
+    entries.swap(buffer);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarRadixSort::FindRuns(
+  const std::vector<Entry>& entries, vtkIdType nbEntries, std::vector<vtkIdType>& starts)
+{
+  const vtkIdType nbBlocks = GetNumberOfBlocks(nbEntries);
+  const vtkIdType blockSize = (nbEntries + nbBlocks - 1) / nbBlocks;
+  auto isStart = [&](vtkIdType i) { return i == 0 || entries[i].Key != entries[i - 1].Key; };
+  std::vector<vtkIdType> offsets(nbBlocks + 1, 0);
+  vtkSMPTools::For(0, nbBlocks, 1, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType block = begin; block < end; ++block)
+    {
+      const vtkIdType last = std::min(nbEntries, (block + 1) * blockSize);
+      for (vtkIdType i = block * blockSize; i < last; ++i)
+      {
+        offsets[block + 1] += isStart(i) ? 1 : 0;
+      }
+    }
+  });
+  for (vtkIdType block = 0; block < nbBlocks; ++block)
+  {
+    offsets[block + 1] += offsets[block];
+  }
+  starts.resize(offsets.back() + 1);
+  vtkSMPTools::For(0, nbBlocks, 1, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType block = begin; block < end; ++block)
+    {
+      vtkIdType next = offsets[block];
+      const vtkIdType last = std::min(nbEntries, (block + 1) * blockSize);
+      for (vtkIdType i = block * blockSize; i < last; ++i)
+      {
+        if (isStart(i))
+        {
+          starts[next++] = i;
+        }
+      }
+    }
+  });
+  starts.back() = nbEntries;
+}
@@ -0,0 +1,53 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarRadixSort.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarRadixSort_h
+#define LidarRadixSort_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class LidarRadixSort
+ * @brief Parallel sort of point ids by integer key, such as a voxel key.
+ *
+ * Sort() is a stable LSD radix sort, 11 bits per pass, on the low bits of
+ * the keys. The entries are split in blocks of at least 65536 entries, each
+ * block counting its own digit histogram, so that the passes run in parallel.
+ * The blocks do not depend on the number of threads, neither does the result.
+ */
+class LIDARPROCESSING_EXPORT LidarRadixSort
+{
+public:
+  struct Entry
+  {
+    std::uint64_t Key;
+    vtkIdType Id;
+  };
+
+  /**
+   * Sort entries by their nbBits low key bits, the higher bits being 0.
+   */
+  static void Sort(std::vector<Entry>& entries, int nbBits);
+
+  /**
+   * First entry of each run of equal keys among the nbEntries first sorted
+   * entries, followed by nbEntries.
+   */
+  static void FindRuns(
+    const std::vector<Entry>& entries, vtkIdType nbEntries, std::vector<vtkIdType>& starts);
+};
+
+#endif // LidarRadixSort_h
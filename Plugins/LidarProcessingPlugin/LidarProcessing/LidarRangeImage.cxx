@@ -0,0 +1,567 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarRangeImage.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarRangeImage.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkTemplateAliasMacro.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+// Laser ids are expected in [0, MAX_LASERS[, other points are left out
+constexpr int MAX_LASERS = 4096;
+
+// Closest point key of the empty pixels, see LidarRangeImage::Build()
+constexpr std::uint64_t EMPTY_PIXEL = ~std::uint64_t(0);
+
+// Columns transposed together when gathering the pixel values
+constexpr vtkIdType TILE_COLUMNS = 16;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// atan2 with a maximum error of about 1e-5 rad (Abramowitz and Stegun 4.4.49),
+// several times faster than std::atan2. Computed in the precision of the
+// points, float being enough for the azimuth columns.
+template <typename T>
+inline T FastAtan2(T y, T x)
+{
+  const T ax = std::abs(x);
+  const T ay = std::abs(y);
+  const T high = std::max(ax, ay);
+  if (high == T(0))
+  {
+    return T(0);
+  }
+  const T a = std::min(ax, ay) / high;
+  const T s = a * a;
+  T angle = a *
+    (T(0.99997726) +
+      s *
+        (T(-0.33262347) +
+          s * (T(0.19354346) + s * (T(-0.11643287) + s * (T(0.05265332) - s * T(0.01172120))))));
+  const T pi = static_cast<T>(vtkMath::Pi());
+  if (ay > ax)
+  {
+    angle = pi / T(2) - angle;
+  }
+  if (x < T(0))
+  {
+    angle = pi - angle;
+  }
+  return y < T(0) ? -angle : angle;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+struct PointReader
+{
+  using ValueType = T;
+  const T* Points;
+
+  void Get(vtkIdType id, T p[3]) const
+  {
+    const T* point = this->Points + 3 * id;
+    p[0] = point[0];
+    p[1] = point[1];
+    p[2] = point[2];
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct GenericPointReader
+{
+  using ValueType = double;
+  vtkDataArray* Points;
+
+  void Get(vtkIdType id, double p[3]) const { this->Points->GetTuple(id, p); }
+};
+
+//-----------------------------------------------------------------------------
+// Keep array unless it is referenced elsewhere, e.g. by an exported image
+template <typename ArrayT>
+ArrayT* Renew(vtkSmartPointer<ArrayT>& array, const char* name)
+{
+  if (!array || array->GetReferenceCount() > 1)
+  {
+    array = vtkSmartPointer<ArrayT>::New();
+    array->SetName(name);
+  }
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void GatherLasers(const T* values, vtkIdType nbPoints, int* lasers)
+{
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const double laser = static_cast<double>(values[i]);
+      lasers[i] = laser >= 0. && laser < MAX_LASERS ? static_cast<int>(laser) : -1;
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void GatherIntensities(const T* values, const vtkIdType* pointIds, vtkIdType nbPixels,
+  float* intensities)
+{
+  vtkSMPTools::For(0, nbPixels, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType pixel = begin; pixel < end; ++pixel)
+    {
+      const vtkIdType id = pointIds[pixel];
+      intensities[pixel] = id < 0 ? 0.f : static_cast<float>(values[id]);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+// Range, elevation slope and azimuth column of each point, in a single pass
+// in the precision of the points. The points without a valid laser, at the
+// origin or NaN are left out (-1 laser).
+template <typename Reader>
+void Project(const Reader& points, vtkIdType nbPoints, int nbColumns, float* ranges,
+  float* slopes, int* columns, int* lasers)
+{
+  using T = typename Reader::ValueType;
+  const T pi = static_cast<T>(vtkMath::Pi());
+  const T scale = static_cast<T>(nbColumns / (2. * vtkMath::Pi()));
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    T p[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      points.Get(i, p);
+      const T horizontal2 = p[0] * p[0] + p[1] * p[1];
+      const float range = static_cast<float>(std::sqrt(horizontal2 + p[2] * p[2]));
+      const float slope = static_cast<float>(p[2] / std::sqrt(horizontal2));
+      ranges[i] = range;
+      slopes[i] = slope;
+      if (lasers[i] < 0 || !(range > 0.f) || !std::isfinite(slope))
+      {
+        lasers[i] = -1;
+        columns[i] = 0;
+        continue;
+      }
+      const T column = (FastAtan2(p[1], p[0]) + pi) * scale;
+      columns[i] = std::min(static_cast<int>(column), nbColumns - 1);
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+// Point id, range and position of each pixel, in a single pass, from the
+// closest point keys stored column by column. The image is transposed by
+// tiles of a few columns, so that the keys, the points of these columns and
+// the pixels written stay in cache.
+template <typename Reader>
+void GatherPixels(const Reader& points, const std::uint64_t* closest, int nbColumns,
+  int nbLaserRows, int nbRows, vtkIdType* pointIds, float* ranges, float* positions)
+{
+  vtkSMPTools::For(0, nbColumns, [&](vtkIdType begin, vtkIdType end) {
+    typename Reader::ValueType p[3];
+    for (vtkIdType tile = begin; tile < end; tile += TILE_COLUMNS)
+    {
+      const vtkIdType tileEnd = std::min(tile + TILE_COLUMNS, end);
+      for (int row = 0; row < nbRows; ++row)
+      {
+        for (vtkIdType column = tile; column < tileEnd; ++column)
+        {
+          const vtkIdType pixel = static_cast<vtkIdType>(row) * nbColumns + column;
+          const std::uint64_t key =
+            row < nbLaserRows ? closest[column * nbLaserRows + row] : EMPTY_PIXEL;
+          float* position = positions + 3 * pixel;
+          if (key == EMPTY_PIXEL)
+          {
+            pointIds[pixel] = -1;
+            ranges[pixel] = 0.f;
+            position[0] = position[1] = position[2] = 0.f;
+            continue;
+          }
+          const vtkIdType id = static_cast<vtkIdType>(key & 0xffffffffu);
+          pointIds[pixel] = id;
+          const std::uint32_t rangeBits = static_cast<std::uint32_t>(key >> 32);
+          std::memcpy(ranges + pixel, &rangeBits, sizeof(rangeBits));
+          points.Get(id, p);
+          position[0] = static_cast<float>(p[0]);
+          position[1] = static_cast<float>(p[1]);
+          position[2] = static_cast<float>(p[2]);
+        }
+      }
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType FindRoot(std::vector<vtkIdType>& parents, vtkIdType pixel)
+{
+  while (parents[pixel] != pixel)
+  {
+    parents[pixel] = parents[parents[pixel]];
+    pixel = parents[pixel];
+  }
+  return pixel;
+}
+}
+
+//-----------------------------------------------------------------------------
+void LidarRangeImage::SetNumberOfColumns(int nbColumns)
+{
+  this->NumberOfColumns = std::max(nbColumns, 1);
+}
+
+//-----------------------------------------------------------------------------
+bool LidarRangeImage::Build(
+  vtkDataArray* points, vtkDataArray* laserIds, vtkDataArray* intensities, std::string* error)
+{
+  if (!points || points->GetNumberOfComponents() != 3)
+  {
+    SetError(error, "Invalid points");
+    return false;
+  }
+  const vtkIdType nbPoints = points->GetNumberOfTuples();
+  if (!laserIds || laserIds->GetNumberOfComponents() != 1 ||
+    laserIds->GetNumberOfTuples() != nbPoints)
+  {
+    SetError(error, "Invalid laser id array");
+    return false;
+  }
+  if (intensities &&
+    (intensities->GetNumberOfComponents() != 1 || intensities->GetNumberOfTuples() != nbPoints))
+  {
+    SetError(error, "Invalid intensity array");
+    return false;
+  }
+  // Point ids are packed on 32 bits to find the closest point of each pixel
+  if (static_cast<std::uint64_t>(nbPoints) > std::numeric_limits<std::uint32_t>::max())
+  {
+    SetError(error, "Too many points");
+    return false;
+  }
+
+  // Project the points
+  const int nbColumns = this->NumberOfColumns;
+  std::vector<float>& ranges = this->PointRanges;
+  std::vector<float>& slopes = this->PointSlopes;
+  std::vector<int>& columns = this->PointColumns;
+  std::vector<int>& lasers = this->PointLasers;
+  ranges.resize(nbPoints);
+  slopes.resize(nbPoints);
+  columns.resize(nbPoints);
+  lasers.resize(nbPoints);
+  switch (laserIds->GetDataType())
+  {
+    vtkTemplateAliasMacro(GatherLasers(
+      static_cast<const VTK_TT*>(laserIds->GetVoidPointer(0)), nbPoints, lasers.data()));
+    default:
+      SetError(error, "Unsupported laser id array type");
+      return false;
+  }
+  auto floatPoints = vtkFloatArray::FastDownCast(points);
+  auto doublePoints = vtkDoubleArray::FastDownCast(points);
+  if (floatPoints)
+  {
+    Project(PointReader<float>{ floatPoints->GetPointer(0) }, nbPoints, nbColumns, ranges.data(),
+      slopes.data(), columns.data(), lasers.data());
+  }
+  else if (doublePoints)
+  {
+    Project(PointReader<double>{ doublePoints->GetPointer(0) }, nbPoints, nbColumns,
+      ranges.data(), slopes.data(), columns.data(), lasers.data());
+  }
+  else
+  {
+    Project(GenericPointReader{ points }, nbPoints, nbColumns, ranges.data(), slopes.data(),
+      columns.data(), lasers.data());
+  }
+
+  // Rows: the lasers sorted by mean elevation
+  std::vector<double> slopeSums(MAX_LASERS, 0.);
+  std::vector<vtkIdType> counts(MAX_LASERS, 0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (lasers[i] >= 0)
+    {
+      slopeSums[lasers[i]] += slopes[i];
+      counts[lasers[i]]++;
+    }
+  }
+  this->RowLasers.clear();
+  for (int laser = 0; laser < MAX_LASERS; ++laser)
+  {
+    if (counts[laser] > 0)
+    {
+      slopeSums[laser] /= counts[laser];
+      this->RowLasers.push_back(laser);
+    }
+  }
+  std::sort(this->RowLasers.begin(), this->RowLasers.end(), [&](int a, int b) {
+    return slopeSums[a] < slopeSums[b] || (slopeSums[a] == slopeSums[b] && a < b);
+  });
+  std::vector<int> laserRows(MAX_LASERS, -1);
+  for (int row = 0; row < this->GetHeight(); ++row)
+  {
+    laserRows[this->RowLasers[row]] = row;
+  }
+
+  // Closest point of each pixel: the smallest (range, point id) key, the bits
+  // of a positive float ordering as the float, so that the first of the points
+  // at the same range wins. The keys are stored column by column, as the
+  // points of a firing are, so that this serial pass stays in cache.
+  const int nbLaserRows = this->GetHeight();
+  std::vector<std::uint64_t>& closest = this->ClosestKeys;
+  closest.assign(static_cast<std::size_t>(nbColumns) * nbLaserRows, EMPTY_PIXEL);
+  this->PointPixels.resize(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (lasers[i] < 0)
+    {
+      this->PointPixels[i] = -1;
+      continue;
+    }
+    const int row = laserRows[lasers[i]];
+    this->PointPixels[i] = this->GetPixel(row, columns[i]);
+    std::uint32_t rangeBits;
+    std::memcpy(&rangeBits, &ranges[i], sizeof(rangeBits));
+    const std::uint64_t key = static_cast<std::uint64_t>(rangeBits) << 32 |
+      static_cast<std::uint64_t>(i);
+    std::uint64_t& pixelKey = closest[static_cast<std::size_t>(columns[i]) * nbLaserRows + row];
+    pixelKey = std::min(pixelKey, key);
+  }
+
+  // Pixel values, including the empty rows exported above the lasers
+  const int nbRows = this->GetNumberOfRows();
+  const vtkIdType nbPixels = static_cast<vtkIdType>(nbColumns) * nbRows;
+  Renew(this->PointIds, "point_id")->SetNumberOfTuples(nbPixels);
+  vtkIdType* pointIds = this->PointIds->GetPointer(0);
+  Renew(this->Ranges, "range")->SetNumberOfTuples(nbPixels);
+  Renew(this->Positions, "position")->SetNumberOfComponents(3);
+  this->Positions->SetNumberOfTuples(nbPixels);
+  if (floatPoints)
+  {
+    GatherPixels(PointReader<float>{ floatPoints->GetPointer(0) }, closest.data(), nbColumns,
+      nbLaserRows, nbRows, pointIds, this->Ranges->GetPointer(0),
+      this->Positions->GetPointer(0));
+  }
+  else if (doublePoints)
+  {
+    GatherPixels(PointReader<double>{ doublePoints->GetPointer(0) }, closest.data(), nbColumns,
+      nbLaserRows, nbRows, pointIds, this->Ranges->GetPointer(0),
+      this->Positions->GetPointer(0));
+  }
+  else
+  {
+    GatherPixels(GenericPointReader{ points }, closest.data(), nbColumns, nbLaserRows, nbRows,
+      pointIds, this->Ranges->GetPointer(0), this->Positions->GetPointer(0));
+  }
+  if (!intensities)
+  {
+    this->Intensities = nullptr;
+  }
+  else
+  {
+    Renew(this->Intensities, "intensity")->SetNumberOfTuples(nbPixels);
+    switch (intensities->GetDataType())
+    {
+      vtkTemplateAliasMacro(
+        GatherIntensities(static_cast<const VTK_TT*>(intensities->GetVoidPointer(0)), pointIds,
+          nbPixels, this->Intensities->GetPointer(0)));
+      default:
+        this->Intensities = nullptr;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void LidarRangeImage::ExportTo(vtkImageData* image) const
+{
+  image->Initialize();
+  // An empty extent when there is no row
+  const int nbRows = this->GetNumberOfRows();
+  image->SetExtent(0, this->NumberOfColumns - 1, 0, nbRows - 1, 0, 0);
+  vtkPointData* pointData = image->GetPointData();
+  pointData->AddArray(this->Ranges);
+  pointData->SetActiveScalars("range");
+  pointData->AddArray(this->Positions);
+  pointData->AddArray(this->PointIds);
+  if (this->Intensities)
+  {
+    pointData->AddArray(this->Intensities);
+  }
+  vtkNew<vtkIntArray> rowLasers;
+  rowLasers->SetName("row_laser_id");
+  rowLasers->SetNumberOfTuples(nbRows);
+  std::copy(this->RowLasers.begin(), this->RowLasers.end(), rowLasers->GetPointer(0));
+  std::fill(rowLasers->GetPointer(0) + this->GetHeight(), rowLasers->GetPointer(0) + nbRows, -1);
+  image->GetFieldData()->AddArray(rowLasers);
+}
+
+//-----------------------------------------------------------------------------
+int LidarRangeImage::ClusterPixels(
+  const unsigned char* mask, double tolerance, int maxGap, std::vector<int>& clusters) const
+{
+  const int width = this->GetWidth();
+  const int height = this->GetHeight();
+  const vtkIdType nbPixels = this->GetNumberOfPixels();
+  const double tolerance2 = tolerance * tolerance;
+  const vtkIdType* pointIds = this->PointIds->GetPointer(0);
+  std::vector<vtkIdType> parents(nbPixels);
+  for (vtkIdType pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    parents[pixel] = pixel;
+  }
+
+  // Connect a pixel to the first occupied pixel after it in its row and in
+  // its column, up to lastRow
+  auto connect = [&](vtkIdType pixel, vtkIdType neighbor) {
+    if (mask[neighbor] &&
+      vtkMath::Distance2BetweenPoints(this->GetPosition(pixel), this->GetPosition(neighbor)) <=
+        tolerance2)
+    {
+      const vtkIdType a = FindRoot(parents, pixel);
+      const vtkIdType b = FindRoot(parents, neighbor);
+      parents[std::max(a, b)] = std::min(a, b);
+    }
+  };
+  auto connectNeighbors = [&](int row, int column, int lastRow, bool alongRow) {
+    const vtkIdType pixel = this->GetPixel(row, column);
+    if (!mask[pixel])
+    {
+      return;
+    }
+    for (int step = 1; alongRow && step <= maxGap + 1; ++step)
+    {
+      const vtkIdType next = this->GetPixel(row, (column + step) % width);
+      if (pointIds[next] >= 0)
+      {
+        connect(pixel, next);
+        break;
+      }
+    }
+    for (int step = 1; step <= maxGap + 1 && row + step <= lastRow; ++step)
+    {
+      const vtkIdType next = this->GetPixel(row + step, column);
+      if (pointIds[next] >= 0)
+      {
+        connect(pixel, next);
+        break;
+      }
+    }
+  };
+
+  // Each block only links its own pixels, so that their trees are disjoint.
+  // The links crossing the block boundaries are added afterwards
+  const int blockSize = std::max(maxGap + 1, 4);
+  const int nbBlocks = (height + blockSize - 1) / blockSize;
+  vtkSMPTools::For(0, nbBlocks, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType block = begin; block < end; ++block)
+    {
+      const int firstRow = static_cast<int>(block) * blockSize;
+      const int lastRow = std::min(firstRow + blockSize, height) - 1;
+      for (int row = firstRow; row <= lastRow; ++row)
+      {
+        for (int column = 0; column < width; ++column)
+        {
+          connectNeighbors(row, column, lastRow, true);
+        }
+      }
+    }
+  });
+  for (int block = 1; block < nbBlocks; ++block)
+  {
+    const int firstRow = block * blockSize;
+    for (int row = std::max(firstRow - maxGap - 1, 0); row < firstRow; ++row)
+    {
+      for (int column = 0; column < width; ++column)
+      {
+        connectNeighbors(row, column, height - 1, false);
+      }
+    }
+  }
+
+  // Roots are the first pixel of their tree, so numbering them in pixel order
+  // only needs the roots seen before
+  clusters.assign(nbPixels, -1);
+  int nbClusters = 0;
+  for (vtkIdType pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    if (mask[pixel])
+    {
+      const vtkIdType root = FindRoot(parents, pixel);
+      clusters[pixel] = root == pixel ? nbClusters++ : clusters[root];
+    }
+  }
+  return nbClusters;
+}
+
+//-----------------------------------------------------------------------------
+int LidarRangeImage::ClusterPoints(const unsigned char* pointMask, double tolerance, int maxGap,
+  vtkIdType minSize, int* clusters) const
+{
+  const vtkIdType nbPoints = static_cast<vtkIdType>(this->PointPixels.size());
+  const vtkIdType nbPixels = this->GetNumberOfPixels();
+  const vtkIdType* pointIds = this->PointIds->GetPointer(0);
+  std::vector<unsigned char> mask(nbPixels);
+  vtkSMPTools::For(0, nbPixels, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType pixel = begin; pixel < end; ++pixel)
+    {
+      mask[pixel] = pointIds[pixel] >= 0 && pointMask[pointIds[pixel]] ? 1 : 0;
+    }
+  });
+  std::vector<int> pixelClusters;
+  const int nbPixelClusters = this->ClusterPixels(mask.data(), tolerance, maxGap, pixelClusters);
+
+  // Masked points sharing the pixel of an unmasked point are left out
+  std::vector<vtkIdType> sizes(nbPixelClusters, 0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    const vtkIdType pixel = this->PointPixels[i];
+    clusters[i] = pixel >= 0 && pointMask[i] ? pixelClusters[pixel] : -1;
+    if (clusters[i] >= 0)
+    {
+      sizes[clusters[i]]++;
+    }
+  }
+  std::vector<int> clusterIds(nbPixelClusters, -1);
+  int nbClusters = 0;
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    const int cluster = clusters[i];
+    if (cluster >= 0 && sizes[cluster] >= minSize && clusterIds[cluster] < 0)
+    {
+      clusterIds[cluster] = nbClusters++;
+    }
+    clusters[i] = cluster >= 0 ? clusterIds[cluster] : -1;
+  }
+  return nbClusters;
+}
@@ -0,0 +1,156 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarRangeImage.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarRangeImage_h
+#define LidarRangeImage_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class vtkDataArray;
+class vtkImageData;
+
+/**
+ * @class LidarRangeImage
+ * @brief Organized view of a lidar frame: a lasers by azimuth grid of points.
+ *
+ * Rows are the lasers sorted by increasing elevation (row 0 is the lowest
+ * laser), columns are NumberOfColumns azimuth bins covering [-pi, pi[. Each
+ * pixel holds the closest point falling into it: its id, range, position and
+ * optionally intensity. Empty pixels have a point id of -1 and a range of 0.
+ * Neighbor pixels are neighbor points of the scan, which makes neighborhood
+ * operations simple and cache friendly compared to a spatial search.
+ *
+ * The projection is computed in parallel, and the pixel of each point is kept
+ * so that points sharing a pixel can be mapped back to it. The frame is
+ * expected in the sensor coordinates.
+ *
+ * The pixel values are stored in VTK arrays that ExportTo() exposes without
+ * copy. Build() allocates new arrays only when the previous ones are still
+ * referenced, e.g. by an exported image, which stays valid. Keeping the same
+ * object from frame to frame thus reuses its arrays and work buffers.
+ */
+class LIDARPROCESSING_EXPORT LidarRangeImage
+{
+public:
+  //@{
+  /**
+   * Number of azimuth bins, about the number of firings per rotation.
+   * Default is 2048.
+   */
+  void SetNumberOfColumns(int nbColumns);
+  int GetNumberOfColumns() const { return this->NumberOfColumns; }
+  //@}
+
+  //@{
+  /**
+   * Minimum number of rows of the exported image: the rows above the lasers
+   * are empty, so that the image keeps the same extent from frame to frame.
+   * Default is 0, as many rows as lasers.
+   */
+  void SetMinimumNumberOfRows(int nbRows) { this->MinimumNumberOfRows = nbRows; }
+  int GetMinimumNumberOfRows() const { return this->MinimumNumberOfRows; }
+  //@}
+
+  /**
+   * Project a frame. laserIds must be a single component array, points with a
+   * laser id outside of [0, 4096[ are left out of the image. intensities is
+   * optional.
+   */
+  bool Build(vtkDataArray* points, vtkDataArray* laserIds, vtkDataArray* intensities = nullptr,
+    std::string* error = nullptr);
+
+  /**
+   * Expose the image as a NumberOfColumns by GetNumberOfRows() image, with
+   * the "range", "position", "point_id" (and "intensity") point arrays and the
+   * "row_laser_id" field array (-1 for the empty rows).
+   */
+  void ExportTo(vtkImageData* image) const;
+
+  int GetWidth() const { return this->NumberOfColumns; }
+  int GetHeight() const { return static_cast<int>(this->RowLasers.size()); }
+  int GetNumberOfRows() const { return std::max(this->GetHeight(), this->MinimumNumberOfRows); }
+  vtkIdType GetNumberOfPixels() const
+  {
+    return static_cast<vtkIdType>(this->NumberOfColumns) * this->GetHeight();
+  }
+  vtkIdType GetPixel(int row, int column) const
+  {
+    return static_cast<vtkIdType>(row) * this->NumberOfColumns + column;
+  }
+
+  //@{
+  /**
+   * Values of a pixel.
+   */
+  vtkIdType GetPointId(vtkIdType pixel) const { return this->PointIds->GetValue(pixel); }
+  float GetRange(vtkIdType pixel) const { return this->Ranges->GetValue(pixel); }
+  const float* GetPosition(vtkIdType pixel) const { return this->Positions->GetPointer(3 * pixel); }
+  //@}
+
+  /**
+   * Pixel of a point, -1 when its laser is not valid.
+   */
+  vtkIdType GetPointPixel(vtkIdType pointId) const { return this->PointPixels[pointId]; }
+
+  /**
+   * Laser of a row.
+   */
+  int GetRowLaser(int row) const { return this->RowLasers[row]; }
+
+  /**
+   * Connected components of the pixels where mask is not 0. Two pixels are
+   * neighbors when they follow each other along a row (the rows wrap around)
+   * or a column, with at most maxGap empty pixels in between; they are
+   * connected when their points are closer than tolerance. Fills the cluster
+   * of each pixel (-1 outside of the mask), numbered in pixel order, and
+   * returns the number of clusters. Blocks of rows are labeled in parallel.
+   */
+  int ClusterPixels(
+    const unsigned char* mask, double tolerance, int maxGap, std::vector<int>& clusters) const;
+
+  /**
+   * Clusters of the points where pointMask is not 0, using ClusterPixels() on
+   * the pixels whose closest point is in the mask. Clusters of fewer than
+   * minSize points are dropped (-1), the others are numbered in the order of
+   * their first point. Returns the number of clusters.
+   */
+  int ClusterPoints(const unsigned char* pointMask, double tolerance, int maxGap,
+    vtkIdType minSize, int* clusters) const;
+
+private:
+  int NumberOfColumns = 2048;
+  int MinimumNumberOfRows = 0;
+  std::vector<int> RowLasers;
+  std::vector<vtkIdType> PointPixels;
+  vtkSmartPointer<vtkIdTypeArray> PointIds = vtkSmartPointer<vtkIdTypeArray>::New();
+  vtkSmartPointer<vtkFloatArray> Ranges = vtkSmartPointer<vtkFloatArray>::New();
+  vtkSmartPointer<vtkFloatArray> Positions = vtkSmartPointer<vtkFloatArray>::New();
+  vtkSmartPointer<vtkFloatArray> Intensities;
+
+  // Work buffers of Build(), per point and per pixel
+  std::vector<float> PointRanges;
+  std::vector<float> PointSlopes;
+  std::vector<int> PointColumns;
+  std::vector<int> PointLasers;
+  std::vector<std::uint64_t> ClosestKeys;
+};
+
+#endif // LidarRangeImage_h
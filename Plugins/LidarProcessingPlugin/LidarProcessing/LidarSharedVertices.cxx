@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarSharedVertices.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarSharedVertices.h"
+
+#include "LidarFrameBuffer.h"
+
+#include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
+namespace
+{
+std::mutex CacheMutex;
+LidarFrameBuffer* Identity = nullptr;
+vtkIdType Capacity = 0;
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkIdTypeArray> NewIdentityView(LidarFrameBuffer* buffer, vtkIdType nbValues)
+{
+  buffer->Register();
+  auto array = vtkSmartPointer<vtkIdTypeArray>::New();
+  array->SetArray(static_cast<vtkIdType*>(buffer->GetSection(0)), nbValues, 0,
+    vtkIdTypeArray::VTK_DATA_ARRAY_USER_DEFINED);
+  array->SetArrayFreeFunction(LidarFrameBuffer::ReleaseSection);
+  return array;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkCellArray> LidarSharedVertices::Get(vtkIdType nbPoints)
+{
+  std::lock_guard<std::mutex> lock(CacheMutex);
+  // offsets need nbPoints + 1 values, connectivity nbPoints
+  if (!Identity || Capacity < nbPoints + 1)
+  {
+    // Grow geometrically, the previous buffer lives as long as its views
+    const vtkIdType capacity = std::max(nbPoints + 1, 2 * Capacity);
+    LidarFrameBuffer* buffer =
+      LidarFrameBuffer::New({ static_cast<std::size_t>(capacity) * sizeof(vtkIdType) });
+    vtkIdType* ids = static_cast<vtkIdType*>(buffer->GetSection(0));
+    std::iota(ids, ids + capacity, 0);
+    if (Identity)
+    {
+      Identity->UnRegister();
+    }
+    Identity = buffer;
+    Capacity = capacity;
+  }
+
+  auto verts = vtkSmartPointer<vtkCellArray>::New();
+  verts->SetData(NewIdentityView(Identity, nbPoints + 1), NewIdentityView(Identity, nbPoints));
+  return verts;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType LidarSharedVertices::GetCapacity()
+{
+  std::lock_guard<std::mutex> lock(CacheMutex);
+  return Capacity;
+}
+
+//-----------------------------------------------------------------------------
+void LidarSharedVertices::Clear()
+{
+  std::lock_guard<std::mutex> lock(CacheMutex);
+  if (Identity)
+  {
+    Identity->UnRegister();
+    Identity = nullptr;
+  }
+  Capacity = 0;
+}
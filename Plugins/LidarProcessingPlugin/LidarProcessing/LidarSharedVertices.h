@@ -0,0 +1,56 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarSharedVertices.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarSharedVertices_h
+#define LidarSharedVertices_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+class vtkCellArray;
+
+/**
+ * @class LidarSharedVertices
+ * @brief One vertex per point cell arrays shared between all the frames.
+ *
+ * The vertex cells of a lidar frame only exist so that the frame can be
+ * rendered: offsets and connectivity are both 0, 1, 2, ... which costs 16
+ * bytes per point and a full pass per frame. Instead, a single identity buffer
+ * is built lazily, grown when a larger frame comes, and the returned cell
+ * arrays wrap a prefix of it without copy.
+ *
+ * The returned cell arrays must be considered read only: in place
+ * modifications would affect every frame sharing the buffer. Operations
+ * resizing the arrays (such as InsertNextCell) are safe since they copy it.
+ */
+class LIDARPROCESSING_EXPORT LidarSharedVertices
+{
+public:
+  /**
+   * Get a cell array with one vertex per point, for nbPoints points.
+   */
+  static vtkSmartPointer<vtkCellArray> Get(vtkIdType nbPoints);
+
+  /**
+   * Number of points covered by the current identity buffer.
+   */
+  static vtkIdType GetCapacity();
+
+  /**
+   * Release the identity buffer of the cache. Cell arrays already returned
+   * stay valid.
+   */
+  static void Clear();
+};
+
+#endif // LidarSharedVertices_h
@@ -0,0 +1,455 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarSpatialIndex.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarSpatialIndex.h"
+
+#include "LidarFrameCache.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+// Cell coordinates are packed on 21 bits each
+constexpr int CELL_BITS = 21;
+constexpr int CELL_OFFSET = 1 << (CELL_BITS - 1);
+constexpr int MAX_CELL = CELL_OFFSET - 1;
+// Frames whose index is kept, enough for the trailing frames displayed at once
+constexpr std::size_t CACHE_SIZE = 4;
+
+//-----------------------------------------------------------------------------
+template <typename T>
+struct CopyPointsWorker
+{
+  const T* Points;
+  double* Coordinates;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = 3 * begin; i < 3 * end; ++i)
+    {
+      this->Coordinates[i] = static_cast<double>(this->Points[i]);
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+double Distance2(const double* a, const double* b)
+{
+  const double dx = a[0] - b[0];
+  const double dy = a[1] - b[1];
+  const double dz = a[2] - b[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool LidarSpatialIndex::Build(vtkDataArray* points, double cellSize)
+{
+  this->CellKeys.clear();
+  this->CellStarts.assign(1, 0);
+  this->Ids.clear();
+  this->Coordinates.clear();
+  if (!points || points->GetNumberOfComponents() != 3 || !(cellSize > 0.))
+  {
+    return false;
+  }
+  this->CellSize = cellSize;
+  const vtkIdType nbPoints = points->GetNumberOfTuples();
+
+  // Coordinates in double, in the input order for now
+  std::vector<double> coordinates(3 * nbPoints);
+  if (auto floatPoints = vtkFloatArray::FastDownCast(points))
+  {
+    CopyPointsWorker<float> worker{ floatPoints->GetPointer(0), coordinates.data() };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  else if (auto doublePoints = vtkDoubleArray::FastDownCast(points))
+  {
+    CopyPointsWorker<double> worker{ doublePoints->GetPointer(0), coordinates.data() };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  else
+  {
+    vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        points->GetTuple(i, &coordinates[3 * i]);
+      }
+    });
+  }
+
+  // Sort the points by cell, ties by id so that the result is deterministic
+  std::vector<std::pair<Key, vtkIdType>> sorted(nbPoints);
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    int cell[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      this->GetCell(&coordinates[3 * i], cell);
+      sorted[i] = std::make_pair(this->GetKey(cell), i);
+    }
+  });
+  vtkSMPTools::Sort(sorted.begin(), sorted.end());
+
+  this->Ids.resize(nbPoints);
+  this->Coordinates.resize(3 * nbPoints);
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const vtkIdType id = sorted[i].second;
+      this->Ids[i] = id;
+      std::copy(&coordinates[3 * id], &coordinates[3 * id] + 3, &this->Coordinates[3 * i]);
+    }
+  });
+
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (i == 0 || sorted[i].first != sorted[i - 1].first)
+    {
+      if (i > 0)
+      {
+        this->CellStarts.push_back(i);
+      }
+      this->CellKeys.push_back(sorted[i].first);
+    }
+  }
+  if (nbPoints > 0)
+  {
+    this->CellStarts.push_back(nbPoints);
+  }
+
+  points->GetRange(this->Bounds, 0);
+  points->GetRange(this->Bounds + 2, 1);
+  points->GetRange(this->Bounds + 4, 2);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const LidarSpatialIndex> LidarSpatialIndex::GetIndex(vtkPointSet* frame)
+{
+  if (!frame || !frame->GetPoints() || frame->GetNumberOfPoints() == 0)
+  {
+    return nullptr;
+  }
+  static std::mutex mutex;
+  static LidarFrameCache<LidarFrameObjectKey, std::shared_ptr<const LidarSpatialIndex>> cache(
+    CACHE_SIZE);
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const LidarSpatialIndex>& index = cache.Get(GetLidarFrameObjectKey(frame));
+  if (!index)
+  {
+    auto built = std::make_shared<LidarSpatialIndex>();
+    built->Build(frame->GetPoints()->GetData());
+    index = built;
+  }
+  return index;
+}
+
+//-----------------------------------------------------------------------------
+LidarSpatialIndex::Key LidarSpatialIndex::GetKey(const int cell[3]) const
+{
+  return (static_cast<Key>(cell[0] + CELL_OFFSET) << (2 * CELL_BITS)) |
+    (static_cast<Key>(cell[1] + CELL_OFFSET) << CELL_BITS) |
+    static_cast<Key>(cell[2] + CELL_OFFSET);
+}
+
+//-----------------------------------------------------------------------------
+void LidarSpatialIndex::GetCell(const double x[3], int cell[3]) const
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    const double index = std::floor(x[i] / this->CellSize);
+    // Also maps NaN to the first cell
+    cell[i] = index >= -CELL_OFFSET
+      ? (index <= MAX_CELL ? static_cast<int>(index) : MAX_CELL)
+      : -CELL_OFFSET;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool LidarSpatialIndex::GetCellRange(const int cell[3], vtkIdType& begin, vtkIdType& end) const
+{
+  const Key key = this->GetKey(cell);
+  const auto it = std::lower_bound(this->CellKeys.begin(), this->CellKeys.end(), key);
+  if (it == this->CellKeys.end() || *it != key)
+  {
+    return false;
+  }
+  const std::size_t index = it - this->CellKeys.begin();
+  begin = this->CellStarts[index];
+  end = this->CellStarts[index + 1];
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+template <typename Functor>
+void LidarSpatialIndex::ForEachCellInRange(
+  const int low[3], const int high[3], Functor&& functor) const
+{
+  const double nbCells = (high[0] - low[0] + 1.) * (high[1] - low[1] + 1.) *
+    (high[2] - low[2] + 1.);
+  if (nbCells > static_cast<double>(this->CellKeys.size()))
+  {
+    // Large range: going through the occupied cells is cheaper
+    const Key mask = (Key(1) << CELL_BITS) - 1;
+    for (std::size_t i = 0; i < this->CellKeys.size(); ++i)
+    {
+      const Key key = this->CellKeys[i];
+      const int cell[3] = { static_cast<int>(key >> (2 * CELL_BITS)) - CELL_OFFSET,
+        static_cast<int>((key >> CELL_BITS) & mask) - CELL_OFFSET,
+        static_cast<int>(key & mask) - CELL_OFFSET };
+      if (cell[0] >= low[0] && cell[0] <= high[0] && cell[1] >= low[1] && cell[1] <= high[1] &&
+        cell[2] >= low[2] && cell[2] <= high[2])
+      {
+        functor(this->CellStarts[i], this->CellStarts[i + 1]);
+      }
+    }
+    return;
+  }
+
+  int cell[3];
+  vtkIdType begin, end;
+  for (cell[0] = low[0]; cell[0] <= high[0]; ++cell[0])
+  {
+    for (cell[1] = low[1]; cell[1] <= high[1]; ++cell[1])
+    {
+      for (cell[2] = low[2]; cell[2] <= high[2]; ++cell[2])
+      {
+        if (this->GetCellRange(cell, begin, end))
+        {
+          functor(begin, end);
+        }
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType LidarSpatialIndex::FindClosestPoint(
+  const double x[3], double maxDistance, double* distance2) const
+{
+  if (this->Ids.empty() || !(maxDistance >= 0.))
+  {
+    return -1;
+  }
+  int center[3];
+  this->GetCell(x, center);
+  // No need to search beyond the cells of the bounds
+  const double low[3] = { this->Bounds[0], this->Bounds[2], this->Bounds[4] };
+  const double high[3] = { this->Bounds[1], this->Bounds[3], this->Bounds[5] };
+  int lowCell[3], highCell[3];
+  this->GetCell(low, lowCell);
+  this->GetCell(high, highCell);
+  int boundsRing = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    boundsRing = std::max(boundsRing, std::max(center[i] - lowCell[i], highCell[i] - center[i]));
+  }
+  const int maxRing = static_cast<int>(
+    std::min<double>(std::ceil(maxDistance / this->CellSize), boundsRing));
+
+  vtkIdType best = -1;
+  double bestDistance2 = maxDistance * maxDistance;
+  for (int ring = 0; ring <= maxRing; ++ring)
+  {
+    // Only the shell of the cube of cells around the center is new
+    int cell[3];
+    vtkIdType begin, end;
+    for (int dx = -ring; dx <= ring; ++dx)
+    {
+      for (int dy = -ring; dy <= ring; ++dy)
+      {
+        const bool onShell = std::abs(dx) == ring || std::abs(dy) == ring;
+        for (int dz = -ring; dz <= ring; dz += onShell ? 1 : std::max(2 * ring, 1))
+        {
+          cell[0] = center[0] + dx;
+          cell[1] = center[1] + dy;
+          cell[2] = center[2] + dz;
+          if (!this->GetCellRange(cell, begin, end))
+          {
+            continue;
+          }
+          for (vtkIdType i = begin; i < end; ++i)
+          {
+            const double d2 = Distance2(&this->Coordinates[3 * i], x);
+            if (d2 <= bestDistance2 && (best < 0 || d2 < bestDistance2 || this->Ids[i] < best))
+            {
+              bestDistance2 = d2;
+              best = this->Ids[i];
+            }
+          }
+        }
+      }
+    }
+    // Cells of the next rings are all farther than ring cells from x
+    const double reached = ring * this->CellSize;
+    if (best >= 0 && bestDistance2 <= reached * reached)
+    {
+      break;
+    }
+  }
+  if (best >= 0 && distance2)
+  {
+    *distance2 = bestDistance2;
+  }
+  return best;
+}
+
+//-----------------------------------------------------------------------------
+void LidarSpatialIndex::FindPointsWithinRadius(
+  const double x[3], double radius, std::vector<vtkIdType>& ids) const
+{
+  ids.clear();
+  if (this->Ids.empty() || !(radius >= 0.))
+  {
+    return;
+  }
+  const double low[3] = { x[0] - radius, x[1] - radius, x[2] - radius };
+  const double high[3] = { x[0] + radius, x[1] + radius, x[2] + radius };
+  int lowCell[3], highCell[3];
+  this->GetCell(low, lowCell);
+  this->GetCell(high, highCell);
+  const double radius2 = radius * radius;
+  this->ForEachCellInRange(lowCell, highCell, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      if (Distance2(&this->Coordinates[3 * i], x) <= radius2)
+      {
+        ids.push_back(this->Ids[i]);
+      }
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+void LidarSpatialIndex::FindPointsInBox(const double bounds[6], std::vector<vtkIdType>& ids) const
+{
+  ids.clear();
+  if (this->Ids.empty())
+  {
+    return;
+  }
+  const double low[3] = { bounds[0], bounds[2], bounds[4] };
+  const double high[3] = { bounds[1], bounds[3], bounds[5] };
+  int lowCell[3], highCell[3];
+  this->GetCell(low, lowCell);
+  this->GetCell(high, highCell);
+  this->ForEachCellInRange(lowCell, highCell, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const double* p = &this->Coordinates[3 * i];
+      if (p[0] >= low[0] && p[0] <= high[0] && p[1] >= low[1] && p[1] <= high[1] &&
+        p[2] >= low[2] && p[2] <= high[2])
+      {
+        ids.push_back(this->Ids[i]);
+      }
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType LidarSpatialIndex::FindClosestPointToRay(
+  const double origin[3], const double direction[3], double tolerance) const
+{
+  const double norm = std::sqrt(
+    direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+  if (this->Ids.empty() || norm == 0. || !(tolerance >= 0.))
+  {
+    return -1;
+  }
+  const double u[3] = { direction[0] / norm, direction[1] / norm, direction[2] / norm };
+
+  // Part of the ray crossing the bounds of the points, grown by the tolerance
+  double tMin = 0.;
+  double tMax = std::numeric_limits<double>::max();
+  for (int i = 0; i < 3; ++i)
+  {
+    const double low = this->Bounds[2 * i] - tolerance;
+    const double high = this->Bounds[2 * i + 1] + tolerance;
+    if (u[i] == 0.)
+    {
+      if (origin[i] < low || origin[i] > high)
+      {
+        return -1;
+      }
+      continue;
+    }
+    double t0 = (low - origin[i]) / u[i];
+    double t1 = (high - origin[i]) / u[i];
+    if (t0 > t1)
+    {
+      std::swap(t0, t1);
+    }
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+  }
+  if (tMin > tMax)
+  {
+    return -1;
+  }
+
+  // March along the ray one cell at a time, looking at the cells around it
+  const int reach = static_cast<int>(std::ceil(tolerance / this->CellSize)) + 1;
+  const double tolerance2 = tolerance * tolerance;
+  std::unordered_set<Key> visited;
+  vtkIdType best = -1;
+  double bestT = std::numeric_limits<double>::max();
+  for (double t = tMin; t <= tMax + this->CellSize; t += this->CellSize)
+  {
+    // Points not visited yet are at least this far along the ray
+    if (best >= 0 && t > bestT + (reach + 1) * this->CellSize)
+    {
+      break;
+    }
+    const double p[3] = { origin[0] + t * u[0], origin[1] + t * u[1], origin[2] + t * u[2] };
+    int center[3];
+    this->GetCell(p, center);
+    int cell[3];
+    vtkIdType begin, end;
+    for (cell[0] = center[0] - reach; cell[0] <= center[0] + reach; ++cell[0])
+    {
+      for (cell[1] = center[1] - reach; cell[1] <= center[1] + reach; ++cell[1])
+      {
+        for (cell[2] = center[2] - reach; cell[2] <= center[2] + reach; ++cell[2])
+        {
+          if (!visited.insert(this->GetKey(cell)).second || !this->GetCellRange(cell, begin, end))
+          {
+            continue;
+          }
+          for (vtkIdType i = begin; i < end; ++i)
+          {
+            const double* q = &this->Coordinates[3 * i];
+            const double d[3] = { q[0] - origin[0], q[1] - origin[1], q[2] - origin[2] };
+            const double along = d[0] * u[0] + d[1] * u[1] + d[2] * u[2];
+            const double across2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - along * along;
+            if (along >= 0. && across2 <= tolerance2 && along < bestT)
+            {
+              bestT = along;
+              best = this->Ids[i];
+            }
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
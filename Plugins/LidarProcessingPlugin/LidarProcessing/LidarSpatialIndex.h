@@ -0,0 +1,104 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarSpatialIndex.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarSpatialIndex_h
+#define LidarSpatialIndex_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vtkType.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class vtkDataArray;
+class vtkPointSet;
+
+/**
+ * @class LidarSpatialIndex
+ * @brief Sparse voxel hash of the points of a frame, for interactive queries.
+ *
+ * Points are bucketed into cubic cells of CellSize: the cell keys are computed
+ * in parallel and the points sorted by key, so that each occupied cell is a
+ * contiguous range of points found by binary search. Memory only grows with
+ * the number of occupied cells, whatever the extent of the frame. Point
+ * coordinates are copied in cell order to keep the queries cache friendly.
+ *
+ * GetIndex() lazily builds and caches the index of a frame. The cache is keyed
+ * by the frame and its modification time, so a modified or new frame gets a
+ * new index.
+ */
+class LIDARPROCESSING_EXPORT LidarSpatialIndex
+{
+public:
+  /**
+   * Build the index of points, a 3 component array.
+   */
+  bool Build(vtkDataArray* points, double cellSize = 0.5);
+
+  /**
+   * Index of a frame, built on first use then kept in a small cache shared by
+   * all the callers. Returns nullptr for a frame without points.
+   */
+  static std::shared_ptr<const LidarSpatialIndex> GetIndex(vtkPointSet* frame);
+
+  vtkIdType GetNumberOfPoints() const { return static_cast<vtkIdType>(this->Ids.size()); }
+  double GetCellSize() const { return this->CellSize; }
+
+  /**
+   * Closest point to x, no farther than maxDistance. Returns -1 when there is
+   * none, the squared distance being stored in distance2 otherwise.
+   */
+  vtkIdType FindClosestPoint(
+    const double x[3], double maxDistance, double* distance2 = nullptr) const;
+
+  /**
+   * Points within radius of x, in no particular order.
+   */
+  void FindPointsWithinRadius(const double x[3], double radius, std::vector<vtkIdType>& ids) const;
+
+  /**
+   * Points inside bounds (xmin, xmax, ymin, ymax, zmin, zmax), in no particular
+   * order.
+   */
+  void FindPointsInBox(const double bounds[6], std::vector<vtkIdType>& ids) const;
+
+  /**
+   * First point along a ray, among those closer than tolerance to it: the
+   * point to snap to under the mouse cursor. Returns -1 when there is none.
+   */
+  vtkIdType FindClosestPointToRay(
+    const double origin[3], const double direction[3], double tolerance) const;
+
+private:
+  using Key = std::uint64_t;
+
+  Key GetKey(const int cell[3]) const;
+  void GetCell(const double x[3], int cell[3]) const;
+  // Range of the sorted points of a cell, empty if the cell is not occupied
+  bool GetCellRange(const int cell[3], vtkIdType& begin, vtkIdType& end) const;
+
+  template <typename Functor>
+  void ForEachCellInRange(const int low[3], const int high[3], Functor&& functor) const;
+
+  double CellSize = 0.5;
+  double Bounds[6] = { 0., 0., 0., 0., 0., 0. };
+  //! Keys of the occupied cells, sorted
+  std::vector<Key> CellKeys;
+  //! Sorted points of cell i are [CellStarts[i], CellStarts[i + 1])
+  std::vector<vtkIdType> CellStarts;
+  //! Point ids and coordinates, sorted by cell
+  std::vector<vtkIdType> Ids;
+  std::vector<double> Coordinates;
+};
+
+#endif // LidarSpatialIndex_h
@@ -0,0 +1,91 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarTaskPool.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarTaskPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+std::atomic<unsigned int> DefaultNumberOfThreads(0);
+}
+
+//-----------------------------------------------------------------------------
+LidarTaskPool& LidarTaskPool::GetInstance()
+{
+  // Never destroyed: joining threads during static destruction may deadlock
+  static LidarTaskPool* instance = new LidarTaskPool(
+    DefaultNumberOfThreads ? DefaultNumberOfThreads.load() : std::thread::hardware_concurrency());
+  return *instance;
+}
+
+//-----------------------------------------------------------------------------
+void LidarTaskPool::SetDefaultNumberOfThreads(unsigned int nbThreads)
+{
+  DefaultNumberOfThreads = nbThreads;
+}
+
+//-----------------------------------------------------------------------------
+LidarTaskPool::LidarTaskPool(unsigned int nbThreads)
+{
+  nbThreads = std::max(nbThreads, 1u);
+  this->Threads.reserve(nbThreads);
+  for (unsigned int i = 0; i < nbThreads; ++i)
+  {
+    this->Threads.emplace_back(&LidarTaskPool::Run, this);
+  }
+}
+
+//-----------------------------------------------------------------------------
+LidarTaskPool::~LidarTaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Stopping = true;
+  }
+  this->Condition.notify_all();
+  for (std::thread& thread : this->Threads)
+  {
+    thread.join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LidarTaskPool::Enqueue(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Tasks.push_back(std::move(task));
+  }
+  this->Condition.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+void LidarTaskPool::Run()
+{
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(this->Mutex);
+      this->Condition.wait(lock, [this]() { return this->Stopping || !this->Tasks.empty(); });
+      // Pending tasks are still run on destruction so that no future is left hanging
+      if (this->Tasks.empty())
+      {
+        return;
+      }
+      task = std::move(this->Tasks.front());
+      this->Tasks.pop_front();
+    }
+    task();
+  }
+}
@@ -0,0 +1,88 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarTaskPool.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarTaskPool_h
+#define LidarTaskPool_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class LidarTaskPool
+ * @brief Fixed set of worker threads running independent tasks.
+ *
+ * vtkSMPTools covers data parallel loops; this pool is meant for pipelines
+ * where the caller keeps producing work (encode a chunk, compress a frame)
+ * while previous tasks run, and consumes their results in submission order
+ * through the returned futures. Tasks must not wait on other tasks of the
+ * same pool.
+ */
+class LIDARPROCESSING_EXPORT LidarTaskPool
+{
+public:
+  /**
+   * Pool shared by the whole process, by default with one thread per
+   * hardware thread.
+   */
+  static LidarTaskPool& GetInstance();
+
+  /**
+   * Number of threads of the shared pool, 0 meaning one per hardware thread.
+   * Only effective before the first call to GetInstance().
+   */
+  static void SetDefaultNumberOfThreads(unsigned int nbThreads);
+
+  explicit LidarTaskPool(unsigned int nbThreads);
+  ~LidarTaskPool();
+
+  /**
+   * Queue a task. The future holds its result, or the exception it threw.
+   */
+  template <typename Task>
+  std::future<typename std::result_of<Task()>::type> Submit(Task&& task)
+  {
+    using Result = typename std::result_of<Task()>::type;
+    // std::function needs a copyable callable
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+    std::future<Result> result = packaged->get_future();
+    this->Enqueue([packaged]() { (*packaged)(); });
+    return result;
+  }
+
+  unsigned int GetNumberOfThreads() const
+  {
+    return static_cast<unsigned int>(this->Threads.size());
+  }
+
+private:
+  LidarTaskPool(const LidarTaskPool&) = delete;
+  void operator=(const LidarTaskPool&) = delete;
+
+  void Enqueue(std::function<void()> task);
+  void Run();
+
+  std::mutex Mutex;
+  std::condition_variable Condition;
+  std::deque<std::function<void()>> Tasks;
+  std::vector<std::thread> Threads;
+  bool Stopping = false;
+};
+
+#endif // LidarTaskPool_h
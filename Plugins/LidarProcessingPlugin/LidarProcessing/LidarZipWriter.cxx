@@ -0,0 +1,326 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarZipWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarZipWriter.h"
+
+#include <vtk_zlib.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+constexpr std::uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr std::uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+constexpr std::uint32_t END_SIGNATURE = 0x06054b50;
+constexpr std::uint32_t ZIP64_END_SIGNATURE = 0x06064b50;
+constexpr std::uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr std::uint16_t ZIP64_EXTRA_ID = 0x0001;
+constexpr std::uint16_t VERSION = 20;
+constexpr std::uint16_t ZIP64_VERSION = 45;
+// Names are UTF-8
+constexpr std::uint16_t FLAGS = 1 << 11;
+constexpr std::uint16_t STORED = 0;
+constexpr std::uint16_t DEFLATED = 8;
+constexpr std::uint32_t MAX_32 = 0xFFFFFFFF;
+constexpr std::uint16_t MAX_16 = 0xFFFF;
+// zlib processes at most 4 GiB per call
+constexpr std::size_t ZLIB_BLOCK = std::size_t(1) << 30;
+
+//-----------------------------------------------------------------------------
+void SetError(std::string* error, const std::string& message)
+{
+  if (error)
+  {
+    *error = message;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Zip is little endian, as are all the platforms LidarView runs on
+template <typename T>
+void Put(std::string& buffer, T value)
+{
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+std::uint32_t Clamp32(std::uint64_t value)
+{
+  return value >= MAX_32 ? MAX_32 : static_cast<std::uint32_t>(value);
+}
+}
+
+//-----------------------------------------------------------------------------
+LidarZipWriter::~LidarZipWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+LidarZipWriter::Entry LidarZipWriter::MakeEntry(
+  const std::string& name, const void* data, std::size_t size, bool compress)
+{
+  Entry entry;
+  entry.Name = name;
+  entry.Size = size;
+  const Bytef* bytes = static_cast<const Bytef*>(data);
+  uLong crc = crc32(0L, Z_NULL, 0);
+  for (std::size_t done = 0; done < size; done += ZLIB_BLOCK)
+  {
+    crc = crc32(crc, bytes + done, static_cast<uInt>(std::min(ZLIB_BLOCK, size - done)));
+  }
+  entry.CRC = static_cast<std::uint32_t>(crc);
+
+  if (compress && size > 0)
+  {
+    // Raw deflate stream, without the zlib header and checksum
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+          Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+      std::string compressed(deflateBound(&stream, static_cast<uLong>(size)), '\0');
+      stream.next_in = const_cast<Bytef*>(bytes);
+      stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+      int status = Z_OK;
+      std::size_t remaining = size;
+      while (status == Z_OK)
+      {
+        const uInt chunk = static_cast<uInt>(std::min(ZLIB_BLOCK, remaining));
+        stream.avail_in = chunk;
+        remaining -= chunk;
+        stream.avail_out = static_cast<uInt>(std::min<std::size_t>(
+          ZLIB_BLOCK, compressed.size() - stream.total_out));
+        status = deflate(&stream, remaining == 0 ? Z_FINISH : Z_NO_FLUSH);
+        remaining += stream.avail_in;
+      }
+      if (status == Z_STREAM_END && stream.total_out < size)
+      {
+        compressed.resize(stream.total_out);
+        entry.Data.swap(compressed);
+        entry.Deflated = true;
+      }
+      deflateEnd(&stream);
+    }
+  }
+  if (!entry.Deflated && size > 0)
+  {
+    entry.Data.assign(static_cast<const char*>(data), size);
+  }
+  return entry;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarZipWriter::Open(const std::string& fileName, std::string* error)
+{
+  this->Close();
+  this->File = std::fopen(fileName.c_str(), "wb");
+  if (!this->File)
+  {
+    SetError(error, "Unable to open " + fileName);
+    return false;
+  }
+  this->FileName = fileName;
+  this->Offset = 0;
+  this->Records.clear();
+
+  // All the entries get the time the archive was created, in MS-DOS format
+  const std::time_t now = std::time(nullptr);
+  const std::tm* local = std::localtime(&now);
+  this->Time = static_cast<std::uint16_t>(
+    (local->tm_hour << 11) | (local->tm_min << 5) | (local->tm_sec / 2));
+  this->Date = static_cast<std::uint16_t>(
+    ((std::max(local->tm_year, 80) - 80) << 9) | ((local->tm_mon + 1) << 5) | local->tm_mday);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarZipWriter::Write(const Entry& entry, std::string* error)
+{
+  if (!this->File)
+  {
+    SetError(error, "No archive opened");
+    return false;
+  }
+
+  Record record;
+  record.Name = entry.Name;
+  record.Offset = this->Offset;
+  record.CompressedSize = entry.Data.size();
+  record.Size = entry.Size;
+  record.CRC = entry.CRC;
+  record.Method = entry.Deflated ? DEFLATED : STORED;
+
+  // The sizes are known in advance: no data descriptor
+  const bool zip64 = record.Size >= MAX_32 || record.CompressedSize >= MAX_32;
+  std::string header;
+  Put(header, LOCAL_HEADER_SIGNATURE);
+  Put(header, zip64 ? ZIP64_VERSION : VERSION);
+  Put(header, FLAGS);
+  Put(header, record.Method);
+  Put(header, this->Time);
+  Put(header, this->Date);
+  Put(header, record.CRC);
+  Put(header, zip64 ? MAX_32 : static_cast<std::uint32_t>(record.CompressedSize));
+  Put(header, zip64 ? MAX_32 : static_cast<std::uint32_t>(record.Size));
+  Put(header, static_cast<std::uint16_t>(record.Name.size()));
+  Put(header, static_cast<std::uint16_t>(zip64 ? 20 : 0));
+  header += record.Name;
+  if (zip64)
+  {
+    Put(header, ZIP64_EXTRA_ID);
+    Put(header, std::uint16_t(16));
+    Put(header, record.Size);
+    Put(header, record.CompressedSize);
+  }
+
+  if (!this->WriteBytes(header) || !this->WriteBytes(entry.Data))
+  {
+    SetError(error, "Unable to write " + this->FileName);
+    return false;
+  }
+  this->Records.push_back(record);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarZipWriter::Write(
+  const std::string& name, const void* data, std::size_t size, bool compress, std::string* error)
+{
+  return this->Write(MakeEntry(name, data, size, compress), error);
+}
+
+//-----------------------------------------------------------------------------
+bool LidarZipWriter::WriteFile(
+  const std::string& name, const std::string& fileName, bool compress, std::string* error)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file)
+  {
+    SetError(error, "Unable to read " + fileName);
+    return false;
+  }
+  const std::string content(
+    (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return this->Write(name, content.data(), content.size(), compress, error);
+}
+
+//-----------------------------------------------------------------------------
+bool LidarZipWriter::WriteBytes(const std::string& bytes)
+{
+  if (std::fwrite(bytes.data(), 1, bytes.size(), this->File) != bytes.size())
+  {
+    return false;
+  }
+  this->Offset += bytes.size();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarZipWriter::Close(std::string* error)
+{
+  if (!this->File)
+  {
+    return true;
+  }
+
+  std::string directory;
+  for (const Record& record : this->Records)
+  {
+    // Zip64 extra field with only the values that do not fit
+    std::string extra;
+    if (record.Size >= MAX_32)
+    {
+      Put(extra, record.Size);
+    }
+    if (record.CompressedSize >= MAX_32)
+    {
+      Put(extra, record.CompressedSize);
+    }
+    if (record.Offset >= MAX_32)
+    {
+      Put(extra, record.Offset);
+    }
+    if (!extra.empty())
+    {
+      std::string field;
+      Put(field, ZIP64_EXTRA_ID);
+      Put(field, static_cast<std::uint16_t>(extra.size()));
+      extra = field + extra;
+    }
+
+    Put(directory, CENTRAL_HEADER_SIGNATURE);
+    Put(directory, ZIP64_VERSION);
+    Put(directory, extra.empty() ? VERSION : ZIP64_VERSION);
+    Put(directory, FLAGS);
+    Put(directory, record.Method);
+    Put(directory, this->Time);
+    Put(directory, this->Date);
+    Put(directory, record.CRC);
+    Put(directory, Clamp32(record.CompressedSize));
+    Put(directory, Clamp32(record.Size));
+    Put(directory, static_cast<std::uint16_t>(record.Name.size()));
+    Put(directory, static_cast<std::uint16_t>(extra.size()));
+    // Comment length, disk, internal and external attributes
+    Put(directory, std::uint16_t(0));
+    Put(directory, std::uint16_t(0));
+    Put(directory, std::uint16_t(0));
+    Put(directory, std::uint32_t(0));
+    Put(directory, Clamp32(record.Offset));
+    directory += record.Name;
+    directory += extra;
+  }
+
+  const std::uint64_t directoryOffset = this->Offset;
+  const std::uint64_t nbEntries = this->Records.size();
+  std::string end;
+  if (nbEntries >= MAX_16 || directoryOffset >= MAX_32 || directory.size() >= MAX_32)
+  {
+    const std::uint64_t zip64EndOffset = directoryOffset + directory.size();
+    Put(end, ZIP64_END_SIGNATURE);
+    Put(end, std::uint64_t(44));
+    Put(end, ZIP64_VERSION);
+    Put(end, ZIP64_VERSION);
+    Put(end, std::uint32_t(0));
+    Put(end, std::uint32_t(0));
+    Put(end, nbEntries);
+    Put(end, nbEntries);
+    Put(end, static_cast<std::uint64_t>(directory.size()));
+    Put(end, directoryOffset);
+    Put(end, ZIP64_LOCATOR_SIGNATURE);
+    Put(end, std::uint32_t(0));
+    Put(end, zip64EndOffset);
+    Put(end, std::uint32_t(1));
+  }
+  const std::uint16_t nbEntries16 =
+    nbEntries >= MAX_16 ? MAX_16 : static_cast<std::uint16_t>(nbEntries);
+  Put(end, END_SIGNATURE);
+  Put(end, std::uint16_t(0));
+  Put(end, std::uint16_t(0));
+  Put(end, nbEntries16);
+  Put(end, nbEntries16);
+  Put(end, Clamp32(directory.size()));
+  Put(end, Clamp32(directoryOffset));
+  Put(end, std::uint16_t(0));
+
+  bool ok = this->WriteBytes(directory) && this->WriteBytes(end);
+  ok = std::fclose(this->File) == 0 && ok;
+  this->File = nullptr;
+  this->Records.clear();
+  if (!ok)
+  {
+    SetError(error, "Unable to write " + this->FileName);
+  }
+  return ok;
+}
@@ -0,0 +1,101 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    LidarZipWriter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef LidarZipWriter_h
+#define LidarZipWriter_h
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @class LidarZipWriter
+ * @brief Minimal streaming zip archive writer.
+ *
+ * Entries are appended one after the other, either stored or deflated, and
+ * the central directory is written on Close(). Zip64 records are only added
+ * when the archive needs them (4 GiB or 65535 entries).
+ *
+ * Preparing an entry (CRC and compression) is independent from the archive:
+ * MakeEntry() may run on several threads while the entries already prepared
+ * are written in order.
+ */
+class LIDARPROCESSING_EXPORT LidarZipWriter
+{
+public:
+  struct Entry
+  {
+    std::string Name;
+    //! Data as stored in the archive
+    std::string Data;
+    std::uint64_t Size = 0;
+    std::uint32_t CRC = 0;
+    bool Deflated = false;
+  };
+
+  LidarZipWriter() = default;
+  ~LidarZipWriter();
+
+  /**
+   * Prepare an entry. Data already compressed, such as zlib compressed VTK
+   * XML files, is better stored than deflated again.
+   */
+  static Entry MakeEntry(const std::string& name, const void* data, std::size_t size,
+    bool compress);
+
+  bool Open(const std::string& fileName, std::string* error = nullptr);
+  bool Write(const Entry& entry, std::string* error = nullptr);
+  bool Write(const std::string& name, const void* data, std::size_t size, bool compress,
+    std::string* error = nullptr);
+
+  /**
+   * Add the content of a file on disk.
+   */
+  bool WriteFile(const std::string& name, const std::string& fileName, bool compress,
+    std::string* error = nullptr);
+
+  /**
+   * Write the central directory. An archive closed after an error still
+   * lists the entries written before it.
+   */
+  bool Close(std::string* error = nullptr);
+
+  bool IsOpen() const { return this->File != nullptr; }
+  std::uint64_t GetNumberOfBytesWritten() const { return this->Offset; }
+
+private:
+  LidarZipWriter(const LidarZipWriter&) = delete;
+  void operator=(const LidarZipWriter&) = delete;
+
+  struct Record
+  {
+    std::string Name;
+    std::uint64_t Offset;
+    std::uint64_t CompressedSize;
+    std::uint64_t Size;
+    std::uint32_t CRC;
+    std::uint16_t Method;
+  };
+
+  bool WriteBytes(const std::string& bytes);
+
+  std::FILE* File = nullptr;
+  std::string FileName;
+  std::uint64_t Offset = 0;
+  std::uint16_t Time = 0;
+  std::uint16_t Date = 0;
+  std::vector<Record> Records;
+};
+
+#endif // LidarZipWriter_h
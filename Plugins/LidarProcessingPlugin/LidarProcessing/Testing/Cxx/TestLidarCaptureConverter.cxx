@@ -0,0 +1,293 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    TestLidarCaptureConverter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarCaptureConverter.h"
+
+#include <vtkTestUtilities.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Little endian pcapng block writer
+class PcapngBuilder
+{
+public:
+  void AddSectionHeader()
+  {
+    this->Begin(0x0A0D0D0A);
+    this->U32(0x1A2B3C4D);
+    this->U16(1);
+    this->U16(0);
+    this->U32(0xFFFFFFFF); // unknown section length, 64 bits
+    this->U32(0xFFFFFFFF);
+    this->End();
+  }
+
+  // tsresol < 0 leaves the default microsecond resolution
+  void AddInterface(std::uint16_t linkType, int tsresol)
+  {
+    this->Begin(1);
+    this->U16(linkType);
+    this->U16(0);
+    this->U32(65535);
+    if (tsresol >= 0)
+    {
+      this->U16(9); // if_tsresol
+      this->U16(1);
+      this->Data.push_back(static_cast<unsigned char>(tsresol));
+      this->Pad();
+      this->U32(0); // opt_endofopt
+    }
+    this->End();
+  }
+
+  void AddEnhancedPacket(
+    std::uint32_t interfaceId, std::uint64_t timestamp, const std::string& payload)
+  {
+    this->Begin(6);
+    this->U32(interfaceId);
+    this->U32(static_cast<std::uint32_t>(timestamp >> 32));
+    this->U32(static_cast<std::uint32_t>(timestamp));
+    this->U32(static_cast<std::uint32_t>(payload.size()));
+    this->U32(static_cast<std::uint32_t>(payload.size()));
+    this->Data.insert(this->Data.end(), payload.begin(), payload.end());
+    this->Pad();
+    this->End();
+  }
+
+  void AddStatistics()
+  {
+    this->Begin(5);
+    this->U32(0);
+    this->U32(0);
+    this->U32(0);
+    this->End();
+  }
+
+  bool Save(const std::string& fileName, std::size_t size = 0) const
+  {
+    std::FILE* file = std::fopen(fileName.c_str(), "wb");
+    if (!file)
+    {
+      return false;
+    }
+    size = size ? size : this->Data.size();
+    const bool ok = std::fwrite(this->Data.data(), 1, size, file) == size;
+    return std::fclose(file) == 0 && ok;
+  }
+
+  std::size_t GetSize() const { return this->Data.size(); }
+
+private:
+  void U16(std::uint16_t value)
+  {
+    this->Data.push_back(static_cast<unsigned char>(value));
+    this->Data.push_back(static_cast<unsigned char>(value >> 8));
+  }
+
+  void U32(std::uint32_t value)
+  {
+    this->U16(static_cast<std::uint16_t>(value));
+    this->U16(static_cast<std::uint16_t>(value >> 16));
+  }
+
+  void Pad()
+  {
+    while (this->Data.size() % 4 != 0)
+    {
+      this->Data.push_back(0);
+    }
+  }
+
+  void Begin(std::uint32_t type)
+  {
+    this->BlockStart = this->Data.size();
+    this->U32(type);
+    this->U32(0); // length, set by End
+  }
+
+  void End()
+  {
+    const std::uint32_t length =
+      static_cast<std::uint32_t>(this->Data.size() - this->BlockStart + 4);
+    this->U32(length);
+    std::memcpy(this->Data.data() + this->BlockStart + 4, &length, sizeof(length));
+  }
+
+  std::vector<unsigned char> Data;
+  std::size_t BlockStart = 0;
+};
+
+//-----------------------------------------------------------------------------
+bool ReadFile(const std::string& fileName, std::vector<unsigned char>& content)
+{
+  content.clear();
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (!file)
+  {
+    return false;
+  }
+  unsigned char buffer[4096];
+  std::size_t nbRead;
+  while ((nbRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    content.insert(content.end(), buffer, buffer + nbRead);
+  }
+  std::fclose(file);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::uint32_t GetU32(const std::vector<unsigned char>& content, std::size_t offset)
+{
+  std::uint32_t value;
+  std::memcpy(&value, content.data() + offset, sizeof(value));
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+bool FileExists(const std::string& fileName)
+{
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (file)
+  {
+    std::fclose(file);
+  }
+  return file != nullptr;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestLidarCaptureConverter(int argc, char* argv[])
+{
+  char* tempDir =
+    vtkTestUtilities::GetArgOrEnvOrDefault("-T", argc, argv, "VTK_TEMP_DIR", "Testing/Temporary");
+  const std::string prefix = std::string(tempDir) + "/TestLidarCaptureConverter";
+  delete[] tempDir;
+  const std::string pcapngFileName = prefix + ".pcapng";
+  const std::string pcapFileName = prefix + ".pcap";
+  int status = EXIT_SUCCESS;
+
+  // Capture file names, optionally compressed
+  const char* captureNames[] = { "a.pcap", "a.pcapng", "a.pcap.gz", "a.pcapng.zst",
+    "a.pcapng.zstd" };
+  for (const char* name : captureNames)
+  {
+    if (!LidarCaptureConverter::IsCaptureFileName(name))
+    {
+      std::cerr << name << " should be a capture file name" << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  const char* otherNames[] = { "a.csv", "a.gz", "a.pcap.bz2", "pcap" };
+  for (const char* name : otherNames)
+  {
+    if (LidarCaptureConverter::IsCaptureFileName(name))
+    {
+      std::cerr << name << " should not be a capture file name" << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+
+  // Nanosecond interface, then a microsecond interface with another link type
+  // whose packets are dropped, and an ignored statistics block
+  PcapngBuilder builder;
+  builder.AddSectionHeader();
+  builder.AddInterface(1, 9);
+  builder.AddInterface(101, -1);
+  builder.AddEnhancedPacket(0, 1500000000123456789ull, "first");
+  builder.AddEnhancedPacket(1, 1500000001000000ull, "dropped");
+  builder.AddStatistics();
+  builder.AddEnhancedPacket(0, 1500000002000001000ull, "second packet");
+  if (!builder.Save(pcapngFileName))
+  {
+    std::cerr << "Unable to write " << pcapngFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (LidarCaptureConverter::DetectFormat(pcapngFileName) != LidarCaptureConverter::PCAPNG)
+  {
+    std::cerr << "The pcapng format is not detected" << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  std::string error;
+  if (!LidarCaptureConverter::ConvertPcapng(pcapngFileName, pcapFileName, &error))
+  {
+    std::cerr << "Conversion failed: " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (LidarCaptureConverter::DetectFormat(pcapFileName) != LidarCaptureConverter::PCAP)
+  {
+    std::cerr << "The pcap format is not detected" << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  // Global header, then two records with microsecond timestamps
+  std::vector<unsigned char> pcap;
+  if (!ReadFile(pcapFileName, pcap) || pcap.size() != 24 + 16 + 5 + 16 + 13)
+  {
+    std::cerr << "Unexpected pcap size " << pcap.size() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (GetU32(pcap, 0) != 0xa1b2c3d4 || GetU32(pcap, 4) != 0x00040002 || GetU32(pcap, 20) != 1)
+  {
+    std::cerr << "Unexpected pcap global header" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  struct Record
+  {
+    std::uint32_t Seconds;
+    std::uint32_t Microseconds;
+    std::string Payload;
+  };
+  const Record records[] = { { 1500000000, 123456, "first" },
+    { 1500000002, 1, "second packet" } };
+  std::size_t offset = 24;
+  for (const Record& record : records)
+  {
+    const std::uint32_t size = static_cast<std::uint32_t>(record.Payload.size());
+    if (GetU32(pcap, offset) != record.Seconds || GetU32(pcap, offset + 4) != record.Microseconds ||
+      GetU32(pcap, offset + 8) != size || GetU32(pcap, offset + 12) != size ||
+      std::memcmp(pcap.data() + offset + 16, record.Payload.data(), size) != 0)
+    {
+      std::cerr << "Unexpected record \"" << record.Payload << "\"" << std::endl;
+      status = EXIT_FAILURE;
+    }
+    offset += 16 + size;
+  }
+
+  // A truncated capture fails without leaving a partial output
+  if (!builder.Save(pcapngFileName, builder.GetSize() - 6))
+  {
+    std::cerr << "Unable to write " << pcapngFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::remove(pcapFileName.c_str());
+  error.clear();
+  if (LidarCaptureConverter::ConvertPcapng(pcapngFileName, pcapFileName, &error) ||
+    error.empty() || FileExists(pcapFileName))
+  {
+    std::cerr << "A truncated pcapng should not be converted" << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  std::remove(pcapngFileName.c_str());
+  std::remove(pcapFileName.c_str());
+  return status;
+}
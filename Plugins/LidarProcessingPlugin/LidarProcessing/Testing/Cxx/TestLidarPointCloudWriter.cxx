@@ -0,0 +1,293 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    TestLidarPointCloudWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarPointCloudWriter.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTestUtilities.h>
+#include <vtkUnsignedShortArray.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Reference LZF decompression, false on a malformed stream
+bool DecompressLZF(
+  const unsigned char* input, std::size_t size, std::vector<unsigned char>& output)
+{
+  output.clear();
+  std::size_t i = 0;
+  while (i < size)
+  {
+    const unsigned int control = input[i++];
+    if (control < 32)
+    {
+      // Literal run of control + 1 bytes
+      if (i + control + 1 > size)
+      {
+        return false;
+      }
+      output.insert(output.end(), input + i, input + i + control + 1);
+      i += control + 1;
+      continue;
+    }
+    // Back reference of length + 2 bytes
+    std::size_t length = control >> 5;
+    if (length == 7)
+    {
+      if (i >= size)
+      {
+        return false;
+      }
+      length += input[i++];
+    }
+    if (i >= size)
+    {
+      return false;
+    }
+    const std::size_t distance = ((control & 0x1f) << 8) + input[i++] + 1;
+    if (distance > output.size())
+    {
+      return false;
+    }
+    const std::size_t from = output.size() - distance;
+    for (std::size_t n = 0; n < length + 2; ++n)
+    {
+      output.push_back(output[from + n]);
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool TestLZF(const std::vector<unsigned char>& input, const char* name)
+{
+  std::vector<unsigned char> compressed(LidarPointCloudWriter::GetLZFBound(input.size()));
+  const std::size_t size =
+    LidarPointCloudWriter::CompressLZF(input.data(), input.size(), compressed.data());
+  std::vector<unsigned char> output;
+  if (size > compressed.size() || !DecompressLZF(compressed.data(), size, output) ||
+    output != input)
+  {
+    std::cerr << "LZF round trip failed for " << name << " data" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ReadFile(const std::string& fileName)
+{
+  std::string content;
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (!file)
+  {
+    return content;
+  }
+  char buffer[4096];
+  std::size_t nbRead;
+  while ((nbRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    content.append(buffer, nbRead);
+  }
+  std::fclose(file);
+  return content;
+}
+
+//-----------------------------------------------------------------------------
+// Position of the data following the header of a PLY or PCD file
+std::size_t GetDataOffset(const std::string& content, bool isPLY)
+{
+  const std::string last = isPLY ? "end_header\n" : "\nDATA ";
+  std::size_t offset = content.find(last);
+  if (offset == std::string::npos)
+  {
+    return offset;
+  }
+  offset = content.find('\n', offset + (isPLY ? 0 : 1));
+  return offset == std::string::npos ? offset : offset + 1;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestLidarPointCloudWriter(int argc, char* argv[])
+{
+  char* tempDir =
+    vtkTestUtilities::GetArgOrEnvOrDefault("-T", argc, argv, "VTK_TEMP_DIR", "Testing/Temporary");
+  const std::string prefix = std::string(tempDir) + "/TestLidarPointCloudWriter";
+  delete[] tempDir;
+  int status = EXIT_SUCCESS;
+
+  // LZF: incompressible, constant, periodic and long distance repetitions,
+  // with literal runs and matches longer than their encoding limits
+  const std::size_t size = 100000;
+  std::vector<unsigned char> random(size);
+  std::uint32_t seed = 12345;
+  for (unsigned char& value : random)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    value = static_cast<unsigned char>(seed >> 24);
+  }
+  std::vector<unsigned char> constant(size, 7);
+  std::vector<unsigned char> periodic(size);
+  std::vector<unsigned char> repeated(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    periodic[i] = static_cast<unsigned char>((i / 3) % 11);
+    repeated[i] = i < 5000 ? random[i] : repeated[i - 5000 + (i % 7 == 0 ? 1 : 0)];
+  }
+  if (!TestLZF(std::vector<unsigned char>(), "empty") ||
+    !TestLZF(std::vector<unsigned char>(random.begin(), random.begin() + 1), "single byte") ||
+    !TestLZF(random, "random") || !TestLZF(constant, "constant") ||
+    !TestLZF(periodic, "periodic") || !TestLZF(repeated, "repeated"))
+  {
+    status = EXIT_FAILURE;
+  }
+
+  // Frame with float positions and two arrays, only one of them selected
+  const vtkIdType nbPoints = 1000;
+  vtkNew<vtkPolyData> frame;
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(nbPoints);
+  vtkNew<vtkUnsignedShortArray> intensity;
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(nbPoints);
+  vtkNew<vtkDoubleArray> timestamp;
+  timestamp->SetName("timestamp");
+  timestamp->SetNumberOfTuples(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    points->SetPoint(i, 0.5 * i, -0.25 * i, 3.);
+    intensity->SetValue(i, static_cast<unsigned short>(i % 256));
+    timestamp->SetValue(i, 1e-3 * i);
+  }
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(intensity);
+  frame->GetPointData()->AddArray(timestamp);
+
+  // Queued files, then the frame is modified before Flush: the writer owns a
+  // copy of the arrays
+  const LidarPointCloudWriter::Format formats[] = { LidarPointCloudWriter::PLY,
+    LidarPointCloudWriter::PCD, LidarPointCloudWriter::PCD_COMPRESSED };
+  const char* extensions[] = { ".ply", ".pcd", ".compressed.pcd" };
+  LidarPointCloudWriter writer;
+  writer.SetArrayNames({ "intensity", "missing" });
+  for (int f = 0; f < 3; ++f)
+  {
+    writer.SetFormat(formats[f]);
+    if (!writer.WriteFrame(frame, prefix + extensions[f]))
+    {
+      std::cerr << "Queuing failed: " << writer.GetLastError() << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  std::vector<unsigned short> expectedIntensities(
+    intensity->GetPointer(0), intensity->GetPointer(0) + nbPoints);
+  std::vector<float> expectedPositions(3 * nbPoints);
+  std::memcpy(expectedPositions.data(), points->GetVoidPointer(0), 3 * nbPoints * sizeof(float));
+  intensity->FillValue(0);
+  if (!writer.Flush())
+  {
+    std::cerr << "Writing failed: " << writer.GetLastError() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::size_t rowSize = 3 * sizeof(float) + sizeof(unsigned short);
+  for (int f = 0; f < 3; ++f)
+  {
+    const std::string fileName = prefix + extensions[f];
+    const std::string content = ReadFile(fileName);
+    const bool isPLY = formats[f] == LidarPointCloudWriter::PLY;
+    const std::size_t offset = GetDataOffset(content, isPLY);
+    const std::string header = content.substr(0, offset);
+    const char* expectedHeader = isPLY
+      ? "element vertex 1000\nproperty float x\nproperty float y\nproperty float z\n"
+        "property ushort intensity\nend_header\n"
+      : "FIELDS x y z intensity\nSIZE 4 4 4 2\nTYPE F F F U\nCOUNT 1 1 1 1\n";
+    if (offset == std::string::npos || header.find(expectedHeader) == std::string::npos)
+    {
+      std::cerr << "Unexpected header of " << fileName << ":\n" << header << std::endl;
+      status = EXIT_FAILURE;
+      continue;
+    }
+
+    // Interleaved rows, or the fields one after the other once decompressed
+    std::vector<unsigned char> data(content.begin() + offset, content.end());
+    bool interleaved = true;
+    if (formats[f] == LidarPointCloudWriter::PCD_COMPRESSED)
+    {
+      std::uint32_t sizes[2] = { 0, 0 };
+      if (data.size() >= sizeof(sizes))
+      {
+        std::memcpy(sizes, data.data(), sizeof(sizes));
+      }
+      std::vector<unsigned char> fields;
+      if (data.size() != sizeof(sizes) + sizes[0] ||
+        !DecompressLZF(data.data() + sizeof(sizes), sizes[0], fields) ||
+        fields.size() != sizes[1])
+      {
+        std::cerr << "Invalid compressed data in " << fileName << std::endl;
+        status = EXIT_FAILURE;
+        continue;
+      }
+      data.swap(fields);
+      interleaved = false;
+    }
+    if (data.size() != rowSize * nbPoints)
+    {
+      std::cerr << "Unexpected data size " << data.size() << " in " << fileName << std::endl;
+      status = EXIT_FAILURE;
+      continue;
+    }
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      float position[3];
+      unsigned short value;
+      for (int c = 0; c < 3; ++c)
+      {
+        const std::size_t at =
+          interleaved ? i * rowSize + c * sizeof(float) : (c * nbPoints + i) * sizeof(float);
+        std::memcpy(position + c, data.data() + at, sizeof(float));
+      }
+      const std::size_t at = interleaved ? i * rowSize + 3 * sizeof(float)
+                                         : 3 * nbPoints * sizeof(float) + i * sizeof(value);
+      std::memcpy(&value, data.data() + at, sizeof(value));
+      if (std::memcmp(position, &expectedPositions[3 * i], sizeof(position)) != 0 ||
+        value != expectedIntensities[i])
+      {
+        std::cerr << "Unexpected point " << i << " in " << fileName << std::endl;
+        status = EXIT_FAILURE;
+        break;
+      }
+    }
+    std::remove(fileName.c_str());
+  }
+
+  // Errors are reported by Write
+  std::string error;
+  if (writer.Write(frame, prefix + "/missing/directory.ply", &error) || error.empty())
+  {
+    std::cerr << "Writing to a missing directory should fail" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
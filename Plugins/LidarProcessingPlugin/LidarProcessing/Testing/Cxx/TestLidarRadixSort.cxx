@@ -0,0 +1,94 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    TestLidarRadixSort.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarRadixSort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int TestLidarRadixSort(int, char*[])
+{
+  int status = EXIT_SUCCESS;
+  std::uint64_t seed = 11;
+  auto random = [&seed]() {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed >> 1;
+  };
+
+  // Empty, single block and many block inputs, with keys of a single digit,
+  // of a partial last digit and of 63 bits, drawn from few or many values
+  using Entry = LidarRadixSort::Entry;
+  const vtkIdType sizes[] = { 0, 1, 1000, 70000, 1 << 19 };
+  const int bits[] = { 3, 11, 23, 63 };
+  for (vtkIdType size : sizes)
+  {
+    for (int nbBits : bits)
+    {
+      const std::uint64_t mask = (std::uint64_t(1) << nbBits) - 1;
+      // Few distinct keys give long runs of equal keys
+      const std::uint64_t nbValues = size / 4 + 1;
+      std::vector<std::uint64_t> values(static_cast<std::size_t>(nbValues));
+      for (std::uint64_t& value : values)
+      {
+        value = random() & mask;
+      }
+      std::vector<Entry> entries(size);
+      for (vtkIdType i = 0; i < size; ++i)
+      {
+        entries[i].Key = values[random() % nbValues];
+        entries[i].Id = i;
+      }
+      std::vector<Entry> expected = entries;
+      std::stable_sort(expected.begin(), expected.end(),
+        [](const Entry& a, const Entry& b) { return a.Key < b.Key; });
+
+      // Stable: the ids of equal keys stay in increasing order
+      LidarRadixSort::Sort(entries, nbBits);
+      bool same = entries.size() == expected.size();
+      for (std::size_t i = 0; same && i < entries.size(); ++i)
+      {
+        same = entries[i].Key == expected[i].Key && entries[i].Id == expected[i].Id;
+      }
+      if (!same)
+      {
+        std::cerr << "Unexpected order of " << size << " entries of " << nbBits << " bits"
+                  << std::endl;
+        status = EXIT_FAILURE;
+        continue;
+      }
+
+      // Runs of the first three quarters of the entries
+      const vtkIdType nbEntries = 3 * size / 4;
+      std::vector<vtkIdType> starts;
+      std::vector<vtkIdType> expectedStarts;
+      for (vtkIdType i = 0; i < nbEntries; ++i)
+      {
+        if (i == 0 || expected[i].Key != expected[i - 1].Key)
+        {
+          expectedStarts.push_back(i);
+        }
+      }
+      expectedStarts.push_back(nbEntries);
+      LidarRadixSort::FindRuns(entries, nbEntries, starts);
+      if (starts != expectedStarts)
+      {
+        std::cerr << "Unexpected runs of " << nbEntries << " entries of " << nbBits << " bits"
+                  << std::endl;
+        status = EXIT_FAILURE;
+      }
+    }
+  }
+  return status;
+}
@@ -0,0 +1,251 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    TestLidarRangeImage.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarRangeImage.h"
+
+#include <vtkFloatArray.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+vtkIdType FindRoot(std::vector<vtkIdType>& parents, vtkIdType pixel)
+{
+  while (parents[pixel] != pixel)
+  {
+    parents[pixel] = parents[parents[pixel]];
+    pixel = parents[pixel];
+  }
+  return pixel;
+}
+
+//-----------------------------------------------------------------------------
+// Sequential flood of the masked pixels, following the ClusterPixels rules
+int ReferenceClusters(const LidarRangeImage& image, const std::vector<unsigned char>& mask,
+  double tolerance, int maxGap, std::vector<int>& clusters)
+{
+  const int width = image.GetWidth();
+  const int height = image.GetHeight();
+  const vtkIdType nbPixels = static_cast<vtkIdType>(width) * height;
+  std::vector<vtkIdType> parents(nbPixels);
+  std::iota(parents.begin(), parents.end(), 0);
+  auto connect = [&](vtkIdType pixel, vtkIdType neighbor) {
+    if (mask[neighbor] &&
+      vtkMath::Distance2BetweenPoints(image.GetPosition(pixel), image.GetPosition(neighbor)) <=
+        tolerance * tolerance)
+    {
+      parents[FindRoot(parents, pixel)] = FindRoot(parents, neighbor);
+    }
+  };
+  for (int row = 0; row < height; ++row)
+  {
+    for (int column = 0; column < width; ++column)
+    {
+      const vtkIdType pixel = image.GetPixel(row, column);
+      if (!mask[pixel])
+      {
+        continue;
+      }
+      // First occupied pixel after this one along its row and its column
+      for (int step = 1; step <= maxGap + 1; ++step)
+      {
+        const vtkIdType next = image.GetPixel(row, (column + step) % width);
+        if (image.GetPointId(next) >= 0)
+        {
+          connect(pixel, next);
+          break;
+        }
+      }
+      for (int step = 1; step <= maxGap + 1 && row + step < height; ++step)
+      {
+        const vtkIdType next = image.GetPixel(row + step, column);
+        if (image.GetPointId(next) >= 0)
+        {
+          connect(pixel, next);
+          break;
+        }
+      }
+    }
+  }
+
+  // Numbered in the order of their first pixel
+  clusters.assign(nbPixels, -1);
+  std::vector<int> rootClusters(nbPixels, -1);
+  int nbClusters = 0;
+  for (vtkIdType pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    if (mask[pixel])
+    {
+      int& cluster = rootClusters[FindRoot(parents, pixel)];
+      if (cluster < 0)
+      {
+        cluster = nbClusters++;
+      }
+      clusters[pixel] = cluster;
+    }
+  }
+  return nbClusters;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestLidarRangeImage(int, char*[])
+{
+  int status = EXIT_SUCCESS;
+
+  // Scan of 40 lasers over 512 columns, the laser ids shuffled in elevation,
+  // with missing returns and a second, farther return in some pixels
+  const int nbLasers = 40;
+  const int nbColumns = 512;
+  vtkNew<vtkFloatArray> points;
+  points->SetNumberOfComponents(3);
+  vtkNew<vtkIntArray> laserIds;
+  std::uint32_t seed = 3;
+  auto random = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+  };
+  for (int laser = 0; laser < nbLasers; ++laser)
+  {
+    const double elevation = vtkMath::RadiansFromDegrees(-20. + laser);
+    for (int column = 0; column < nbColumns; ++column)
+    {
+      if (random() % 10 == 0)
+      {
+        continue;
+      }
+      const double azimuth = -vtkMath::Pi() + (column + 0.5) * 2. * vtkMath::Pi() / nbColumns;
+      // Bands of objects at different ranges, with some noise
+      const double base = 8. + 4. * ((column / 24 + laser / 10) % 3);
+      const int nbReturns = random() % 8 == 0 ? 2 : 1;
+      for (int r = 0; r < nbReturns; ++r)
+      {
+        const double range = base + 0.4 * (random() % 100) / 100. + 3. * r;
+        points->InsertNextTuple3(range * std::cos(elevation) * std::cos(azimuth),
+          range * std::cos(elevation) * std::sin(azimuth), range * std::sin(elevation));
+        laserIds->InsertNextValue((laser * 7) % nbLasers);
+      }
+    }
+  }
+
+  LidarRangeImage image;
+  image.SetNumberOfColumns(nbColumns);
+  std::string error;
+  if (!image.Build(points, laserIds, nullptr, &error) || image.GetHeight() != nbLasers)
+  {
+    std::cerr << "Unable to build the image: " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (int row = 0; row < nbLasers; ++row)
+  {
+    if (image.GetRowLaser(row) != (row * 7) % nbLasers)
+    {
+      std::cerr << "Unexpected laser of row " << row << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+
+  // Occupied pixels, some of them masked out
+  const vtkIdType nbPixels = image.GetNumberOfPixels();
+  std::vector<unsigned char> mask(nbPixels);
+  for (vtkIdType pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    mask[pixel] = image.GetPointId(pixel) >= 0 && random() % 6 != 0 ? 1 : 0;
+  }
+
+  std::vector<int> clusters;
+  std::vector<int> expected;
+  for (int maxGap : { 0, 1, 2, 5 })
+  {
+    for (double tolerance : { 0.3, 0.6, 2. })
+    {
+      const int nbClusters = image.ClusterPixels(mask.data(), tolerance, maxGap, clusters);
+      const int nbExpected = ReferenceClusters(image, mask, tolerance, maxGap, expected);
+      if (nbClusters != nbExpected || clusters != expected)
+      {
+        std::cerr << "ClusterPixels found " << nbClusters << " clusters instead of "
+                  << nbExpected << " with a gap of " << maxGap << " and a tolerance of "
+                  << tolerance << std::endl;
+        status = EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Point clusters are the pixel clusters of the masked points, the small
+  // ones dropped, numbered in the order of their first point
+  const vtkIdType nbPoints = points->GetNumberOfTuples();
+  std::vector<unsigned char> pointMask(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    pointMask[i] = random() % 6 != 0 ? 1 : 0;
+  }
+  for (vtkIdType pixel = 0; pixel < nbPixels; ++pixel)
+  {
+    const vtkIdType pointId = image.GetPointId(pixel);
+    mask[pixel] = pointId >= 0 && pointMask[pointId] ? 1 : 0;
+  }
+  const vtkIdType minSize = 5;
+  ReferenceClusters(image, mask, 0.6, 1, expected);
+  std::vector<vtkIdType> sizes(nbPixels, 0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    const vtkIdType pixel = image.GetPointPixel(i);
+    if (pixel >= 0 && pointMask[i] && expected[pixel] >= 0)
+    {
+      sizes[expected[pixel]]++;
+    }
+  }
+  std::vector<int> renumbered(nbPixels, -1);
+  int nbExpected = 0;
+  std::vector<int> pointClusters(nbPoints);
+  const int nbClusters =
+    image.ClusterPoints(pointMask.data(), 0.6, 1, minSize, pointClusters.data());
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    const vtkIdType pixel = image.GetPointPixel(i);
+    int cluster = pixel >= 0 && pointMask[i] ? expected[pixel] : -1;
+    if (cluster >= 0 && sizes[cluster] >= minSize)
+    {
+      if (renumbered[cluster] < 0)
+      {
+        renumbered[cluster] = nbExpected++;
+      }
+      cluster = renumbered[cluster];
+    }
+    else
+    {
+      cluster = -1;
+    }
+    if (pointClusters[i] != cluster)
+    {
+      std::cerr << "Unexpected cluster " << pointClusters[i] << " of point " << i << std::endl;
+      status = EXIT_FAILURE;
+      break;
+    }
+  }
+  if (nbClusters != nbExpected || nbExpected == 0)
+  {
+    std::cerr << "ClusterPoints found " << nbClusters << " clusters instead of " << nbExpected
+              << std::endl;
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
@@ -0,0 +1,233 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    TestLidarSpatialIndex.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarSpatialIndex.h"
+
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Deterministic uniform values in [low, high)
+class RandomSequence
+{
+public:
+  double Next(double low, double high)
+  {
+    this->Seed = this->Seed * 6364136223846793005ull + 1442695040888963407ull;
+    return low + (high - low) * static_cast<double>(this->Seed >> 11) / 9007199254740992.;
+  }
+
+private:
+  std::uint64_t Seed = 7;
+};
+
+//-----------------------------------------------------------------------------
+double Distance2(const double a[3], const double b[3])
+{
+  const double dx = a[0] - b[0];
+  const double dy = a[1] - b[1];
+  const double dz = a[2] - b[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+//-----------------------------------------------------------------------------
+// Distance of p along the ray, and squared distance to it
+double GetAlong(const double p[3], const double origin[3], const double direction[3],
+  double& across2)
+{
+  const double norm = std::sqrt(
+    direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+  const double u[3] = { direction[0] / norm, direction[1] / norm, direction[2] / norm };
+  const double d[3] = { p[0] - origin[0], p[1] - origin[1], p[2] - origin[2] };
+  const double along = d[0] * u[0] + d[1] * u[1] + d[2] * u[2];
+  across2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - along * along;
+  return along;
+}
+
+//-----------------------------------------------------------------------------
+bool SameIds(std::vector<vtkIdType> ids, std::vector<vtkIdType> expected)
+{
+  std::sort(ids.begin(), ids.end());
+  std::sort(expected.begin(), expected.end());
+  return ids == expected;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestLidarSpatialIndex(int, char*[])
+{
+  int status = EXIT_SUCCESS;
+
+  // Points of a street sized scene, with duplicates and a far away outlier
+  RandomSequence random;
+  const vtkIdType nbPoints = 20000;
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(nbPoints);
+  std::vector<double> coordinates(3 * nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    double* p = &coordinates[3 * i];
+    if (i % 100 == 1)
+    {
+      points->GetPoint(i - 1, p);
+    }
+    else if (i == nbPoints - 1)
+    {
+      p[0] = 500.;
+      p[1] = -300.;
+      p[2] = 10.;
+    }
+    else
+    {
+      p[0] = random.Next(-20., 20.);
+      p[1] = random.Next(-20., 20.);
+      p[2] = random.Next(-2., 2.);
+    }
+    points->SetPoint(i, p);
+    // Coordinates as stored by the float array
+    points->GetPoint(i, p);
+  }
+
+  LidarSpatialIndex index;
+  if (!index.Build(points->GetData(), 0.5) || index.GetNumberOfPoints() != nbPoints)
+  {
+    std::cerr << "Unable to build the index" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<vtkIdType> ids;
+  std::vector<vtkIdType> expected;
+  for (int q = 0; q < 200; ++q)
+  {
+    const double x[3] = { random.Next(-25., 25.), random.Next(-25., 25.), random.Next(-3., 3.) };
+
+    // Closest point, the smallest id among the equally close ones
+    for (double maxDistance : { 0.3, 1.5, 1000. })
+    {
+      vtkIdType best = -1;
+      double bestDistance2 = maxDistance * maxDistance;
+      for (vtkIdType i = 0; i < nbPoints; ++i)
+      {
+        const double d2 = Distance2(&coordinates[3 * i], x);
+        if (d2 < bestDistance2 || (d2 == bestDistance2 && best < 0))
+        {
+          bestDistance2 = d2;
+          best = i;
+        }
+      }
+      double distance2 = -1.;
+      const vtkIdType closest = index.FindClosestPoint(x, maxDistance, &distance2);
+      if (closest != best || (best >= 0 && distance2 != bestDistance2))
+      {
+        std::cerr << "FindClosestPoint returned " << closest << " instead of " << best
+                  << " within " << maxDistance << std::endl;
+        status = EXIT_FAILURE;
+      }
+    }
+
+    // Points within a radius
+    const double radius = q % 2 ? 0.7 : 3.;
+    expected.clear();
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      if (Distance2(&coordinates[3 * i], x) <= radius * radius)
+      {
+        expected.push_back(i);
+      }
+    }
+    index.FindPointsWithinRadius(x, radius, ids);
+    if (!SameIds(ids, expected))
+    {
+      std::cerr << "FindPointsWithinRadius found " << ids.size() << " points instead of "
+                << expected.size() << std::endl;
+      status = EXIT_FAILURE;
+    }
+
+    // Points in a box, small or larger than the scene
+    const double size = q % 2 ? 1.3 : 600.;
+    const double bounds[6] = { x[0] - size, x[0] + 0.5 * size, x[1] - 0.5 * size, x[1] + size,
+      x[2] - 1., x[2] + 1. };
+    expected.clear();
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      const double* p = &coordinates[3 * i];
+      if (p[0] >= bounds[0] && p[0] <= bounds[1] && p[1] >= bounds[2] && p[1] <= bounds[3] &&
+        p[2] >= bounds[4] && p[2] <= bounds[5])
+      {
+        expected.push_back(i);
+      }
+    }
+    index.FindPointsInBox(bounds, ids);
+    if (!SameIds(ids, expected))
+    {
+      std::cerr << "FindPointsInBox found " << ids.size() << " points instead of "
+                << expected.size() << std::endl;
+      status = EXIT_FAILURE;
+    }
+
+    // First point along a ray from above the scene, looking down
+    const double origin[3] = { x[0], x[1], 30. };
+    const double direction[3] = { random.Next(-0.2, 0.2), random.Next(-0.2, 0.2), -1. };
+    const double tolerance = 0.2;
+    vtkIdType first = -1;
+    double firstAlong = std::numeric_limits<double>::max();
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      double across2;
+      const double along = GetAlong(&coordinates[3 * i], origin, direction, across2);
+      if (along >= 0. && across2 <= tolerance * tolerance && along < firstAlong)
+      {
+        firstAlong = along;
+        first = i;
+      }
+    }
+    const vtkIdType hit = index.FindClosestPointToRay(origin, direction, tolerance);
+    double across2;
+    if ((hit >= 0) != (first >= 0) ||
+      (hit >= 0 && GetAlong(&coordinates[3 * hit], origin, direction, across2) != firstAlong))
+    {
+      std::cerr << "FindClosestPointToRay returned " << hit << " instead of " << first
+                << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+
+  // The cached index follows the modifications of the frame
+  vtkNew<vtkPolyData> frame;
+  if (LidarSpatialIndex::GetIndex(frame))
+  {
+    std::cerr << "A frame without points should not have an index" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  frame->SetPoints(points);
+  auto firstIndex = LidarSpatialIndex::GetIndex(frame);
+  auto secondIndex = LidarSpatialIndex::GetIndex(frame);
+  frame->Modified();
+  auto thirdIndex = LidarSpatialIndex::GetIndex(frame);
+  if (!firstIndex || firstIndex != secondIndex || !thirdIndex || thirdIndex == firstIndex ||
+    thirdIndex->GetNumberOfPoints() != nbPoints)
+  {
+    std::cerr << "Unexpected cached indices" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
@@ -0,0 +1,257 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    TestLidarZipWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "LidarZipWriter.h"
+
+#include <vtkTestUtilities.h>
+#include <vtk_zlib.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+std::string ReadFile(const std::string& fileName)
+{
+  std::string content;
+  std::FILE* file = std::fopen(fileName.c_str(), "rb");
+  if (!file)
+  {
+    return content;
+  }
+  char buffer[4096];
+  std::size_t nbRead;
+  while ((nbRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    content.append(buffer, nbRead);
+  }
+  std::fclose(file);
+  return content;
+}
+
+//-----------------------------------------------------------------------------
+bool WriteFile(const std::string& fileName, const std::string& content)
+{
+  std::FILE* file = std::fopen(fileName.c_str(), "wb");
+  if (!file)
+  {
+    return false;
+  }
+  const bool ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+T Get(const std::string& buffer, std::size_t offset)
+{
+  T value = 0;
+  if (offset + sizeof(T) <= buffer.size())
+  {
+    std::memcpy(&value, buffer.data() + offset, sizeof(T));
+  }
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+bool Inflate(const std::string& input, std::size_t size, std::string& output)
+{
+  output.assign(size, '\0');
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+  {
+    return false;
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  stream.avail_out = static_cast<uInt>(output.size());
+  const int status = inflate(&stream, Z_FINISH);
+  const bool ok = status == Z_STREAM_END && stream.total_out == size;
+  inflateEnd(&stream);
+  return ok;
+}
+
+//-----------------------------------------------------------------------------
+struct ExpectedEntry
+{
+  std::string Name;
+  std::string Data;
+  bool Deflated;
+};
+
+//-----------------------------------------------------------------------------
+// Check the entries listed by the central directory against their local
+// headers and their expected content
+bool CheckArchive(const std::string& fileName, const std::vector<ExpectedEntry>& expected)
+{
+  const std::string archive = ReadFile(fileName);
+  const std::size_t endOffset = archive.size() < 22 ? 0 : archive.size() - 22;
+  if (Get<std::uint32_t>(archive, endOffset) != 0x06054b50 ||
+    Get<std::uint16_t>(archive, endOffset + 10) != expected.size())
+  {
+    std::cerr << "Invalid end of central directory in " << fileName << std::endl;
+    return false;
+  }
+  std::size_t offset = Get<std::uint32_t>(archive, endOffset + 16);
+  for (const ExpectedEntry& entry : expected)
+  {
+    const std::uint16_t method = Get<std::uint16_t>(archive, offset + 10);
+    const std::uint32_t crc = Get<std::uint32_t>(archive, offset + 16);
+    const std::uint32_t compressedSize = Get<std::uint32_t>(archive, offset + 20);
+    const std::uint32_t size = Get<std::uint32_t>(archive, offset + 24);
+    const std::uint16_t nameSize = Get<std::uint16_t>(archive, offset + 28);
+    const std::size_t headerOffset = Get<std::uint32_t>(archive, offset + 42);
+    if (Get<std::uint32_t>(archive, offset) != 0x02014b50 ||
+      archive.compare(offset + 46, nameSize, entry.Name) != 0 ||
+      method != (entry.Deflated ? 8 : 0) || size != entry.Data.size() ||
+      crc != crc32(0L, reinterpret_cast<const Bytef*>(entry.Data.data()),
+               static_cast<uInt>(entry.Data.size())))
+    {
+      std::cerr << "Invalid central header of " << entry.Name << std::endl;
+      return false;
+    }
+    offset += 46 + nameSize + Get<std::uint16_t>(archive, offset + 30) +
+      Get<std::uint16_t>(archive, offset + 32);
+
+    const std::size_t dataOffset = headerOffset + 30 +
+      Get<std::uint16_t>(archive, headerOffset + 26) +
+      Get<std::uint16_t>(archive, headerOffset + 28);
+    if (Get<std::uint32_t>(archive, headerOffset) != 0x04034b50 ||
+      Get<std::uint32_t>(archive, headerOffset + 14) != crc ||
+      Get<std::uint32_t>(archive, headerOffset + 18) != compressedSize ||
+      dataOffset + compressedSize > archive.size())
+    {
+      std::cerr << "Invalid local header of " << entry.Name << std::endl;
+      return false;
+    }
+    std::string data = archive.substr(dataOffset, compressedSize);
+    if (entry.Deflated)
+    {
+      std::string inflated;
+      if (!Inflate(data, size, inflated))
+      {
+        std::cerr << "Unable to inflate " << entry.Name << std::endl;
+        return false;
+      }
+      data.swap(inflated);
+    }
+    if (data != entry.Data)
+    {
+      std::cerr << "Unexpected content of " << entry.Name << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestLidarZipWriter(int argc, char* argv[])
+{
+  char* tempDir =
+    vtkTestUtilities::GetArgOrEnvOrDefault("-T", argc, argv, "VTK_TEMP_DIR", "Testing/Temporary");
+  const std::string prefix = std::string(tempDir) + "/TestLidarZipWriter";
+  delete[] tempDir;
+  const std::string zipFileName = prefix + ".zip";
+  const std::string inputFileName = prefix + ".txt";
+  int status = EXIT_SUCCESS;
+
+  std::string text;
+  for (int i = 0; i < 1000; ++i)
+  {
+    text += "frame " + std::to_string(i % 10) + " of the capture\n";
+  }
+  std::string noise(4096, '\0');
+  std::uint32_t seed = 42;
+  for (char& c : noise)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    c = static_cast<char>(seed >> 24);
+  }
+  if (!WriteFile(inputFileName, text))
+  {
+    std::cerr << "Unable to write " << inputFileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Stored, deflated, incompressible data falling back to stored, an empty
+  // entry, and the content of a file prepared apart from the archive
+  const std::vector<ExpectedEntry> expected = { { "stored.txt", text, false },
+    { "deflated.txt", text, true }, { "noise.bin", noise, false }, { "dir/empty", "", false },
+    { "file.txt", text, true } };
+  const LidarZipWriter::Entry prepared =
+    LidarZipWriter::MakeEntry("deflated.txt", text.data(), text.size(), true);
+  std::string error;
+  LidarZipWriter writer;
+  if (!writer.Open(zipFileName, &error) ||
+    !writer.Write("stored.txt", text.data(), text.size(), false, &error) ||
+    !writer.Write(prepared, &error) ||
+    !writer.Write("noise.bin", noise.data(), noise.size(), true, &error) ||
+    !writer.Write("dir/empty", nullptr, 0, true, &error) ||
+    !writer.WriteFile("file.txt", inputFileName, true, &error) || !writer.Close(&error))
+  {
+    std::cerr << "Writing failed: " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (writer.IsOpen() || !CheckArchive(zipFileName, expected))
+  {
+    status = EXIT_FAILURE;
+  }
+
+  // More than 65535 entries need the zip64 end of central directory
+  const std::uint32_t nbEntries = 70000;
+  if (!writer.Open(zipFileName, &error))
+  {
+    std::cerr << "Opening failed: " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (std::uint32_t i = 0; i < nbEntries; ++i)
+  {
+    if (!writer.Write(std::to_string(i), nullptr, 0, false, &error))
+    {
+      std::cerr << "Writing failed: " << error << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  writer.Close();
+  const std::string archive = ReadFile(zipFileName);
+  const std::size_t endOffset = archive.size() - 22;
+  const std::size_t zip64EndOffset = endOffset - 20 - 56;
+  if (Get<std::uint16_t>(archive, endOffset + 10) != 0xFFFF ||
+    Get<std::uint32_t>(archive, zip64EndOffset) != 0x06064b50 ||
+    Get<std::uint64_t>(archive, zip64EndOffset + 32) != nbEntries ||
+    Get<std::uint32_t>(archive, endOffset - 20) != 0x07064b50 ||
+    Get<std::uint64_t>(archive, endOffset - 12) != zip64EndOffset)
+  {
+    std::cerr << "Invalid zip64 end of central directory" << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  // Writing without an archive fails
+  error.clear();
+  if (writer.Write("closed", text.data(), text.size(), false, &error) || error.empty())
+  {
+    std::cerr << "Writing to a closed archive should fail" << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  std::remove(zipFileName.c_str());
+  std::remove(inputFileName.c_str());
+  return status;
+}
@@ -0,0 +1,293 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarAdvancedArrays.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarAdvancedArrays.h"
+
+#include "LidarFrameCache.h"
+
+#include <vtkDataArraySelection.h>
+#include <vtkDemandDrivenPipeline.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+
+vtkStandardNewMacro(vtkLidarAdvancedArrays)
+
+namespace
+{
+enum AdvancedArray
+{
+  AZIMUTH = 0,
+  ELEVATION,
+  RANGE,
+  RANGE_XY,
+  RELATIVE_TIME,
+  NUMBER_OF_ADVANCED_ARRAYS
+};
+
+const char* ADVANCED_ARRAY_NAMES[NUMBER_OF_ADVANCED_ARRAYS] = { "azimuth_deg", "elevation_deg",
+  "range_m", "range_xy_m", "relative_time" };
+
+//-----------------------------------------------------------------------------
+template <typename T>
+struct GeometricArrayWorker
+{
+  const T* Points;
+  int Array;
+  float* Output;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    const double radToDeg = vtkMath::DegreesFromRadians(1.);
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const double x = this->Points[3 * i];
+      const double y = this->Points[3 * i + 1];
+      const double z = this->Points[3 * i + 2];
+      double value = 0.;
+      switch (this->Array)
+      {
+        case AZIMUTH:
+          value = std::atan2(y, x) * radToDeg;
+          value = value < 0. ? value + 360. : value;
+          break;
+        case ELEVATION:
+          value = std::atan2(z, std::sqrt(x * x + y * y)) * radToDeg;
+          break;
+        case RANGE:
+          value = std::sqrt(x * x + y * y + z * z);
+          break;
+        case RANGE_XY:
+          value = std::sqrt(x * x + y * y);
+          break;
+      }
+      this->Output[i] = static_cast<float>(value);
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray> ComputeGeometricArray(vtkPolyData* frame, int array)
+{
+  const vtkIdType nbPoints = frame->GetNumberOfPoints();
+  auto output = vtkSmartPointer<vtkFloatArray>::New();
+  output->SetNumberOfValues(nbPoints);
+  if (nbPoints == 0)
+  {
+    return output;
+  }
+
+  vtkDataArray* points = frame->GetPoints()->GetData();
+  if (auto floatPoints = vtkFloatArray::FastDownCast(points))
+  {
+    GeometricArrayWorker<float> worker{ floatPoints->GetPointer(0), array, output->GetPointer(0) };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  else
+  {
+    vtkNew<vtkDoubleArray> doublePoints;
+    if (auto inputDoublePoints = vtkDoubleArray::FastDownCast(points))
+    {
+      doublePoints->ShallowCopy(inputDoublePoints);
+    }
+    else
+    {
+      doublePoints->DeepCopy(points);
+    }
+    GeometricArrayWorker<double> worker{ doublePoints->GetPointer(0), array,
+      output->GetPointer(0) };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  return output;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray> ComputeRelativeTime(vtkPolyData* frame, const char* timestampName)
+{
+  vtkDataArray* timestamps =
+    timestampName ? frame->GetPointData()->GetArray(timestampName) : nullptr;
+  if (!timestamps || timestamps->GetNumberOfComponents() != 1)
+  {
+    return nullptr;
+  }
+  const vtkIdType nbPoints = timestamps->GetNumberOfTuples();
+  auto output = vtkSmartPointer<vtkDoubleArray>::New();
+  output->SetNumberOfValues(nbPoints);
+  const double first = nbPoints > 0 ? timestamps->GetRange(0)[0] : 0.;
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    output->SetValue(i, timestamps->GetComponent(i, 0) - first);
+  }
+  return output;
+}
+}
+
+//-----------------------------------------------------------------------------
+struct vtkLidarAdvancedArrays::vtkInternals
+{
+  // Keyed on the time step: replaying a frame gives a new data object
+  LidarFrameCache<double, std::map<std::string, vtkSmartPointer<vtkDataArray>>> Cache;
+  // The cached frames are stale when the pipeline upstream changed, and the
+  // relative times when the timestamp array changed
+  vtkMTimeType UpstreamTime = 0;
+  std::string TimestampArrayName;
+};
+
+//-----------------------------------------------------------------------------
+vtkLidarAdvancedArrays::vtkLidarAdvancedArrays()
+  : Internals(new vtkInternals)
+{
+  for (const char* name : ADVANCED_ARRAY_NAMES)
+  {
+    this->PointArraySelection->AddArray(name, false);
+  }
+  this->SetTimestampArrayName("timestamp");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarAdvancedArrays::~vtkLidarAdvancedArrays()
+{
+  this->SetTimestampArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarAdvancedArrays::GetNumberOfPointArrays()
+{
+  return this->PointArraySelection->GetNumberOfArrays();
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkLidarAdvancedArrays::GetPointArrayName(int index)
+{
+  return this->PointArraySelection->GetArrayName(index);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarAdvancedArrays::GetPointArrayStatus(const char* name)
+{
+  return this->PointArraySelection->ArrayIsEnabled(name);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarAdvancedArrays::SetPointArrayStatus(const char* name, int status)
+{
+  if (status)
+  {
+    this->PointArraySelection->EnableArray(name);
+  }
+  else
+  {
+    this->PointArraySelection->DisableArray(name);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarAdvancedArrays::SetCacheSize(int size)
+{
+  // Only the memory used changes, not the output: the pipeline is not modified
+  this->Internals->Cache.SetCapacity(static_cast<std::size_t>(std::max(size, 1)));
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarAdvancedArrays::GetCacheSize()
+{
+  return static_cast<int>(this->Internals->Cache.GetCapacity());
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarAdvancedArrays::GetMTime()
+{
+  return std::max(this->Superclass::GetMTime(), this->PointArraySelection->GetMTime());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarAdvancedArrays::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+
+  output->ShallowCopy(input);
+
+  // Without time step, the input itself is the only frame cached
+  vtkInformation* inputInfo = input->GetInformation();
+  const bool hasTimeStep = inputInfo->Has(vtkDataObject::DATA_TIME_STEP());
+  auto executive = vtkDemandDrivenPipeline::SafeDownCast(this->GetInputExecutive(0, 0));
+  const vtkMTimeType upstreamTime =
+    hasTimeStep && executive ? executive->GetPipelineMTime() : input->GetMTime();
+  const std::string timestampName = this->TimestampArrayName ? this->TimestampArrayName : "";
+  vtkInternals& internals = *this->Internals;
+  if (internals.UpstreamTime != upstreamTime || internals.TimestampArrayName != timestampName)
+  {
+    internals.Cache.Clear();
+    internals.UpstreamTime = upstreamTime;
+    internals.TimestampArrayName = timestampName;
+  }
+
+  auto& arrays =
+    internals.Cache.Get(hasTimeStep ? inputInfo->Get(vtkDataObject::DATA_TIME_STEP()) : 0.);
+  for (int i = 0; i < NUMBER_OF_ADVANCED_ARRAYS; ++i)
+  {
+    const char* name = ADVANCED_ARRAY_NAMES[i];
+    if (!this->PointArraySelection->ArrayIsEnabled(name))
+    {
+      continue;
+    }
+
+    auto it = arrays.find(name);
+    if (it == arrays.end())
+    {
+      vtkSmartPointer<vtkDataArray> array = (i == RELATIVE_TIME)
+        ? ComputeRelativeTime(input, this->TimestampArrayName)
+        : ComputeGeometricArray(input, i);
+      if (!array)
+      {
+        vtkWarningMacro(<< "Unable to compute " << name << ", missing timestamp array \""
+                        << (this->TimestampArrayName ? this->TimestampArrayName : "") << "\"");
+        continue;
+      }
+      array->SetName(name);
+      it = arrays.emplace(name, array).first;
+    }
+    output->GetPointData()->AddArray(it->second);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarAdvancedArrays::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "TimestampArrayName: "
+     << (this->TimestampArrayName ? this->TimestampArrayName : "(none)") << endl;
+  os << indent << "CacheSize: " << this->GetCacheSize() << endl;
+  os << indent << "CacheHits: " << this->Internals->Cache.GetNumberOfHits() << endl;
+  os << indent << "CacheMisses: " << this->Internals->Cache.GetNumberOfMisses() << endl;
+  os << indent << "PointArraySelection:" << endl;
+  this->PointArraySelection->PrintSelf(os, indent.GetNextIndent());
+}
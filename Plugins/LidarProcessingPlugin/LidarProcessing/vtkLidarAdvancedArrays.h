@@ -0,0 +1,96 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarAdvancedArrays.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarAdvancedArrays_h
+#define vtkLidarAdvancedArrays_h
+
+#include <vtkNew.h>
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <memory>
+
+class vtkDataArraySelection;
+
+/**
+ * @class vtkLidarAdvancedArrays
+ * @brief Compute advanced per point arrays on demand.
+ *
+ * Each array is computed only when it is enabled in the array selection,
+ * so that the frames only carry the arrays that are actually used for
+ * coloring, inspection in the spreadsheet or export. Computed arrays are kept
+ * in a per frame cache, keyed on the time step of the frame: enabling another
+ * array, or going back to a frame still in the cache, does not recompute the
+ * arrays already available. The cache is cleared when the pipeline upstream
+ * is modified.
+ *
+ * Available arrays:
+ *  - azimuth_deg: azimuth from the +X axis, in [0, 360[ degrees
+ *  - elevation_deg: elevation above the XY plane, in degrees
+ *  - range_m: distance to the sensor
+ *  - range_xy_m: distance to the sensor in the XY plane
+ *  - relative_time: timestamp relative to the first point of the frame
+ */
+class LIDARPROCESSING_EXPORT vtkLidarAdvancedArrays : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarAdvancedArrays* New();
+  vtkTypeMacro(vtkLidarAdvancedArrays, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Selection of the arrays to compute. All are disabled by default.
+   */
+  vtkDataArraySelection* GetPointArraySelection() { return this->PointArraySelection; }
+  int GetNumberOfPointArrays();
+  const char* GetPointArrayName(int index);
+  int GetPointArrayStatus(const char* name);
+  void SetPointArrayStatus(const char* name, int status);
+  //@}
+
+  //@{
+  /**
+   * Name of the timestamp array used by relative_time. Default is "timestamp".
+   */
+  vtkSetStringMacro(TimestampArrayName);
+  vtkGetStringMacro(TimestampArrayName);
+  //@}
+
+  //@{
+  /**
+   * Number of frames whose arrays are kept in the cache. Default is 16.
+   */
+  void SetCacheSize(int size);
+  int GetCacheSize();
+  //@}
+
+  vtkMTimeType GetMTime() override;
+
+protected:
+  vtkLidarAdvancedArrays();
+  ~vtkLidarAdvancedArrays() override;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  vtkNew<vtkDataArraySelection> PointArraySelection;
+  char* TimestampArrayName = nullptr;
+
+private:
+  vtkLidarAdvancedArrays(const vtkLidarAdvancedArrays&) = delete;
+  void operator=(const vtkLidarAdvancedArrays&) = delete;
+
+  struct vtkInternals;
+  std::unique_ptr<vtkInternals> Internals;
+};
+
+#endif // vtkLidarAdvancedArrays_h
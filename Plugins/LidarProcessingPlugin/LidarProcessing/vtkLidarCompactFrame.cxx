@@ -0,0 +1,222 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarCompactFrame.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarCompactFrame.h"
+
+#include "LidarCompactFrame.h"
+#include "LidarFrameBufferPool.h"
+#include "LidarPoseStore.h"
+#include "LidarSharedVertices.h"
+
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkLinearTransform.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <new>
+
+vtkStandardNewMacro(vtkLidarCompactFrame)
+vtkCxxSetObjectMacro(vtkLidarCompactFrame, Transform, vtkLinearTransform)
+vtkCxxSetObjectMacro(vtkLidarCompactFrame, PoseTransform, vtkLinearTransform)
+
+//-----------------------------------------------------------------------------
+vtkLidarCompactFrame::vtkLidarCompactFrame()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetPoseTimeArrayName("time");
+  this->SetPoseQuaternionArrayName("orientation");
+  this->SetPoseRollArrayName("roll");
+  this->SetPosePitchArrayName("pitch");
+  this->SetPoseYawArrayName("yaw");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarCompactFrame::~vtkLidarCompactFrame()
+{
+  this->SetTransform(nullptr);
+  this->SetPoseTransform(nullptr);
+  this->SetPoseTimeArrayName(nullptr);
+  this->SetPoseQuaternionArrayName(nullptr);
+  this->SetPoseRollArrayName(nullptr);
+  this->SetPosePitchArrayName(nullptr);
+  this->SetPoseYawArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarCompactFrame::FillInputPortInformation(int port, vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  }
+  return port == 0 || port == 1 ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarCompactFrame::GetMTime()
+{
+  vtkMTimeType mtime = this->Superclass::GetMTime();
+  if (this->Transform)
+  {
+    mtime = std::max(mtime, this->Transform->GetMTime());
+  }
+  if (this->PoseTransform)
+  {
+    mtime = std::max(mtime, this->PoseTransform->GetMTime());
+  }
+  return mtime;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarCompactFrame::SetBufferPoolHighWaterMark(int megaBytes)
+{
+  if (megaBytes < 0 || megaBytes == this->GetBufferPoolHighWaterMark())
+  {
+    return;
+  }
+  LidarFrameBufferPool::GetInstance().SetHighWaterMark(static_cast<std::size_t>(megaBytes) << 20);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarCompactFrame::GetBufferPoolHighWaterMark()
+{
+  return static_cast<int>(LidarFrameBufferPool::GetInstance().GetHighWaterMark() >> 20);
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarCompactFrame::GetBufferPoolReuseRate()
+{
+  return LidarFrameBufferPool::GetInstance().GetStatistics().GetReuseRate();
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarCompactFrame::GetBufferPoolPeakMegaBytes()
+{
+  return LidarFrameBufferPool::GetInstance().GetStatistics().PeakBytesInUse / double(1 << 20);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarCompactFrame::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+
+  LidarCompactFrame frame;
+  frame.RangeQuantum = this->RangeQuantum;
+  frame.IntensityQuantum = this->IntensityQuantum;
+  frame.TimestampQuantum = this->TimestampQuantum;
+
+  // Pose of the frame, interpolated at its time step when poses are given
+  vtkNew<vtkMatrix4x4> pose;
+  bool hasPose = false;
+  vtkPolyData* poses = vtkPolyData::GetData(inputVector[1], 0);
+  if (poses)
+  {
+    LidarPoseStore::ArrayNames names;
+    names.Time = this->PoseTimeArrayName ? this->PoseTimeArrayName : "";
+    names.Quaternion = this->PoseQuaternionArrayName ? this->PoseQuaternionArrayName : "";
+    names.Roll = this->PoseRollArrayName ? this->PoseRollArrayName : "";
+    names.Pitch = this->PosePitchArrayName ? this->PosePitchArrayName : "";
+    names.Yaw = this->PoseYawArrayName ? this->PoseYawArrayName : "";
+    // Shared with the other filters reading the same poses
+    std::shared_ptr<const LidarPoseStore> store = LidarPoseStore::GetStore(poses, names);
+    vtkInformation* inputInfo = input->GetInformation();
+    if (!store)
+    {
+      vtkWarningMacro(<< "No pose with a \"" << names.Time << "\" time array, frame not posed");
+    }
+    else if (!inputInfo->Has(vtkDataObject::DATA_TIME_STEP()))
+    {
+      vtkWarningMacro(<< "The frame has no time step, frame not posed");
+    }
+    else
+    {
+      double matrix[12];
+      store->InterpolateMatrix(inputInfo->Get(vtkDataObject::DATA_TIME_STEP()), matrix);
+      for (int i = 0; i < 3; ++i)
+      {
+        for (int j = 0; j < 4; ++j)
+        {
+          pose->SetElement(i, j, matrix[4 * i + j]);
+        }
+      }
+      hasPose = true;
+    }
+  }
+  else if (this->PoseTransform)
+  {
+    pose->DeepCopy(this->PoseTransform->GetMatrix());
+    hasPose = true;
+  }
+
+  // Fold the sensor transform and the pose into one matrix applied by Pack()
+  vtkNew<vtkMatrix4x4> matrix;
+  if (this->Transform)
+  {
+    matrix->DeepCopy(this->Transform->GetMatrix());
+  }
+  if (hasPose)
+  {
+    vtkMatrix4x4::Multiply4x4(pose, matrix, matrix);
+  }
+  frame.SetTransform((this->Transform || hasPose) ? matrix->GetData() : nullptr);
+  try
+  {
+    frame.Pack(input);
+  }
+  catch (const std::bad_alloc&)
+  {
+    vtkErrorMacro(<< "Unable to allocate a compact frame of " << input->GetNumberOfPoints()
+                  << " points");
+    return 0;
+  }
+
+  // The exported arrays keep the buffer alive once frame goes out of scope
+  output->GetFieldData()->PassData(input->GetFieldData());
+  frame.ExportTo(output);
+  if (this->GenerateVertices)
+  {
+    output->SetVerts(LidarSharedVertices::Get(frame.GetNumberOfPoints()));
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarCompactFrame::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "RangeQuantum: " << this->RangeQuantum << endl;
+  os << indent << "IntensityQuantum: " << this->IntensityQuantum << endl;
+  os << indent << "TimestampQuantum: " << this->TimestampQuantum << endl;
+  os << indent << "GenerateVertices: " << this->GenerateVertices << endl;
+  os << indent << "Transform: " << this->Transform << endl;
+  os << indent << "PoseTransform: " << this->PoseTransform << endl;
+  os << indent << "PoseTimeArrayName: "
+     << (this->PoseTimeArrayName ? this->PoseTimeArrayName : "(none)") << endl;
+  os << indent << "PoseQuaternionArrayName: "
+     << (this->PoseQuaternionArrayName ? this->PoseQuaternionArrayName : "(none)") << endl;
+  const LidarFrameBufferPool::Statistics stats = LidarFrameBufferPool::GetInstance().GetStatistics();
+  os << indent << "BufferPool: " << stats.Requests << " requests, reuse rate "
+     << stats.GetReuseRate() << ", peak " << stats.PeakBytesInUse << " bytes, "
+     << stats.BytesRetained << " bytes retained" << endl;
+}
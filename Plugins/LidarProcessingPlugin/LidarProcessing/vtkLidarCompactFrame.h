@@ -0,0 +1,158 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarCompactFrame.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarCompactFrame_h
+#define vtkLidarCompactFrame_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+class vtkLinearTransform;
+
+/**
+ * @class vtkLidarCompactFrame
+ * @brief Convert a lidar frame to the compact structure-of-arrays layout.
+ *
+ * The output holds float positions, quantized range / intensity / timestamp
+ * offsets and 8 bits laser ids, all stored in one allocation per frame
+ * (see LidarCompactFrame). It is meant to be placed right after the reader when
+ * many frames are kept in memory (trailing frames, frame caches), where it
+ * divides the memory footprint of a frame by about 2.5.
+ *
+ * The sensor transform and the pose of the frame are composed into a single
+ * affine matrix applied while the positions are packed, instead of a separate
+ * pass over the points. The pose is looked up for each frame, at its time
+ * step, in the optional second input: one point per pose, with a time array
+ * and an orientation (see LidarPoseStore), e.g. the output of a
+ * PositionOrientationReader / Stream. Without it, the static PoseTransform is
+ * used. A frame is posed as a whole: see vtkLidarDeskew to move each point with
+ * the pose at its own timestamp.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarCompactFrame : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarCompactFrame* New();
+  vtkTypeMacro(vtkLidarCompactFrame, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Quantization step of the range, in meters. Default is 4 millimeters.
+   */
+  vtkSetClampMacro(RangeQuantum, double, 1e-6, 1.);
+  vtkGetMacro(RangeQuantum, double);
+  //@}
+
+  //@{
+  /**
+   * Quantization step of the intensity. Default is 1.
+   */
+  vtkSetClampMacro(IntensityQuantum, double, 1e-6, 1000.);
+  vtkGetMacro(IntensityQuantum, double);
+  //@}
+
+  //@{
+  /**
+   * Quantization step of the timestamps, in the unit of the timestamp array.
+   * Default is 1 (microseconds for most interpreters).
+   */
+  vtkSetClampMacro(TimestampQuantum, double, 1e-9, 1e6);
+  vtkGetMacro(TimestampQuantum, double);
+  //@}
+
+  //@{
+  /**
+   * Sensor transform, from the sensor to the vehicle frame. Optional.
+   */
+  virtual void SetTransform(vtkLinearTransform*);
+  vtkGetObjectMacro(Transform, vtkLinearTransform);
+  //@}
+
+  //@{
+  /**
+   * Static pose of the vehicle, applied after the sensor transform when the
+   * poses input is not connected. Optional.
+   */
+  virtual void SetPoseTransform(vtkLinearTransform*);
+  vtkGetObjectMacro(PoseTransform, vtkLinearTransform);
+  //@}
+
+  //@{
+  /**
+   * Names of the arrays of the poses input. Defaults are "time",
+   * "orientation" and "roll", "pitch", "yaw". The quaternion array has
+   * precedence over the angles. The time array is in the unit of the time
+   * steps of the frames.
+   */
+  vtkSetStringMacro(PoseTimeArrayName);
+  vtkGetStringMacro(PoseTimeArrayName);
+  vtkSetStringMacro(PoseQuaternionArrayName);
+  vtkGetStringMacro(PoseQuaternionArrayName);
+  vtkSetStringMacro(PoseRollArrayName);
+  vtkGetStringMacro(PoseRollArrayName);
+  vtkSetStringMacro(PosePitchArrayName);
+  vtkGetStringMacro(PosePitchArrayName);
+  vtkSetStringMacro(PoseYawArrayName);
+  vtkGetStringMacro(PoseYawArrayName);
+  //@}
+
+  vtkMTimeType GetMTime() override;
+
+  //@{
+  /**
+   * Generate one vertex cell per point. When disabled the output is point
+   * only and must be displayed with a representation drawing the points
+   * directly, such as "Point Gaussian". Vertices, when generated, share a
+   * single buffer between all frames (see LidarSharedVertices). Default is true.
+   */
+  vtkSetMacro(GenerateVertices, bool);
+  vtkGetMacro(GenerateVertices, bool);
+  vtkBooleanMacro(GenerateVertices, bool);
+  //@}
+
+  //@{
+  /**
+   * Settings and counters of the process wide LidarFrameBufferPool recycling
+   * the frame buffers. The high-water mark is the memory, in MiB, kept idle for
+   * reuse (default 256).
+   */
+  void SetBufferPoolHighWaterMark(int megaBytes);
+  int GetBufferPoolHighWaterMark();
+  double GetBufferPoolReuseRate();
+  double GetBufferPoolPeakMegaBytes();
+  //@}
+
+protected:
+  vtkLidarCompactFrame();
+  ~vtkLidarCompactFrame() override;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  double RangeQuantum = 0.004;
+  double IntensityQuantum = 1.;
+  double TimestampQuantum = 1.;
+  bool GenerateVertices = true;
+  vtkLinearTransform* Transform = nullptr;
+  vtkLinearTransform* PoseTransform = nullptr;
+  char* PoseTimeArrayName = nullptr;
+  char* PoseQuaternionArrayName = nullptr;
+  char* PoseRollArrayName = nullptr;
+  char* PosePitchArrayName = nullptr;
+  char* PoseYawArrayName = nullptr;
+
+private:
+  vtkLidarCompactFrame(const vtkLidarCompactFrame&) = delete;
+  void operator=(const vtkLidarCompactFrame&) = delete;
+};
+
+#endif // vtkLidarCompactFrame_h
@@ -0,0 +1,180 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarCropRegions.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarCropRegions.h"
+
+#include "LidarProcessingHelper.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkSMPTools.h>
+
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarCropRegions)
+
+namespace
+{
+//-----------------------------------------------------------------------------
+template <typename T>
+struct CropMaskWorker
+{
+  const T* Points;
+  const LidarCropRegionSet* Regions;
+  unsigned char* Mask;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const T* p = this->Points + 3 * i;
+      this->Mask[i] = this->Regions->IsKept(p[0], p[1], p[2]) ? 1 : 0;
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct GenericCropMaskWorker
+{
+  vtkDataArray* Points;
+  const LidarCropRegionSet* Regions;
+  unsigned char* Mask;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double p[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      this->Points->GetTuple(i, p);
+      this->Mask[i] = this->Regions->IsKept(p[0], p[1], p[2]) ? 1 : 0;
+    }
+  }
+};
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarCropRegions::AddRegion(const char* description)
+{
+  if (!description)
+  {
+    return;
+  }
+  this->Descriptions.emplace_back(description);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarCropRegions::RemoveAllRegions()
+{
+  if (!this->Descriptions.empty())
+  {
+    this->Descriptions.clear();
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const LidarCropRegionSet> vtkLidarCropRegions::GetRegionSet()
+{
+  if (this->RegionSet && this->CompileTime >= this->GetMTime())
+  {
+    return this->RegionSet;
+  }
+
+  auto regionSet = std::make_shared<LidarCropRegionSet>();
+  for (const std::string& description : this->Descriptions)
+  {
+    // skip empty lines silently, they are common when editing the list in the UI
+    if (description.find_first_not_of(" \t") == std::string::npos)
+    {
+      continue;
+    }
+    if (!regionSet->AddRegion(description))
+    {
+      vtkWarningMacro(<< "Ignoring invalid crop region: \"" << description << "\"");
+    }
+  }
+  regionSet->Compile(this->AzimuthResolution, this->RangeResolution, this->MaxRange);
+  this->CompileTime = this->GetMTime();
+  this->RegionSet = regionSet;
+  return regionSet;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarCropRegions::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+
+  const std::shared_ptr<const LidarCropRegionSet> regionSet = this->GetRegionSet();
+  const LidarCropRegionSet& regions = *regionSet;
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  if (regions.IsEmpty() || nbPoints == 0)
+  {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  // Evaluate the regions in parallel, then compact the kept point ids
+  std::vector<unsigned char> mask(nbPoints);
+  vtkDataArray* points = input->GetPoints()->GetData();
+  if (auto floatPoints = vtkFloatArray::FastDownCast(points))
+  {
+    CropMaskWorker<float> worker{ floatPoints->GetPointer(0), &regions, mask.data() };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  else if (auto doublePoints = vtkDoubleArray::FastDownCast(points))
+  {
+    CropMaskWorker<double> worker{ doublePoints->GetPointer(0), &regions, mask.data() };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  else
+  {
+    GenericCropMaskWorker worker{ points, &regions, mask.data() };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+
+  vtkNew<vtkIdList> keptIds;
+  keptIds->Allocate(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (mask[i])
+    {
+      keptIds->InsertNextId(i);
+    }
+  }
+
+  LidarProcessingHelper::ExtractPoints(input, keptIds, output);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarCropRegions::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "AzimuthResolution: " << this->AzimuthResolution << endl;
+  os << indent << "RangeResolution: " << this->RangeResolution << endl;
+  os << indent << "MaxRange: " << this->MaxRange << endl;
+  os << indent << "Regions: " << this->Descriptions.size() << endl;
+  for (const std::string& description : this->Descriptions)
+  {
+    os << indent.GetNextIndent() << description << endl;
+  }
+}
@@ -0,0 +1,89 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarCropRegions.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarCropRegions_h
+#define vtkLidarCropRegions_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarCropRegionSet.h"
+#include "LidarProcessingModule.h" // for export macro
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class vtkLidarCropRegions
+ * @brief Crop a lidar frame with several include / exclude regions.
+ *
+ * Unlike the single box of the interpreters "CropRegion", any number of boxes,
+ * extruded polygons and spherical sectors can be combined, for example to mask
+ * the vehicle body and some fixed infrastructure while keeping a region of
+ * interest. See LidarCropRegionSet for the region syntax and the combination rule.
+ *
+ * The regions are compiled into an azimuth / range lookup grid whenever they
+ * change, so that the per point cost does not grow with the number of regions.
+ * Regions are expressed in the same frame as the input points.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarCropRegions : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarCropRegions* New();
+  vtkTypeMacro(vtkLidarCropRegions, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Add / remove textual region descriptions, one region per call.
+   * Invalid descriptions are reported and ignored.
+   */
+  void AddRegion(const char* description);
+  void RemoveAllRegions();
+  //@}
+
+  //@{
+  /**
+   * Resolution of the lookup grid. Default is 1 degree, 1 meter, up to 300 meters.
+   */
+  vtkSetClampMacro(AzimuthResolution, double, 0.01, 90.);
+  vtkGetMacro(AzimuthResolution, double);
+  vtkSetClampMacro(RangeResolution, double, 0.01, 100.);
+  vtkGetMacro(RangeResolution, double);
+  vtkSetClampMacro(MaxRange, double, 1., 10000.);
+  vtkGetMacro(MaxRange, double);
+  //@}
+
+  /**
+   * Get the compiled regions, (re)compiling them if needed.
+   */
+  std::shared_ptr<const LidarCropRegionSet> GetRegionSet();
+
+protected:
+  vtkLidarCropRegions() = default;
+  ~vtkLidarCropRegions() override = default;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  double AzimuthResolution = 1.;
+  double RangeResolution = 1.;
+  double MaxRange = 300.;
+
+private:
+  vtkLidarCropRegions(const vtkLidarCropRegions&) = delete;
+  void operator=(const vtkLidarCropRegions&) = delete;
+
+  std::vector<std::string> Descriptions;
+  std::shared_ptr<const LidarCropRegionSet> RegionSet;
+  vtkMTimeType CompileTime = 0;
+};
+
+#endif // vtkLidarCropRegions_h
@@ -0,0 +1,386 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarDeskew.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarDeskew.h"
+
+#include "LidarPoseStore.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSMPTools.h>
+#include <vtkTemplateAliasMacro.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarDeskew)
+
+namespace
+{
+// Upper bound of the number of interpolated poses per frame
+constexpr vtkIdType MAX_BLOCKS = 1 << 20;
+
+// Below this angle between two block orientations, their normalized linear
+// interpolation matches SLERP to well under a nanoradian
+constexpr double NLERP_MAX_ANGLE = 1e-3;
+
+//-----------------------------------------------------------------------------
+// Quaternions are w, x, y, z
+void Multiply(const double a[4], const double b[4], double q[4])
+{
+  q[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+  q[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+  q[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+  q[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+//-----------------------------------------------------------------------------
+void ToRotation(const double q[4], double m[9])
+{
+  const double w = q[0], x = q[1], y = q[2], z = q[3];
+  m[0] = 1. - 2. * (y * y + z * z);
+  m[1] = 2. * (x * y - z * w);
+  m[2] = 2. * (x * z + y * w);
+  m[3] = 2. * (x * y + z * w);
+  m[4] = 1. - 2. * (x * x + z * z);
+  m[5] = 2. * (y * z - x * w);
+  m[6] = 2. * (x * z - y * w);
+  m[7] = 2. * (y * z + x * w);
+  m[8] = 1. - 2. * (x * x + y * y);
+}
+
+//-----------------------------------------------------------------------------
+void Rotate(const double m[9], const double v[3], double out[3])
+{
+  out[0] = m[0] * v[0] + m[1] * v[1] + m[2] * v[2];
+  out[1] = m[3] * v[0] + m[4] * v[1] + m[5] * v[2];
+  out[2] = m[6] * v[0] + m[7] * v[1] + m[8] * v[2];
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void CopyScaled(const T* in, vtkIdType n, double scale, double* out)
+{
+  vtkSMPTools::For(0, n, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      out[i] = static_cast<double>(in[i]) * scale;
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+bool ReadScaled(vtkDataArray* array, double scale, std::vector<double>& values)
+{
+  if (!array || array->GetNumberOfComponents() != 1)
+  {
+    return false;
+  }
+  values.resize(array->GetNumberOfTuples());
+  switch (array->GetDataType())
+  {
+    vtkTemplateAliasMacro(CopyScaled(static_cast<const VTK_TT*>(array->GetVoidPointer(0)),
+      array->GetNumberOfTuples(), scale, values.data()));
+    default:
+      return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void AddValue(vtkFieldData* fieldData, const char* name, double value)
+{
+  vtkNew<vtkDoubleArray> array;
+  array->SetName(name);
+  array->InsertNextValue(value);
+  fieldData->AddArray(array);
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+struct DeskewWorker
+{
+  const T* InPoints;
+  T* OutPoints;
+  const double* Times;
+  //! Block orientations (4 values each), consecutive ones on the same hemisphere
+  const double* Rotations;
+  //! Block positions (3 values each)
+  const double* Translations;
+  //! Angle between the orientations of a block and of the next one
+  const double* Angles;
+  vtkIdType NbBlocks;
+  double FirstBlockTime;
+  double BlockDuration;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      // Interpolate the two block poses around the point timestamp: SLERP for
+      // the orientation, linear for the position, so the motion stays rigid
+      double u = (this->Times[i] - this->FirstBlockTime) / this->BlockDuration;
+      u = std::min(std::max(u, 0.), static_cast<double>(this->NbBlocks - 1));
+      const vtkIdType b = std::min(static_cast<vtkIdType>(u), this->NbBlocks - 2);
+      const double f = u - b;
+      const double* q0 = this->Rotations + 4 * b;
+      const double* q1 = q0 + 4;
+      const double angle = this->Angles[b];
+      double w0 = 1. - f;
+      double w1 = f;
+      if (angle > NLERP_MAX_ANGLE)
+      {
+        const double sinAngle = std::sin(angle);
+        w0 = std::sin((1. - f) * angle) / sinAngle;
+        w1 = std::sin(f * angle) / sinAngle;
+      }
+      double q[4];
+      double norm = 0.;
+      for (int k = 0; k < 4; ++k)
+      {
+        q[k] = w0 * q0[k] + w1 * q1[k];
+        norm += q[k] * q[k];
+      }
+      norm = 1. / std::sqrt(norm);
+      for (int k = 0; k < 4; ++k)
+      {
+        q[k] *= norm;
+      }
+      double m[9];
+      ToRotation(q, m);
+      const double* t0 = this->Translations + 3 * b;
+      const double* t1 = t0 + 3;
+
+      const double p[3] = { static_cast<double>(this->InPoints[3 * i]),
+        static_cast<double>(this->InPoints[3 * i + 1]),
+        static_cast<double>(this->InPoints[3 * i + 2]) };
+      double r[3];
+      Rotate(m, p, r);
+      T* out = this->OutPoints + 3 * i;
+      for (int k = 0; k < 3; ++k)
+      {
+        out[k] = static_cast<T>(r[k] + t0[k] + f * (t1[k] - t0[k]));
+      }
+    }
+  }
+};
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarDeskew::vtkLidarDeskew()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetTimestampArrayName("adjustedtime");
+  this->SetPoseTimeArrayName("time");
+  this->SetPoseQuaternionArrayName("orientation");
+  this->SetPoseRollArrayName("roll");
+  this->SetPosePitchArrayName("pitch");
+  this->SetPoseYawArrayName("yaw");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarDeskew::~vtkLidarDeskew()
+{
+  this->SetTimestampArrayName(nullptr);
+  this->SetPoseTimeArrayName(nullptr);
+  this->SetPoseQuaternionArrayName(nullptr);
+  this->SetPoseRollArrayName(nullptr);
+  this->SetPosePitchArrayName(nullptr);
+  this->SetPoseYawArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarDeskew::FillInputPortInformation(int port, vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  }
+  return port == 0 || port == 1 ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarDeskew::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* poses = vtkPolyData::GetData(inputVector[1], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+  output->ShallowCopy(input);
+
+  // Without poses, e.g. until a pose source is connected, frames pass through
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  if (nbPoints == 0 || !poses)
+  {
+    return 1;
+  }
+
+  // Poses
+  LidarPoseStore::ArrayNames names;
+  names.Time = this->PoseTimeArrayName ? this->PoseTimeArrayName : "";
+  names.Quaternion = this->PoseQuaternionArrayName ? this->PoseQuaternionArrayName : "";
+  names.Roll = this->PoseRollArrayName ? this->PoseRollArrayName : "";
+  names.Pitch = this->PosePitchArrayName ? this->PosePitchArrayName : "";
+  names.Yaw = this->PoseYawArrayName ? this->PoseYawArrayName : "";
+  // Shared with the other filters reading the same poses
+  std::shared_ptr<const LidarPoseStore> samples = LidarPoseStore::GetStore(poses, names);
+  if (!samples)
+  {
+    vtkWarningMacro(<< "No pose with a \"" << names.Time << "\" time array, frame left as is");
+    return 1;
+  }
+
+  // Point timestamps, in the pose time unit
+  std::vector<double> times;
+  if (!ReadScaled(this->TimestampArrayName
+        ? input->GetPointData()->GetArray(this->TimestampArrayName) : nullptr,
+        this->TimestampScale, times))
+  {
+    vtkWarningMacro(<< "No \"" << (this->TimestampArrayName ? this->TimestampArrayName : "")
+                    << "\" timestamp array, frame left as is");
+    return 1;
+  }
+  const auto range = std::minmax_element(times.begin(), times.end());
+  const double firstTime = *range.first;
+  const double lastTime = *range.second;
+
+  // One interpolated pose per firing block, expressed in the output frame
+  const vtkIdType nbBlocks = std::min(MAX_BLOCKS,
+    static_cast<vtkIdType>(std::ceil((lastTime - firstTime) / this->BlockDuration)) + 2);
+  const double blockDuration =
+    lastTime > firstTime ? (lastTime - firstTime) / (nbBlocks - 1) : this->BlockDuration;
+  double outputRotation[4] = { 1., 0., 0., 0. };
+  double outputTranslation[3] = { 0., 0., 0. };
+  if (this->OutputFrame == REFERENCE_FRAME)
+  {
+    // Inverse of the reference pose
+    double position[3];
+    samples->Interpolate(lastTime, position, outputRotation);
+    for (int k = 1; k < 4; ++k)
+    {
+      outputRotation[k] = -outputRotation[k];
+    }
+    double m[9];
+    ToRotation(outputRotation, m);
+    Rotate(m, position, outputTranslation);
+    for (int k = 0; k < 3; ++k)
+    {
+      outputTranslation[k] = -outputTranslation[k];
+    }
+  }
+  std::vector<double> blockTimes(nbBlocks);
+  for (vtkIdType b = 0; b < nbBlocks; ++b)
+  {
+    blockTimes[b] = firstTime + b * blockDuration;
+  }
+  std::vector<double> translations(3 * nbBlocks);
+  std::vector<double> poseRotations(4 * nbBlocks);
+  samples->InterpolateBatch(
+    blockTimes.data(), nbBlocks, translations.data(), poseRotations.data());
+  std::vector<double> rotations(4 * nbBlocks);
+  vtkSMPTools::For(0, nbBlocks, [&](vtkIdType begin, vtkIdType end) {
+    double m[9];
+    ToRotation(outputRotation, m);
+    for (vtkIdType b = begin; b < end; ++b)
+    {
+      Multiply(outputRotation, &poseRotations[4 * b], &rotations[4 * b]);
+      double* t = &translations[3 * b];
+      const double position[3] = { t[0], t[1], t[2] };
+      Rotate(m, position, t);
+      for (int k = 0; k < 3; ++k)
+      {
+        t[k] += outputTranslation[k];
+      }
+    }
+  });
+  // Keep consecutive orientations on the same hemisphere, so that the
+  // interpolation takes the shortest path, and store the angle between them
+  std::vector<double> angles(nbBlocks, 0.);
+  for (vtkIdType b = 0; b + 1 < nbBlocks; ++b)
+  {
+    const double* q0 = &rotations[4 * b];
+    double* q1 = &rotations[4 * (b + 1)];
+    double dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+    if (dot < 0.)
+    {
+      for (int k = 0; k < 4; ++k)
+      {
+        q1[k] = -q1[k];
+      }
+      dot = -dot;
+    }
+    angles[b] = std::acos(std::min(dot, 1.));
+  }
+
+  // Move each point with the pose at its timestamp
+  vtkDataArray* inPoints = input->GetPoints()->GetData();
+  vtkNew<vtkPoints> outPoints;
+  if (auto floatPoints = vtkFloatArray::FastDownCast(inPoints))
+  {
+    outPoints->SetDataTypeToFloat();
+    outPoints->SetNumberOfPoints(nbPoints);
+    DeskewWorker<float> worker{ floatPoints->GetPointer(0),
+      vtkFloatArray::FastDownCast(outPoints->GetData())->GetPointer(0), times.data(),
+      rotations.data(), translations.data(), angles.data(), nbBlocks, firstTime,
+      blockDuration };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  else
+  {
+    vtkNew<vtkDoubleArray> doublePoints;
+    doublePoints->DeepCopy(inPoints);
+    outPoints->SetDataTypeToDouble();
+    outPoints->SetNumberOfPoints(nbPoints);
+    DeskewWorker<double> worker{ doublePoints->GetPointer(0),
+      vtkDoubleArray::FastDownCast(outPoints->GetData())->GetPointer(0), times.data(),
+      rotations.data(), translations.data(), angles.data(), nbBlocks, firstTime,
+      blockDuration };
+    vtkSMPTools::For(0, nbPoints, worker);
+  }
+  output->SetPoints(outPoints);
+
+  // Statistics of the pose store, cumulated over all its users
+  vtkFieldData* fieldData = output->GetFieldData();
+  AddValue(fieldData, "pose_count", static_cast<double>(samples->GetNumberOfPoses()));
+  AddValue(fieldData, "pose_memory", static_cast<double>(samples->GetMemorySize()));
+  AddValue(fieldData, "pose_queries", static_cast<double>(samples->GetNumberOfQueries()));
+  AddValue(fieldData, "pose_query_throughput", samples->GetQueryThroughput());
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarDeskew::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "OutputFrame: " << this->OutputFrame << endl;
+  os << indent << "TimestampArrayName: "
+     << (this->TimestampArrayName ? this->TimestampArrayName : "(none)") << endl;
+  os << indent << "TimestampScale: " << this->TimestampScale << endl;
+  os << indent << "PoseTimeArrayName: "
+     << (this->PoseTimeArrayName ? this->PoseTimeArrayName : "(none)") << endl;
+  os << indent << "PoseQuaternionArrayName: "
+     << (this->PoseQuaternionArrayName ? this->PoseQuaternionArrayName : "(none)") << endl;
+  os << indent << "BlockDuration: " << this->BlockDuration << endl;
+}
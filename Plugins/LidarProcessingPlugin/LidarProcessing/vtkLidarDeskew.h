@@ -0,0 +1,128 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarDeskew.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarDeskew_h
+#define vtkLidarDeskew_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+/**
+ * @class vtkLidarDeskew
+ * @brief Per point motion compensation of a lidar frame from a pose stream.
+ *
+ * Placing a whole sweep with a single pose smears the scene by the distance
+ * travelled during the sweep (about 3 m at 30 m/s for a 100 ms sweep). This
+ * filter moves each point with the pose of the vehicle at the time the point
+ * was measured.
+ *
+ * Poses are interpolated by a LidarPoseStore (SLERP for the orientation,
+ * linear for the position) once per firing block, i.e. every BlockDuration
+ * seconds of the frame. Each point then interpolates the two block poses
+ * surrounding its timestamp the same way, so that it is moved rigidly, in
+ * parallel.
+ *
+ * The first input is the lidar frame, the second one the optional poses (the
+ * frame is passed through when it is not connected), e.g. the
+ * output of a PositionOrientationReader / Stream: one point per pose, with a
+ * time array and an optional orientation (either a quaternion array w, x, y, z
+ * or roll / pitch / yaw arrays in degrees). Missing orientation is considered
+ * constant.
+ *
+ * The output field data reports the pose store, shared with the other filters
+ * reading the same poses: pose_count, pose_memory (bytes), pose_queries and
+ * pose_query_throughput (batch queried timestamps per second).
+ */
+class LIDARPROCESSING_EXPORT vtkLidarDeskew : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarDeskew* New();
+  vtkTypeMacro(vtkLidarDeskew, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum OutputFrameType
+  {
+    //! Vehicle frame at the time of the last point of the frame
+    REFERENCE_FRAME = 0,
+    //! Frame of the poses, e.g. local geographic frame
+    WORLD_FRAME = 1
+  };
+
+  //@{
+  /**
+   * Frame of the output points. Default is REFERENCE_FRAME.
+   */
+  vtkSetClampMacro(OutputFrame, int, REFERENCE_FRAME, WORLD_FRAME);
+  vtkGetMacro(OutputFrame, int);
+  //@}
+
+  //@{
+  /**
+   * Name of the per point timestamp array and factor converting it to the
+   * time unit of the poses. Default is "adjustedtime" in microseconds, with
+   * poses in seconds.
+   */
+  vtkSetStringMacro(TimestampArrayName);
+  vtkGetStringMacro(TimestampArrayName);
+  vtkSetMacro(TimestampScale, double);
+  vtkGetMacro(TimestampScale, double);
+  //@}
+
+  //@{
+  /**
+   * Names of the pose arrays. Defaults are "time", "orientation" and "roll",
+   * "pitch", "yaw". The quaternion array has precedence over the angles.
+   */
+  vtkSetStringMacro(PoseTimeArrayName);
+  vtkGetStringMacro(PoseTimeArrayName);
+  vtkSetStringMacro(PoseQuaternionArrayName);
+  vtkGetStringMacro(PoseQuaternionArrayName);
+  vtkSetStringMacro(PoseRollArrayName);
+  vtkGetStringMacro(PoseRollArrayName);
+  vtkSetStringMacro(PosePitchArrayName);
+  vtkGetStringMacro(PosePitchArrayName);
+  vtkSetStringMacro(PoseYawArrayName);
+  vtkGetStringMacro(PoseYawArrayName);
+  //@}
+
+  //@{
+  /**
+   * Duration between two interpolated poses, in the time unit of the poses.
+   * Default is 55.296e-6 s, the firing cycle of the VLP-16.
+   */
+  vtkSetClampMacro(BlockDuration, double, 1e-9, 1.);
+  vtkGetMacro(BlockDuration, double);
+  //@}
+
+protected:
+  vtkLidarDeskew();
+  ~vtkLidarDeskew() override;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  int OutputFrame = REFERENCE_FRAME;
+  char* TimestampArrayName = nullptr;
+  double TimestampScale = 1e-6;
+  char* PoseTimeArrayName = nullptr;
+  char* PoseQuaternionArrayName = nullptr;
+  char* PoseRollArrayName = nullptr;
+  char* PosePitchArrayName = nullptr;
+  char* PoseYawArrayName = nullptr;
+  double BlockDuration = 55.296e-6;
+
+private:
+  vtkLidarDeskew(const vtkLidarDeskew&) = delete;
+  void operator=(const vtkLidarDeskew&) = delete;
+};
+
+#endif // vtkLidarDeskew_h
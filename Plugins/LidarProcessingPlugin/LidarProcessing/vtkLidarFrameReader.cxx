@@ -0,0 +1,194 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarFrameReader.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarFrameReader.h"
+
+#include "LidarCompactFrame.h"
+#include "LidarRangeImage.h"
+#include "LidarSharedVertices.h"
+
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+#include <string>
+
+vtkStandardNewMacro(vtkLidarFrameReader)
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameReader::vtkLidarFrameReader()
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(2);
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameReader::~vtkLidarFrameReader()
+{
+  this->SetFileName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarFrameReader::CanReadFile(const char* fileName)
+{
+  LidarFrameContainer container;
+  return fileName && container.Open(fileName);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameReader::FillOutputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 1)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkImageData");
+    return 1;
+  }
+  return this->Superclass::FillOutputPortInformation(port, info);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameReader::RequestInformation(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  if (!this->FileName)
+  {
+    vtkErrorMacro(<< "No file name");
+    return 0;
+  }
+  // Remapped on each update of the information, to see the frames appended by
+  // a writer since the last one
+  std::string error;
+  if (!this->Container.Open(this->FileName, &error))
+  {
+    vtkErrorMacro(<< error);
+    return 0;
+  }
+
+  // Frames saved without a pipeline time get their index instead
+  const std::size_t nbFrames = this->Container.GetNumberOfFrames();
+  this->TimeSteps.resize(nbFrames);
+  bool increasing = true;
+  for (std::size_t i = 0; i < nbFrames; ++i)
+  {
+    this->TimeSteps[i] = this->Container.GetFrame(i).Time;
+    increasing = increasing && (i == 0 || this->TimeSteps[i] > this->TimeSteps[i - 1]);
+  }
+  if (!increasing)
+  {
+    for (std::size_t i = 0; i < nbFrames; ++i)
+    {
+      this->TimeSteps[i] = static_cast<double>(i);
+    }
+  }
+
+  for (int port = 0; port < this->GetNumberOfOutputPorts(); ++port)
+  {
+    vtkInformation* outInfo = outputVector->GetInformationObject(port);
+    outInfo->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    outInfo->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    if (nbFrames > 0)
+    {
+      outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), this->TimeSteps.data(),
+        static_cast<int>(nbFrames));
+      const double range[2] = { this->TimeSteps.front(), this->TimeSteps.back() };
+      outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), range, 2);
+    }
+  }
+  const int extent[6] = { 0, this->RangeImageColumns - 1, 0, this->RangeImageRows - 1, 0, 0 };
+  outputVector->GetInformationObject(1)->Set(
+    vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameReader::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+  if (this->TimeSteps.empty())
+  {
+    return 1;
+  }
+
+  // Last frame starting before the requested time
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  std::size_t frame = 0;
+  if (outInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    const double time = outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    const auto next = std::upper_bound(this->TimeSteps.begin(), this->TimeSteps.end(), time);
+    frame = next == this->TimeSteps.begin()
+      ? 0
+      : static_cast<std::size_t>(next - this->TimeSteps.begin() - 1);
+  }
+
+  LidarCompactFrame compact;
+  std::string error;
+  if (!this->Container.ReadFrame(frame, compact, &error))
+  {
+    vtkErrorMacro(<< error);
+    return 0;
+  }
+  // The exported arrays keep the buffer alive once compact goes out of scope
+  compact.ExportTo(output);
+  if (this->GenerateVertices)
+  {
+    output->SetVerts(LidarSharedVertices::Get(compact.GetNumberOfPoints()));
+  }
+  output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), this->TimeSteps[frame]);
+
+  vtkImageData* image = vtkImageData::GetData(outputVector, 1);
+  if (image && this->GenerateRangeImage && compact.GetNumberOfPoints() > 0)
+  {
+    vtkPointData* pointData = output->GetPointData();
+    LidarRangeImage rangeImage;
+    rangeImage.SetNumberOfColumns(this->RangeImageColumns);
+    rangeImage.SetMinimumNumberOfRows(this->RangeImageRows);
+    if (!rangeImage.Build(output->GetPoints()->GetData(),
+          pointData->GetArray(compact.LaserIdArrayName.c_str()),
+          pointData->GetArray(compact.IntensityArrayName.c_str()), &error))
+    {
+      vtkErrorMacro(<< error);
+      return 0;
+    }
+    if (rangeImage.GetHeight() > this->RangeImageRows)
+    {
+      vtkWarningMacro(<< "The frame has " << rangeImage.GetHeight() << " lasers, more than the "
+                      << this->RangeImageRows << " rows of the range image");
+    }
+    rangeImage.ExportTo(image);
+    image->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), this->TimeSteps[frame]);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameReader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << endl;
+  os << indent << "GenerateVertices: " << this->GenerateVertices << endl;
+  os << indent << "GenerateRangeImage: " << this->GenerateRangeImage << endl;
+  os << indent << "RangeImageColumns: " << this->RangeImageColumns << endl;
+  os << indent << "RangeImageRows: " << this->RangeImageRows << endl;
+  os << indent << "NumberOfFrames: " << this->Container.GetNumberOfFrames() << endl;
+}
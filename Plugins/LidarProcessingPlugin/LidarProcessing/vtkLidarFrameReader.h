@@ -0,0 +1,124 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarFrameReader.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarFrameReader_h
+#define vtkLidarFrameReader_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarFrameContainer.h"   // for member
+#include "LidarProcessingModule.h" // for export macro
+
+#include <vector>
+
+/**
+ * @class vtkLidarFrameReader
+ * @brief Replay the frames of an .lvf file written by vtkLidarFrameWriter.
+ *
+ * The frames are stored already decoded in the compact layout: loading one is
+ * a parallel copy (or inflate) of its chunks from the memory mapped file into
+ * a single allocation, without any packet parsing or quantization. The output
+ * is the same as the one of vtkLidarCompactFrame.
+ *
+ * The frames are a lossy subset of the saved ones: float positions,
+ * "timestamp_offset" (uint32 offsets from the timestamp_base field data value),
+ * intensity and "distance_q" (uint16, 4 millimeter steps by default) and
+ * laser_id (uint8). They are returned as stored, in quantized units, the
+ * quantization steps being in the field data. All the other arrays of the
+ * saved frames, e.g. azimuth or distance_m, are not stored.
+ *
+ * The time steps are the times the frames were saved with.
+ *
+ * When GenerateRangeImage is enabled, the second output is the range image of
+ * the frame (see LidarRangeImage), filled from the arrays just loaded. Its
+ * whole extent is RangeImageColumns by RangeImageRows.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarFrameReader : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarFrameReader* New();
+  vtkTypeMacro(vtkLidarFrameReader, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Name of the .lvf file.
+   */
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  //@}
+
+  //@{
+  /**
+   * Generate one vertex cell per point, shared between the frames (see
+   * LidarSharedVertices). Default is true.
+   */
+  vtkSetMacro(GenerateVertices, bool);
+  vtkGetMacro(GenerateVertices, bool);
+  vtkBooleanMacro(GenerateVertices, bool);
+  //@}
+
+  //@{
+  /**
+   * Fill the range image of the second output. Default is false.
+   */
+  vtkSetMacro(GenerateRangeImage, bool);
+  vtkGetMacro(GenerateRangeImage, bool);
+  vtkBooleanMacro(GenerateRangeImage, bool);
+  //@}
+
+  //@{
+  /**
+   * Number of azimuth columns of the range image. Default is 2048.
+   */
+  vtkSetClampMacro(RangeImageColumns, int, 16, 65536);
+  vtkGetMacro(RangeImageColumns, int);
+  //@}
+
+  //@{
+  /**
+   * Number of rows of the range image, at least the number of lasers of the
+   * sensor. Default is 128.
+   */
+  vtkSetClampMacro(RangeImageRows, int, 1, 4096);
+  vtkGetMacro(RangeImageRows, int);
+  //@}
+
+  int GetNumberOfFrames() const { return static_cast<int>(this->Container.GetNumberOfFrames()); }
+
+  /**
+   * Whether fileName is an .lvf file this reader can open.
+   */
+  static bool CanReadFile(const char* fileName);
+
+protected:
+  vtkLidarFrameReader();
+  ~vtkLidarFrameReader() override;
+
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
+  int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* FileName = nullptr;
+  bool GenerateVertices = true;
+  bool GenerateRangeImage = false;
+  int RangeImageColumns = 2048;
+  int RangeImageRows = 128;
+
+private:
+  vtkLidarFrameReader(const vtkLidarFrameReader&) = delete;
+  void operator=(const vtkLidarFrameReader&) = delete;
+
+  LidarFrameContainer Container;
+  std::vector<double> TimeSteps;
+};
+
+#endif // vtkLidarFrameReader_h
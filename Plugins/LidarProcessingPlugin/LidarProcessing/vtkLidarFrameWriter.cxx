@@ -0,0 +1,109 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarFrameWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarFrameWriter.h"
+
+#include "LidarCompactFrame.h"
+
+#include <vtkAlgorithm.h>
+#include <vtkDataObject.h>
+#include <vtkInformation.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+#include <new>
+#include <string>
+
+vtkStandardNewMacro(vtkLidarFrameWriter)
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameWriter::~vtkLidarFrameWriter()
+{
+  this->CloseFile();
+  this->SetFileName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameWriter::CloseFile()
+{
+  this->Container.Close();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameWriter::FillInputPortInformation(int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameWriter::WriteData()
+{
+  vtkPolyData* input = vtkPolyData::SafeDownCast(this->GetInput());
+  if (!input || !this->FileName)
+  {
+    vtkErrorMacro(<< "Invalid input or file name");
+    return;
+  }
+
+  // Keep writing to the same container as long as the file name is the same
+  std::string error;
+  if (!this->Container.IsOpen() || this->Container.GetFileName() != this->FileName)
+  {
+    this->Container.RangeQuantum = this->RangeQuantum;
+    this->Container.IntensityQuantum = this->IntensityQuantum;
+    this->Container.TimestampQuantum = this->TimestampQuantum;
+    this->Container.CompressionLevel = this->CompressionLevel;
+    if (!this->Container.Open(this->FileName, this->Append, &error))
+    {
+      vtkErrorMacro(<< error);
+      return;
+    }
+  }
+
+  // When appending, the quantization steps are the ones of the existing file
+  LidarCompactFrame frame;
+  frame.RangeQuantum = this->Container.RangeQuantum;
+  frame.IntensityQuantum = this->Container.IntensityQuantum;
+  frame.TimestampQuantum = this->Container.TimestampQuantum;
+  try
+  {
+    frame.Pack(input);
+  }
+  catch (const std::bad_alloc&)
+  {
+    vtkErrorMacro(<< "Unable to allocate a compact frame of " << input->GetNumberOfPoints()
+                  << " points");
+    return;
+  }
+
+  vtkInformation* info = input->GetInformation();
+  const double time = info->Has(vtkDataObject::DATA_TIME_STEP())
+    ? info->Get(vtkDataObject::DATA_TIME_STEP())
+    : static_cast<double>(this->Container.GetNumberOfFrames());
+  if (!this->Container.WriteFrame(frame, time, &error))
+  {
+    vtkErrorMacro(<< error);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << endl;
+  os << indent << "Append: " << this->Append << endl;
+  os << indent << "CompressionLevel: " << this->CompressionLevel << endl;
+  os << indent << "RangeQuantum: " << this->RangeQuantum << endl;
+  os << indent << "IntensityQuantum: " << this->IntensityQuantum << endl;
+  os << indent << "TimestampQuantum: " << this->TimestampQuantum << endl;
+  os << indent << "NumberOfFramesWritten: " << this->Container.GetNumberOfFrames() << endl;
+}
@@ -0,0 +1,110 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarFrameWriter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarFrameWriter_h
+#define vtkLidarFrameWriter_h
+
+#include <vtkWriter.h>
+
+#include "LidarFrameContainerWriter.h" // for member
+#include "LidarProcessingModule.h"     // for export macro
+
+/**
+ * @class vtkLidarFrameWriter
+ * @brief Save lidar frames to an .lvf file, for replay without decoding.
+ *
+ * Each frame is packed in the compact layout (see LidarCompactFrame) and
+ * appended to the container (see LidarFrameContainer) with the time step it
+ * was produced for. Consecutive writes to the same FileName go to the same
+ * file, so that saving a range of frames frame by frame, as the save frame
+ * reaction does, produces a single container. The file is recreated on the
+ * first write after the FileName changes, unless Append is enabled.
+ *
+ * This is lossy: only the positions (as float), the timestamps, intensity and
+ * range (quantized, see the quanta below) and the laser id (uint8) are saved.
+ * All the other arrays, e.g. azimuth or distance_m, are dropped.
+ *
+ * The frames are read back by vtkLidarFrameReader, in quantized units.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarFrameWriter : public vtkWriter
+{
+public:
+  static vtkLidarFrameWriter* New();
+  vtkTypeMacro(vtkLidarFrameWriter, vtkWriter);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Name of the .lvf file.
+   */
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  //@}
+
+  //@{
+  /**
+   * Append to the frames already saved in FileName instead of recreating it.
+   * Default is false.
+   */
+  vtkSetMacro(Append, bool);
+  vtkGetMacro(Append, bool);
+  vtkBooleanMacro(Append, bool);
+  //@}
+
+  //@{
+  /**
+   * Deflate level of the chunks, from 0 (stored) to 9. Default is 1.
+   */
+  vtkSetClampMacro(CompressionLevel, int, 0, 9);
+  vtkGetMacro(CompressionLevel, int);
+  //@}
+
+  //@{
+  /**
+   * Quantization steps of the range (meters), intensity and timestamps, for
+   * new files. Defaults are 4 millimeters, 1 and 1.
+   */
+  vtkSetClampMacro(RangeQuantum, double, 1e-6, 1.);
+  vtkGetMacro(RangeQuantum, double);
+  vtkSetClampMacro(IntensityQuantum, double, 1e-6, 1000.);
+  vtkGetMacro(IntensityQuantum, double);
+  vtkSetClampMacro(TimestampQuantum, double, 1e-9, 1e6);
+  vtkGetMacro(TimestampQuantum, double);
+  //@}
+
+  /**
+   * Close the file. Called automatically when the FileName changes or the
+   * writer is destroyed.
+   */
+  void CloseFile();
+
+protected:
+  vtkLidarFrameWriter() = default;
+  ~vtkLidarFrameWriter() override;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  void WriteData() override;
+
+  char* FileName = nullptr;
+  bool Append = false;
+  int CompressionLevel = 1;
+  double RangeQuantum = 0.004;
+  double IntensityQuantum = 1.;
+  double TimestampQuantum = 1.;
+
+private:
+  vtkLidarFrameWriter(const vtkLidarFrameWriter&) = delete;
+  void operator=(const vtkLidarFrameWriter&) = delete;
+
+  LidarFrameContainerWriter Container;
+};
+
+#endif // vtkLidarFrameWriter_h
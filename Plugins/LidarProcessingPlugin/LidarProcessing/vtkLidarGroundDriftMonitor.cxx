@@ -0,0 +1,397 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarGroundDriftMonitor.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarGroundDriftMonitor.h"
+
+#include "LidarPlaneFit.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTable.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarGroundDriftMonitor)
+
+namespace
+{
+// The bias of lasers with fewer ground points in a frame is not updated for
+// that frame, nor their inlier ratio with fewer points in range
+constexpr vtkIdType MIN_LASER_INLIERS = 10;
+constexpr vtkIdType MIN_LASER_POINTS = 10;
+// Points the hypotheses are scored on, plenty for the ground
+constexpr vtkIdType MAX_SAMPLES = 5000;
+// Row of the sensor height
+constexpr int HEIGHT_ROW = -1;
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void SelectCloseIds(const T* points, vtkIdType nbPoints, double maxRange2,
+  std::vector<vtkIdType>& ids)
+{
+  ids.reserve(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i, points += 3)
+  {
+    const double x = points[0];
+    const double y = points[1];
+    if (x * x + y * y <= maxRange2)
+    {
+      ids.push_back(i);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+struct TrackedValue
+{
+  vtkIdType Frames = 0;
+  // Welford accumulators over the warmup frames
+  double Baseline = 0.;
+  double BaselineM2 = 0.;
+  // Exponential moving average once the baseline is known
+  double Smoothed = 0.;
+  double Last = 0.;
+
+  // Returns true once the baseline is known
+  bool Update(double value, int warmupFrames, double smoothing)
+  {
+    ++this->Frames;
+    this->Last = value;
+    if (this->Frames <= warmupFrames)
+    {
+      const double delta = value - this->Baseline;
+      this->Baseline += delta / this->Frames;
+      this->BaselineM2 += delta * (value - this->Baseline);
+      this->Smoothed = this->Baseline;
+      return false;
+    }
+    this->Smoothed += smoothing * (value - this->Smoothed);
+    return true;
+  }
+
+  double GetDrift() const { return this->Smoothed - this->Baseline; }
+
+  double GetBaselineStdDev() const
+  {
+    return this->Frames > 1 ? std::sqrt(this->BaselineM2 / (this->Frames - 1)) : 0.;
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct DriftStatistics
+{
+  // Mean distance of the ground points to the plane, or sensor height
+  TrackedValue Bias;
+  // Ground points over points in range, a laser drifting beyond the distance
+  // threshold loses its inliers before its bias can show it
+  TrackedValue InlierRatio;
+  bool BiasAlarm = false;
+  bool RatioAlarm = false;
+
+  bool IsAlarm() const { return this->BiasAlarm || this->RatioAlarm; }
+
+  // Raised above the threshold, cleared below the threshold lowered by the
+  // hysteresis
+  void UpdateBiasAlarm(double threshold, double hysteresis)
+  {
+    const double drift = std::abs(this->Bias.GetDrift());
+    this->BiasAlarm = drift > (this->BiasAlarm ? (1. - hysteresis) * threshold : threshold);
+  }
+
+  // Raised below a fraction of the baseline, cleared above that fraction
+  // raised by the hysteresis
+  void UpdateRatioAlarm(double minRatio, double hysteresis)
+  {
+    const double level = minRatio * this->InlierRatio.Baseline;
+    this->RatioAlarm =
+      this->InlierRatio.Smoothed < (this->RatioAlarm ? (1. + hysteresis) * level : level);
+  }
+};
+}
+
+//-----------------------------------------------------------------------------
+struct vtkLidarGroundDriftMonitor::vtkInternals
+{
+  std::map<int, DriftStatistics> Statistics;
+  bool HasPlane = false;
+  double Normal[3] = { 0., 0., 1. };
+  double Origin[3] = { 0., 0., 0. };
+  // Last frame accounted for
+  vtkMTimeType InputTime = 0;
+};
+
+//-----------------------------------------------------------------------------
+vtkLidarGroundDriftMonitor::vtkLidarGroundDriftMonitor()
+  : Internals(new vtkInternals)
+{
+  this->SetLaserIdArrayName("laser_id");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarGroundDriftMonitor::~vtkLidarGroundDriftMonitor()
+{
+  this->SetLaserIdArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarGroundDriftMonitor::ResetStatistics()
+{
+  this->Internals->Statistics.clear();
+  this->Internals->HasPlane = false;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarGroundDriftMonitor::GetNumberOfAlarms()
+{
+  int nbAlarms = 0;
+  for (const auto& laser : this->Internals->Statistics)
+  {
+    nbAlarms += laser.second.IsAlarm() ? 1 : 0;
+  }
+  return nbAlarms;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarGroundDriftMonitor::FillInputPortInformation(int port, vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  return port == 0 ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarGroundDriftMonitor::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkTable* output = vtkTable::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+
+  vtkInternals& internals = *this->Internals;
+  if (input->GetPoints() && input->GetMTime() != internals.InputTime)
+  {
+    internals.InputTime = input->GetMTime();
+
+    // Ground candidates: the points close to the sensor
+    vtkDataArray* points = input->GetPoints()->GetData();
+    const double maxRange2 = this->MaxRange * this->MaxRange;
+    std::vector<vtkIdType> ids;
+    if (auto floatPoints = vtkFloatArray::FastDownCast(points))
+    {
+      SelectCloseIds(floatPoints->GetPointer(0), floatPoints->GetNumberOfTuples(), maxRange2, ids);
+    }
+    else if (auto doublePoints = vtkDoubleArray::FastDownCast(points))
+    {
+      SelectCloseIds(
+        doublePoints->GetPointer(0), doublePoints->GetNumberOfTuples(), maxRange2, ids);
+    }
+    else
+    {
+      double p[3];
+      for (vtkIdType i = 0; i < points->GetNumberOfTuples(); ++i)
+      {
+        points->GetTuple(i, p);
+        if (p[0] * p[0] + p[1] * p[1] <= maxRange2)
+        {
+          ids.push_back(i);
+        }
+      }
+    }
+
+    LidarPlaneFit fit;
+    fit.SetThreshold(this->DistanceThreshold);
+    fit.SetMaxIterations(this->MaxIterations);
+    fit.SetMaxSamples(MAX_SAMPLES);
+    if (internals.HasPlane)
+    {
+      fit.SetInitialPlane(internals.Normal, internals.Origin);
+    }
+    vtkDataArray* laserIds =
+      this->LaserIdArrayName ? input->GetPointData()->GetArray(this->LaserIdArrayName) : nullptr;
+    std::string error;
+    if (fit.Fit(points, ids, laserIds, &error))
+    {
+      std::copy(fit.GetNormal(), fit.GetNormal() + 3, internals.Normal);
+      std::copy(fit.GetOrigin(), fit.GetOrigin() + 3, internals.Origin);
+      internals.HasPlane = true;
+
+      // The sensor is the origin of the frame
+      std::vector<int> raised;
+      const double sensorHeight = -vtkMath::Dot(internals.Normal, internals.Origin);
+      DriftStatistics& height = internals.Statistics[HEIGHT_ROW];
+      if (height.Bias.Update(sensorHeight, this->WarmupFrames, this->SmoothingFactor))
+      {
+        const bool wasAlarm = height.IsAlarm();
+        height.UpdateBiasAlarm(this->DriftThreshold, this->AlarmHysteresis);
+        if (height.IsAlarm() && !wasAlarm)
+        {
+          raised.push_back(HEIGHT_ROW);
+        }
+      }
+      // The first statistics are the global ones, their mean bias is zero
+      const std::vector<LidarPlaneFit::Statistics>& stats = fit.GetStatistics();
+      for (std::size_t i = 1; i < stats.size(); ++i)
+      {
+        DriftStatistics& laser = internals.Statistics[stats[i].LaserId];
+        const bool wasAlarm = laser.IsAlarm();
+        if (stats[i].NbPoints >= MIN_LASER_POINTS &&
+          laser.InlierRatio.Update(static_cast<double>(stats[i].NbInliers) / stats[i].NbPoints,
+            this->WarmupFrames, this->SmoothingFactor))
+        {
+          laser.UpdateRatioAlarm(this->MinInlierRatio, this->AlarmHysteresis);
+        }
+        if (stats[i].NbInliers >= MIN_LASER_INLIERS &&
+          laser.Bias.Update(stats[i].InlierMean, this->WarmupFrames, this->SmoothingFactor))
+        {
+          laser.UpdateBiasAlarm(this->DriftThreshold, this->AlarmHysteresis);
+        }
+        if (laser.IsAlarm() && !wasAlarm)
+        {
+          raised.push_back(stats[i].LaserId);
+        }
+      }
+
+      if (!raised.empty())
+      {
+        std::ostringstream message;
+        for (int laser : raised)
+        {
+          if (laser == HEIGHT_ROW)
+          {
+            message << " sensor height";
+          }
+          else
+          {
+            message << " laser " << laser;
+          }
+          const DriftStatistics& laserStats = internals.Statistics[laser];
+          message << " (" << laserStats.Bias.GetDrift() << " m";
+          if (laserStats.RatioAlarm)
+          {
+            message << ", " << 100. * laserStats.InlierRatio.Smoothed << "% of ground points";
+          }
+          message << ")";
+        }
+        vtkWarningMacro(<< "Calibration drift detected:" << message.str());
+      }
+    }
+    else
+    {
+      vtkDebugMacro(<< "No ground plane in this frame: " << error);
+    }
+  }
+
+  // One row per laser tracked, the sensor height first
+  const vtkIdType nbRows = static_cast<vtkIdType>(internals.Statistics.size());
+  vtkNew<vtkIntArray> laser;
+  laser->SetName("laser_id");
+  vtkNew<vtkIdTypeArray> frames;
+  frames->SetName("frames");
+  vtkNew<vtkDoubleArray> baseline;
+  baseline->SetName("baseline");
+  vtkNew<vtkDoubleArray> baselineStdDev;
+  baselineStdDev->SetName("baseline_stddev");
+  vtkNew<vtkDoubleArray> smoothed;
+  smoothed->SetName("bias");
+  vtkNew<vtkDoubleArray> drift;
+  drift->SetName("drift");
+  vtkNew<vtkDoubleArray> last;
+  last->SetName("last");
+  vtkNew<vtkDoubleArray> baselineRatio;
+  baselineRatio->SetName("baseline_inlier_ratio");
+  vtkNew<vtkDoubleArray> ratio;
+  ratio->SetName("inlier_ratio");
+  vtkNew<vtkUnsignedCharArray> alarm;
+  alarm->SetName("alarm");
+  vtkDataArray* columns[] = { laser, frames, baseline, baselineStdDev, smoothed, drift, last,
+    baselineRatio, ratio, alarm };
+  for (vtkDataArray* column : columns)
+  {
+    column->SetNumberOfTuples(nbRows);
+    output->AddColumn(column);
+  }
+  vtkIdType row = 0;
+  int nbAlarms = 0;
+  for (const auto& entry : internals.Statistics)
+  {
+    const TrackedValue& bias = entry.second.Bias;
+    laser->SetValue(row, entry.first);
+    frames->SetValue(row, bias.Frames);
+    baseline->SetValue(row, bias.Baseline);
+    baselineStdDev->SetValue(row, bias.GetBaselineStdDev());
+    smoothed->SetValue(row, bias.Smoothed);
+    drift->SetValue(row, bias.GetDrift());
+    last->SetValue(row, bias.Last);
+    baselineRatio->SetValue(row, entry.second.InlierRatio.Baseline);
+    ratio->SetValue(row, entry.second.InlierRatio.Smoothed);
+    alarm->SetValue(row, entry.second.IsAlarm() ? 1 : 0);
+    nbAlarms += entry.second.IsAlarm() ? 1 : 0;
+    ++row;
+  }
+
+  vtkFieldData* fieldData = output->GetFieldData();
+  if (internals.HasPlane)
+  {
+    vtkNew<vtkDoubleArray> normal;
+    normal->SetName("plane_normal");
+    normal->SetNumberOfComponents(3);
+    normal->InsertNextTuple(internals.Normal);
+    fieldData->AddArray(normal);
+    vtkNew<vtkDoubleArray> origin;
+    origin->SetName("plane_origin");
+    origin->SetNumberOfComponents(3);
+    origin->InsertNextTuple(internals.Origin);
+    fieldData->AddArray(origin);
+  }
+  vtkNew<vtkIntArray> alarms;
+  alarms->SetName("alarms");
+  alarms->InsertNextValue(nbAlarms);
+  fieldData->AddArray(alarms);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarGroundDriftMonitor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserIdArrayName: "
+     << (this->LaserIdArrayName ? this->LaserIdArrayName : "(none)") << endl;
+  os << indent << "DistanceThreshold: " << this->DistanceThreshold << endl;
+  os << indent << "MaxRange: " << this->MaxRange << endl;
+  os << indent << "MaxIterations: " << this->MaxIterations << endl;
+  os << indent << "WarmupFrames: " << this->WarmupFrames << endl;
+  os << indent << "SmoothingFactor: " << this->SmoothingFactor << endl;
+  os << indent << "DriftThreshold: " << this->DriftThreshold << endl;
+  os << indent << "MinInlierRatio: " << this->MinInlierRatio << endl;
+  os << indent << "AlarmHysteresis: " << this->AlarmHysteresis << endl;
+  os << indent << "Lasers tracked: " << this->Internals->Statistics.size() << endl;
+}
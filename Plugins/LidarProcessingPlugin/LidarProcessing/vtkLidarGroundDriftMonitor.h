@@ -0,0 +1,169 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarGroundDriftMonitor.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarGroundDriftMonitor_h
+#define vtkLidarGroundDriftMonitor_h
+
+#include <vtkTableAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <memory>
+
+/**
+ * @class vtkLidarGroundDriftMonitor
+ * @brief Track the ground plane and the bias of each laser over a stream.
+ *
+ * Each new frame, the ground plane is fitted with LidarPlaneFit on the points
+ * closer than MaxRange, the plane of the previous frame being scored first so
+ * that few hypotheses are drawn while it still fits. The mean signed distance
+ * of the inliers of each laser to the plane is its bias for the frame.
+ *
+ * Per laser, in constant memory and time:
+ *  - the bias of the first WarmupFrames frames is averaged into a baseline
+ *    (Welford mean and standard deviation)
+ *  - the bias of the following frames is smoothed by an exponential moving
+ *    average
+ *  - an alarm is raised when the smoothed bias drifts from the baseline by
+ *    more than DriftThreshold, and cleared once the drift falls below
+ *    (1 - AlarmHysteresis) times DriftThreshold.
+ * The bias only accounts for the inliers: the points of a laser drifting
+ * beyond DistanceThreshold leave its bias instead of shifting it. The ratio of
+ * inliers among the points of each laser in range is thus tracked the same
+ * way, and an alarm is also raised when its smoothed value falls below
+ * MinInlierRatio times its baseline, cleared once it rises above
+ * (1 + AlarmHysteresis) times that level.
+ * The row of laser_id -1 tracks the sensor height above the plane the same way.
+ *
+ * A frame is accounted for once: updating the pipeline again on the same frame
+ * does not change the statistics.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarGroundDriftMonitor : public vtkTableAlgorithm
+{
+public:
+  static vtkLidarGroundDriftMonitor* New();
+  vtkTypeMacro(vtkLidarGroundDriftMonitor, vtkTableAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Name of the laser index array. Default is "laser_id".
+   */
+  vtkSetStringMacro(LaserIdArrayName);
+  vtkGetStringMacro(LaserIdArrayName);
+  //@}
+
+  //@{
+  /**
+   * Maximum distance of a ground point to the plane. Default is 0.1 m.
+   */
+  vtkSetClampMacro(DistanceThreshold, double, 1e-6, VTK_DOUBLE_MAX);
+  vtkGetMacro(DistanceThreshold, double);
+  //@}
+
+  //@{
+  /**
+   * Only the points closer than MaxRange (in the XY plane) are used to fit the
+   * ground. Default is 30 m.
+   */
+  vtkSetClampMacro(MaxRange, double, 0.1, VTK_DOUBLE_MAX);
+  vtkGetMacro(MaxRange, double);
+  //@}
+
+  //@{
+  /**
+   * Maximum number of RANSAC hypotheses per frame. Default is 100.
+   */
+  vtkSetClampMacro(MaxIterations, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaxIterations, int);
+  //@}
+
+  //@{
+  /**
+   * Number of frames averaged into the baseline of each laser. Default is 50.
+   */
+  vtkSetClampMacro(WarmupFrames, int, 1, VTK_INT_MAX);
+  vtkGetMacro(WarmupFrames, int);
+  //@}
+
+  //@{
+  /**
+   * Weight of the new frame in the moving average of the bias. Default is 0.05,
+   * about the last 20 frames.
+   */
+  vtkSetClampMacro(SmoothingFactor, double, 1e-6, 1.);
+  vtkGetMacro(SmoothingFactor, double);
+  //@}
+
+  //@{
+  /**
+   * Drift of the smoothed bias from the baseline raising an alarm.
+   * Default is 0.03 m.
+   */
+  vtkSetClampMacro(DriftThreshold, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(DriftThreshold, double);
+  //@}
+
+  //@{
+  /**
+   * Fraction of its baseline inlier ratio below which the smoothed inlier
+   * ratio of a laser raises an alarm. Default is 0.5.
+   */
+  vtkSetClampMacro(MinInlierRatio, double, 0., 1.);
+  vtkGetMacro(MinInlierRatio, double);
+  //@}
+
+  //@{
+  /**
+   * Relative margin by which a value must come back within its threshold to
+   * clear its alarm, so that a value hovering around the threshold does not
+   * toggle the alarm every frame. Default is 0.2.
+   */
+  vtkSetClampMacro(AlarmHysteresis, double, 0., 1.);
+  vtkGetMacro(AlarmHysteresis, double);
+  //@}
+
+  /**
+   * Forget the baselines and the alarms, for example after a recalibration.
+   */
+  void ResetStatistics();
+
+  /**
+   * Number of lasers, and sensor height, currently in alarm.
+   */
+  int GetNumberOfAlarms();
+
+protected:
+  vtkLidarGroundDriftMonitor();
+  ~vtkLidarGroundDriftMonitor() override;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* LaserIdArrayName = nullptr;
+  double DistanceThreshold = 0.1;
+  double MaxRange = 30.;
+  int MaxIterations = 100;
+  int WarmupFrames = 50;
+  double SmoothingFactor = 0.05;
+  double DriftThreshold = 0.03;
+  double MinInlierRatio = 0.5;
+  double AlarmHysteresis = 0.2;
+
+private:
+  vtkLidarGroundDriftMonitor(const vtkLidarGroundDriftMonitor&) = delete;
+  void operator=(const vtkLidarGroundDriftMonitor&) = delete;
+
+  struct vtkInternals;
+  std::unique_ptr<vtkInternals> Internals;
+};
+
+#endif // vtkLidarGroundDriftMonitor_h
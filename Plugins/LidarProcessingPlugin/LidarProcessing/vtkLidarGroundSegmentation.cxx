@@ -0,0 +1,219 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarGroundSegmentation.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarGroundSegmentation.h"
+
+#include "LidarProcessingHelper.h"
+
+#include <vtkIdList.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarGroundSegmentation)
+
+namespace
+{
+// Empty pixels skipped when looking for the neighbors of a cluster pixel
+constexpr int MAX_CLUSTER_GAP = 1;
+
+// Columns walked together, to read the rows of the image in order
+constexpr int TILE_COLUMNS = 64;
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarGroundSegmentation::vtkLidarGroundSegmentation()
+{
+  this->SetLaserIdArrayName("laser_id");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarGroundSegmentation::~vtkLidarGroundSegmentation()
+{
+  this->SetLaserIdArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarGroundSegmentation::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  vtkDataArray* laserIds =
+    this->LaserIdArrayName ? input->GetPointData()->GetArray(this->LaserIdArrayName) : nullptr;
+  if (nbPoints == 0 || !laserIds)
+  {
+    if (nbPoints > 0)
+    {
+      vtkWarningMacro(<< "No \"" << (this->LaserIdArrayName ? this->LaserIdArrayName : "")
+                      << "\" laser array, the frame is not segmented");
+    }
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  vtkDataArray* points = input->GetPoints()->GetData();
+  LidarRangeImage& image = this->RangeImage;
+  image.SetNumberOfColumns(this->NumberOfColumns);
+  std::string error;
+  if (!image.Build(points, laserIds, nullptr, &error))
+  {
+    vtkErrorMacro(<< error);
+    return 0;
+  }
+
+  // Walk each column upwards from the ground below the sensor. A tile of
+  // columns is walked row by row, reading the image in memory order
+  const int nbColumns = image.GetWidth();
+  const int nbRows = image.GetHeight();
+  std::vector<unsigned char>& pixelLabels = this->PixelLabels;
+  pixelLabels.assign(image.GetNumberOfPixels(), UNLABELED);
+  const double maxSlope = std::tan(vtkMath::RadiansFromDegrees(this->MaxSlope));
+  const double threshold = this->GroundThreshold;
+  const double sensorHeight = this->SensorHeight;
+  vtkSMPTools::For(0, nbColumns, [&](vtkIdType begin, vtkIdType end) {
+    double groundRanges[TILE_COLUMNS];
+    double groundHeights[TILE_COLUMNS];
+    for (vtkIdType tile = begin; tile < end; tile += TILE_COLUMNS)
+    {
+      const int tileSize = static_cast<int>(std::min<vtkIdType>(TILE_COLUMNS, end - tile));
+      std::fill(groundRanges, groundRanges + tileSize, 0.);
+      std::fill(groundHeights, groundHeights + tileSize, -sensorHeight);
+      for (int row = 0; row < nbRows; ++row)
+      {
+        const vtkIdType rowPixel = image.GetPixel(row, static_cast<int>(tile));
+        for (int k = 0; k < tileSize; ++k)
+        {
+          const vtkIdType pixel = rowPixel + k;
+          if (image.GetPointId(pixel) < 0)
+          {
+            continue;
+          }
+          const float* position = image.GetPosition(pixel);
+          const double range = std::sqrt(position[0] * position[0] + position[1] * position[1]);
+          const double dz = position[2] - groundHeights[k];
+          if (std::abs(dz) <= std::max(range - groundRanges[k], 0.) * maxSlope + threshold)
+          {
+            pixelLabels[pixel] = GROUND;
+            groundRanges[k] = range;
+            groundHeights[k] = position[2];
+          }
+          else
+          {
+            pixelLabels[pixel] = OBSTACLE;
+          }
+        }
+      }
+    }
+  });
+
+  // Label the points from their pixel, the points sharing the pixel of a
+  // ground point may stand above it
+  vtkNew<vtkUnsignedCharArray> labels;
+  labels->SetName("ground_label");
+  labels->SetNumberOfTuples(nbPoints);
+  unsigned char* label = labels->GetPointer(0);
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      const vtkIdType pixel = image.GetPointPixel(i);
+      if (pixel < 0)
+      {
+        label[i] = UNLABELED;
+      }
+      else if (pixelLabels[pixel] != GROUND)
+      {
+        label[i] = OBSTACLE;
+      }
+      else
+      {
+        label[i] = image.GetPointId(pixel) == i ||
+            points->GetComponent(i, 2) - image.GetPosition(pixel)[2] <= threshold
+          ? GROUND
+          : OBSTACLE;
+      }
+    }
+  });
+
+  vtkNew<vtkPolyData> labeled;
+  labeled->ShallowCopy(input);
+  labeled->GetPointData()->AddArray(labels);
+
+  if (this->GenerateClusters)
+  {
+    vtkNew<vtkIntArray> clusters;
+    clusters->SetName("cluster_id");
+    clusters->SetNumberOfTuples(nbPoints);
+    std::vector<unsigned char> mask(nbPoints);
+    vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        mask[i] = label[i] == OBSTACLE ? 1 : 0;
+      }
+    });
+    image.ClusterPoints(mask.data(), this->ClusterTolerance, MAX_CLUSTER_GAP,
+      this->MinClusterSize, clusters->GetPointer(0));
+    labeled->GetPointData()->AddArray(clusters);
+  }
+
+  if (!this->ExtractObstacles)
+  {
+    output->ShallowCopy(labeled);
+    return 1;
+  }
+  vtkNew<vtkIdList> obstacleIds;
+  obstacleIds->Allocate(nbPoints);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (label[i] == OBSTACLE)
+    {
+      obstacleIds->InsertNextId(i);
+    }
+  }
+  LidarProcessingHelper::ExtractPoints(labeled, obstacleIds, output);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarGroundSegmentation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserIdArrayName: "
+     << (this->LaserIdArrayName ? this->LaserIdArrayName : "(none)") << endl;
+  os << indent << "NumberOfColumns: " << this->NumberOfColumns << endl;
+  os << indent << "SensorHeight: " << this->SensorHeight << endl;
+  os << indent << "MaxSlope: " << this->MaxSlope << endl;
+  os << indent << "GroundThreshold: " << this->GroundThreshold << endl;
+  os << indent << "ExtractObstacles: " << this->ExtractObstacles << endl;
+  os << indent << "GenerateClusters: " << this->GenerateClusters << endl;
+  os << indent << "ClusterTolerance: " << this->ClusterTolerance << endl;
+  os << indent << "MinClusterSize: " << this->MinClusterSize << endl;
+}
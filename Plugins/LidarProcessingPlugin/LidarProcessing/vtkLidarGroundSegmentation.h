@@ -0,0 +1,158 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarGroundSegmentation.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarGroundSegmentation_h
+#define vtkLidarGroundSegmentation_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+#include "LidarRangeImage.h"       // for member
+
+#include <vector>
+
+/**
+ * @class vtkLidarGroundSegmentation
+ * @brief Label the ground and the obstacles of a lidar frame, scan line by scan line.
+ *
+ * The frame is projected into a range image (see LidarRangeImage): lasers
+ * sorted by elevation by azimuth columns. Each column is then walked
+ * from the lowest laser upwards, starting from the ground below the sensor: a
+ * point continues the ground when the slope from the last ground point is
+ * below MaxSlope. Every point of a pixel takes the label of the pixel, unless
+ * it is higher than GroundThreshold above a ground pixel.
+ *
+ * Obstacle points can optionally be clustered: neighbor pixels of the image
+ * (along the scan line and between adjacent lasers) are connected when their
+ * points are closer than ClusterTolerance.
+ *
+ * Columns are processed in parallel. Output arrays:
+ *  - ground_label: 0 for points without a valid laser, 1 ground, 2 obstacle
+ *  - cluster_id: obstacle cluster index, -1 for the other points
+ *    (GenerateClusters only)
+ */
+class LIDARPROCESSING_EXPORT vtkLidarGroundSegmentation : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarGroundSegmentation* New();
+  vtkTypeMacro(vtkLidarGroundSegmentation, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum Label
+  {
+    UNLABELED = 0,
+    GROUND = 1,
+    OBSTACLE = 2
+  };
+
+  //@{
+  /**
+   * Name of the laser index array. Default is "laser_id".
+   */
+  vtkSetStringMacro(LaserIdArrayName);
+  vtkGetStringMacro(LaserIdArrayName);
+  //@}
+
+  //@{
+  /**
+   * Number of azimuth columns of the range image. Default is 2048.
+   */
+  vtkSetClampMacro(NumberOfColumns, int, 16, 65536);
+  vtkGetMacro(NumberOfColumns, int);
+  //@}
+
+  //@{
+  /**
+   * Height of the sensor above the ground, the starting point of each column.
+   * Default is 1.8 m.
+   */
+  vtkSetMacro(SensorHeight, double);
+  vtkGetMacro(SensorHeight, double);
+  //@}
+
+  //@{
+  /**
+   * Maximum slope of the ground between two consecutive lasers, in degrees.
+   * Default is 10.
+   */
+  vtkSetClampMacro(MaxSlope, double, 0., 89.);
+  vtkGetMacro(MaxSlope, double);
+  //@}
+
+  //@{
+  /**
+   * Height tolerance of the ground, absorbing the measurement noise.
+   * Default is 0.15 m.
+   */
+  vtkSetClampMacro(GroundThreshold, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(GroundThreshold, double);
+  //@}
+
+  //@{
+  /**
+   * Keep only the obstacle points in the output. Default is false.
+   */
+  vtkSetMacro(ExtractObstacles, bool);
+  vtkGetMacro(ExtractObstacles, bool);
+  vtkBooleanMacro(ExtractObstacles, bool);
+  //@}
+
+  //@{
+  /**
+   * Cluster the obstacle points. Default is false.
+   */
+  vtkSetMacro(GenerateClusters, bool);
+  vtkGetMacro(GenerateClusters, bool);
+  vtkBooleanMacro(GenerateClusters, bool);
+  //@}
+
+  //@{
+  /**
+   * Maximum distance between two neighbor points of a cluster. Default is 0.5 m.
+   */
+  vtkSetClampMacro(ClusterTolerance, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(ClusterTolerance, double);
+  //@}
+
+  //@{
+  /**
+   * Clusters with fewer points are discarded (cluster_id -1). Default is 10.
+   */
+  vtkSetClampMacro(MinClusterSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MinClusterSize, int);
+  //@}
+
+protected:
+  vtkLidarGroundSegmentation();
+  ~vtkLidarGroundSegmentation() override;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* LaserIdArrayName = nullptr;
+  int NumberOfColumns = 2048;
+  double SensorHeight = 1.8;
+  double MaxSlope = 10.;
+  double GroundThreshold = 0.15;
+  bool ExtractObstacles = false;
+  bool GenerateClusters = false;
+  double ClusterTolerance = 0.5;
+  int MinClusterSize = 10;
+
+private:
+  vtkLidarGroundSegmentation(const vtkLidarGroundSegmentation&) = delete;
+  void operator=(const vtkLidarGroundSegmentation&) = delete;
+
+  // Kept from frame to frame to reuse their buffers
+  LidarRangeImage RangeImage;
+  std::vector<unsigned char> PixelLabels;
+};
+
+#endif // vtkLidarGroundSegmentation_h
@@ -0,0 +1,491 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarObjectTracker.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarObjectTracker.h"
+
+#include "LidarRangeImage.h"
+#include "vtkLidarGroundSegmentation.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarObjectTracker)
+
+namespace
+{
+// Empty pixels skipped when looking for the neighbors of a cluster pixel
+constexpr int MAX_CLUSTER_GAP = 1;
+// Weight of a new measure in the velocity of a track
+constexpr double VELOCITY_GAIN = 0.5;
+
+//-----------------------------------------------------------------------------
+struct OrientedBox
+{
+  double Center[3] = { 0., 0., 0. };
+  // Angle of the length axis with the x axis, in radians
+  double Heading = 0.;
+  double Size[3] = { 0., 0., 0. };
+  vtkIdType NbPoints = 0;
+};
+
+//-----------------------------------------------------------------------------
+struct Track
+{
+  int Id = -1;
+  OrientedBox Box;
+  double Velocity[2] = { 0., 0. };
+  int Hits = 0;
+  int Misses = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Oriented bounding box of each cluster, clusters processed in parallel
+void ComputeBoxes(vtkDataArray* points, const int* clusters, vtkIdType nbPoints, int nbClusters,
+  std::vector<OrientedBox>& boxes)
+{
+  // Points sorted by cluster
+  std::vector<vtkIdType> offsets(nbClusters + 1, 0);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (clusters[i] >= 0)
+    {
+      offsets[clusters[i] + 1]++;
+    }
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<vtkIdType> sorted(offsets.back());
+  std::vector<vtkIdType> next(offsets.begin(), offsets.end() - 1);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (clusters[i] >= 0)
+    {
+      sorted[next[clusters[i]]++] = i;
+    }
+  }
+
+  boxes.resize(nbClusters);
+  vtkSMPTools::For(0, nbClusters, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<double> coordinates;
+    for (vtkIdType cluster = begin; cluster < end; ++cluster)
+    {
+      const vtkIdType nbClusterPoints = offsets[cluster + 1] - offsets[cluster];
+      coordinates.resize(3 * nbClusterPoints);
+      double mean[2] = { 0., 0. };
+      for (vtkIdType k = 0; k < nbClusterPoints; ++k)
+      {
+        double* p = coordinates.data() + 3 * k;
+        points->GetTuple(sorted[offsets[cluster] + k], p);
+        mean[0] += p[0];
+        mean[1] += p[1];
+      }
+      mean[0] /= nbClusterPoints;
+      mean[1] /= nbClusterPoints;
+
+      // Heading: principal axis of the horizontal covariance
+      double xx = 0., xy = 0., yy = 0.;
+      for (vtkIdType k = 0; k < nbClusterPoints; ++k)
+      {
+        const double dx = coordinates[3 * k] - mean[0];
+        const double dy = coordinates[3 * k + 1] - mean[1];
+        xx += dx * dx;
+        xy += dx * dy;
+        yy += dy * dy;
+      }
+      OrientedBox& box = boxes[cluster];
+      box.Heading = 0.5 * std::atan2(2. * xy, xx - yy);
+      const double u[2] = { std::cos(box.Heading), std::sin(box.Heading) };
+
+      double low[3], high[3];
+      std::fill(low, low + 3, std::numeric_limits<double>::max());
+      std::fill(high, high + 3, std::numeric_limits<double>::lowest());
+      for (vtkIdType k = 0; k < nbClusterPoints; ++k)
+      {
+        const double dx = coordinates[3 * k] - mean[0];
+        const double dy = coordinates[3 * k + 1] - mean[1];
+        const double local[3] = { dx * u[0] + dy * u[1], dy * u[0] - dx * u[1],
+          coordinates[3 * k + 2] };
+        for (int c = 0; c < 3; ++c)
+        {
+          low[c] = std::min(low[c], local[c]);
+          high[c] = std::max(high[c], local[c]);
+        }
+      }
+      const double along = 0.5 * (low[0] + high[0]);
+      const double across = 0.5 * (low[1] + high[1]);
+      box.Center[0] = mean[0] + along * u[0] - across * u[1];
+      box.Center[1] = mean[1] + along * u[1] + across * u[0];
+      box.Center[2] = 0.5 * (low[2] + high[2]);
+      for (int c = 0; c < 3; ++c)
+      {
+        box.Size[c] = high[c] - low[c];
+      }
+      box.NbPoints = nbClusterPoints;
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+void AddBox(const OrientedBox& box, vtkPoints* points, vtkCellArray* polys)
+{
+  const double u[2] = { std::cos(box.Heading), std::sin(box.Heading) };
+  const vtkIdType first = points->GetNumberOfPoints();
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    const double along = (corner & 1 ? 0.5 : -0.5) * box.Size[0];
+    const double across = (corner & 2 ? 0.5 : -0.5) * box.Size[1];
+    const double up = (corner & 4 ? 0.5 : -0.5) * box.Size[2];
+    points->InsertNextPoint(box.Center[0] + along * u[0] - across * u[1],
+      box.Center[1] + along * u[1] + across * u[0], box.Center[2] + up);
+  }
+  static const vtkIdType faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+    { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+  for (const auto& face : faces)
+  {
+    const vtkIdType ids[4] = { first + face[0], first + face[1], first + face[2],
+      first + face[3] };
+    polys->InsertNextCell(4, ids);
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+struct vtkLidarObjectTracker::vtkInternals
+{
+  std::vector<Track> Tracks;
+  int NextId = 0;
+  // Last frame accounted for
+  vtkMTimeType InputTime = 0;
+  bool HasTime = false;
+  double Time = 0.;
+  // Tracks before the last frame, restored when it is executed again
+  std::vector<Track> PreviousTracks;
+  int PreviousNextId = 0;
+  double PreviousDt = 1.;
+  // Track of each cluster of the last frame, -1 for the unreported ones
+  std::vector<int> ClusterTracks;
+  int NumberOfObjects = 0;
+
+  void Reset()
+  {
+    this->Tracks.clear();
+    this->PreviousTracks.clear();
+    this->PreviousNextId = this->NextId;
+    this->ClusterTracks.clear();
+    this->HasTime = false;
+    this->InputTime = 0;
+  }
+
+  void Update(const std::vector<OrientedBox>& boxes, double dt, double gate, int maxMisses,
+    int minHits);
+};
+
+//-----------------------------------------------------------------------------
+void vtkLidarObjectTracker::vtkInternals::Update(
+  const std::vector<OrientedBox>& boxes, double dt, double gate, int maxMisses, int minHits)
+{
+  // Greedy association by increasing distance to the predictions
+  std::vector<std::tuple<double, std::size_t, std::size_t>> candidates;
+  for (std::size_t t = 0; t < this->Tracks.size(); ++t)
+  {
+    const Track& track = this->Tracks[t];
+    const double predicted[2] = { track.Box.Center[0] + track.Velocity[0] * dt,
+      track.Box.Center[1] + track.Velocity[1] * dt };
+    for (std::size_t c = 0; c < boxes.size(); ++c)
+    {
+      const double dx = boxes[c].Center[0] - predicted[0];
+      const double dy = boxes[c].Center[1] - predicted[1];
+      const double distance2 = dx * dx + dy * dy;
+      if (distance2 <= gate * gate)
+      {
+        candidates.emplace_back(distance2, t, c);
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  std::vector<int> clusterTracks(boxes.size(), -1);
+  std::vector<bool> matched(this->Tracks.size(), false);
+  for (const auto& candidate : candidates)
+  {
+    const std::size_t t = std::get<1>(candidate);
+    const std::size_t c = std::get<2>(candidate);
+    if (matched[t] || clusterTracks[c] >= 0)
+    {
+      continue;
+    }
+    matched[t] = true;
+    clusterTracks[c] = static_cast<int>(t);
+
+    Track& track = this->Tracks[t];
+    for (int i = 0; i < 2; ++i)
+    {
+      const double measured = (boxes[c].Center[i] - track.Box.Center[i]) / dt;
+      // The first measure of the velocity needs two matches
+      track.Velocity[i] = track.Hits == 1
+        ? measured
+        : track.Velocity[i] + VELOCITY_GAIN * (measured - track.Velocity[i]);
+    }
+    track.Box = boxes[c];
+    track.Hits++;
+    track.Misses = 0;
+  }
+
+  // Unmatched tracks coast, unmatched clusters start new tracks
+  for (std::size_t t = 0; t < this->Tracks.size(); ++t)
+  {
+    if (!matched[t])
+    {
+      Track& track = this->Tracks[t];
+      track.Box.Center[0] += track.Velocity[0] * dt;
+      track.Box.Center[1] += track.Velocity[1] * dt;
+      track.Box.NbPoints = 0;
+      track.Misses++;
+    }
+  }
+  for (std::size_t c = 0; c < boxes.size(); ++c)
+  {
+    if (clusterTracks[c] < 0)
+    {
+      Track track;
+      track.Id = this->NextId++;
+      track.Box = boxes[c];
+      track.Hits = 1;
+      clusterTracks[c] = static_cast<int>(this->Tracks.size());
+      this->Tracks.push_back(track);
+    }
+  }
+
+  // Report the track ids, then drop the lost tracks
+  this->ClusterTracks.assign(boxes.size(), -1);
+  for (std::size_t c = 0; c < boxes.size(); ++c)
+  {
+    const Track& track = this->Tracks[clusterTracks[c]];
+    this->ClusterTracks[c] = track.Hits >= minHits ? track.Id : -1;
+  }
+  this->Tracks.erase(std::remove_if(this->Tracks.begin(), this->Tracks.end(),
+                       [&](const Track& track) { return track.Misses > maxMisses; }),
+    this->Tracks.end());
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarObjectTracker::vtkLidarObjectTracker()
+  : Internals(new vtkInternals)
+{
+  this->SetNumberOfOutputPorts(2);
+  this->SetLaserIdArrayName("laser_id");
+  this->SetGroundLabelArrayName("ground_label");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarObjectTracker::~vtkLidarObjectTracker()
+{
+  this->SetLaserIdArrayName(nullptr);
+  this->SetGroundLabelArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarObjectTracker::ResetTracks()
+{
+  this->Internals->Reset();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarObjectTracker::GetNumberOfObjects()
+{
+  return this->Internals->NumberOfObjects;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarObjectTracker::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  vtkPolyData* boxOutput = vtkPolyData::GetData(outputVector, 1);
+  if (!input || !output || !boxOutput)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+  output->ShallowCopy(input);
+  vtkInternals& internals = *this->Internals;
+  internals.NumberOfObjects = 0;
+
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  vtkPointData* pointData = input->GetPointData();
+  vtkDataArray* laserIds =
+    this->LaserIdArrayName ? pointData->GetArray(this->LaserIdArrayName) : nullptr;
+  if (nbPoints == 0 || !laserIds)
+  {
+    if (nbPoints > 0)
+    {
+      vtkWarningMacro(<< "No \"" << (this->LaserIdArrayName ? this->LaserIdArrayName : "")
+                      << "\" laser array, no object is tracked");
+    }
+    return 1;
+  }
+
+  // Clusters of the obstacle points
+  vtkDataArray* points = input->GetPoints()->GetData();
+  LidarRangeImage image;
+  image.SetNumberOfColumns(this->NumberOfColumns);
+  std::string error;
+  if (!image.Build(points, laserIds, nullptr, &error))
+  {
+    vtkErrorMacro(<< error);
+    return 0;
+  }
+  vtkDataArray* groundLabels =
+    this->GroundLabelArrayName ? pointData->GetArray(this->GroundLabelArrayName) : nullptr;
+  std::vector<unsigned char> mask(nbPoints, 1);
+  if (groundLabels && groundLabels->GetNumberOfComponents() == 1)
+  {
+    vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; ++i)
+      {
+        mask[i] = groundLabels->GetComponent(i, 0) == vtkLidarGroundSegmentation::GROUND ? 0 : 1;
+      }
+    });
+  }
+  vtkNew<vtkIntArray> clusters;
+  clusters->SetName("cluster_id");
+  clusters->SetNumberOfTuples(nbPoints);
+  const int nbClusters = image.ClusterPoints(mask.data(), this->ClusterTolerance,
+    MAX_CLUSTER_GAP, this->MinClusterSize, clusters->GetPointer(0));
+  std::vector<OrientedBox> boxes;
+  ComputeBoxes(points, clusters->GetPointer(0), nbPoints, nbClusters, boxes);
+
+  // The tracks only move forward in time. The last frame executed again, e.g.
+  // for a property change, replaces its own update instead of counting as a
+  // new frame. An earlier frame, after seeking backward or when a replay
+  // loops, restarts the tracking. Frames without time are told apart by their
+  // modification time.
+  vtkInformation* inputInfo = input->GetInformation();
+  const bool hasTime = inputInfo->Has(vtkDataObject::DATA_TIME_STEP()) != 0;
+  const double time = hasTime ? inputInfo->Get(vtkDataObject::DATA_TIME_STEP()) : 0.;
+  if (hasTime && internals.HasTime && time < internals.Time)
+  {
+    internals.Reset();
+  }
+  const bool sameFrame = hasTime ? internals.HasTime && time == internals.Time
+                                 : !internals.HasTime && input->GetMTime() == internals.InputTime;
+  double dt = 1.;
+  if (sameFrame)
+  {
+    internals.Tracks = internals.PreviousTracks;
+    internals.NextId = internals.PreviousNextId;
+    dt = internals.PreviousDt;
+  }
+  else
+  {
+    internals.PreviousTracks = internals.Tracks;
+    internals.PreviousNextId = internals.NextId;
+    dt = hasTime && internals.HasTime ? time - internals.Time : 1.;
+    internals.PreviousDt = dt;
+  }
+  internals.InputTime = input->GetMTime();
+  internals.HasTime = hasTime;
+  internals.Time = time;
+  internals.Update(boxes, dt, this->AssociationDistance, this->MaxMissedFrames, this->MinHits);
+
+  // Points of the reported objects
+  vtkNew<vtkIntArray> trackIds;
+  trackIds->SetName("track_id");
+  trackIds->SetNumberOfTuples(nbPoints);
+  const int* cluster = clusters->GetPointer(0);
+  int* trackId = trackIds->GetPointer(0);
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      trackId[i] = cluster[i] >= 0 ? internals.ClusterTracks[cluster[i]] : -1;
+    }
+  });
+  output->GetPointData()->AddArray(clusters);
+  output->GetPointData()->AddArray(trackIds);
+
+  // Boxes of the reported objects
+  vtkNew<vtkPoints> boxPoints;
+  vtkNew<vtkCellArray> boxPolys;
+  vtkNew<vtkIntArray> boxTracks;
+  boxTracks->SetName("track_id");
+  vtkNew<vtkIdTypeArray> boxSizes;
+  boxSizes->SetName("points");
+  vtkNew<vtkDoubleArray> velocities;
+  velocities->SetName("velocity");
+  velocities->SetNumberOfComponents(2);
+  vtkNew<vtkDoubleArray> dimensions;
+  dimensions->SetName("size");
+  dimensions->SetNumberOfComponents(3);
+  for (const Track& track : internals.Tracks)
+  {
+    if (track.Misses > 0 || track.Hits < this->MinHits)
+    {
+      continue;
+    }
+    AddBox(track.Box, boxPoints, boxPolys);
+    for (int face = 0; face < 6; ++face)
+    {
+      boxTracks->InsertNextValue(track.Id);
+      boxSizes->InsertNextValue(track.Box.NbPoints);
+      velocities->InsertNextTuple(track.Velocity);
+      dimensions->InsertNextTuple(track.Box.Size);
+    }
+    internals.NumberOfObjects++;
+  }
+  boxOutput->SetPoints(boxPoints);
+  boxOutput->SetPolys(boxPolys);
+  boxOutput->GetCellData()->AddArray(boxTracks);
+  boxOutput->GetCellData()->AddArray(boxSizes);
+  boxOutput->GetCellData()->AddArray(velocities);
+  boxOutput->GetCellData()->AddArray(dimensions);
+  vtkNew<vtkIntArray> objectCount;
+  objectCount->SetName("object_count");
+  objectCount->InsertNextValue(internals.NumberOfObjects);
+  boxOutput->GetFieldData()->AddArray(objectCount);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarObjectTracker::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserIdArrayName: "
+     << (this->LaserIdArrayName ? this->LaserIdArrayName : "(none)") << endl;
+  os << indent << "GroundLabelArrayName: "
+     << (this->GroundLabelArrayName ? this->GroundLabelArrayName : "(none)") << endl;
+  os << indent << "NumberOfColumns: " << this->NumberOfColumns << endl;
+  os << indent << "ClusterTolerance: " << this->ClusterTolerance << endl;
+  os << indent << "MinClusterSize: " << this->MinClusterSize << endl;
+  os << indent << "AssociationDistance: " << this->AssociationDistance << endl;
+  os << indent << "MaxMissedFrames: " << this->MaxMissedFrames << endl;
+  os << indent << "MinHits: " << this->MinHits << endl;
+  os << indent << "Tracks: " << this->Internals->Tracks.size() << endl;
+}
@@ -0,0 +1,156 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarObjectTracker.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarObjectTracker_h
+#define vtkLidarObjectTracker_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+#include <memory>
+
+/**
+ * @class vtkLidarObjectTracker
+ * @brief Cluster the obstacles of a stream and track them from frame to frame.
+ *
+ * The points that are not ground (see vtkLidarGroundSegmentation, all the
+ * points when there is no ground label array) are clustered by connectivity
+ * in the range image of the frame (see LidarRangeImage::ClusterPoints). Each
+ * cluster gets an oriented bounding box: its heading is the principal axis
+ * of the cluster in the horizontal plane.
+ *
+ * Tracks are predicted with a constant velocity model, then associated with
+ * the clusters by increasing distance between the predicted and the measured
+ * box centers, within AssociationDistance. Unmatched clusters start new
+ * tracks, tracks unmatched for more than MaxMissedFrames are dropped. A track
+ * is reported once it has been matched MinHits times.
+ *
+ * Outputs:
+ *  - port 0: the input frame with the "cluster_id" and "track_id" point
+ *    arrays (-1 for the points outside of a reported object)
+ *  - port 1: one box (8 points, 6 quads) per reported track, with the
+ *    "track_id", "points", "velocity" and "size" cell arrays. The
+ *    "object_count" field array holds the number of boxes.
+ *
+ * The tracks are updated once per input time step: executing the last frame
+ * again replaces its update, and an earlier time step (seeking backward, a
+ * looping replay) resets the tracks. The velocity is in meters per unit of
+ * the pipeline time, or per frame when the frames have no time.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarObjectTracker : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarObjectTracker* New();
+  vtkTypeMacro(vtkLidarObjectTracker, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Name of the laser index array. Default is "laser_id".
+   */
+  vtkSetStringMacro(LaserIdArrayName);
+  vtkGetStringMacro(LaserIdArrayName);
+  //@}
+
+  //@{
+  /**
+   * Name of the ground label array, ground points being labeled 1.
+   * Default is "ground_label".
+   */
+  vtkSetStringMacro(GroundLabelArrayName);
+  vtkGetStringMacro(GroundLabelArrayName);
+  //@}
+
+  //@{
+  /**
+   * Number of azimuth columns of the range image. Default is 2048.
+   */
+  vtkSetClampMacro(NumberOfColumns, int, 16, 65536);
+  vtkGetMacro(NumberOfColumns, int);
+  //@}
+
+  //@{
+  /**
+   * Maximum distance between two neighbor points of a cluster. Default is 0.5 m.
+   */
+  vtkSetClampMacro(ClusterTolerance, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(ClusterTolerance, double);
+  //@}
+
+  //@{
+  /**
+   * Clusters with fewer points are ignored. Default is 10.
+   */
+  vtkSetClampMacro(MinClusterSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MinClusterSize, int);
+  //@}
+
+  //@{
+  /**
+   * Maximum horizontal distance between the predicted center of a track and
+   * the center of the cluster it is associated with. Default is 2 m.
+   */
+  vtkSetClampMacro(AssociationDistance, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(AssociationDistance, double);
+  //@}
+
+  //@{
+  /**
+   * Number of consecutive frames a track can go unmatched before it is
+   * dropped. Default is 3.
+   */
+  vtkSetClampMacro(MaxMissedFrames, int, 0, VTK_INT_MAX);
+  vtkGetMacro(MaxMissedFrames, int);
+  //@}
+
+  //@{
+  /**
+   * Number of matches before a track is reported. Default is 3.
+   */
+  vtkSetClampMacro(MinHits, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MinHits, int);
+  //@}
+
+  /**
+   * Drop all the tracks, e.g. when jumping in a recording.
+   */
+  void ResetTracks();
+
+  /**
+   * Number of tracks reported for the last frame.
+   */
+  int GetNumberOfObjects();
+
+protected:
+  vtkLidarObjectTracker();
+  ~vtkLidarObjectTracker() override;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* LaserIdArrayName = nullptr;
+  char* GroundLabelArrayName = nullptr;
+  int NumberOfColumns = 2048;
+  double ClusterTolerance = 0.5;
+  int MinClusterSize = 10;
+  double AssociationDistance = 2.;
+  int MaxMissedFrames = 3;
+  int MinHits = 3;
+
+private:
+  vtkLidarObjectTracker(const vtkLidarObjectTracker&) = delete;
+  void operator=(const vtkLidarObjectTracker&) = delete;
+
+  struct vtkInternals;
+  std::unique_ptr<vtkInternals> Internals;
+};
+
+#endif // vtkLidarObjectTracker_h
@@ -0,0 +1,127 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarOutlierRemoval.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarOutlierRemoval.h"
+
+#include "LidarProcessingHelper.h"
+#include "LidarRangeImage.h"
+
+#include <vtkIdList.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <string>
+
+vtkStandardNewMacro(vtkLidarOutlierRemoval)
+
+//-----------------------------------------------------------------------------
+vtkLidarOutlierRemoval::vtkLidarOutlierRemoval()
+{
+  this->SetLaserIdArrayName("laser_id");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarOutlierRemoval::~vtkLidarOutlierRemoval()
+{
+  this->SetLaserIdArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarOutlierRemoval::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  vtkDataArray* laserIds =
+    this->LaserIdArrayName ? input->GetPointData()->GetArray(this->LaserIdArrayName) : nullptr;
+  if (nbPoints == 0 || !laserIds)
+  {
+    if (nbPoints > 0)
+    {
+      vtkWarningMacro(<< "No \"" << (this->LaserIdArrayName ? this->LaserIdArrayName : "")
+                      << "\" laser array, the frame is not filtered");
+    }
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  vtkDataArray* points = input->GetPoints()->GetData();
+  LidarRangeImage image;
+  image.SetNumberOfColumns(this->NumberOfColumns);
+  std::string error;
+  if (!image.Build(points, laserIds, nullptr, &error))
+  {
+    vtkErrorMacro(<< error);
+    return 0;
+  }
+
+  LidarOutlierDetector detector;
+  detector.SetMethod(this->Method);
+  detector.SetNeighborhoodSize(this->NeighborhoodSize);
+  detector.SetRadius(this->Radius);
+  detector.SetMinNeighbors(this->MinNeighbors);
+  detector.SetRadiusMultiplier(this->RadiusMultiplier);
+  detector.SetMeanK(this->MeanK);
+  detector.SetStdDevMultiplier(this->StdDevMultiplier);
+  vtkNew<vtkUnsignedCharArray> outliers;
+  outliers->SetName("outlier");
+  outliers->SetNumberOfTuples(nbPoints);
+  const unsigned char* outlier = outliers->GetPointer(0);
+  const vtkIdType nbOutliers = detector.Detect(image, points, outliers->GetPointer(0));
+
+  if (!this->RemoveOutliers)
+  {
+    output->ShallowCopy(input);
+    output->GetPointData()->AddArray(outliers);
+    return 1;
+  }
+  vtkNew<vtkIdList> inlierIds;
+  inlierIds->Allocate(nbPoints - nbOutliers);
+  for (vtkIdType i = 0; i < nbPoints; ++i)
+  {
+    if (!outlier[i])
+    {
+      inlierIds->InsertNextId(i);
+    }
+  }
+  LidarProcessingHelper::ExtractPoints(input, inlierIds, output);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarOutlierRemoval::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserIdArrayName: "
+     << (this->LaserIdArrayName ? this->LaserIdArrayName : "(none)") << endl;
+  os << indent << "NumberOfColumns: " << this->NumberOfColumns << endl;
+  os << indent << "Method: " << this->Method << endl;
+  os << indent << "NeighborhoodSize: " << this->NeighborhoodSize << endl;
+  os << indent << "Radius: " << this->Radius << endl;
+  os << indent << "MinNeighbors: " << this->MinNeighbors << endl;
+  os << indent << "RadiusMultiplier: " << this->RadiusMultiplier << endl;
+  os << indent << "MeanK: " << this->MeanK << endl;
+  os << indent << "StdDevMultiplier: " << this->StdDevMultiplier << endl;
+  os << indent << "RemoveOutliers: " << this->RemoveOutliers << endl;
+}
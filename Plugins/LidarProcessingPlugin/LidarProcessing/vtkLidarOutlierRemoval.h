@@ -0,0 +1,154 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarOutlierRemoval.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarOutlierRemoval_h
+#define vtkLidarOutlierRemoval_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarOutlierDetector.h" // for MethodType
+#include "LidarProcessingModule.h" // for export macro
+
+/**
+ * @class vtkLidarOutlierRemoval
+ * @brief Remove the isolated points of a lidar frame, such as rain, dust or spray.
+ *
+ * The frame is projected into a range image (see LidarRangeImage) and the
+ * neighbors of each point are read from the pixels around its own, see
+ * LidarOutlierDetector for the statistical, radius and dynamic radius
+ * criteria.
+ *
+ * The outliers are removed from the output, or only flagged in the "outlier"
+ * array (1 for an outlier) when RemoveOutliers is off.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarOutlierRemoval : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarOutlierRemoval* New();
+  vtkTypeMacro(vtkLidarOutlierRemoval, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum MethodType
+  {
+    //! Mean distance to the closest neighbors far above the frame average
+    STATISTICAL = LidarOutlierDetector::STATISTICAL,
+    //! Too few neighbors within a fixed radius
+    RADIUS = LidarOutlierDetector::RADIUS,
+    //! Too few neighbors within a radius growing with the range
+    DYNAMIC_RADIUS = LidarOutlierDetector::DYNAMIC_RADIUS
+  };
+
+  //@{
+  /**
+   * Name of the laser index array. Default is "laser_id".
+   */
+  vtkSetStringMacro(LaserIdArrayName);
+  vtkGetStringMacro(LaserIdArrayName);
+  //@}
+
+  //@{
+  /**
+   * Number of azimuth columns of the range image. Default is 2048.
+   */
+  vtkSetClampMacro(NumberOfColumns, int, 16, 65536);
+  vtkGetMacro(NumberOfColumns, int);
+  //@}
+
+  //@{
+  /**
+   * Outlier criterion. Default is DYNAMIC_RADIUS.
+   */
+  vtkSetClampMacro(Method, int, STATISTICAL, DYNAMIC_RADIUS);
+  vtkGetMacro(Method, int);
+  //@}
+
+  //@{
+  /**
+   * Number of pixels on each side of the pixel of a point where its neighbors
+   * are looked for. Default is 2.
+   */
+  vtkSetClampMacro(NeighborhoodSize, int, 1, 7);
+  vtkGetMacro(NeighborhoodSize, int);
+  //@}
+
+  //@{
+  /**
+   * Search radius of RADIUS, minimum radius of DYNAMIC_RADIUS. Default is 0.2 m.
+   */
+  vtkSetClampMacro(Radius, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(Radius, double);
+  //@}
+
+  //@{
+  /**
+   * Neighbors needed within the radius to be an inlier. Default is 2.
+   */
+  vtkSetClampMacro(MinNeighbors, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MinNeighbors, int);
+  //@}
+
+  //@{
+  /**
+   * Radius of DYNAMIC_RADIUS, in azimuth column spacings. Default is 3.
+   */
+  vtkSetClampMacro(RadiusMultiplier, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(RadiusMultiplier, double);
+  //@}
+
+  //@{
+  /**
+   * Number of closest neighbors of STATISTICAL. Default is 8.
+   */
+  vtkSetClampMacro(MeanK, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MeanK, int);
+  //@}
+
+  //@{
+  /**
+   * Standard deviations above the mean of STATISTICAL. Default is 1.
+   */
+  vtkSetMacro(StdDevMultiplier, double);
+  vtkGetMacro(StdDevMultiplier, double);
+  //@}
+
+  //@{
+  /**
+   * Remove the outliers from the output, instead of only flagging them.
+   * Default is true.
+   */
+  vtkSetMacro(RemoveOutliers, bool);
+  vtkGetMacro(RemoveOutliers, bool);
+  vtkBooleanMacro(RemoveOutliers, bool);
+  //@}
+
+protected:
+  vtkLidarOutlierRemoval();
+  ~vtkLidarOutlierRemoval() override;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* LaserIdArrayName = nullptr;
+  int NumberOfColumns = 2048;
+  int Method = DYNAMIC_RADIUS;
+  int NeighborhoodSize = 2;
+  double Radius = 0.2;
+  int MinNeighbors = 2;
+  double RadiusMultiplier = 3.;
+  int MeanK = 8;
+  double StdDevMultiplier = 1.;
+  bool RemoveOutliers = true;
+
+private:
+  vtkLidarOutlierRemoval(const vtkLidarOutlierRemoval&) = delete;
+  void operator=(const vtkLidarOutlierRemoval&) = delete;
+};
+
+#endif // vtkLidarOutlierRemoval_h
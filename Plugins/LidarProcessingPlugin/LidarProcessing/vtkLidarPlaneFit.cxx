@@ -0,0 +1,253 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarPlaneFit.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarPlaneFit.h"
+
+#include "LidarPlaneFit.h"
+
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkExtractSelection.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPointSet.h>
+#include <vtkPoints.h>
+#include <vtkSelection.h>
+#include <vtkSignedCharArray.h>
+#include <vtkTable.h>
+
+#include <numeric>
+#include <string>
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarPlaneFit)
+
+namespace
+{
+//-----------------------------------------------------------------------------
+template <typename ArrayT>
+ArrayT* AddColumn(vtkTable* table, const char* name, vtkIdType nbRows)
+{
+  vtkNew<ArrayT> column;
+  column->SetName(name);
+  column->SetNumberOfTuples(nbRows);
+  table->AddColumn(column);
+  return column;
+}
+
+//-----------------------------------------------------------------------------
+void AddVector(vtkFieldData* fieldData, const char* name, const double* values)
+{
+  vtkNew<vtkDoubleArray> array;
+  array->SetName(name);
+  array->SetNumberOfComponents(3);
+  array->InsertNextTuple(values);
+  fieldData->AddArray(array);
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Ids of the points flagged by the selection. The selection is evaluated in
+ * place (PreserveTopology), which only adds an insidedness array to a shallow
+ * copy of the input. Selected cells select their points.
+ */
+std::vector<vtkIdType> GetSelectedIds(vtkPointSet* input, vtkSelection* selection)
+{
+  vtkNew<vtkExtractSelection> extract;
+  extract->PreserveTopologyOn();
+  extract->SetInputData(0, input);
+  extract->SetInputData(1, selection);
+  extract->Update();
+
+  std::vector<vtkIdType> ids;
+  vtkDataSet* flagged = vtkDataSet::SafeDownCast(extract->GetOutputDataObject(0));
+  if (!flagged)
+  {
+    return ids;
+  }
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  if (auto pointFlags = vtkSignedCharArray::SafeDownCast(
+        flagged->GetPointData()->GetArray("vtkInsidedness")))
+  {
+    const signed char* inside = pointFlags->GetPointer(0);
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      if (inside[i] > 0)
+      {
+        ids.push_back(i);
+      }
+    }
+  }
+  else if (auto cellFlags = vtkSignedCharArray::SafeDownCast(
+             flagged->GetCellData()->GetArray("vtkInsidedness")))
+  {
+    std::vector<unsigned char> selected(nbPoints, 0);
+    vtkNew<vtkIdList> cellPoints;
+    const signed char* inside = cellFlags->GetPointer(0);
+    for (vtkIdType cell = 0; cell < cellFlags->GetNumberOfTuples(); ++cell)
+    {
+      if (inside[cell] > 0)
+      {
+        input->GetCellPoints(cell, cellPoints);
+        for (vtkIdType j = 0; j < cellPoints->GetNumberOfIds(); ++j)
+        {
+          selected[cellPoints->GetId(j)] = 1;
+        }
+      }
+    }
+    for (vtkIdType i = 0; i < nbPoints; ++i)
+    {
+      if (selected[i])
+      {
+        ids.push_back(i);
+      }
+    }
+  }
+  return ids;
+}
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarPlaneFit::vtkLidarPlaneFit()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetLaserIdArrayName("laser_id");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarPlaneFit::~vtkLidarPlaneFit()
+{
+  this->SetLaserIdArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarPlaneFit::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 0)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPointSet");
+    return 1;
+  }
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkSelection");
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarPlaneFit::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPointSet* input = vtkPointSet::GetData(inputVector[0], 0);
+  vtkSelection* selection = vtkSelection::GetData(inputVector[1], 0);
+  vtkTable* output = vtkTable::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+  if (!input->GetPoints())
+  {
+    return 1;
+  }
+
+  std::vector<vtkIdType> ids;
+  if (selection)
+  {
+    ids = GetSelectedIds(input, selection);
+  }
+  else
+  {
+    ids.resize(input->GetNumberOfPoints());
+    std::iota(ids.begin(), ids.end(), 0);
+  }
+  if (ids.empty())
+  {
+    vtkWarningMacro(<< "An empty selection is defined");
+    return 1;
+  }
+
+  LidarPlaneFit fit;
+  fit.SetThreshold(this->DistanceThreshold);
+  fit.SetMaxIterations(this->MaxIterations);
+  fit.SetSeed(static_cast<unsigned int>(this->Seed));
+  vtkDataArray* laserIds =
+    this->LaserIdArrayName ? input->GetPointData()->GetArray(this->LaserIdArrayName) : nullptr;
+  std::string error;
+  if (!fit.Fit(input->GetPoints()->GetData(), ids, laserIds, &error))
+  {
+    vtkWarningMacro(<< "Plane fitting failed: " << error);
+    return 1;
+  }
+
+  const std::vector<LidarPlaneFit::Statistics>& stats = fit.GetStatistics();
+  const vtkIdType nbRows = static_cast<vtkIdType>(stats.size());
+  vtkIntArray* laser = AddColumn<vtkIntArray>(output, "laser_id", nbRows);
+  vtkIdTypeArray* points = AddColumn<vtkIdTypeArray>(output, "points", nbRows);
+  vtkIdTypeArray* inliers = AddColumn<vtkIdTypeArray>(output, "inliers", nbRows);
+  vtkDoubleArray* mean = AddColumn<vtkDoubleArray>(output, "mean", nbRows);
+  vtkDoubleArray* stdDev = AddColumn<vtkDoubleArray>(output, "stddev", nbRows);
+  vtkDoubleArray* rms = AddColumn<vtkDoubleArray>(output, "rms", nbRows);
+  vtkDoubleArray* min = AddColumn<vtkDoubleArray>(output, "min", nbRows);
+  vtkDoubleArray* max = AddColumn<vtkDoubleArray>(output, "max", nbRows);
+  vtkDoubleArray* inlierMean = AddColumn<vtkDoubleArray>(output, "inlier_mean", nbRows);
+  vtkDoubleArray* inlierStdDev = AddColumn<vtkDoubleArray>(output, "inlier_stddev", nbRows);
+  vtkDoubleArray* inlierRms = AddColumn<vtkDoubleArray>(output, "inlier_rms", nbRows);
+  vtkDoubleArray* inlierMin = AddColumn<vtkDoubleArray>(output, "inlier_min", nbRows);
+  vtkDoubleArray* inlierMax = AddColumn<vtkDoubleArray>(output, "inlier_max", nbRows);
+  for (vtkIdType row = 0; row < nbRows; ++row)
+  {
+    const LidarPlaneFit::Statistics& rowStats = stats[row];
+    laser->SetValue(row, rowStats.LaserId);
+    points->SetValue(row, rowStats.NbPoints);
+    inliers->SetValue(row, rowStats.NbInliers);
+    mean->SetValue(row, rowStats.Mean);
+    stdDev->SetValue(row, rowStats.StdDev);
+    rms->SetValue(row, rowStats.RMS);
+    min->SetValue(row, rowStats.Min);
+    max->SetValue(row, rowStats.Max);
+    inlierMean->SetValue(row, rowStats.InlierMean);
+    inlierStdDev->SetValue(row, rowStats.InlierStdDev);
+    inlierRms->SetValue(row, rowStats.InlierRMS);
+    inlierMin->SetValue(row, rowStats.InlierMin);
+    inlierMax->SetValue(row, rowStats.InlierMax);
+  }
+
+  vtkFieldData* fieldData = output->GetFieldData();
+  AddVector(fieldData, "plane_normal", fit.GetNormal());
+  AddVector(fieldData, "plane_origin", fit.GetOrigin());
+  vtkNew<vtkIntArray> iterations;
+  iterations->SetName("iterations");
+  iterations->InsertNextValue(fit.GetNumberOfIterations());
+  fieldData->AddArray(iterations);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPlaneFit::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserIdArrayName: "
+     << (this->LaserIdArrayName ? this->LaserIdArrayName : "(none)") << endl;
+  os << indent << "DistanceThreshold: " << this->DistanceThreshold << endl;
+  os << indent << "MaxIterations: " << this->MaxIterations << endl;
+  os << indent << "Seed: " << this->Seed << endl;
+}
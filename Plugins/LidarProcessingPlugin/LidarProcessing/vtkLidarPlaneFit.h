@@ -0,0 +1,99 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarPlaneFit.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarPlaneFit_h
+#define vtkLidarPlaneFit_h
+
+#include <vtkTableAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+/**
+ * @class vtkLidarPlaneFit
+ * @brief Fit a plane to the selected points of a lidar frame.
+ *
+ * The plane is fitted with LidarPlaneFit (parallel RANSAC then least squares)
+ * directly on the frame points: the optional selection input is only used to
+ * flag the selected points, nothing is extracted nor appended. Without
+ * selection, all the points are used.
+ *
+ * The output table holds the residual statistics of all the lasers (laser_id
+ * -1), then of each laser: mean, stddev, rms, min and max over all the
+ * selected points, and the same over the inliers only (inlier_ prefix). The
+ * plane normal and origin are stored in the field data.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarPlaneFit : public vtkTableAlgorithm
+{
+public:
+  static vtkLidarPlaneFit* New();
+  vtkTypeMacro(vtkLidarPlaneFit, vtkTableAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /**
+   * Convenience method to set the selection input (port 1).
+   */
+  void SetSelectionConnection(vtkAlgorithmOutput* algOutput)
+  {
+    this->SetInputConnection(1, algOutput);
+  }
+
+  //@{
+  /**
+   * Name of the laser index array. When missing, only the global statistics
+   * are computed. Default is "laser_id".
+   */
+  vtkSetStringMacro(LaserIdArrayName);
+  vtkGetStringMacro(LaserIdArrayName);
+  //@}
+
+  //@{
+  /**
+   * Maximum distance of an inlier to the plane. Default is 0.05 m.
+   */
+  vtkSetClampMacro(DistanceThreshold, double, 1e-6, VTK_DOUBLE_MAX);
+  vtkGetMacro(DistanceThreshold, double);
+  //@}
+
+  //@{
+  /**
+   * Maximum number of RANSAC hypotheses. Default is 500.
+   */
+  vtkSetClampMacro(MaxIterations, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaxIterations, int);
+  //@}
+
+  //@{
+  /**
+   * Seed of the RANSAC hypotheses, results are reproducible for a given seed.
+   * Default is 0.
+   */
+  vtkSetMacro(Seed, int);
+  vtkGetMacro(Seed, int);
+  //@}
+
+protected:
+  vtkLidarPlaneFit();
+  ~vtkLidarPlaneFit() override;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* LaserIdArrayName = nullptr;
+  double DistanceThreshold = 0.05;
+  int MaxIterations = 500;
+  int Seed = 0;
+
+private:
+  vtkLidarPlaneFit(const vtkLidarPlaneFit&) = delete;
+  void operator=(const vtkLidarPlaneFit&) = delete;
+};
+
+#endif // vtkLidarPlaneFit_h
@@ -0,0 +1,118 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarPointCloudWriter.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarPointCloudWriter.h"
+
+#include <vtkAlgorithm.h>
+#include <vtkErrorCode.h>
+#include <vtkInformation.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+vtkStandardNewMacro(vtkLidarPointCloudWriter)
+
+//-----------------------------------------------------------------------------
+vtkLidarPointCloudWriter::~vtkLidarPointCloudWriter()
+{
+  // Files still queued when Flush() was not called
+  if (!this->Writer.Flush())
+  {
+    vtkGenericWarningMacro(<< this->Writer.GetLastError());
+  }
+  this->SetFileName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudWriter::AddArrayName(const char* name)
+{
+  if (name && *name)
+  {
+    this->ArrayNames.push_back(name);
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudWriter::ClearArrayNames()
+{
+  if (!this->ArrayNames.empty())
+  {
+    this->ArrayNames.clear();
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPointCloudWriter::Flush()
+{
+  if (!this->Writer.Flush())
+  {
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    vtkErrorMacro(<< this->Writer.GetLastError());
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarPointCloudWriter::FillInputPortInformation(
+  int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudWriter::WriteData()
+{
+  this->SetErrorCode(vtkErrorCode::NoError);
+  vtkPolyData* input = vtkPolyData::SafeDownCast(this->GetInput());
+  if (!input || !this->FileName)
+  {
+    this->SetErrorCode(vtkErrorCode::NoFileNameError);
+    vtkErrorMacro(<< "Invalid input or file name");
+    return;
+  }
+
+  this->Writer.SetFormat(this->FileFormat == PLY
+      ? LidarPointCloudWriter::PLY
+      : (this->Compression ? LidarPointCloudWriter::PCD_COMPRESSED : LidarPointCloudWriter::PCD));
+  this->Writer.SetArrayNames(this->ArrayNames);
+  this->Writer.SetWriteAllArrays(this->WriteAllArrays);
+  // Fails when a previously queued file could not be written
+  if (!this->Writer.WriteFrame(input, this->FileName))
+  {
+    this->SetErrorCode(vtkErrorCode::CannotOpenFileError);
+    vtkErrorMacro(<< this->Writer.GetLastError());
+  }
+  if (!this->Asynchronous)
+  {
+    this->Flush();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPointCloudWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << (this->FileName ? this->FileName : "(none)") << endl;
+  os << indent << "FileFormat: " << (this->FileFormat == PLY ? "PLY" : "PCD") << endl;
+  os << indent << "Compression: " << this->Compression << endl;
+  os << indent << "ArrayNames:";
+  for (const std::string& name : this->ArrayNames)
+  {
+    os << " " << name;
+  }
+  os << endl;
+  os << indent << "WriteAllArrays: " << this->WriteAllArrays << endl;
+  os << indent << "Asynchronous: " << this->Asynchronous << endl;
+  os << indent << "BytesWritten: " << this->Writer.GetNumberOfBytesWritten() << endl;
+}
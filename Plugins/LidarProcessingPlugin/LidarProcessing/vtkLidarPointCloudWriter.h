@@ -0,0 +1,132 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarPointCloudWriter.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarPointCloudWriter_h
+#define vtkLidarPointCloudWriter_h
+
+#include <vtkWriter.h>
+
+#include "LidarPointCloudWriter.h" // for member
+#include "LidarProcessingModule.h" // for export macro
+
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+/**
+ * @class vtkLidarPointCloudWriter
+ * @brief Save a lidar frame as a binary PLY or PCD file.
+ *
+ * The file is written straight from the arrays of the frame, see
+ * LidarPointCloudWriter: the positions and the arrays added with
+ * AddArrayName(), or all the numeric arrays with WriteAllArrays.
+ *
+ * With Asynchronous enabled, Write() only queues the frame: the files of
+ * consecutive writes, e.g. the frames of a range saved one by one, are
+ * encoded concurrently. A file that could not be written fails the next
+ * Write() (see GetErrorCode()) or Flush(). Flush() waits for the queued
+ * files and must be called after the last frame; the destructor only
+ * flushes the files left over, and can only warn about their errors.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarPointCloudWriter : public vtkWriter
+{
+public:
+  static vtkLidarPointCloudWriter* New();
+  vtkTypeMacro(vtkLidarPointCloudWriter, vtkWriter);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum FileFormats
+  {
+    PLY = 0,
+    PCD
+  };
+
+  //@{
+  /**
+   * Name of the file to write.
+   */
+  vtkSetStringMacro(FileName);
+  vtkGetStringMacro(FileName);
+  //@}
+
+  //@{
+  /**
+   * PLY (binary little endian) or PCD (binary). Default is PLY.
+   */
+  vtkSetClampMacro(FileFormat, int, PLY, PCD);
+  vtkGetMacro(FileFormat, int);
+  //@}
+
+  //@{
+  /**
+   * Write PCD files as binary_compressed (LZF). Default is false.
+   */
+  vtkSetMacro(Compression, bool);
+  vtkGetMacro(Compression, bool);
+  vtkBooleanMacro(Compression, bool);
+  //@}
+
+  //@{
+  /**
+   * Point data arrays written after the positions. None by default.
+   */
+  void AddArrayName(const char* name);
+  void ClearArrayNames();
+  //@}
+
+  //@{
+  /**
+   * Write all the numeric point data arrays instead of the added ones.
+   * Default is false.
+   */
+  vtkSetMacro(WriteAllArrays, bool);
+  vtkGetMacro(WriteAllArrays, bool);
+  vtkBooleanMacro(WriteAllArrays, bool);
+  //@}
+
+  //@{
+  /**
+   * Return from Write() once the frame is queued, before the file is
+   * written. The caller must then call Flush() after the last frame.
+   * Default is false.
+   */
+  vtkSetMacro(Asynchronous, bool);
+  vtkGetMacro(Asynchronous, bool);
+  vtkBooleanMacro(Asynchronous, bool);
+  //@}
+
+  /**
+   * Wait for the queued files. Returns false, and sets the error code, if one
+   * could not be written.
+   */
+  bool Flush();
+
+protected:
+  vtkLidarPointCloudWriter() = default;
+  ~vtkLidarPointCloudWriter() override;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  void WriteData() override;
+
+  char* FileName = nullptr;
+  int FileFormat = PLY;
+  bool Compression = false;
+  bool WriteAllArrays = false;
+  bool Asynchronous = false;
+  std::vector<std::string> ArrayNames;
+
+private:
+  vtkLidarPointCloudWriter(const vtkLidarPointCloudWriter&) = delete;
+  void operator=(const vtkLidarPointCloudWriter&) = delete;
+
+  LidarPointCloudWriter Writer;
+};
+
+#endif // vtkLidarPointCloudWriter_h
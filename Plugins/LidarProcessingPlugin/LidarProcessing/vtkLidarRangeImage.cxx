@@ -0,0 +1,110 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarRangeImage.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarRangeImage.h"
+
+#include "LidarRangeImage.h"
+
+#include <vtkDataObject.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <string>
+
+vtkStandardNewMacro(vtkLidarRangeImage)
+
+//-----------------------------------------------------------------------------
+vtkLidarRangeImage::vtkLidarRangeImage()
+{
+  this->SetLaserIdArrayName("laser_id");
+  this->SetIntensityArrayName("intensity");
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarRangeImage::~vtkLidarRangeImage()
+{
+  this->SetLaserIdArrayName(nullptr);
+  this->SetIntensityArrayName(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarRangeImage::FillOutputPortInformation(int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkImageData");
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarRangeImage::RequestInformation(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  const int extent[6] = { 0, this->NumberOfColumns - 1, 0, this->NumberOfRows - 1, 0, 0 };
+  outputVector->GetInformationObject(0)->Set(
+    vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), extent, 6);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarRangeImage::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkImageData* output = vtkImageData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+  if (!input->GetPoints())
+  {
+    return 1;
+  }
+
+  vtkPointData* pointData = input->GetPointData();
+  vtkDataArray* laserIds =
+    this->LaserIdArrayName ? pointData->GetArray(this->LaserIdArrayName) : nullptr;
+  vtkDataArray* intensities =
+    this->IntensityArrayName ? pointData->GetArray(this->IntensityArrayName) : nullptr;
+  LidarRangeImage image;
+  image.SetNumberOfColumns(this->NumberOfColumns);
+  image.SetMinimumNumberOfRows(this->NumberOfRows);
+  std::string error;
+  if (!image.Build(input->GetPoints()->GetData(), laserIds, intensities, &error))
+  {
+    vtkErrorMacro(<< error);
+    return 0;
+  }
+  if (image.GetHeight() > this->NumberOfRows)
+  {
+    vtkWarningMacro(<< "The frame has " << image.GetHeight() << " lasers, more than the "
+                    << this->NumberOfRows << " rows of the image");
+  }
+  image.ExportTo(output);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarRangeImage::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LaserIdArrayName: "
+     << (this->LaserIdArrayName ? this->LaserIdArrayName : "(none)") << endl;
+  os << indent << "IntensityArrayName: "
+     << (this->IntensityArrayName ? this->IntensityArrayName : "(none)") << endl;
+  os << indent << "NumberOfColumns: " << this->NumberOfColumns << endl;
+  os << indent << "NumberOfRows: " << this->NumberOfRows << endl;
+}
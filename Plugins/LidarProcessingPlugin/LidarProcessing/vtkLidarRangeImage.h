@@ -0,0 +1,92 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarRangeImage.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarRangeImage_h
+#define vtkLidarRangeImage_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+/**
+ * @class vtkLidarRangeImage
+ * @brief Organize a lidar frame into a range image.
+ *
+ * The output is a NumberOfColumns by NumberOfRows vtkImageData (see
+ * LidarRangeImage): rows are the lasers sorted by elevation, columns the
+ * azimuth bins, each pixel holding the closest point falling into it. Point
+ * arrays: "range", "position", "point_id" (-1 for empty pixels) and
+ * "intensity" when the intensity array exists. The "row_laser_id" field
+ * array gives the laser of each row, -1 for the empty rows above the lasers.
+ * NumberOfRows is the whole extent published before the frame is known: a
+ * frame with more lasers gives a taller image, with a warning.
+ *
+ * The arrays are filled in parallel and exported without copy.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarRangeImage : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarRangeImage* New();
+  vtkTypeMacro(vtkLidarRangeImage, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //@{
+  /**
+   * Name of the laser index array. Default is "laser_id".
+   */
+  vtkSetStringMacro(LaserIdArrayName);
+  vtkGetStringMacro(LaserIdArrayName);
+  //@}
+
+  //@{
+  /**
+   * Name of the intensity array, optional. Default is "intensity".
+   */
+  vtkSetStringMacro(IntensityArrayName);
+  vtkGetStringMacro(IntensityArrayName);
+  //@}
+
+  //@{
+  /**
+   * Number of azimuth columns of the image. Default is 2048.
+   */
+  vtkSetClampMacro(NumberOfColumns, int, 16, 65536);
+  vtkGetMacro(NumberOfColumns, int);
+  //@}
+
+  //@{
+  /**
+   * Number of rows of the image, at least the number of lasers of the
+   * sensor. Default is 128.
+   */
+  vtkSetClampMacro(NumberOfRows, int, 1, 4096);
+  vtkGetMacro(NumberOfRows, int);
+  //@}
+
+protected:
+  vtkLidarRangeImage();
+  ~vtkLidarRangeImage() override;
+
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
+  int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  char* LaserIdArrayName = nullptr;
+  char* IntensityArrayName = nullptr;
+  int NumberOfColumns = 2048;
+  int NumberOfRows = 128;
+
+private:
+  vtkLidarRangeImage(const vtkLidarRangeImage&) = delete;
+  void operator=(const vtkLidarRangeImage&) = delete;
+};
+
+#endif // vtkLidarRangeImage_h
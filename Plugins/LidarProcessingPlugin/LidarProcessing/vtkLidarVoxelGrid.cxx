@@ -0,0 +1,368 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarVoxelGrid.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#include "vtkLidarVoxelGrid.h"
+
+#include "LidarProcessingHelper.h"
+#include "LidarRadixSort.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+vtkStandardNewMacro(vtkLidarVoxelGrid)
+
+namespace
+{
+using Key = std::uint64_t;
+using Entry = LidarRadixSort::Entry;
+
+//-----------------------------------------------------------------------------
+// Voxel keys packing the x, y and z voxel indices relative to the bounds
+struct KeyPacking
+{
+  double Origin[3];
+  double Scale;
+  vtkIdType Dimensions[3];
+  int Shifts[3];
+  // Never a valid key, given to the non finite points
+  Key InvalidKey;
+  int NbBits;
+
+  bool Initialize(const double bounds[6], double voxelSize)
+  {
+    this->Scale = 1. / voxelSize;
+    this->NbBits = 0;
+    for (int c = 2; c >= 0; --c)
+    {
+      this->Origin[c] = bounds[2 * c];
+      const double extent = std::floor((bounds[2 * c + 1] - bounds[2 * c]) * this->Scale) + 1.;
+      if (!(extent < static_cast<double>(Key(1) << 40)))
+      {
+        return false;
+      }
+      this->Dimensions[c] = static_cast<vtkIdType>(extent);
+      // One more value for the invalid key
+      int bits = 0;
+      while ((vtkIdType(1) << bits) <= this->Dimensions[c])
+      {
+        ++bits;
+      }
+      this->Shifts[c] = this->NbBits;
+      this->NbBits += bits;
+    }
+    if (this->NbBits > 63)
+    {
+      return false;
+    }
+    this->InvalidKey = (Key(1) << this->NbBits) - 1;
+    return true;
+  }
+
+  Key GetKey(const double p[3]) const
+  {
+    Key key = 0;
+    for (int c = 0; c < 3; ++c)
+    {
+      const double index = std::floor((p[c] - this->Origin[c]) * this->Scale);
+      // Also catches NaN
+      if (!(index >= 0. && index < this->Dimensions[c]))
+      {
+        return this->InvalidKey;
+      }
+      key |= static_cast<Key>(index) << this->Shifts[c];
+    }
+    return key;
+  }
+};
+
+//-----------------------------------------------------------------------------
+template <typename T>
+struct PointReader
+{
+  const T* Points;
+
+  void Get(vtkIdType id, double p[3]) const
+  {
+    const T* point = this->Points + 3 * id;
+    p[0] = static_cast<double>(point[0]);
+    p[1] = static_cast<double>(point[1]);
+    p[2] = static_cast<double>(point[2]);
+  }
+};
+
+//-----------------------------------------------------------------------------
+struct GenericPointReader
+{
+  vtkDataArray* Points;
+
+  void Get(vtkIdType id, double p[3]) const { this->Points->GetTuple(id, p); }
+};
+
+//-----------------------------------------------------------------------------
+template <typename Reader>
+void ComputeKeys(const Reader& points, const KeyPacking& packing, std::vector<Entry>& entries)
+{
+  const vtkIdType nbPoints = static_cast<vtkIdType>(entries.size());
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    double p[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      points.Get(i, p);
+      entries[i].Key = packing.GetKey(p);
+      entries[i].Id = i;
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+// SplitMix64 finalizer, to pick the point of a voxel
+Key Hash(Key key)
+{
+  key += 0x9e3779b97f4a7c15ull;
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+  return key ^ (key >> 31);
+}
+
+//-----------------------------------------------------------------------------
+// Centroid of each voxel, and its closest point
+template <typename Reader>
+void ComputeCentroids(const Reader& points, const std::vector<Entry>& entries,
+  const std::vector<vtkIdType>& starts, double* centroids, vtkIdType* closest)
+{
+  const vtkIdType nbVoxels = static_cast<vtkIdType>(starts.size()) - 1;
+  vtkSMPTools::For(0, nbVoxels, [&](vtkIdType begin, vtkIdType end) {
+    double p[3];
+    for (vtkIdType voxel = begin; voxel < end; ++voxel)
+    {
+      double* centroid = centroids + 3 * voxel;
+      centroid[0] = centroid[1] = centroid[2] = 0.;
+      for (vtkIdType i = starts[voxel]; i < starts[voxel + 1]; ++i)
+      {
+        points.Get(entries[i].Id, p);
+        centroid[0] += p[0];
+        centroid[1] += p[1];
+        centroid[2] += p[2];
+      }
+      const double nbPoints = static_cast<double>(starts[voxel + 1] - starts[voxel]);
+      centroid[0] /= nbPoints;
+      centroid[1] /= nbPoints;
+      centroid[2] /= nbPoints;
+
+      double closestDistance2 = std::numeric_limits<double>::max();
+      for (vtkIdType i = starts[voxel]; i < starts[voxel + 1]; ++i)
+      {
+        points.Get(entries[i].Id, p);
+        const double dx = p[0] - centroid[0];
+        const double dy = p[1] - centroid[1];
+        const double dz = p[2] - centroid[2];
+        const double distance2 = dx * dx + dy * dy + dz * dz;
+        if (distance2 < closestDistance2)
+        {
+          closestDistance2 = distance2;
+          closest[voxel] = entries[i].Id;
+        }
+      }
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void AverageArray(const T* input, T* output, int nbComponents, const std::vector<Entry>& entries,
+  const std::vector<vtkIdType>& starts)
+{
+  const vtkIdType nbVoxels = static_cast<vtkIdType>(starts.size()) - 1;
+  vtkSMPTools::For(0, nbVoxels, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<double> sums(nbComponents);
+    for (vtkIdType voxel = begin; voxel < end; ++voxel)
+    {
+      std::fill(sums.begin(), sums.end(), 0.);
+      for (vtkIdType i = starts[voxel]; i < starts[voxel + 1]; ++i)
+      {
+        const T* value = input + entries[i].Id * nbComponents;
+        for (int c = 0; c < nbComponents; ++c)
+        {
+          sums[c] += static_cast<double>(value[c]);
+        }
+      }
+      const double nbPoints = static_cast<double>(starts[voxel + 1] - starts[voxel]);
+      for (int c = 0; c < nbComponents; ++c)
+      {
+        output[voxel * nbComponents + c] = static_cast<T>(sums[c] / nbPoints);
+      }
+    }
+  });
+}
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarVoxelGrid::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0], 0);
+  vtkPolyData* output = vtkPolyData::GetData(outputVector, 0);
+  if (!input || !output)
+  {
+    vtkErrorMacro(<< "Invalid input or output");
+    return 0;
+  }
+  const vtkIdType nbPoints = input->GetNumberOfPoints();
+  if (nbPoints == 0)
+  {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  // Voxel keys, the bounds ignore the non finite points
+  double bounds[6];
+  input->GetPoints()->GetBounds(bounds);
+  KeyPacking packing;
+  if (!packing.Initialize(bounds, this->VoxelSize))
+  {
+    vtkErrorMacro(<< "Voxel size " << this->VoxelSize << " too small for the extent of the points");
+    return 0;
+  }
+  vtkDataArray* points = input->GetPoints()->GetData();
+  auto floatPoints = vtkFloatArray::FastDownCast(points);
+  auto doublePoints = vtkDoubleArray::FastDownCast(points);
+  std::vector<Entry> entries(nbPoints);
+  if (floatPoints)
+  {
+    ComputeKeys(PointReader<float>{ floatPoints->GetPointer(0) }, packing, entries);
+  }
+  else if (doublePoints)
+  {
+    ComputeKeys(PointReader<double>{ doublePoints->GetPointer(0) }, packing, entries);
+  }
+  else
+  {
+    ComputeKeys(GenericPointReader{ points }, packing, entries);
+  }
+
+  // Sort by voxel, the invalid points end up last
+  LidarRadixSort::Sort(entries, packing.NbBits);
+  const vtkIdType nbValid = std::lower_bound(entries.begin(), entries.end(), packing.InvalidKey,
+                              [](const Entry& entry, Key key) { return entry.Key < key; }) -
+    entries.begin();
+  std::vector<vtkIdType> starts;
+  LidarRadixSort::FindRuns(entries, nbValid, starts);
+  const vtkIdType nbVoxels = static_cast<vtkIdType>(starts.size()) - 1;
+
+  // One representative point per voxel, with all its arrays
+  vtkNew<vtkIdList> ids;
+  ids->SetNumberOfIds(nbVoxels);
+  vtkIdType* representatives = ids->GetPointer(0);
+  std::vector<double> centroids;
+  if (this->Mode == RANDOM)
+  {
+    vtkSMPTools::For(0, nbVoxels, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType voxel = begin; voxel < end; ++voxel)
+      {
+        const Key count = static_cast<Key>(starts[voxel + 1] - starts[voxel]);
+        const Key pick = Hash(entries[starts[voxel]].Key) % count;
+        representatives[voxel] = entries[starts[voxel] + static_cast<vtkIdType>(pick)].Id;
+      }
+    });
+  }
+  else
+  {
+    centroids.resize(3 * nbVoxels);
+    if (floatPoints)
+    {
+      ComputeCentroids(PointReader<float>{ floatPoints->GetPointer(0) }, entries, starts,
+        centroids.data(), representatives);
+    }
+    else if (doublePoints)
+    {
+      ComputeCentroids(PointReader<double>{ doublePoints->GetPointer(0) }, entries, starts,
+        centroids.data(), representatives);
+    }
+    else
+    {
+      ComputeCentroids(
+        GenericPointReader{ points }, entries, starts, centroids.data(), representatives);
+    }
+  }
+  LidarProcessingHelper::ExtractPoints(input, ids, output);
+
+  if (this->Mode == AVERAGE)
+  {
+    // Centroids and averaged floating point arrays
+    vtkDataArray* outPoints = output->GetPoints()->GetData();
+    vtkSMPTools::For(0, nbVoxels, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType voxel = begin; voxel < end; ++voxel)
+      {
+        outPoints->SetTuple(voxel, &centroids[3 * voxel]);
+      }
+    });
+    vtkPointData* inPD = input->GetPointData();
+    vtkPointData* outPD = output->GetPointData();
+    for (int i = 0; i < inPD->GetNumberOfArrays(); ++i)
+    {
+      vtkDataArray* inArray = inPD->GetArray(i);
+      vtkDataArray* outArray =
+        inArray && inArray->GetName() ? outPD->GetArray(inArray->GetName()) : nullptr;
+      if (!outArray || outArray->GetDataType() != inArray->GetDataType())
+      {
+        continue;
+      }
+      const int nbComponents = inArray->GetNumberOfComponents();
+      if (auto floatArray = vtkFloatArray::FastDownCast(inArray))
+      {
+        AverageArray(floatArray->GetPointer(0),
+          vtkFloatArray::FastDownCast(outArray)->GetPointer(0), nbComponents, entries, starts);
+      }
+      else if (auto doubleArray = vtkDoubleArray::FastDownCast(inArray))
+      {
+        AverageArray(doubleArray->GetPointer(0),
+          vtkDoubleArray::FastDownCast(outArray)->GetPointer(0), nbComponents, entries, starts);
+      }
+    }
+  }
+
+  vtkNew<vtkIntArray> counts;
+  counts->SetName("point_count");
+  counts->SetNumberOfTuples(nbVoxels);
+  int* count = counts->GetPointer(0);
+  vtkSMPTools::For(0, nbVoxels, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType voxel = begin; voxel < end; ++voxel)
+    {
+      count[voxel] = static_cast<int>(starts[voxel + 1] - starts[voxel]);
+    }
+  });
+  output->GetPointData()->AddArray(counts);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarVoxelGrid::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "VoxelSize: " << this->VoxelSize << endl;
+  os << indent << "Mode: " << this->Mode << endl;
+}
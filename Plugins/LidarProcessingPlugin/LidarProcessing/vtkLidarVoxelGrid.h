@@ -0,0 +1,82 @@
+/*=========================================================================
+
+  Program:   LidarView
+  Module:    vtkLidarVoxelGrid.h
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See LICENSE or http://www.apache.org/licenses/LICENSE-2.0 for details.
+
+=========================================================================*/
+
+#ifndef vtkLidarVoxelGrid_h
+#define vtkLidarVoxelGrid_h
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include "LidarProcessingModule.h" // for export macro
+
+/**
+ * @class vtkLidarVoxelGrid
+ * @brief Downsample a point cloud to one point per occupied voxel.
+ *
+ * Meant for large point clouds such as trailing frames. The voxel key of each
+ * point is computed in parallel, then the points are sorted by key with a
+ * parallel radix sort (see LidarRadixSort), which makes the points of each
+ * voxel contiguous. The voxels are then reduced in parallel:
+ *  - AVERAGE: the output point is the centroid of the voxel, the floating
+ *    point arrays are averaged, the other arrays (laser id, ...) are taken
+ *    from the point closest to the centroid.
+ *  - RANDOM: the output point is a point of the voxel picked at random, with
+ *    all its arrays. The pick only depends on the voxel, so that a static
+ *    scene gives the same output from frame to frame.
+ *
+ * The "point_count" array gives the number of points of each voxel. Points
+ * with non finite coordinates are dropped.
+ */
+class LIDARPROCESSING_EXPORT vtkLidarVoxelGrid : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarVoxelGrid* New();
+  vtkTypeMacro(vtkLidarVoxelGrid, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  enum ModeType
+  {
+    //! Centroid of the voxel, averaged floating point arrays
+    AVERAGE = 0,
+    //! A point of the voxel picked at random
+    RANDOM = 1
+  };
+
+  //@{
+  /**
+   * Edge length of the voxels. Default is 0.1 m.
+   */
+  vtkSetClampMacro(VoxelSize, double, 1e-4, VTK_DOUBLE_MAX);
+  vtkGetMacro(VoxelSize, double);
+  //@}
+
+  //@{
+  /**
+   * How the point of a voxel is computed. Default is AVERAGE.
+   */
+  vtkSetClampMacro(Mode, int, AVERAGE, RANDOM);
+  vtkGetMacro(Mode, int);
+  //@}
+
+protected:
+  vtkLidarVoxelGrid() = default;
+  ~vtkLidarVoxelGrid() override = default;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  double VoxelSize = 0.1;
+  int Mode = AVERAGE;
+
+private:
+  vtkLidarVoxelGrid(const vtkLidarVoxelGrid&) = delete;
+  void operator=(const vtkLidarVoxelGrid&) = delete;
+};
+
+#endif // vtkLidarVoxelGrid_h
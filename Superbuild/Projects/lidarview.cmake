@@ -5,7 +5,7 @@ superbuild_add_project(lidarview
   CMAKE_ARGS
     #LidarView base configuration
     -DBUILD_SHARED_LIBS:BOOL=ON
-    -DBUILD_TESTING:BOOL=OFF
+    -DBUILD_TESTING:BOOL=${LIDARVIEW_BUILD_TESTING}
     -DLV_BUILD_PLATFORM=${LV_BUILD_PLATFORM}
     -Dsuperbuild_python_version=${superbuild_python_version}
     -DParaView_DIR:PATH=${SuperBuild_BINARY_DIR}/common-superbuild/paraview/build